@@ -193,7 +193,7 @@ namespace desc
 
 		for (std::uint32_t i = 0; i < imageCount; ++i)
 		{
-			writeDescSet[i + bufferCount] = create_write_desc_set(outDescriptorSet, imageInfos[i].binding, &imageInfos[i].imageInfo);
+			writeDescSet[i + bufferCount] = create_write_desc_set(outDescriptorSet, imageInfos[i].binding, &imageInfos[i].imageInfo, 1, imageInfos[i].type);
 		}
 		
 		// call update function for desc set
@@ -274,14 +274,15 @@ namespace desc
 		return desc;
 	}
 
-	VkWriteDescriptorSet create_write_desc_set( VkDescriptorSet descritporSet, std::uint32_t layoutBinding, VkDescriptorImageInfo* descImageInfos, std::uint32_t descriptorCount )
+	VkWriteDescriptorSet create_write_desc_set( VkDescriptorSet descritporSet, std::uint32_t layoutBinding, VkDescriptorImageInfo* descImageInfos, std::uint32_t descriptorCount,
+		VkDescriptorType descriptorType )
 	{
 		VkWriteDescriptorSet desc{};
 
 		desc.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
 		desc.dstSet = descritporSet;
 		desc.dstBinding = layoutBinding;
-		desc.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+		desc.descriptorType = descriptorType;
 		desc.descriptorCount = descriptorCount;
 		desc.pImageInfo = descImageInfos;
 
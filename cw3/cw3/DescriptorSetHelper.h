@@ -27,6 +27,7 @@ namespace desc
 		lut::Image* image;
 		VkDescriptorImageInfo imageInfo;
 		std::uint32_t binding;
+		VkDescriptorType type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
 	};
 
 	class DescriptorSetPack
@@ -67,5 +68,6 @@ namespace desc
 	VkDescriptorBufferInfo create_desc_buffer_info(VkBuffer buffer, VkDeviceSize range = VK_WHOLE_SIZE, VkDeviceSize offset = 0);
 	VkDescriptorImageInfo create_desc_image_info(VkImageView imageView, VkSampler sampler, VkImageLayout imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
 	VkWriteDescriptorSet create_write_desc_set(VkDescriptorSet descritporSet, std::uint32_t layoutBinding, VkDescriptorBufferInfo* descBufferInfos, std::uint32_t descriptorCount = 1);
-	VkWriteDescriptorSet create_write_desc_set(VkDescriptorSet descritporSet, std::uint32_t layoutBinding, VkDescriptorImageInfo* descImageInfos, std::uint32_t descriptorCount = 1);
+	VkWriteDescriptorSet create_write_desc_set(VkDescriptorSet descritporSet, std::uint32_t layoutBinding, VkDescriptorImageInfo* descImageInfos, std::uint32_t descriptorCount = 1,
+		VkDescriptorType descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER);
 }
\ No newline at end of file
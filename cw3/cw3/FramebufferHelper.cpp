@@ -31,13 +31,25 @@ void Attachment::create_image_buffer(lut::VulkanWindow const& aWindow, lut::Allo
 	imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
 
 
+	// Transient attachments never leave tile memory on tiled GPUs, so they
+	// may not need any memory at all. Devices without lazily allocated
+	// memory (most desktop GPUs) fall back to regular device memory.
 	VmaAllocationCreateInfo allocInfo{};
-	allocInfo.usage = VMA_MEMORY_USAGE_GPU_ONLY;
+	allocInfo.usage = (usage & VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT) ? VMA_MEMORY_USAGE_GPU_LAZILY_ALLOCATED : VMA_MEMORY_USAGE_GPU_ONLY;
 
 	VkImage image = VK_NULL_HANDLE;
 	VmaAllocation allocation = VK_NULL_HANDLE;
 
-	if (auto const res = vmaCreateImage(aAllocator.allocator, &imageInfo, &allocInfo, &image, &allocation, nullptr); res != VK_SUCCESS)
+	auto res = vmaCreateImage(aAllocator.allocator, &imageInfo, &allocInfo, &image, &allocation, nullptr);
+	if (VK_ERROR_FEATURE_NOT_PRESENT == res && VMA_MEMORY_USAGE_GPU_LAZILY_ALLOCATED == allocInfo.usage)
+	{
+		allocInfo.usage = VMA_MEMORY_USAGE_GPU_ONLY;
+		res = vmaCreateImage(aAllocator.allocator, &imageInfo, &allocInfo, &image, &allocation, nullptr);
+	}
+
+	lazilyAllocated = (VMA_MEMORY_USAGE_GPU_LAZILY_ALLOCATED == allocInfo.usage);
+
+	if (res != VK_SUCCESS)
 	{
 		throw lut::Error("Unable to allocate depth buffer image.\nvmaCreateImage() returned %s", lut::to_string(res).c_str());
 	}
@@ -72,229 +84,121 @@ void Attachment::create_image_buffer(lut::VulkanWindow const& aWindow, lut::Allo
 }
 
 
-
-FramebufferPack::FramebufferPack(lut::VulkanWindow const& aWindow, Attachment* inColorAttachments, 
-	unsigned int inColorAttachmentCount, VkImageLayout colorAttachdstLayout, Attachment* inDepthAttachment
-	,VkSubpassDependency* spDeps, std::uint32_t spDepCount)
-	:colorAttachments(inColorAttachments), colorAttachmentCount(inColorAttachmentCount), depthAttachment(std::move(inDepthAttachment)), framebuffer(), renderPass()
+DeferredFramebufferPack::DeferredFramebufferPack(lut::VulkanWindow const& aWindow, Attachment* inGBufferAttachments, unsigned int inGBufferAttachmentCount,
+	Attachment* inDepthAttachments, std::uint32_t inFrameCount, VkSubpassDependency* spDeps, std::uint32_t spDepCount)
+	:gbufferAttachmentCount(inGBufferAttachmentCount), frameCount(inFrameCount), gbufferAttachments(inGBufferAttachments), depthAttachments(inDepthAttachments), framebuffers(), renderPass()
 {
-	
-	create_render_pass(aWindow, colorAttachdstLayout, spDeps, spDepCount);
-	
+
+	create_render_pass(aWindow, spDeps, spDepCount);
+
 	create_framebuffer(aWindow);
 }
 
 
 
 
-void FramebufferPack::create_render_pass(lut::VulkanWindow const& aWindow, VkImageLayout colorAttachdstLayout, VkSubpassDependency* spDeps, std::uint32_t spDepCount)
+void DeferredFramebufferPack::create_render_pass(lut::VulkanWindow const& aWindow, VkSubpassDependency* spDeps, std::uint32_t spDepCount)
 {
-	if (renderPass.handle != VK_NULL_HANDLE)
-		throw lut::Error("Gonna overwrite the render pass...\n");
-
+	// Replaces the previous render pass, e.g., after the swapchain format
+	// changed; the framebuffers must be recreated afterwards
 
 	//------------//
 	// Attachment //
 	//------------//
-	unsigned int attachmentCount = (depthAttachment == nullptr) ? colorAttachmentCount : colorAttachmentCount + 1;
-
-	std::vector<VkAttachmentDescription> attachmentDescs(attachmentCount);
-
-	// for COLOR attachmenets ... >
-	std::vector<VkAttachmentReference> colorAttachmentRefs(colorAttachmentCount);
-
-	for (unsigned int i = 0; i < colorAttachmentCount; ++i)
+	std::uint32_t const depthIndex = gbufferAttachmentCount + 1;
+
+	std::vector<VkAttachmentDescription> attachmentDescs(gbufferAttachmentCount + 2);
+
+	// For the swapchain image... >
+	attachmentDescs[0].format = aWindow.swapchainFormat;
+	attachmentDescs[0].samples = VK_SAMPLE_COUNT_1_BIT;
+	attachmentDescs[0].loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+	attachmentDescs[0].storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+	attachmentDescs[0].stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+	attachmentDescs[0].stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+	attachmentDescs[0].initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+	attachmentDescs[0].finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+
+	// For the G-buffer attachments... >
+	// they are consumed within the render pass, so nothing is stored. All
+	// frame slots use the same formats.
+	std::vector<VkAttachmentReference> gbufferWriteRefs(gbufferAttachmentCount);
+	std::vector<VkAttachmentReference> gbufferReadRefs(gbufferAttachmentCount + 1);
+
+	for (unsigned int i = 0; i < gbufferAttachmentCount; ++i)
 	{
-
-		attachmentDescs[i].samples = VK_SAMPLE_COUNT_1_BIT; // no multisampling 
-
-		// load and store operations
-		attachmentDescs[i].loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
-		attachmentDescs[i].storeOp = VK_ATTACHMENT_STORE_OP_STORE;
-		attachmentDescs[i].stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
-		attachmentDescs[i].stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-		
-
-		// format
-		attachmentDescs[i].format = colorAttachments[i].format;
-
-		// layout
-		attachmentDescs[i].initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-		attachmentDescs[i].finalLayout = colorAttachdstLayout;// VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-		//attachmentDescs[i].finalLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
-
-		// attachment references
-		colorAttachmentRefs[i].attachment = i;
-		colorAttachmentRefs[i].layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
-
+		attachmentDescs[i + 1].format = gbufferAttachments[i].format;
+		attachmentDescs[i + 1].samples = VK_SAMPLE_COUNT_1_BIT;
+		attachmentDescs[i + 1].loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+		attachmentDescs[i + 1].storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+		attachmentDescs[i + 1].stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+		attachmentDescs[i + 1].stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+		attachmentDescs[i + 1].initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+		attachmentDescs[i + 1].finalLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+
+		gbufferWriteRefs[i].attachment = i + 1;
+		gbufferWriteRefs[i].layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+
+		gbufferReadRefs[i].attachment = i + 1;
+		gbufferReadRefs[i].layout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
 	}
 
-	// For DEPTH attachment... >
-	VkAttachmentReference depthAttachmentRef{};
+	// For the DEPTH attachment... >
+	attachmentDescs[depthIndex].format = depthAttachments[0].format;
+	attachmentDescs[depthIndex].samples = VK_SAMPLE_COUNT_1_BIT;
+	attachmentDescs[depthIndex].loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+	attachmentDescs[depthIndex].storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+	attachmentDescs[depthIndex].stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+	attachmentDescs[depthIndex].stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+	attachmentDescs[depthIndex].initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+	attachmentDescs[depthIndex].finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL;
 
-	if (depthAttachment != nullptr)
-	{
-		attachmentDescs[colorAttachmentCount].samples = VK_SAMPLE_COUNT_1_BIT; // no multisampling 
-
-		// load and store operations
-		attachmentDescs[colorAttachmentCount].loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
-		attachmentDescs[colorAttachmentCount].storeOp = VK_ATTACHMENT_STORE_OP_STORE;
-		attachmentDescs[colorAttachmentCount].stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
-		attachmentDescs[colorAttachmentCount].stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-
-		// format
-		attachmentDescs[colorAttachmentCount].format = depthAttachment->format;
-		// layout
-		attachmentDescs[colorAttachmentCount].initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-		attachmentDescs[colorAttachmentCount].finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
-		// reference
-		depthAttachmentRef.attachment = colorAttachmentCount;
-		depthAttachmentRef.layout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
-	}
+	VkAttachmentReference depthWriteRef{};
+	depthWriteRef.attachment = depthIndex;
+	depthWriteRef.layout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
 
+	// the depth is the last input attachment
+	gbufferReadRefs[gbufferAttachmentCount].attachment = depthIndex;
+	gbufferReadRefs[gbufferAttachmentCount].layout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL;
 
-	//------------//
-	// Subpass    //
-	//------------//
-
-	// create subpass
-	VkSubpassDescription subpasses[1]{};
-	subpasses[0].pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
-	subpasses[0].colorAttachmentCount = colorAttachmentCount; 
-	subpasses[0].pColorAttachments = colorAttachmentRefs.data();
-	if (depthAttachment != nullptr) subpasses[0].pDepthStencilAttachment = &depthAttachmentRef;
-
-	//VkSubpassDependency deps[1]{};
-	//deps[0].dependencyFlags = VK_DEPENDENCY_BY_REGION_BIT;
-	//deps[0].srcSubpass = 0; // == subpasses[0] declared above 
-	//deps[0].dstSubpass = VK_SUBPASS_EXTERNAL;
-	//deps[0].srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-	//deps[0].dstStageMask = VK_PIPELINE_STAGE_TRANSFER_BIT;
-	//deps[0].srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
-	//deps[0].dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
-
-	//-------------------------//
-	// Create render pass      //
-	//-------------------------//
-
-	VkRenderPassCreateInfo passInfo{};
-	passInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
-	passInfo.attachmentCount = attachmentCount;
-	passInfo.pAttachments = attachmentDescs.data();
-	passInfo.subpassCount = 1;
-	passInfo.pSubpasses = subpasses;
-	passInfo.dependencyCount = spDepCount;
-	passInfo.pDependencies = spDeps;
-
-	VkRenderPass rpass = VK_NULL_HANDLE;
-	if (auto const res = vkCreateRenderPass(aWindow.device, &passInfo, nullptr, &rpass); VK_SUCCESS != res)
-	{
-
-		throw lut::Error("Unable to create render pass\n"
-			"vkCreateRenderPass() returned %s", lut::to_string(res).c_str()
-		);
-
-	}
-
-	renderPass = lut::RenderPass(aWindow.device, rpass);
-}
-
-
-
-
-void FramebufferPack::create_framebuffer(lut::VulkanWindow const& aWindow)
-{
-	std::vector<VkImageView> imageViews(depthAttachment== nullptr?colorAttachmentCount:(colorAttachmentCount + 1));
-
-	for (unsigned int i = 0; i < colorAttachmentCount; ++i)
-	{
-
-		imageViews[i] = colorAttachments[i].imageView.handle;
-	}
-
-	if(depthAttachment != nullptr) imageViews[colorAttachmentCount] = depthAttachment->imageView.handle;
-
-
-	VkFramebufferCreateInfo fbInfo{};
-
-	fbInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
-	fbInfo.flags = 0;
-	fbInfo.renderPass = renderPass.handle;
-	fbInfo.attachmentCount = (depthAttachment == nullptr ? colorAttachmentCount : (colorAttachmentCount + 1)); // two attachment for one image
-	fbInfo.pAttachments = imageViews.data();
-	fbInfo.width = aWindow.swapchainExtent.width;
-	fbInfo.height = aWindow.swapchainExtent.height;
-	fbInfo.layers = 1;
-
-	VkFramebuffer fb = VK_NULL_HANDLE;
-
-	if (auto const res = vkCreateFramebuffer(aWindow.device, &fbInfo, nullptr, &fb); res != VK_SUCCESS)
-	{
-		throw lut::Error(
-			"Unable to create framebuffer\n"
-			"vkCreateFramebuffer() returned %s", lut::to_string(res).c_str()
-		);
-
-	}
-
-	framebuffer = lut::Framebuffer(aWindow.device, fb);
-}
-
-
-
-
-SwapChainFramebufferPack::SwapChainFramebufferPack(lut::VulkanWindow const& aWindow, VkSubpassDependency* spDeps, std::uint32_t spDepCount )
-{
-	
-	create_render_pass(aWindow, spDeps, spDepCount);
-
-	create_framebuffer(aWindow);
-
-}
-
-
-
-
-
-void SwapChainFramebufferPack::create_render_pass(lut::VulkanWindow const& aWindow, VkSubpassDependency* spDeps, std::uint32_t spDepCount)
-{
-	if (renderPass.handle != VK_NULL_HANDLE)
-		throw lut::Error("Gonna overwrite the render pass...\n");
+	VkAttachmentReference swapchainRef{};
+	swapchainRef.attachment = 0;
+	swapchainRef.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
 
 
 	//------------//
-	// Attachment //
+	// Subpass    //
 	//------------//
-	VkAttachmentDescription attachments[1]{}; // ONLY ONE attachment
 
-	// For attachment 0
-	attachments[0].format = aWindow.swapchainFormat; // VK FORMAT R8G8B8A8 SRGB 
-	attachments[0].samples = VK_SAMPLE_COUNT_1_BIT; // no multisampling 
-	// load and store operations
-	attachments[0].loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
-	attachments[0].storeOp = VK_ATTACHMENT_STORE_OP_STORE;
-	// layout
-	attachments[0].initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-	attachments[0].finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+	VkSubpassDescription subpasses[2]{};
 
-	// create attachment reference
-	VkAttachmentReference colorAttachments[1]{};
-	colorAttachments[0].attachment = 0; // the zero refers to attachments[0] declared earlier.
-	//specify the layout for attachment image
-	colorAttachments[0].layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+	// G-buffer
+	subpasses[kGBufferSubpass].pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+	subpasses[kGBufferSubpass].colorAttachmentCount = gbufferAttachmentCount;
+	subpasses[kGBufferSubpass].pColorAttachments = gbufferWriteRefs.data();
+	subpasses[kGBufferSubpass].pDepthStencilAttachment = &depthWriteRef;
 
+	// lighting
+	subpasses[kLightingSubpass].pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+	subpasses[kLightingSubpass].inputAttachmentCount = std::uint32_t(gbufferReadRefs.size());
+	subpasses[kLightingSubpass].pInputAttachments = gbufferReadRefs.data();
+	subpasses[kLightingSubpass].colorAttachmentCount = 1;
+	subpasses[kLightingSubpass].pColorAttachments = &swapchainRef;
 
+	// Each fragment of the lighting subpass only reads the G-buffer at its
+	// own position, so the dependency is by region: on tiled GPUs, the
+	// G-buffer never leaves tile memory
+	std::vector<VkSubpassDependency> deps(spDeps, spDeps + spDepCount);
 
-	//------------//
-	// Subpass    //
-	//------------//
+	VkSubpassDependency& gbufferToLighting = deps.emplace_back();
+	gbufferToLighting.srcSubpass = kGBufferSubpass;
+	gbufferToLighting.dstSubpass = kLightingSubpass;
+	gbufferToLighting.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+	gbufferToLighting.dstStageMask = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+	gbufferToLighting.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+	gbufferToLighting.dstAccessMask = VK_ACCESS_INPUT_ATTACHMENT_READ_BIT;
+	gbufferToLighting.dependencyFlags = VK_DEPENDENCY_BY_REGION_BIT;
 
-	// create subpass
-	VkSubpassDescription subpasses[1]{};
-	subpasses[0].pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
-	subpasses[0].colorAttachmentCount = 1; 
-	subpasses[0].pColorAttachments = colorAttachments;
-	
 
 	//-------------------------//
 	// Create render pass      //
@@ -302,12 +206,12 @@ void SwapChainFramebufferPack::create_render_pass(lut::VulkanWindow const& aWind
 
 	VkRenderPassCreateInfo passInfo{};
 	passInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
-	passInfo.attachmentCount = 1;
-	passInfo.pAttachments = attachments;
-	passInfo.subpassCount = 1;
+	passInfo.attachmentCount = std::uint32_t(attachmentDescs.size());
+	passInfo.pAttachments = attachmentDescs.data();
+	passInfo.subpassCount = 2;
 	passInfo.pSubpasses = subpasses;
-	passInfo.dependencyCount = spDepCount;
-	passInfo.pDependencies = spDeps;
+	passInfo.dependencyCount = std::uint32_t(deps.size());
+	passInfo.pDependencies = deps.data();
 
 	VkRenderPass rpass = VK_NULL_HANDLE;
 	if (auto const res = vkCreateRenderPass(aWindow.device, &passInfo, nullptr, &rpass); VK_SUCCESS != res)
@@ -323,41 +227,47 @@ void SwapChainFramebufferPack::create_render_pass(lut::VulkanWindow const& aWind
 }
 
 
-void SwapChainFramebufferPack::create_framebuffer(lut::VulkanWindow const& aWindow)
+void DeferredFramebufferPack::create_framebuffer(lut::VulkanWindow const& aWindow)
 {
 	framebuffers.clear();
+	framebuffers.resize(frameCount);
+
+	std::vector<VkImageView> imageViews(gbufferAttachmentCount + 2);
 
-	for (std::uint32_t i = 0; i < aWindow.swapViews.size(); i++)
+	for (std::uint32_t frame = 0; frame < frameCount; ++frame)
 	{
+		for (unsigned int i = 0; i < gbufferAttachmentCount; ++i)
+			imageViews[i + 1] = gbufferAttachments[frame * gbufferAttachmentCount + i].imageView.handle;
 
-		VkFramebufferCreateInfo fbInfo{};
+		imageViews[gbufferAttachmentCount + 1] = depthAttachments[frame].imageView.handle;
 
-		fbInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
-		fbInfo.flags = 0;
-		fbInfo.renderPass = renderPass.handle;
-		fbInfo.attachmentCount = 1; 
-		fbInfo.pAttachments = &aWindow.swapViews[i];
-		fbInfo.width = aWindow.swapchainExtent.width;
-		fbInfo.height = aWindow.swapchainExtent.height;
-		fbInfo.layers = 1;
+		for (std::uint32_t i = 0; i < aWindow.swapViews.size(); i++)
+		{
+			imageViews[0] = aWindow.swapViews[i];
 
-		VkFramebuffer fb = VK_NULL_HANDLE;
+			VkFramebufferCreateInfo fbInfo{};
 
-		if (auto const res = vkCreateFramebuffer(aWindow.device, &fbInfo, nullptr, &fb); res != VK_SUCCESS)
-		{
-			throw lut::Error(
-				"Unable to create framebuffer for swap chain image %zu\n"
-				"vkCreateFramebuffer() returned %s", i, lut::to_string(res).c_str()
-			);
+			fbInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+			fbInfo.flags = 0;
+			fbInfo.renderPass = renderPass.handle;
+			fbInfo.attachmentCount = std::uint32_t(imageViews.size());
+			fbInfo.pAttachments = imageViews.data();
+			fbInfo.width = aWindow.swapchainExtent.width;
+			fbInfo.height = aWindow.swapchainExtent.height;
+			fbInfo.layers = 1;
 
-		}
+			VkFramebuffer fb = VK_NULL_HANDLE;
 
+			if (auto const res = vkCreateFramebuffer(aWindow.device, &fbInfo, nullptr, &fb); res != VK_SUCCESS)
+			{
+				throw lut::Error(
+					"Unable to create framebuffer for frame slot %u, swap chain image %u\n"
+					"vkCreateFramebuffer() returned %s", frame, i, lut::to_string(res).c_str()
+				);
 
-		framebuffers.emplace_back(lut::Framebuffer(aWindow.device, fb));
+			}
 
+			framebuffers[frame].emplace_back(lut::Framebuffer(aWindow.device, fb));
+		}
 	}
-	if (framebuffers.size() != aWindow.swapViews.size())
-	{
-		throw lut::Error("The number of framebuffers doesn't match with the number of swapviews.\n");
-	}
-}
\ No newline at end of file
+}
@@ -16,6 +16,8 @@ struct Attachment
 	lut::ImageView imageView;
 	// image format
 	VkFormat format;
+	// whether a transient attachment got lazily allocated memory
+	bool lazilyAllocated = false;
 
 
 	Attachment(lut::VulkanWindow const& aWindow, lut::Allocator const& aAllocator,
@@ -26,40 +28,34 @@ struct Attachment
 };
 
 
-class FramebufferPack
+// G-buffer and lighting in one render pass. Each frame slot has its own
+// G-buffer attachments, such that frames in flight don't wait for each
+// other's G-buffer, and one framebuffer per swapchain image. Subpass 0 writes the G-buffer attachments and the depth
+// attachment; subpass 1 reads them as input attachments, at the fragment
+// that it shades, and writes the swapchain image. The G-buffer contents are
+// not stored at the end of the pass, so the attachments may be transient.
+//
+// Attachment order: swapchain image, G-buffer attachments, depth.
+class DeferredFramebufferPack
 {
 
 public:
-	//	---	Parameters ---  //
-	unsigned int colorAttachmentCount;
-	Attachment* colorAttachments;
-	Attachment* depthAttachment;
-	lut::Framebuffer framebuffer;
-	lut::RenderPass renderPass;
-
-
-	//	---	Constructors ---  //
-	FramebufferPack(lut::VulkanWindow const& aWindow, Attachment* inColorAttachments, unsigned int inColorAttachmentCount, VkImageLayout colorAttachdstLayout, Attachment* inDepthAttachment,
-		VkSubpassDependency* spDeps = nullptr, std::uint32_t spDepCount = 0);
-
-
-	//	---	Functions ---  //
-	void create_render_pass(lut::VulkanWindow const& aWindow, VkImageLayout colorAttachdstLayout, VkSubpassDependency* spDeps = nullptr, std::uint32_t spDependCount = 0);
-	
-	void create_framebuffer(lut::VulkanWindow const& aWindow);
-	
-};
+	static constexpr std::uint32_t kGBufferSubpass = 0;
+	static constexpr std::uint32_t kLightingSubpass = 1;
 
-class SwapChainFramebufferPack
-{
-
-public:
 	//	---	Parameters ---  //
-	std::vector<lut::Framebuffer> framebuffers;
+	unsigned int gbufferAttachmentCount;
+	std::uint32_t frameCount;
+	Attachment* gbufferAttachments; // [frame slot * gbufferAttachmentCount + i]
+	Attachment* depthAttachments; // [frame slot]
+	std::vector<std::vector<lut::Framebuffer>> framebuffers; // [frame slot][swapchain image]
 	lut::RenderPass renderPass;
 
+
 	//	---	Constructors ---  //
-	SwapChainFramebufferPack(lut::VulkanWindow const& aWindow, VkSubpassDependency* spDeps = nullptr, std::uint32_t spDepCount = 0);
+	// spDeps are added to the dependency between the two subpasses
+	DeferredFramebufferPack(lut::VulkanWindow const& aWindow, Attachment* inGBufferAttachments, unsigned int inGBufferAttachmentCount, Attachment* inDepthAttachments,
+		std::uint32_t inFrameCount, VkSubpassDependency* spDeps = nullptr, std::uint32_t spDepCount = 0);
 
 
 	//	---	Functions ---  //
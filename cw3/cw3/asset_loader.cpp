@@ -0,0 +1,139 @@
+#include "asset_loader.hpp"
+
+#include <chrono>
+#include <utility>
+
+#include <cstdio>
+
+#include "../labutils/vkutil.hpp"
+#include "../labutils/upload_batch.hpp"
+namespace lut = labutils;
+
+#include "model.hpp"
+
+namespace
+{
+	// Number of finished meshes that can wait for the render thread. The
+	// loader thread waits if the render thread falls behind.
+	constexpr std::size_t kQueueCapacity = 16;
+
+	constexpr auto kQueueFullWait = std::chrono::milliseconds( 1 );
+}
+
+AssetLoader::AssetLoader( lut::VulkanWindow const& aWindow, lut::Allocator const& aAllocator, lut::GeometryArena& aArena, lut::SamplerCache& aSamplers, std::vector<std::string> aModelPaths, VkDescriptorSetLayout aTextureSetLayout, MaterialTable& aMaterials, BindlessTextureTable* aBindless )
+	: mWindow( aWindow )
+	, mAllocator( aAllocator )
+	, mArena( aArena )
+	, mModelPaths( std::move(aModelPaths) )
+	, mMaterials( aMaterials )
+	, mPool( lut::create_descriptor_pool( aWindow ) )
+	, mTextures( aWindow, aAllocator, aSamplers, aTextureSetLayout, mPool.handle, aBindless )
+	, mQueue( kQueueCapacity )
+{
+	mThread = std::thread( [this] { run_(); } );
+}
+
+AssetLoader::~AssetLoader()
+{
+	stop();
+}
+
+
+std::size_t AssetLoader::poll( std::vector<std::vector<ModelVertexTexturePack>>& aModels )
+{
+	// Check for completion first: if the loader has finished, everything it
+	// pushed is visible to the loop below.
+	bool const finished = mFinished.load( std::memory_order_acquire );
+
+	std::size_t count = 0;
+	while( auto mesh = mQueue.try_pop() )
+	{
+		if( aModels.size() <= mesh->modelIndex )
+			aModels.resize( mesh->modelIndex+1 );
+
+		aModels[mesh->modelIndex].emplace_back( std::move(mesh->pack) );
+		++count;
+	}
+
+	if( finished && !mDone )
+	{
+		if( mError )
+			std::rethrow_exception( std::exchange( mError, nullptr ) );
+
+		mDone = true;
+	}
+
+	return count;
+}
+
+bool AssetLoader::done() const noexcept
+{
+	return mDone;
+}
+
+void AssetLoader::stop() noexcept
+{
+	mStopRequested.store( true, std::memory_order_relaxed );
+
+	if( mThread.joinable() )
+		mThread.join();
+}
+
+
+void AssetLoader::run_()
+{
+	try
+	{
+		// The batch is only used by this thread
+		lut::UploadBatch batch( mWindow, mAllocator );
+
+		for( std::size_t modelIndex = 0; modelIndex < mModelPaths.size(); ++modelIndex )
+		{
+			if( mStopRequested.load( std::memory_order_relaxed ) )
+				break;
+
+			ModelData model = load_obj_model( mModelPaths[modelIndex] );
+
+			// Decode the model's textures in the background. The meshes pick
+			// them up in create_model_attribute_set().
+			for( auto const& mesh : model.meshes )
+			{
+				auto const& path = model.materials[mesh.materialIndex].mapDiffuse;
+				if( !path.empty() )
+					mTextures.prefetch( path );
+			}
+
+			// Record the uploads of all meshes of the model, and submit them
+			// together. The meshes are handed over once the uploads completed.
+			std::vector<LoadedMesh_> meshes;
+			for( std::size_t meshIndex = 0; meshIndex < model.meshes.size(); ++meshIndex )
+			{
+				if( mStopRequested.load( std::memory_order_relaxed ) )
+					break;
+
+				meshes.emplace_back( LoadedMesh_{ modelIndex, create_model_attribute_set( mArena, batch, model, mTextures, mMaterials, unsigned(meshIndex) ) } );
+			}
+
+			batch.flush();
+
+			for( auto& mesh : meshes )
+			{
+				while( !mQueue.try_push( std::move(mesh) ) )
+				{
+					if( mStopRequested.load( std::memory_order_relaxed ) )
+						break;
+
+					std::this_thread::sleep_for( kQueueFullWait );
+				}
+			}
+		}
+
+		std::printf( "Asset loader: %zu meshes use %zu distinct textures\n", mTextures.requests(), mTextures.created() );
+	}
+	catch( ... )
+	{
+		mError = std::current_exception();
+	}
+
+	mFinished.store( true, std::memory_order_release );
+}
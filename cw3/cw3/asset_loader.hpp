@@ -0,0 +1,97 @@
+#pragma once
+
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+#include <exception>
+
+#include <cstddef>
+
+#include "../labutils/vkobject.hpp"
+#include "../labutils/allocator.hpp"
+#include "../labutils/geometry_arena.hpp"
+#include "../labutils/sampler_cache.hpp"
+#include "../labutils/vulkan_window.hpp"
+
+#include "vertex_data.h"
+#include "shared_texture_cache.hpp"
+#include "material_table.hpp"
+#include "spsc_queue.hpp"
+
+/* Loads models on a background thread, such that rendering can start before
+ * all of the assets are available.
+ *
+ * The loader thread loads each model with load_obj_model() and records the
+ * uploads of its meshes with create_model_attribute_set() into an
+ * UploadBatch, which is submitted once per model. Finished meshes are
+ * handed to the render thread through a lock-free SpscQueue; the render
+ * thread picks them up with poll() once per frame. Meshes that haven't
+ * arrived yet are simply not drawn.
+ *
+ * Meshes that use the same texture share it through a SharedTextureCache,
+ * which decodes the textures of a model on a pool of worker threads while
+ * the loader thread records the uploads.
+ * The loader allocates its descriptor sets from its own pool, since pools
+ * are externally synchronized. Queue submissions on either thread must hold
+ * VulkanContext::queueMutex.
+ */
+class AssetLoader
+{
+	public:
+		// Starts loading the models at aModelPaths, in order. The window,
+		// allocator, arena, sampler cache, texture set layout, material table
+		// and bindless table must outlive the loader. Textures go into
+		// aBindless if it is given; see SharedTextureCache.
+		AssetLoader( labutils::VulkanWindow const&, labutils::Allocator const&, labutils::GeometryArena&, labutils::SamplerCache&, std::vector<std::string> aModelPaths,
+			VkDescriptorSetLayout aTextureSetLayout, MaterialTable&, BindlessTextureTable* aBindless = nullptr );
+
+		// Stops the loader thread (see stop()).
+		~AssetLoader();
+
+		AssetLoader( AssetLoader const& ) = delete;
+		AssetLoader& operator= (AssetLoader const&) = delete;
+
+	public:
+		// Appends the meshes that have finished loading since the last call
+		// to aModels[i], where i is the index of the model's path. Returns the
+		// number of new meshes. Rethrows any error from the loader thread.
+		std::size_t poll( std::vector<std::vector<ModelVertexTexturePack>>& aModels );
+
+		// True once all meshes have been handed over by poll().
+		bool done() const noexcept;
+
+		// Asks the loader thread to stop after the current mesh, and waits
+		// for it to do so. Must be called before waiting for the device to
+		// go idle at shutdown.
+		void stop() noexcept;
+
+	private:
+		struct LoadedMesh_
+		{
+			std::size_t modelIndex;
+			ModelVertexTexturePack pack;
+		};
+
+		void run_();
+
+	private:
+		labutils::VulkanWindow const& mWindow;
+		labutils::Allocator const& mAllocator;
+		labutils::GeometryArena& mArena;
+
+		std::vector<std::string> mModelPaths;
+		MaterialTable& mMaterials;
+
+		labutils::DescriptorPool mPool;
+		SharedTextureCache mTextures; // uses mPool
+
+		SpscQueue<LoadedMesh_> mQueue;
+
+		std::atomic<bool> mStopRequested{ false };
+		std::atomic<bool> mFinished{ false }; // written by the loader thread
+		bool mDone = false;                   // all meshes received by poll()
+		std::exception_ptr mError;            // valid once mFinished is set
+
+		std::thread mThread;
+};
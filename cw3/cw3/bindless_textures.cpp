@@ -0,0 +1,160 @@
+#include "bindless_textures.hpp"
+
+#include <algorithm>
+
+#include "../labutils/error.hpp"
+#include "../labutils/to_string.hpp"
+namespace lut = labutils;
+
+namespace
+{
+	constexpr VkDescriptorBindingFlags kBindlessBindingFlags = VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT
+		| VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT
+		| VK_DESCRIPTOR_BINDING_UPDATE_UNUSED_WHILE_PENDING_BIT;
+}
+
+BindlessTextureTable::BindlessTextureTable( lut::VulkanContext const& aContext, VkDescriptorSetLayout aLayout, std::uint32_t aCapacity )
+	: mContext( aContext )
+	, mCapacity( aCapacity )
+{
+	VkDescriptorPoolSize poolSize{};
+	poolSize.type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	poolSize.descriptorCount = aCapacity;
+
+	VkDescriptorPoolCreateInfo poolInfo{};
+	poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+	poolInfo.flags = VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT;
+	poolInfo.maxSets = 1;
+	poolInfo.poolSizeCount = 1;
+	poolInfo.pPoolSizes = &poolSize;
+
+	VkDescriptorPool pool = VK_NULL_HANDLE;
+	if( auto const res = vkCreateDescriptorPool( aContext.device, &poolInfo, nullptr, &pool ); VK_SUCCESS != res )
+	{
+		throw lut::Error( "Unable to create bindless descriptor pool\n"
+			"vkCreateDescriptorPool() returned %s", lut::to_string(res).c_str() );
+	}
+
+	mPool = lut::DescriptorPool( aContext.device, pool );
+
+	VkDescriptorSetAllocateInfo allocInfo{};
+	allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+	allocInfo.descriptorPool = mPool.handle;
+	allocInfo.descriptorSetCount = 1;
+	allocInfo.pSetLayouts = &aLayout;
+
+	if( auto const res = vkAllocateDescriptorSets( aContext.device, &allocInfo, &mSet ); VK_SUCCESS != res )
+	{
+		throw lut::Error( "Unable to allocate bindless descriptor set\n"
+			"vkAllocateDescriptorSets() returned %s", lut::to_string(res).c_str() );
+	}
+}
+
+
+std::uint32_t BindlessTextureTable::add( VkImageView aView, VkSampler aSampler )
+{
+	std::lock_guard<std::mutex> lock( mMutex );
+
+	std::uint32_t index;
+	if( !mFree.empty() )
+	{
+		index = mFree.back();
+		mFree.pop_back();
+	}
+	else if( mNext < mCapacity )
+	{
+		index = mNext++;
+	}
+	else
+	{
+		throw lut::Error( "Bindless texture table is full (%u textures)", mCapacity );
+	}
+
+	VkDescriptorImageInfo imageInfo{};
+	imageInfo.sampler = aSampler;
+	imageInfo.imageView = aView;
+	imageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+
+	VkWriteDescriptorSet desc{};
+	desc.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+	desc.dstSet = mSet;
+	desc.dstBinding = 0;
+	desc.dstArrayElement = index;
+	desc.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	desc.descriptorCount = 1;
+	desc.pImageInfo = &imageInfo;
+
+	// Writes to the set are externally synchronized; the mutex covers this
+	vkUpdateDescriptorSets( mContext.device, 1, &desc, 0, nullptr );
+
+	return index;
+}
+
+void BindlessTextureTable::release( std::uint32_t aIndex )
+{
+	std::lock_guard<std::mutex> lock( mMutex );
+	mFree.emplace_back( aIndex );
+}
+
+VkDescriptorSet BindlessTextureTable::set() const noexcept
+{
+	return mSet;
+}
+std::uint32_t BindlessTextureTable::capacity() const noexcept
+{
+	return mCapacity;
+}
+
+
+std::uint32_t bindless_texture_capacity( lut::VulkanContext const& aContext )
+{
+	VkPhysicalDeviceDescriptorIndexingProperties indexingProps{};
+	indexingProps.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_PROPERTIES;
+
+	VkPhysicalDeviceProperties2 props{};
+	props.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+	props.pNext = &indexingProps;
+	vkGetPhysicalDeviceProperties2( aContext.physicalDevice, &props );
+
+	// The G-buffer pipeline has no other samplers, so the whole per-stage
+	// budget is available to the table
+	std::uint32_t const limit = std::min( {
+		indexingProps.maxDescriptorSetUpdateAfterBindSampledImages,
+		indexingProps.maxDescriptorSetUpdateAfterBindSamplers,
+		indexingProps.maxPerStageDescriptorUpdateAfterBindSampledImages,
+		indexingProps.maxPerStageDescriptorUpdateAfterBindSamplers,
+		indexingProps.maxPerStageUpdateAfterBindResources
+	} );
+
+	return std::min( kMaxBindlessTextures, limit );
+}
+
+lut::DescriptorSetLayout create_bindless_texture_layout( lut::VulkanContext const& aContext, std::uint32_t aCapacity )
+{
+	VkDescriptorSetLayoutBinding binding{};
+	binding.binding = 0;
+	binding.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	binding.descriptorCount = aCapacity;
+	binding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+
+	VkDescriptorSetLayoutBindingFlagsCreateInfo flagsInfo{};
+	flagsInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO;
+	flagsInfo.bindingCount = 1;
+	flagsInfo.pBindingFlags = &kBindlessBindingFlags;
+
+	VkDescriptorSetLayoutCreateInfo layoutInfo{};
+	layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+	layoutInfo.pNext = &flagsInfo;
+	layoutInfo.flags = VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT;
+	layoutInfo.bindingCount = 1;
+	layoutInfo.pBindings = &binding;
+
+	VkDescriptorSetLayout layout = VK_NULL_HANDLE;
+	if( auto const res = vkCreateDescriptorSetLayout( aContext.device, &layoutInfo, nullptr, &layout ); VK_SUCCESS != res )
+	{
+		throw lut::Error( "Unable to create bindless descriptor set layout\n"
+			"vkCreateDescriptorSetLayout() returned %s", lut::to_string(res).c_str() );
+	}
+
+	return lut::DescriptorSetLayout( aContext.device, layout );
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <volk/volk.h>
+
+#include <mutex>
+#include <vector>
+
+#include <cstdint>
+
+#include "../labutils/vkobject.hpp"
+#include "../labutils/vulkan_context.hpp"
+
+/* All textures in one descriptor set, as an array of combined image samplers
+ * that shaders index with a per-draw value (MeshPushConstants::textureIndex).
+ * The set is bound once per frame instead of once per mesh.
+ *
+ * Textures are added while the set is in use: the binding is created with
+ * UPDATE_AFTER_BIND, PARTIALLY_BOUND and UPDATE_UNUSED_WHILE_PENDING, so
+ * slots that no pending draw uses can be written at any time, and slots that
+ * were never written don't need to be valid. This needs
+ * VulkanContext::descriptorIndexing; without it, each texture gets its own
+ * set instead (see SharedTextureCache).
+ *
+ * add() and release() are thread safe.
+ */
+class BindlessTextureTable
+{
+	public:
+		// The layout (see create_bindless_texture_layout()) and the context
+		// must outlive the table.
+		BindlessTextureTable( labutils::VulkanContext const&, VkDescriptorSetLayout, std::uint32_t aCapacity );
+
+		BindlessTextureTable( BindlessTextureTable const& ) = delete;
+		BindlessTextureTable& operator= (BindlessTextureTable const&) = delete;
+
+	public:
+		// Writes the view and sampler into a free slot, and returns its index.
+		// Throws an Error if all slots are in use.
+		std::uint32_t add( VkImageView, VkSampler );
+
+		// Returns a slot to the table. The slot must no longer be used by
+		// pending draws once it is added again.
+		void release( std::uint32_t aIndex );
+
+		VkDescriptorSet set() const noexcept;
+		std::uint32_t capacity() const noexcept;
+
+	private:
+		labutils::VulkanContext const& mContext;
+		std::uint32_t mCapacity;
+
+		labutils::DescriptorPool mPool;
+		VkDescriptorSet mSet = VK_NULL_HANDLE;
+
+		std::mutex mMutex;
+		std::vector<std::uint32_t> mFree; // released slots
+		std::uint32_t mNext = 0;          // first slot that was never used
+};
+
+// Number of slots in a table: kMaxBindlessTextures, or less if the device's
+// update-after-bind limits are lower. Requires VulkanContext::descriptorIndexing.
+constexpr std::uint32_t kMaxBindlessTextures = 4096;
+std::uint32_t bindless_texture_capacity( labutils::VulkanContext const& );
+
+// Set layout with a single binding (0) of aCapacity combined image samplers,
+// visible to fragment shaders.
+labutils::DescriptorSetLayout create_bindless_texture_layout( labutils::VulkanContext const&, std::uint32_t aCapacity );
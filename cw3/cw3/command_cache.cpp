@@ -0,0 +1,53 @@
+#include "command_cache.hpp"
+
+#include <cassert>
+
+CommandCache::CommandCache( labutils::VulkanContext const& aContext, std::uint32_t aKeyCount, std::uint32_t aSlotCount, std::size_t aThreadCount )
+	: mSlotCount( aSlotCount )
+	, mGenerations( aKeyCount, 1 )
+	, mEntries( std::size_t(aKeyCount) * aSlotCount )
+	, mRecorder( aContext, aKeyCount * aSlotCount, aThreadCount )
+{}
+
+
+std::vector<VkCommandBuffer> const& CommandCache::get( std::uint32_t aKey, std::uint32_t aSlot, VkCommandBufferInheritanceInfo const& aInheritance,
+	std::size_t aCount, RangeRecorder const& aRecord )
+{
+	assert( aKey < mGenerations.size() && aSlot < mSlotCount );
+	std::uint32_t const target = aKey * mSlotCount + aSlot;
+	Entry_& entry = mEntries[target];
+
+	if( entry.generation == mGenerations[aKey] )
+	{
+		++mStats.reused;
+		return entry.buffers;
+	}
+
+	// Mark the entry as stale while recording, in case aRecord throws
+	entry.generation = 0;
+	entry.buffers = mRecorder.record( target, aInheritance, aCount, aRecord );
+	entry.generation = mGenerations[aKey];
+	++mStats.recorded;
+
+	return entry.buffers;
+}
+
+void CommandCache::invalidate() noexcept
+{
+	for( auto& generation : mGenerations )
+		++generation;
+}
+void CommandCache::invalidate( std::uint32_t aKey ) noexcept
+{
+	assert( aKey < mGenerations.size() );
+	++mGenerations[aKey];
+}
+
+CommandCache::Stats const& CommandCache::stats() const noexcept
+{
+	return mStats;
+}
+void CommandCache::reset_stats() noexcept
+{
+	mStats = Stats{};
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <volk/volk.h>
+
+#include <vector>
+
+#include <cstdint>
+
+#include "../labutils/vulkan_context.hpp"
+
+#include "parallel_recorder.hpp"
+
+/* Secondary command buffers that are recorded once and then executed every
+ * frame, until the commands they contain change.
+ *
+ * The buffers are organized by key (e.g., the model that is drawn) and by
+ * frame slot (see FrameScheduler): a buffer may only be re-recorded once the
+ * GPU has finished the primary command buffer that executed it, and
+ * descriptor sets that differ per frame slot are baked into it. Each key has
+ * a generation counter; invalidate() bumps it, and get() re-records the
+ * buffers that were recorded in an older generation.
+ *
+ * Each entry may consist of several buffers, which are recorded in parallel
+ * by a ParallelRecorder.
+ */
+class CommandCache
+{
+	public:
+		using RangeRecorder = ParallelRecorder::RangeRecorder;
+
+		struct Stats
+		{
+			std::uint64_t recorded = 0;
+			std::uint64_t reused = 0;
+		};
+
+	public:
+		// Entries are recorded on aThreadCount threads (see ParallelRecorder).
+		// The context must outlive the cache.
+		CommandCache( labutils::VulkanContext const&, std::uint32_t aKeyCount, std::uint32_t aSlotCount, std::size_t aThreadCount = 0 );
+
+		CommandCache( CommandCache const& ) = delete;
+		CommandCache& operator= (CommandCache const&) = delete;
+
+	public:
+		// Returns the buffers of (aKey, aSlot), to be executed in order. If
+		// they were invalidated since they were last recorded, aRecord
+		// records aCount items into them again, in the subpass described by
+		// aInheritance. The caller must ensure that the slot's previous
+		// submission has completed.
+		std::vector<VkCommandBuffer> const& get( std::uint32_t aKey, std::uint32_t aSlot, VkCommandBufferInheritanceInfo const& aInheritance,
+			std::size_t aCount, RangeRecorder const& aRecord );
+
+		// Invalidates the buffers of all keys, or of aKey only
+		void invalidate() noexcept;
+		void invalidate( std::uint32_t aKey ) noexcept;
+
+		Stats const& stats() const noexcept;
+		void reset_stats() noexcept;
+
+	private:
+		struct Entry_
+		{
+			std::vector<VkCommandBuffer> buffers;
+			std::uint64_t generation = 0; // 0: never recorded
+		};
+
+		std::uint32_t mSlotCount;
+
+		std::vector<std::uint64_t> mGenerations; // per key, starting at 1
+		std::vector<Entry_> mEntries;            // [key * mSlotCount + slot]
+
+		Stats mStats;
+
+		ParallelRecorder mRecorder; // one target per entry
+};
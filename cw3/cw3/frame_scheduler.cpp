@@ -0,0 +1,75 @@
+#include "frame_scheduler.hpp"
+
+#include <chrono>
+#include <algorithm>
+
+#include <cassert>
+
+#include "../labutils/vkutil.hpp"
+#include "../labutils/timeline.hpp"
+namespace lut = labutils;
+
+FrameScheduler::FrameScheduler( lut::VulkanContext const& aContext, VkCommandPool aPool, std::uint32_t aFramesInFlight )
+	: mContext( aContext )
+	, mIndex( aFramesInFlight-1 ) // the first begin_frame() moves to slot 0
+{
+	assert( aFramesInFlight > 0 );
+
+	mFrames.reserve( aFramesInFlight );
+	for( std::uint32_t i = 0; i < aFramesInFlight; ++i )
+	{
+		mFrames.emplace_back( Frame{
+			lut::alloc_command_buffer( aContext, aPool ),
+			0,
+			lut::create_semaphore( aContext ),
+			lut::create_semaphore( aContext )
+		} );
+	}
+}
+
+
+FrameScheduler::Frame& FrameScheduler::begin_frame()
+{
+	mIndex = (mIndex+1) % mFrames.size();
+	Frame& frame = mFrames[mIndex];
+
+	auto const waitStart = std::chrono::steady_clock::now();
+
+	mContext.timelines->graphics.wait( frame.graphicsValue );
+
+	double const waitMs = std::chrono::duration<double, std::milli>( std::chrono::steady_clock::now() - waitStart ).count();
+
+	++mWaitStats.frames;
+	mWaitStats.totalMs += waitMs;
+	mWaitStats.maxMs = std::max( mWaitStats.maxMs, waitMs );
+
+	return frame;
+}
+
+void FrameScheduler::mark_submitted( std::uint64_t aGraphicsValue ) noexcept
+{
+	assert( aGraphicsValue > mFrames[mIndex].graphicsValue );
+	mFrames[mIndex].graphicsValue = aGraphicsValue;
+}
+
+FrameScheduler::Frame& FrameScheduler::current() noexcept
+{
+	return mFrames[mIndex];
+}
+std::uint32_t FrameScheduler::index() const noexcept
+{
+	return mIndex;
+}
+std::uint32_t FrameScheduler::frames_in_flight() const noexcept
+{
+	return std::uint32_t(mFrames.size());
+}
+
+FrameScheduler::WaitStats const& FrameScheduler::wait_stats() const noexcept
+{
+	return mWaitStats;
+}
+void FrameScheduler::reset_wait_stats() noexcept
+{
+	mWaitStats = WaitStats{};
+}
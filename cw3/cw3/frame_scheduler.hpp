@@ -0,0 +1,81 @@
+#pragma once
+
+#include <volk/volk.h>
+
+#include <vector>
+
+#include <cstdint>
+
+#include "../labutils/vkobject.hpp"
+#include "../labutils/vulkan_context.hpp"
+
+/* Rotates through a fixed number of frame slots, such that the CPU records
+ * the next frame while the GPU still executes the previous ones.
+ *
+ * Each slot owns the command buffer and semaphores of one frame, and the
+ * value that the frame's last submission signals on the context's graphics
+ * timeline (see labutils::Timeline). That value covers the earlier
+ * submissions, since a queue completes its submissions in order.
+ * begin_frame() moves to the next slot and waits until the timeline reaches
+ * the value of the frame that used it last; only then may the slot's command
+ * buffer and any per-frame data indexed with index() be overwritten. Frames
+ * in different slots share no data that the GPU writes (main.cpp gives each
+ * slot its own uniform buffers and G-buffer), so they only wait for each
+ * other through the swapchain.
+ *
+ * The value is recorded by mark_submitted() after that submission, so a frame
+ * that is abandoned before submitting (e.g., because the swapchain is out of
+ * date) leaves the previous one, which has already been reached.
+ */
+class FrameScheduler
+{
+	public:
+		struct Frame
+		{
+			VkCommandBuffer cmdBuffer;
+
+			std::uint64_t graphicsValue; // 0: never submitted
+			labutils::Semaphore imageAvailable;
+			labutils::Semaphore renderFinished;
+		};
+
+		// CPU time spent in begin_frame(), waiting for the GPU
+		struct WaitStats
+		{
+			std::uint32_t frames = 0;
+			double totalMs = 0.0;
+			double maxMs = 0.0;
+		};
+
+	public:
+		// The command buffer is allocated from aPool, which needs
+		// VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT. The context and the
+		// pool must outlive the scheduler.
+		FrameScheduler( labutils::VulkanContext const&, VkCommandPool aPool, std::uint32_t aFramesInFlight );
+
+		FrameScheduler( FrameScheduler const& ) = delete;
+		FrameScheduler& operator= (FrameScheduler const&) = delete;
+
+	public:
+		// Moves to the next slot, and waits for its previous frame.
+		Frame& begin_frame();
+
+		// Records the graphics timeline value that the current slot's last
+		// submission signals
+		void mark_submitted( std::uint64_t aGraphicsValue ) noexcept;
+
+		Frame& current() noexcept;
+		std::uint32_t index() const noexcept;
+		std::uint32_t frames_in_flight() const noexcept;
+
+		WaitStats const& wait_stats() const noexcept;
+		void reset_wait_stats() noexcept;
+
+	private:
+		labutils::VulkanContext const& mContext;
+
+		std::vector<Frame> mFrames;
+		std::uint32_t mIndex;
+
+		WaitStats mWaitStats;
+};
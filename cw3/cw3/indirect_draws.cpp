@@ -0,0 +1,92 @@
+#include "indirect_draws.hpp"
+
+#include <algorithm>
+
+#include <cassert>
+
+#include "../labutils/error.hpp"
+#include "../labutils/timeline.hpp"
+#include "../labutils/to_string.hpp"
+namespace lut = labutils;
+
+namespace
+{
+	constexpr VkDeviceSize kCommandSize = sizeof(VkDrawIndexedIndirectCommand);
+
+	lut::Buffer create_mapped_commands_( lut::Allocator const& aAllocator, std::uint32_t aCount, VkDrawIndexedIndirectCommand*& aMapped )
+	{
+		VkBufferCreateInfo bufferInfo{};
+		bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+		bufferInfo.size = aCount * kCommandSize;
+		bufferInfo.usage = VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT;
+
+		VmaAllocationCreateInfo allocInfo{};
+		allocInfo.usage = VMA_MEMORY_USAGE_CPU_TO_GPU;
+		allocInfo.flags = VMA_ALLOCATION_CREATE_MAPPED_BIT;
+
+		VkBuffer buffer = VK_NULL_HANDLE;
+		VmaAllocation allocation = VK_NULL_HANDLE;
+		VmaAllocationInfo info{};
+
+		if( auto const res = vmaCreateBuffer( aAllocator.allocator, &bufferInfo, &allocInfo, &buffer, &allocation, &info ); VK_SUCCESS != res )
+		{
+			throw lut::Error( "Unable to allocate indirect draw buffer.\nvmaCreateBuffer() returned %s", lut::to_string(res).c_str() );
+		}
+
+		aMapped = static_cast<VkDrawIndexedIndirectCommand*>(info.pMappedData);
+		return lut::Buffer( aAllocator.allocator, buffer, allocation );
+	}
+}
+
+IndirectDrawBuffer::IndirectDrawBuffer( lut::VulkanContext const& aContext, lut::Allocator const& aAllocator, std::uint32_t aSlotCount, std::uint32_t aCapacity )
+	: mContext( aContext )
+	, mAllocator( aAllocator )
+	, mCapacity( std::max( aCapacity, 1u ) )
+	, mSlots( aSlotCount )
+{
+	for( auto& slot : mSlots )
+		slot.buffer = create_mapped_commands_( mAllocator, mCapacity, slot.commands );
+}
+
+
+bool IndirectDrawBuffer::reserve( std::uint32_t aCount )
+{
+	if( aCount <= mCapacity )
+		return false;
+
+	auto& graphics = mContext.timelines->graphics;
+	graphics.wait( graphics.last() );
+
+	mCapacity = std::max( aCount, 2 * mCapacity );
+	for( auto& slot : mSlots )
+		slot.buffer = create_mapped_commands_( mAllocator, mCapacity, slot.commands );
+
+	return true;
+}
+
+VkBuffer IndirectDrawBuffer::buffer( std::uint32_t aSlot ) const noexcept
+{
+	assert( aSlot < mSlots.size() );
+	return mSlots[aSlot].buffer.buffer;
+}
+VkDrawIndexedIndirectCommand* IndirectDrawBuffer::commands( std::uint32_t aSlot ) const noexcept
+{
+	assert( aSlot < mSlots.size() );
+	return mSlots[aSlot].commands;
+}
+
+void IndirectDrawBuffer::flush( std::uint32_t aSlot ) const
+{
+	assert( aSlot < mSlots.size() );
+
+	// A no-op for host-coherent memory
+	if( auto const res = vmaFlushAllocation( mAllocator.allocator, mSlots[aSlot].buffer.allocation, 0, VK_WHOLE_SIZE ); VK_SUCCESS != res )
+	{
+		throw lut::Error( "Unable to flush indirect draw buffer.\nvmaFlushAllocation() returned %s", lut::to_string(res).c_str() );
+	}
+}
+
+std::uint32_t IndirectDrawBuffer::capacity() const noexcept
+{
+	return mCapacity;
+}
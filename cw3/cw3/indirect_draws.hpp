@@ -0,0 +1,64 @@
+#pragma once
+
+#include <volk/volk.h>
+
+#include <vector>
+
+#include <cstdint>
+
+#include "../labutils/vkbuffer.hpp"
+#include "../labutils/allocator.hpp"
+#include "../labutils/vulkan_context.hpp"
+
+/* Draw commands that the CPU writes every frame, and that the G-buffer draws
+ * execute with vkCmdDrawIndexedIndirect().
+ *
+ * The level of detail and the meshlet culling depend on the camera. If the
+ * cached G-buffer draws (see CommandCache) contained their result, they would
+ * have to be recorded again whenever the camera moves. Instead, each mesh
+ * owns a fixed range of commands, which its recorded draw executes. Every
+ * frame, the CPU writes the visible parts of the mesh into the range, and
+ * sets the index count of the remaining commands to zero.
+ *
+ * Each frame slot (see FrameScheduler) has its own persistently mapped
+ * buffer. A slot's commands may only be written once its previous frame has
+ * completed; flush() makes them visible to the slot's next submission.
+ */
+class IndirectDrawBuffer
+{
+	public:
+		// The context and the allocator must outlive the buffer
+		IndirectDrawBuffer( labutils::VulkanContext const&, labutils::Allocator const&, std::uint32_t aSlotCount, std::uint32_t aCapacity = 4096 );
+
+		IndirectDrawBuffer( IndirectDrawBuffer const& ) = delete;
+		IndirectDrawBuffer& operator= (IndirectDrawBuffer const&) = delete;
+
+	public:
+		// Makes room for aCount commands per slot. Growing replaces the
+		// buffers, which submitted frames may still read, so it first waits
+		// for all work on the graphics timeline. Returns true if the buffers
+		// were replaced; draws recorded with buffer() must then be recorded
+		// again.
+		bool reserve( std::uint32_t aCount );
+
+		VkBuffer buffer( std::uint32_t aSlot ) const noexcept;
+		VkDrawIndexedIndirectCommand* commands( std::uint32_t aSlot ) const noexcept;
+
+		// Makes the commands written to aSlot visible to the device
+		void flush( std::uint32_t aSlot ) const;
+
+		std::uint32_t capacity() const noexcept;
+
+	private:
+		struct Slot_
+		{
+			labutils::Buffer buffer;
+			VkDrawIndexedIndirectCommand* commands = nullptr;
+		};
+
+		labutils::VulkanContext const& mContext;
+		labutils::Allocator const& mAllocator;
+
+		std::uint32_t mCapacity = 0;
+		std::vector<Slot_> mSlots;
+};
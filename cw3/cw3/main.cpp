@@ -1,9 +1,15 @@
 #include <volk/volk.h>
 #include <iostream>
 #include <tuple>
+#include <mutex>
+#include <optional>
+#include <memory>
 #include <chrono>
+#include <thread>
 #include <limits>
 #include <vector>
+#include <utility>
+#include <algorithm>
 #include <stdexcept>
 
 #include <cstdio>
@@ -33,6 +39,8 @@ using namespace labutils::literals;
 #include "../labutils/vkobject.hpp"
 #include "../labutils/vkbuffer.hpp"
 #include "../labutils/allocator.hpp" 
+#include "../labutils/geometry_arena.hpp"
+#include "../labutils/sampler_cache.hpp"
 namespace lut = labutils;
 
 
@@ -41,10 +49,27 @@ namespace lut = labutils;
 #include "DescriptorSetHelper.h"
 #include "FramebufferHelper.h"
 #include "model.hpp"
+#include "meshlet.hpp"
+#include "mesh_lod.hpp"
+#include "asset_loader.hpp"
+#include "mip_benchmark.hpp"
+#include "obj_benchmark.hpp"
+#include "optimizer_benchmark.hpp"
+#include "quantize_check.hpp"
+#include "bindless_textures.hpp"
+#include "material_table.hpp"
+#include "frame_scheduler.hpp"
+#include "command_cache.hpp"
+#include "indirect_draws.hpp"
+#include "record_benchmark.hpp"
 
 #define INPUT_ATTRIBUTE_NUM 3
 #define LIGHT_COUNT 5
 
+// Cull meshlets against the view frustum and their normal cones before
+// drawing the G-buffer (see meshlet.hpp). Comment out to draw whole meshes.
+#define MESHLET_CULLING
+
 
 namespace
 {
@@ -83,6 +108,65 @@ namespace
 		constexpr float kCameraFar   = 100.f;
 		constexpr auto kCameraFov    = 60.0_degf;
 
+		// Coarser levels of detail are used while their geometric error
+		// projects to at most this many pixels (see mesh_lod.hpp).
+		constexpr float kLodMaxPixelError = 1.f;
+
+		// Frames are rendered while the models are loaded in the background,
+		// see asset_loader.hpp
+		constexpr bool kLoadAssetsInBackground = true;
+
+		// Uploads use a dedicated transfer queue if the device has one. Set
+		// to false to share the graphics queue, as on devices without one.
+		constexpr bool kUseTransferQueue = true;
+
+		// Put all textures into one descriptor array, indexed per draw, if
+		// the device supports descriptor indexing (see bindless_textures.hpp).
+		// Otherwise, or if false, each mesh binds a set with its texture.
+		constexpr bool kBindlessTextures = true;
+
+		// Number of frames the CPU may record ahead of the GPU (see
+		// frame_scheduler.hpp). The CPU time spent waiting for the GPU is
+		// printed every kFrameStatsInterval frames; 0 disables the output.
+		constexpr std::uint32_t kFramesInFlight = 2;
+		constexpr std::uint32_t kFrameStatsInterval = 600;
+
+		// Compare the parallel OBJ parser with tinyobj on the scene's models
+		// and on a synthetic OBJ of kBenchmarkObjBytes bytes, check that both
+		// produce the same ModelData, print the results and exit (see
+		// obj_benchmark.hpp)
+		constexpr bool kBenchmarkObjParsing = false;
+		constexpr std::uint64_t kBenchmarkObjBytes = 500ull << 20;
+
+		// Run the mesh optimization on synthetic grids and on the scene's
+		// models, check that it keeps the triangles and doesn't increase the
+		// ACMR, print the results and exit (see optimizer_benchmark.hpp)
+		constexpr bool kBenchmarkMeshOptimization = false;
+
+		// Check the vertex quantization against its error bounds, on random
+		// and edge-case vertices, print the results and exit (see
+		// quantize_check.hpp)
+		constexpr bool kCheckVertexQuantization = false;
+
+		// Compare the CPU mip generator with GPU blits for the scene's
+		// textures, print the results and exit (see mip_benchmark.hpp)
+		constexpr bool kBenchmarkMipGeneration = false;
+
+		// Threads that record the G-buffer draws (see parallel_recorder.hpp);
+		// 0 uses one per hardware thread
+		constexpr std::size_t kRecordThreads = 0;
+
+		// Measure the time to record the G-buffer draws of a synthetic scene
+		// with this many draws with 1, 2, 4, ... threads, print the results
+		// and exit (see record_benchmark.hpp)
+		constexpr bool kBenchmarkCommandRecording = false;
+		constexpr std::size_t kBenchmarkDrawCount = 50000;
+
+		// Capacity of the geometry arena that holds the vertices and indices
+		// of all meshes
+		constexpr VkDeviceSize kArenaVertexCapacity = 4u << 20;
+		constexpr VkDeviceSize kArenaIndexBytes = 64u << 20;
+
 
 		constexpr char const* kImageOutput = "output.png";
 
@@ -91,8 +175,8 @@ namespace
 		
 
 		const VertexInputInfo vertexInputInfo{ INPUT_ATTRIBUTE_NUM,
-			{sizeof(float) * 3,sizeof(float) * 2,sizeof(float) * 3},
-			{VK_FORMAT_R32G32B32_SFLOAT, VK_FORMAT_R32G32B32_SFLOAT, VK_FORMAT_R32G32B32_SFLOAT} };
+			{vtx::kPositionSize, vtx::kTexcoordSize, vtx::kNormalSize},
+			{vtx::kPositionFormat, vtx::kTexcoordFormat, vtx::kNormalFormat} };
 
 		bool isNewShip = false;
 
@@ -113,6 +197,22 @@ namespace
 
 		static_assert(sizeof(SceneUniform) <= 65536, "SceneUniform must be less than 65536 bytes for vkCmdUpdateBuffer.");
 		static_assert(sizeof(SceneUniform) % 4 == 0, "SceneUniform size must be a multiple of 4 bytes.");
+
+		// Per-mesh position bounds, used to reconstruct quantized positions,
+		// the mesh's slot in the bindless texture table (0 otherwise), which
+		// the G-buffer shaders don't read yet, and its slot in the material
+		// table. textureIndex fills the padding after positionExtent.
+		struct MeshPushConstants
+		{
+			alignas(16) glm::vec3 positionMin;
+			alignas(16) glm::vec3 positionExtent;
+			std::uint32_t textureIndex;
+			std::uint32_t materialIndex;
+		};
+
+		static_assert(sizeof(MeshPushConstants) <= 128, "MeshPushConstants must fit into the guaranteed push constant space.");
+		static_assert(offsetof(MeshPushConstants, textureIndex) == 28, "MeshPushConstants::textureIndex must match the std430 offset in the shaders.");
+		static_assert(offsetof(MeshPushConstants, materialIndex) == 32, "MeshPushConstants::materialIndex must match the std430 offset in the shaders.");
 	}
 
 	namespace glsl
@@ -219,30 +319,56 @@ namespace
 	// Local functions:
 	lut::RenderPass create_render_pass(lut::VulkanWindow const&);
 	lut::PipelineLayout create_pipeline_layout(lut::VulkanContext const&);
-	lut::PipelineLayout create_pipeline_layout(lut::VulkanContext const& aContext, std::vector<labutils::DescriptorSetLayout> const& layouts);
+	lut::PipelineLayout create_pipeline_layout(lut::VulkanContext const& aContext, std::vector<labutils::DescriptorSetLayout> const& layouts, std::vector<VkPushConstantRange> const& pushConstantRanges = {});
 	lut::PipelineLayout create_pipeline_layout(lut::VulkanContext const& aContext, VkDescriptorSetLayout* vaLayouts, std::uint32_t setLayoutCount);
-	lut::Pipeline create_pipeline(lut::VulkanWindow const&, VkRenderPass, VkPipelineLayout, VertexInputInfo);
-	lut::Pipeline create_pipeline_without_vertex_input(lut::VulkanWindow const& aWindow, VkRenderPass aRenderPass, VkPipelineLayout aPipelineLayout);
+	lut::Pipeline create_pipeline(lut::VulkanWindow const&, VkRenderPass, VkPipelineLayout, VertexInputInfo, std::uint32_t aTextureCount);
+	lut::Pipeline create_pipeline_without_vertex_input(lut::VulkanWindow const& aWindow, VkRenderPass aRenderPass, std::uint32_t aSubpass, VkPipelineLayout aPipelineLayout);
 
 	void create_swapchain_framebuffers(lut::VulkanWindow const&, VkRenderPass, std::vector<lut::Framebuffer>&, VkImageView aDepthView);
 	
-	void record_commands(VkCommandBuffer, VkRenderPass, VkFramebuffer, VkPipeline, VkPipelineLayout, VkExtent2D const&,
-		std::vector< std::vector<ModelVertexTexturePack>>&, std::vector<desc::DescriptorSetPack>& descriptorSetPack);
-
-	void submit_commands(lut::VulkanContext const& aContext, VkPipelineStageFlags* waitPipelineStages, VkCommandBuffer aCmdBuff, VkFence aFence, VkSemaphore* aWaitSemaphore, std::uint32_t waitSemaphoreCount, VkSemaphore aSignalSemaphore);
+	// Also signals the next value on the graphics timeline, and returns it
+	std::uint64_t submit_commands(lut::VulkanContext const& aContext, VkPipelineStageFlags* waitPipelineStages, VkCommandBuffer aCmdBuff, VkSemaphore* aWaitSemaphore, std::uint32_t waitSemaphoreCount, VkSemaphore aSignalSemaphore);
 	
 	void update_scene_uniforms(glsl::SceneUniform& aSceneUniforms, std::uint32_t aFramebufferWidth, std::uint32_t aFramebufferHeight);
+
+	std::size_t select_mesh_lod(ModelVertexTexturePack const& aMesh, std::uint32_t aViewportHeight);
 	
 	std::tuple<lut::Image, lut::ImageView> create_image_buffer(lut::VulkanWindow const& aWindow, lut::Allocator const& aAllocator,
 		VkFormat format, VkImageUsageFlags usage);
 	
 	std::tuple<lut::Image, lut::ImageView> create_depth_buffer(lut::VulkanWindow const& aWindow, lut::Allocator const& aAllocator);
 	
-	void record_offscreen_commands(VkCommandBuffer aCmdBuff, std::vector<desc::DescriptorSetPack>& uniformDescSets, FramebufferPack& framebufferPack, VkPipeline aGraphicsPipe,
-		VkPipelineLayout aGraphicsPipeLayout, VkExtent2D const& aImageExtent, std::vector< std::vector<ModelVertexTexturePack>>& mesh);
-	
-	void record_draw_commands(VkCommandBuffer aCmdBuff, VkDescriptorSet* uniformDescSets, std::uint32_t uniformDescSetCount, desc::Buffer* updateBuffer, std::uint32_t updateBufferCount,
-		FramebufferPack& framebufferPack, SwapChainFramebufferPack& scframebufferPack, std::uint32_t framebufferIndex, VkPipeline aGraphicsPipe, VkPipelineLayout aGraphicsPipeLayout, VkExtent2D const& aImageExtent);
+	// Records the frame into the framebuffer of frame slot aFrameIndex and
+	// swapchain image aFramebufferIndex: the G-buffer subpass executes
+	// aGBufferDraws, and the lighting subpass shades the slot's G-buffer with
+	// aLightingDescSets.
+	void record_frame_commands(VkCommandBuffer aCmdBuff, std::vector<desc::DescriptorSetPack>& uniformDescSets, desc::Buffer& aLightBuffer,
+		DeferredFramebufferPack& deferredPack, std::uint32_t aFrameIndex, std::uint32_t aFramebufferIndex, std::vector<VkCommandBuffer> const& aGBufferDraws,
+		VkDescriptorSet* aLightingDescSets, std::uint32_t aLightingDescSetCount, VkPipeline aLightingPipe, VkPipelineLayout aLightingPipeLayout, VkExtent2D const& aImageExtent);
+
+	// Records the draws of the meshes aMeshAt(i), i in [aFirst, aEnd), into a
+	// secondary command buffer of the G-buffer subpass. Each mesh executes
+	// its range of aDrawCommands (see IndirectDrawBuffer), in indirect draws
+	// of at most aMaxDrawCount commands, so the result doesn't depend on the
+	// camera. Called concurrently for different ranges (see
+	// ParallelRecorder).
+	template< typename tMeshAt >
+	void record_gbuffer_draws(VkCommandBuffer aCmdBuff, std::vector<desc::DescriptorSetPack> const& uniformDescSets, VkPipeline aGraphicsPipe, VkPipelineLayout aGraphicsPipeLayout,
+		lut::GeometryArena const& aArena, std::size_t aFirst, std::size_t aEnd, tMeshAt const& aMeshAt,
+		VkBuffer aDrawCommands, std::uint32_t aMaxDrawCount, VkDescriptorSet aBindlessTextureSet, VkDescriptorSet aMaterialSet);
+
+	// Number of commands that the G-buffer draw of the mesh executes: one
+	// per meshlet, or one for the whole mesh
+	std::uint32_t gbuffer_draw_command_count(ModelVertexTexturePack const& aMesh);
+
+	// Assigns consecutive ranges of commands to the meshes of all models, and
+	// returns the number of commands
+	std::uint32_t assign_gbuffer_draw_commands(std::vector<std::vector<ModelVertexTexturePack>>& aModels);
+
+	// Writes the frame's commands of aMeshes: the selected level of detail,
+	// or the meshlets of the full-detail mesh that survive culling
+	void write_gbuffer_draw_commands(VkDrawIndexedIndirectCommand* aCommands, std::vector<ModelVertexTexturePack> const& aMeshes,
+		VkExtent2D const& aImageExtent, MeshletCullInfo const& aCullInfo);
 
 }
 
@@ -454,7 +580,7 @@ namespace
 		return lut::PipelineLayout(aContext.device, layout);
 	}
 
-	lut::PipelineLayout create_pipeline_layout(lut::VulkanContext const& aContext, std::vector<labutils::DescriptorSetLayout> const& vaLayouts)
+	lut::PipelineLayout create_pipeline_layout(lut::VulkanContext const& aContext, std::vector<labutils::DescriptorSetLayout> const& vaLayouts, std::vector<VkPushConstantRange> const& pushConstantRanges)
 	{
 
 		// fill the layout list with layouts
@@ -469,8 +595,8 @@ namespace
 		layoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
 		layoutInfo.setLayoutCount = layouts.size();
 		layoutInfo.pSetLayouts = layouts.data();
-		layoutInfo.pushConstantRangeCount = 0;
-		layoutInfo.pPushConstantRanges = nullptr;
+		layoutInfo.pushConstantRangeCount = std::uint32_t(pushConstantRanges.size());
+		layoutInfo.pPushConstantRanges = pushConstantRanges.data();
 
 
 		// create pipeline layout
@@ -514,7 +640,7 @@ namespace
 		return lut::PipelineLayout(aContext.device, layout);
 	}
 
-	lut::Pipeline create_pipeline(lut::VulkanWindow const& aWindow, VkRenderPass aRenderPass, VkPipelineLayout aPipelineLayout, VertexInputInfo vInfo)
+	lut::Pipeline create_pipeline(lut::VulkanWindow const& aWindow, VkRenderPass aRenderPass, VkPipelineLayout aPipelineLayout, VertexInputInfo vInfo, std::uint32_t aTextureCount)
 	{
 		// load shader modules
 		lut::ShaderModule vert = lut::load_shader_module(aWindow, cfg::mrtVertShaderPath);
@@ -525,17 +651,52 @@ namespace
 		VkPipelineShaderStageCreateInfo stages[2]{}; // for vert shader and frag shader respectively
 
 
+		// specialization constant selecting the vertex decoding (constant_id = 0)
+#ifdef QUANTIZED_VERTEX_MODE
+		VkBool32 const quantizedVertices = VK_TRUE;
+#else
+		VkBool32 const quantizedVertices = VK_FALSE;
+#endif
+
+		VkSpecializationMapEntry specEntry{};
+		specEntry.constantID = 0;
+		specEntry.offset = 0;
+		specEntry.size = sizeof(VkBool32);
+
+		VkSpecializationInfo specInfo{};
+		specInfo.mapEntryCount = 1;
+		specInfo.pMapEntries = &specEntry;
+		specInfo.dataSize = sizeof(VkBool32);
+		specInfo.pData = &quantizedVertices;
+
+		// size of the texture array (constant_id = 1): the capacity of the
+		// bindless table, or 1 for per-mesh texture sets
+		std::int32_t const textureCount = std::int32_t(aTextureCount);
+
+		VkSpecializationMapEntry fragSpecEntry{};
+		fragSpecEntry.constantID = 1;
+		fragSpecEntry.offset = 0;
+		fragSpecEntry.size = sizeof(std::int32_t);
+
+		VkSpecializationInfo fragSpecInfo{};
+		fragSpecInfo.mapEntryCount = 1;
+		fragSpecInfo.pMapEntries = &fragSpecEntry;
+		fragSpecInfo.dataSize = sizeof(std::int32_t);
+		fragSpecInfo.pData = &textureCount;
+
 		// stage for vertex shader
 		stages[0].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
 		stages[0].stage = VK_SHADER_STAGE_VERTEX_BIT;
 		stages[0].module = vert.handle;
 		stages[0].pName = "main";
+		stages[0].pSpecializationInfo = &specInfo;
 
 		// stage for fragment shader
 		stages[1].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
 		stages[1].stage = VK_SHADER_STAGE_FRAGMENT_BIT;
 		stages[1].module = frag.handle;
 		stages[1].pName = "main";
+		stages[1].pSpecializationInfo = &fragSpecInfo;
 
 		// vertex input
 		VkVertexInputBindingDescription vertexInputs[INPUT_ATTRIBUTE_NUM]{};
@@ -671,7 +832,7 @@ namespace
 		return lut::Pipeline(aWindow.device, pipe);
 	}
 
-	lut::Pipeline create_pipeline_without_vertex_input(lut::VulkanWindow const& aWindow, VkRenderPass aRenderPass, VkPipelineLayout aPipelineLayout)
+	lut::Pipeline create_pipeline_without_vertex_input(lut::VulkanWindow const& aWindow, VkRenderPass aRenderPass, std::uint32_t aSubpass, VkPipelineLayout aPipelineLayout)
 	{
 		// load shader modules
 		lut::ShaderModule vert = lut::load_shader_module(aWindow, cfg::kVertShaderPath);
@@ -774,7 +935,7 @@ namespace
 
 		pipeInfo.layout = aPipelineLayout;
 		pipeInfo.renderPass = aRenderPass;
-		pipeInfo.subpass = 0; // first subpass of aRenderPass 
+		pipeInfo.subpass = aSubpass; 
 
 		VkPipeline pipe = VK_NULL_HANDLE;
 		if (auto const res = vkCreateGraphicsPipelines(aWindow.device, VK_NULL_HANDLE, 1, &pipeInfo, nullptr, &pipe); res != VK_SUCCESS)
@@ -878,6 +1039,24 @@ namespace
 
 	}
 
+	std::size_t select_mesh_lod(ModelVertexTexturePack const& aMesh, std::uint32_t aViewportHeight)
+	{
+		// distance from the camera to the bounding sphere of the mesh
+		glm::vec3 const center = aMesh.positionMin + 0.5f * aMesh.positionExtent;
+		float const radius = 0.5f * glm::length(aMesh.positionExtent);
+		float const distance = std::max(glm::distance(glsl::camera.camTranslation, center) - radius, cfg::kCameraNear);
+
+		// pick the coarsest level whose error is below the threshold
+		std::size_t level = 0;
+		for (std::size_t i = 0; i < aMesh.lods.size(); ++i)
+		{
+			if (projected_error_pixels(aMesh.lods[i].error, distance, lut::Radians(cfg::kCameraFov).value(), float(aViewportHeight)) <= cfg::kLodMaxPixelError)
+				level = i + 1;
+		}
+
+		return level;
+	}
+
 	std::tuple<lut::Image, lut::ImageView> create_image_buffer(lut::VulkanWindow const& aWindow, lut::Allocator const& aAllocator,
 		VkFormat format, VkImageUsageFlags usage)
 	{
@@ -991,9 +1170,9 @@ namespace
 		return { std::move(depthImage), lut::ImageView{aWindow.device, view} };
 	}
 
-	// run cmd commands
-	void record_commands(VkCommandBuffer aCmdBuff, VkRenderPass aRenderPass, VkFramebuffer aFramebuffer, VkPipeline aGraphicsPipe, VkPipelineLayout aGraphicsPipeLayout,
-		VkExtent2D const& aImageExtent, std::vector< std::vector<ModelVertexTexturePack>>& mesh, std::vector<desc::DescriptorSetPack>& uniformDescSets)
+	void record_frame_commands(VkCommandBuffer aCmdBuff, std::vector<desc::DescriptorSetPack>& uniformDescSets, desc::Buffer& aLightBuffer,
+		DeferredFramebufferPack& deferredPack, std::uint32_t aFrameIndex, std::uint32_t aFramebufferIndex, std::vector<VkCommandBuffer> const& aGBufferDraws,
+		VkDescriptorSet* aLightingDescSets, std::uint32_t aLightingDescSetCount, VkPipeline aLightingPipe, VkPipelineLayout aLightingPipeLayout, VkExtent2D const& aImageExtent)
 	{
 
 		// Begin recording commands
@@ -1008,56 +1187,62 @@ namespace
 				"vkBeginCommandBuffer() returned %s", lut::to_string(res).c_str());
 		}
 
-
-		// Begin render pass
-		VkClearValue clearValues[2]{};
+		// Clear values, in attachment order: swapchain image, G-buffer, depth
+		VkClearValue clearValues[5]{};
 		clearValues[0].color.float32[0] = 0.1f; // Clear to a dark gray background. 
 		clearValues[0].color.float32[1] = 0.1f; // If we were debugging, this would potentially 
 		clearValues[0].color.float32[2] = 0.1f; // help us see whether the render pass took 
 		clearValues[0].color.float32[3] = 1.f;  // place, even if nothing else was drawn.
-		
-		clearValues[1].depthStencil.depth = 1.f;
 
-		// update data in matrix uniform buffer object
+		clearValues[1].color.float32[0] = 0.1f; 
+		clearValues[1].color.float32[1] = 0.1f; 
+		clearValues[1].color.float32[2] = 0.1f; 
+		clearValues[1].color.float32[3] = 1.f;  
+
+		clearValues[2].color.float32[0] = 0.0f; 
+		clearValues[2].color.float32[1] = 0.0f; 
+		clearValues[2].color.float32[2] = 0.0f; 
+		clearValues[2].color.float32[3] = 0.0f;  
+
+		clearValues[3].color.float32[0] = 0.1f; 
+		clearValues[3].color.float32[1] = 0.1f; 
+		clearValues[3].color.float32[2] = 0.1f; 
+		clearValues[3].color.float32[3] = 1.f;  
+
+		clearValues[4].depthStencil.depth = 1.f;
+
+		// Update uniform buffers; transfers aren't allowed inside the render
+		// pass
 		for (auto& descriptorSetPack : uniformDescSets)
 			descriptorSetPack.update_ubo_data(aCmdBuff);
 
+		aLightBuffer.update_ubo_data(aCmdBuff);
+
 
 		VkRenderPassBeginInfo passInfo{};
 		passInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
-		passInfo.renderPass = aRenderPass;
-		passInfo.framebuffer = aFramebuffer;
+		passInfo.renderPass = deferredPack.renderPass.handle;
+		passInfo.framebuffer = deferredPack.framebuffers[aFrameIndex][aFramebufferIndex].handle;
 		passInfo.renderArea.offset = VkOffset2D{ 0, 0 };
 		passInfo.renderArea.extent = VkExtent2D{ aImageExtent.width, aImageExtent.height };
-		passInfo.clearValueCount = 2;
+		passInfo.clearValueCount = 5;
 		passInfo.pClearValues = clearValues;
-		vkCmdBeginRenderPass(aCmdBuff, &passInfo, VK_SUBPASS_CONTENTS_INLINE);
+		vkCmdBeginRenderPass(aCmdBuff, &passInfo, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
 
+		// G-buffer subpass. The draws are recorded separately, see
+		// record_gbuffer_draws()
+		vkCmdExecuteCommands(aCmdBuff, std::uint32_t(aGBufferDraws.size()), aGBufferDraws.data());
 
-		// Commands
-		vkCmdBindPipeline(aCmdBuff, VK_PIPELINE_BIND_POINT_GRAPHICS, aGraphicsPipe);
-
-		for (unsigned int meshIndex = 0; meshIndex < mesh[cfg::isNewShip].size(); ++meshIndex)
-		{
-
-			// Binding vertex buffers
-			VkBuffer buffers[INPUT_ATTRIBUTE_NUM] = { mesh[cfg::isNewShip][meshIndex].positions.buffer, mesh[cfg::isNewShip][meshIndex].texcoords.buffer, mesh[cfg::isNewShip][meshIndex].normals.buffer };
-			VkDeviceSize offsets[INPUT_ATTRIBUTE_NUM]{};
-			vkCmdBindVertexBuffers(aCmdBuff, 0, INPUT_ATTRIBUTE_NUM, buffers, offsets);
-
-
-			// Binding descriptor sets
-			for (std::uint32_t descriptorSetIndex = 0; descriptorSetIndex < uniformDescSets.size(); ++descriptorSetIndex)
-				vkCmdBindDescriptorSets(aCmdBuff, VK_PIPELINE_BIND_POINT_GRAPHICS, aGraphicsPipeLayout, descriptorSetIndex, 1, &uniformDescSets[descriptorSetIndex].descriptorSet, 0, nullptr);
-
-			vkCmdBindDescriptorSets(aCmdBuff, VK_PIPELINE_BIND_POINT_GRAPHICS, aGraphicsPipeLayout, uniformDescSets.size(), 1, &mesh[cfg::isNewShip][meshIndex].textureDescriptorSet, 0, nullptr);
+		// Lighting subpass: a fullscreen quad that reads the G-buffer as
+		// input attachments
+		vkCmdNextSubpass(aCmdBuff, VK_SUBPASS_CONTENTS_INLINE);
 
-			vkCmdBindDescriptorSets(aCmdBuff, VK_PIPELINE_BIND_POINT_GRAPHICS, aGraphicsPipeLayout, uniformDescSets.size() + 1, 1, &mesh[cfg::isNewShip][meshIndex].materialDescSetPack.descriptorSet, 0, nullptr);
+		vkCmdBindPipeline(aCmdBuff, VK_PIPELINE_BIND_POINT_GRAPHICS, aLightingPipe);
 
-			// Draw a mesh
-			vkCmdDraw(aCmdBuff, mesh[cfg::isNewShip][meshIndex].vertexCount, 1, 0, 0);
-		}
+		for (std::uint32_t i = 0; i < aLightingDescSetCount; ++i)
+			vkCmdBindDescriptorSets(aCmdBuff, VK_PIPELINE_BIND_POINT_GRAPHICS, aLightingPipeLayout, i, 1, &aLightingDescSets[i], 0, nullptr);
 
+		vkCmdDraw(aCmdBuff, 6, 1, 0, 0);
 
 		// End the render pass 
 		vkCmdEndRenderPass(aCmdBuff);
@@ -1070,176 +1255,167 @@ namespace
 		}
 	}
 
-	void record_offscreen_commands(VkCommandBuffer aCmdBuff, std::vector<desc::DescriptorSetPack>& uniformDescSets, FramebufferPack& framebufferPack, VkPipeline aGraphicsPipe,
-		VkPipelineLayout aGraphicsPipeLayout, VkExtent2D const& aImageExtent, std::vector< std::vector<ModelVertexTexturePack>>& mesh)
+	template< typename tMeshAt >
+	void record_gbuffer_draws(VkCommandBuffer aCmdBuff, std::vector<desc::DescriptorSetPack> const& uniformDescSets, VkPipeline aGraphicsPipe, VkPipelineLayout aGraphicsPipeLayout,
+		lut::GeometryArena const& aArena, std::size_t aFirst, std::size_t aEnd, tMeshAt const& aMeshAt,
+		VkBuffer aDrawCommands, std::uint32_t aMaxDrawCount, VkDescriptorSet aBindlessTextureSet, VkDescriptorSet aMaterialSet)
 	{
-
-		// Begin recording commands
-		VkCommandBufferBeginInfo begInfo{};
-		begInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-		begInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
-		begInfo.pInheritanceInfo = nullptr;
-
-		if (auto const res = vkBeginCommandBuffer(aCmdBuff, &begInfo); VK_SUCCESS != res)
-		{
-			throw lut::Error("Unable to begin recording command buffer\n"
-				"vkBeginCommandBuffer() returned %s", lut::to_string(res).c_str());
-		}
-
-		// Begin render pass
-		VkClearValue clearValues[4]{};
-		clearValues[0].color.float32[0] = 0.1f; 
-		clearValues[0].color.float32[1] = 0.1f; 
-		clearValues[0].color.float32[2] = 0.1f; 
-		clearValues[0].color.float32[3] = 1.f;  
-
-		clearValues[1].color.float32[0] = 0.0f; 
-		clearValues[1].color.float32[1] = 0.0f; 
-		clearValues[1].color.float32[2] = 0.0f; 
-		clearValues[1].color.float32[3] = 0.0f;  
-
-		clearValues[2].color.float32[0] = 0.1f; 
-		clearValues[2].color.float32[1] = 0.1f; 
-		clearValues[2].color.float32[2] = 0.1f; 
-		clearValues[2].color.float32[3] = 1.f;  
-
-		clearValues[3].depthStencil.depth = 1.f;
-
-		// update data in matrix uniform buffer object
-		for (auto& descriptorSetPack : uniformDescSets)
-			descriptorSetPack.update_ubo_data(aCmdBuff);
-
-
-		VkRenderPassBeginInfo passInfo{};
-		passInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
-		passInfo.renderPass = framebufferPack.renderPass.handle;
-		passInfo.framebuffer = framebufferPack.framebuffer.handle;
-		passInfo.renderArea.offset = VkOffset2D{ 0, 0 };
-		passInfo.renderArea.extent = VkExtent2D{ aImageExtent.width, aImageExtent.height };
-		passInfo.clearValueCount = 4;
-		passInfo.pClearValues = clearValues;
-		vkCmdBeginRenderPass(aCmdBuff, &passInfo, VK_SUBPASS_CONTENTS_INLINE);
-
-
 		// Commands
 		vkCmdBindPipeline(aCmdBuff, VK_PIPELINE_BIND_POINT_GRAPHICS, aGraphicsPipe);
 
-		for (unsigned int meshIndex = 0; meshIndex < mesh[cfg::isNewShip].size(); ++meshIndex)
-		{
+		// All meshes live in the geometry arena, so its vertex buffers are
+		// bound once. The index buffer is rebound only when the index type
+		// changes.
+		VkBuffer buffers[INPUT_ATTRIBUTE_NUM] = { aArena.attributes[0].buffer, aArena.attributes[1].buffer, aArena.attributes[2].buffer };
+		VkDeviceSize offsets[INPUT_ATTRIBUTE_NUM]{};
+		vkCmdBindVertexBuffers(aCmdBuff, 0, INPUT_ATTRIBUTE_NUM, buffers, offsets);
 
-			// Binding vertex buffers
-			VkBuffer buffers[INPUT_ATTRIBUTE_NUM] = { mesh[cfg::isNewShip][meshIndex].positions.buffer, mesh[cfg::isNewShip][meshIndex].texcoords.buffer, mesh[cfg::isNewShip][meshIndex].normals.buffer };
-			VkDeviceSize offsets[INPUT_ATTRIBUTE_NUM]{};
-			vkCmdBindVertexBuffers(aCmdBuff, 0, INPUT_ATTRIBUTE_NUM, buffers, offsets);
+		VkIndexType boundIndexType = VK_INDEX_TYPE_MAX_ENUM;
 
+		// The scene uniforms are the same for all draws
+		for (std::uint32_t descriptorSetIndex = 0; descriptorSetIndex < uniformDescSets.size(); ++descriptorSetIndex)
+			vkCmdBindDescriptorSets(aCmdBuff, VK_PIPELINE_BIND_POINT_GRAPHICS, aGraphicsPipeLayout, descriptorSetIndex, 1, &uniformDescSets[descriptorSetIndex].descriptorSet, 0, nullptr);
 
-			// Binding descriptor sets
-			for (std::uint32_t descriptorSetIndex = 0; descriptorSetIndex < uniformDescSets.size(); ++descriptorSetIndex)
-				vkCmdBindDescriptorSets(aCmdBuff, VK_PIPELINE_BIND_POINT_GRAPHICS, aGraphicsPipeLayout, descriptorSetIndex, 1, &uniformDescSets[descriptorSetIndex].descriptorSet, 0, nullptr);
+		// The bindless texture table is bound once; the draws select their
+		// texture with MeshPushConstants::textureIndex
+		if (VK_NULL_HANDLE != aBindlessTextureSet)
+			vkCmdBindDescriptorSets(aCmdBuff, VK_PIPELINE_BIND_POINT_GRAPHICS, aGraphicsPipeLayout, uniformDescSets.size(), 1, &aBindlessTextureSet, 0, nullptr);
 
-			vkCmdBindDescriptorSets(aCmdBuff, VK_PIPELINE_BIND_POINT_GRAPHICS, aGraphicsPipeLayout, uniformDescSets.size(), 1, &mesh[cfg::isNewShip][meshIndex].textureDescriptorSet, 0, nullptr);
+		// Likewise, the material table is bound once, and indexed with
+		// MeshPushConstants::materialIndex
+		vkCmdBindDescriptorSets(aCmdBuff, VK_PIPELINE_BIND_POINT_GRAPHICS, aGraphicsPipeLayout, uniformDescSets.size() + 1, 1, &aMaterialSet, 0, nullptr);
 
-			vkCmdBindDescriptorSets(aCmdBuff, VK_PIPELINE_BIND_POINT_GRAPHICS, aGraphicsPipeLayout, uniformDescSets.size() + 1, 1, &mesh[cfg::isNewShip][meshIndex].materialDescSetPack.descriptorSet, 0, nullptr);
+		// Each mesh executes its own range of the frame's commands
+		constexpr std::uint32_t stride = sizeof(VkDrawIndexedIndirectCommand);
 
-			// Draw a mesh
-			vkCmdDraw(aCmdBuff, mesh[cfg::isNewShip][meshIndex].vertexCount, 1, 0, 0);
-		}
+		for (std::size_t meshIndex = aFirst; meshIndex < aEnd; ++meshIndex)
+		{
+			ModelVertexTexturePack const& mesh = aMeshAt(meshIndex);
 
+			// Without the bindless table, each mesh binds its own texture set
+			if (VK_NULL_HANDLE == aBindlessTextureSet)
+				vkCmdBindDescriptorSets(aCmdBuff, VK_PIPELINE_BIND_POINT_GRAPHICS, aGraphicsPipeLayout, uniformDescSets.size(), 1, &mesh.textureDescriptorSet, 0, nullptr);
 
-		// End the render pass 
-		vkCmdEndRenderPass(aCmdBuff);
+			// Position bounds, texture and material of the mesh
+			glsl::MeshPushConstants meshConstants{ mesh.positionMin, mesh.positionExtent,
+				mesh.texture->textureIndex, mesh.materialIndex };
+			vkCmdPushConstants(aCmdBuff, aGraphicsPipeLayout, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(glsl::MeshPushConstants), &meshConstants);
 
-		// End command recording
-		if (auto const res = vkEndCommandBuffer(aCmdBuff); VK_SUCCESS != res)
-		{
-			throw lut::Error("Unable to end recording command buffer\n"
-				"vkEndCommandBuffer() returned %s", lut::to_string(res).c_str());
+			if (mesh.indexType != boundIndexType)
+			{
+				boundIndexType = mesh.indexType;
+				vkCmdBindIndexBuffer(aCmdBuff, aArena.indices.buffer, 0, boundIndexType);
+			}
+
+			// Draw the parts of the mesh that the frame's commands select
+			std::uint32_t const count = gbuffer_draw_command_count(mesh);
+			for (std::uint32_t first = 0; first < count; first += aMaxDrawCount)
+			{
+				VkDeviceSize const offset = VkDeviceSize(mesh.firstDrawCommand + first) * stride;
+				vkCmdDrawIndexedIndirect(aCmdBuff, aDrawCommands, offset, std::min(aMaxDrawCount, count - first), stride);
+			}
 		}
 	}
 
-	void record_draw_commands(VkCommandBuffer aCmdBuff, VkDescriptorSet* uniformDescSets, std::uint32_t uniformDescSetCount, desc::Buffer* updateBuffer, std::uint32_t updateBufferCount,
-		FramebufferPack& framebufferPack, SwapChainFramebufferPack& scframebufferPack, std::uint32_t framebufferIndex, VkPipeline aGraphicsPipe, VkPipelineLayout aGraphicsPipeLayout, VkExtent2D const& aImageExtent)
+	std::uint32_t gbuffer_draw_command_count(ModelVertexTexturePack const& aMesh)
 	{
-		// Begin recording commands
-		VkCommandBufferBeginInfo begInfo{};
-		begInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-		begInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
-		begInfo.pInheritanceInfo = nullptr;
+#ifdef MESHLET_CULLING
+		return std::max(std::uint32_t(aMesh.meshlets.size()), 1u);
+#else
+		return 1;
+#endif
+	}
 
-		if (auto const res = vkBeginCommandBuffer(aCmdBuff, &begInfo); VK_SUCCESS != res)
+	std::uint32_t assign_gbuffer_draw_commands(std::vector<std::vector<ModelVertexTexturePack>>& aModels)
+	{
+		std::uint32_t count = 0;
+		for (auto& model : aModels)
 		{
-			throw lut::Error("Unable to begin recording command buffer\n"
-				"vkBeginCommandBuffer() returned %s", lut::to_string(res).c_str());
+			for (auto& mesh : model)
+			{
+				mesh.firstDrawCommand = count;
+				count += gbuffer_draw_command_count(mesh);
+			}
 		}
 
-		// Convert color image buffer back into depth image buffer
-		lut::image_barrier(
-			aCmdBuff,
-			framebufferPack.depthAttachment->lutImage.image,
-			VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT,
-			VK_ACCESS_SHADER_READ_BIT,
-			VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL,
-			VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
-			VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT,
-			VK_PIPELINE_STAGE_VERTEX_SHADER_BIT,
-			{ VK_IMAGE_ASPECT_DEPTH_BIT,0, 1, 0, 1 });
-		
-		// Begin render pass
-		VkClearValue clearValues[1]{};
-		clearValues[0].color.float32[0] = 0.1f; // Clear to a dark gray background. 
-		clearValues[0].color.float32[1] = 0.1f; // If we were debugging, this would potentially 
-		clearValues[0].color.float32[2] = 0.1f; // help us see whether the render pass took 
-		clearValues[0].color.float32[3] = 1.f;  // place, even if nothing else was drawn.
-
-		// Update uniform buffers
-		for (std::uint32_t i = 0; i < updateBufferCount; ++i)
-			updateBuffer[i].update_ubo_data(aCmdBuff);
-
-
-		// Begin render pass
-		VkRenderPassBeginInfo passInfo{};
-		passInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
-		passInfo.renderPass = scframebufferPack.renderPass.handle;
-		passInfo.framebuffer = scframebufferPack.framebuffers[framebufferIndex].handle;
-		passInfo.renderArea.offset = VkOffset2D{ 0, 0 };
-		passInfo.renderArea.extent = VkExtent2D{ aImageExtent.width, aImageExtent.height };
-		passInfo.clearValueCount = 1;
-		passInfo.pClearValues = clearValues;
-		vkCmdBeginRenderPass(aCmdBuff, &passInfo, VK_SUBPASS_CONTENTS_INLINE);
-
-
-		// Commands
-		vkCmdBindPipeline(aCmdBuff, VK_PIPELINE_BIND_POINT_GRAPHICS, aGraphicsPipe);
+		return count;
+	}
 
-		// Binding descriptor sets
-		for (std::uint32_t i = 0; i < uniformDescSetCount; ++i)
-			vkCmdBindDescriptorSets(aCmdBuff, VK_PIPELINE_BIND_POINT_GRAPHICS, aGraphicsPipeLayout, i, 1, &uniformDescSets[i], 0, nullptr);
+	void write_gbuffer_draw_commands(VkDrawIndexedIndirectCommand* aCommands, std::vector<ModelVertexTexturePack> const& aMeshes,
+		VkExtent2D const& aImageExtent, MeshletCullInfo const& aCullInfo)
+	{
+		for (ModelVertexTexturePack const& mesh : aMeshes)
+		{
+			VkDrawIndexedIndirectCommand* const commands = aCommands + mesh.firstDrawCommand;
+			std::uint32_t const count = gbuffer_draw_command_count(mesh);
 
+			// Commands that draw nothing, unless overwritten below
+			std::fill_n(commands, count, VkDrawIndexedIndirectCommand{});
 
-		// Draw a mesh
-		vkCmdDraw(aCmdBuff, 6, 1, 0, 0);
+			auto const draw = [&](VkDrawIndexedIndirectCommand& aCommand, std::uint32_t aFirstIndex, std::uint32_t aIndexCount)
+			{
+				aCommand.indexCount = aIndexCount;
+				aCommand.instanceCount = 1;
+				aCommand.firstIndex = mesh.firstIndex + aFirstIndex;
+				aCommand.vertexOffset = std::int32_t(mesh.geometry.vertexOffset);
+				aCommand.firstInstance = 0;
+			};
+
+			// Coarser levels of detail are drawn as a whole. Meshlets only
+			// exist for the full-detail mesh.
+			if (std::size_t const lod = select_mesh_lod(mesh, aImageExtent.height); lod > 0)
+			{
+				MeshLod const& range = mesh.lods[lod - 1];
+				draw(commands[0], range.firstIndex, range.indexCount);
+				continue;
+			}
 
+#ifdef MESHLET_CULLING
+			if (mesh.meshlets.empty())
+			{
+				draw(commands[0], 0, mesh.indexCount);
+				continue;
+			}
 
-		// End the render pass 
-		vkCmdEndRenderPass(aCmdBuff);
+			// Cull meshlets, and merge runs of consecutive visible meshlets
+			// into the command of the run's first meshlet
+			VkDrawIndexedIndirectCommand* run = nullptr;
+			for (std::uint32_t i = 0; i < count; ++i)
+			{
+				MeshletInfo const& meshlet = mesh.meshlets[i];
+				if (!is_meshlet_visible(meshlet, aCullInfo))
+				{
+					run = nullptr;
+					continue;
+				}
 
-		
-		// End command recording
-		if (auto const res = vkEndCommandBuffer(aCmdBuff); VK_SUCCESS != res)
-		{
-			throw lut::Error("Unable to end recording command buffer\n"
-				"vkEndCommandBuffer() returned %s", lut::to_string(res).c_str());
+				if (run && run->firstIndex + run->indexCount == mesh.firstIndex + meshlet.indexStartIndex)
+					run->indexCount += meshlet.numberOfIndices;
+				else
+					draw(*(run = &commands[i]), meshlet.indexStartIndex, meshlet.numberOfIndices);
+			}
+#else
+			draw(commands[0], 0, mesh.indexCount);
+#endif
 		}
-		
 	}
 
-
-	void submit_commands(lut::VulkanContext const& aContext, VkPipelineStageFlags* waitPipelineStages,  VkCommandBuffer aCmdBuff, VkFence aFence, VkSemaphore* waitSemaphores, std::uint32_t waitSemaphoreCount, VkSemaphore aSignalSemaphore)
+	std::uint64_t submit_commands(lut::VulkanContext const& aContext, VkPipelineStageFlags* waitPipelineStages,  VkCommandBuffer aCmdBuff, VkSemaphore* waitSemaphores, std::uint32_t waitSemaphoreCount, VkSemaphore aSignalSemaphore)
 	{
-		
+		lut::Timeline& graphicsTimeline = aContext.timelines->graphics;
+
+		// the binary semaphore ignores its value
+		VkSemaphore const signalSemaphores[2] = {aSignalSemaphore, graphicsTimeline.handle()};
+		std::uint64_t signalValues[2] = {0, 0};
+
+		VkTimelineSemaphoreSubmitInfo timelineInfo{};
+		timelineInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+		timelineInfo.signalSemaphoreValueCount = 2;
+		timelineInfo.pSignalSemaphoreValues = signalValues;
 
 		VkSubmitInfo submitInfo{};
 		submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+		submitInfo.pNext = &timelineInfo;
 		submitInfo.commandBufferCount = 1;
 		submitInfo.pCommandBuffers = &aCmdBuff;
 
@@ -1249,29 +1425,53 @@ namespace
 		
 		submitInfo.pWaitDstStageMask = waitPipelineStages; // number of stage masks should match the number of semaphore
 
-		submitInfo.signalSemaphoreCount = 1;
-		submitInfo.pSignalSemaphores = &aSignalSemaphore;
+		submitInfo.signalSemaphoreCount = 2;
+		submitInfo.pSignalSemaphores = signalSemaphores;
 
 
-		if (auto const res = vkQueueSubmit(aContext.graphicsQueue, 1, &submitInfo, aFence);
+		// use and reserve the value under the queue lock, so that values are
+		// signalled in order. It is only reserved once the submission
+		// succeeded; otherwise, nothing may wait for it.
+		std::scoped_lock queueLock(aContext.queueMutex);
+		signalValues[1] = graphicsTimeline.upcoming();
+		if (auto const res = vkQueueSubmit(aContext.graphicsQueue, 1, &submitInfo, VK_NULL_HANDLE);
 			VK_SUCCESS != res)
 		{
 			throw lut::Error("Unable to submit command buffer to queue\n"
 				"vkQueueSubmit() returned %s", lut::to_string(res).c_str());
 		}
 
-		
+		return graphicsTimeline.next();
 	}
 
 }
 
 int main() try
 {
+	auto const startTime = std::chrono::steady_clock::now();
+
 	glsl::lightManager.updateLightSet();
 
+	if (cfg::kBenchmarkObjParsing)
+	{
+		benchmark_obj_parsing({ cfg::materialtestObjectPath, cfg::newShipObjectPath }, cfg::kBenchmarkObjBytes);
+		return 0;
+	}
+
+	if (cfg::kBenchmarkMeshOptimization)
+	{
+		benchmark_mesh_optimization({ cfg::materialtestObjectPath, cfg::newShipObjectPath });
+		return 0;
+	}
+
+	if (cfg::kCheckVertexQuantization)
+	{
+		check_vertex_quantization();
+		return 0;
+	}
 
 	// Create Vulkan Window
-	lut::VulkanWindow window = lut::make_vulkan_window();
+	lut::VulkanWindow window = lut::make_vulkan_window(cfg::kUseTransferQueue);
 	// Configure the GLFW window
 	glfwSetKeyCallback(window.window, &glfw_callback_key_press);
 	glfwSetCursorPosCallback(window.window, &mouse_pos_callback);
@@ -1280,6 +1480,16 @@ int main() try
 	// Create VMA allocator
 	lut::Allocator allocator = lut::create_allocator(window);
 
+	if (cfg::kBenchmarkMipGeneration)
+	{
+		benchmark_mip_generation(window, allocator, { cfg::materialtestObjectPath, cfg::newShipObjectPath });
+		return 0;
+	}
+
+	// Samplers with identical parameters are created once and shared by the
+	// mesh textures
+	lut::SamplerCache samplers(window);
+
 	// create descriptor pool
 	lut::DescriptorPool dpool = lut::create_descriptor_pool(window);
 
@@ -1293,75 +1503,146 @@ int main() try
 	// create vector to store all descriptor set layouts for [ pipeline 0 ]
 	std::vector<lut::DescriptorSetLayout> layouts;
 
-	// Create descriptor set for uniform block
-	std::vector<desc::DescriptorSetPack> descriptorSetPacks;
-	descriptorSetPacks.emplace_back(desc::create_descriptor_set_for_uniform_buffer(window, allocator, dpool.handle,
+	// Create descriptor set for uniform block, one per frame in flight. Each
+	// frame updates its own buffer, while the GPU may still read the others.
+	std::vector<std::vector<desc::DescriptorSetPack>> descriptorSetPacks(cfg::kFramesInFlight);
+	descriptorSetPacks[0].emplace_back(desc::create_descriptor_set_for_uniform_buffer(window, allocator, dpool.handle,
 		layouts, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT, { sizeof(glsl::SceneUniform) }, 1));
 
+	for (std::uint32_t i = 1; i < cfg::kFramesInFlight; ++i)
+	{
+		descriptorSetPacks[i].emplace_back(desc::create_descriptor_set_for_uniform_buffer(window, allocator, dpool.handle,
+			layouts[0].handle, { sizeof(glsl::SceneUniform) }, 1));
+	}
+
 
 	// update pointer that point to the data needed by the uniform buffer in the later steps
 	glsl::SceneUniform matrixUniform{};
-	descriptorSetPacks[0].data.emplace_back(&matrixUniform);
+	for (auto& framePacks : descriptorSetPacks)
+		framePacks[0].data.emplace_back(&matrixUniform);
 
 	
 
-	// Load mesh
-	ModelData materialtestModel = load_obj_model(cfg::materialtestObjectPath);
-	ModelData newShipModel = load_obj_model(cfg::newShipObjectPath);
+	// create texture layout: the bindless table, or one texture per set
+	bool const bindlessTextures = cfg::kBindlessTextures && window.descriptorIndexing;
+	std::uint32_t const textureCount = bindlessTextures ? bindless_texture_capacity(window) : 1;
+
+	if (bindlessTextures)
+		layouts.emplace_back(create_bindless_texture_layout(window, textureCount));
+	else
+		layouts.emplace_back(desc::create_descriptor_layout(window, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT));
+
+	layouts.emplace_back(create_material_table_layout(window));
+
+	std::fprintf(stderr, bindlessTextures ? "Bindless textures: %u slots\n" : "Bindless textures: not supported, using one set per texture\n", textureCount);
+
+	// All textures, if bindless. Declared before the meshes, which release
+	// their slots.
+	std::optional<BindlessTextureTable> bindlessTable;
+	if (bindlessTextures)
+		bindlessTable.emplace(window, (layouts.end() - 2)->handle, textureCount);
 
+	// materials of all meshes, one slot per mesh
+	MaterialTable materialTable(window, allocator, layouts.back().handle, kMaxMaterials);
 
-	// create texture layout
-	layouts.emplace_back(desc::create_descriptor_layout(window, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT));
-	layouts.emplace_back(desc::create_descriptor_layout(window, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_FRAGMENT_BIT));
 
+	// store model attributes into buffers. Meshes are added as they finish
+	// loading; the ones that aren't resident yet are not drawn.
+	std::vector<std::vector<ModelVertexTexturePack>> modelBuffer(2);
 
-	// store model attributes into buffers
-	std::vector<std::vector<ModelVertexTexturePack>> modelBuffer;
+	// vertex attributes (position, texcoord, normal) and indices of all meshes
+	lut::GeometryArena geometryArena(allocator, { vtx::kPositionSize, vtx::kTexcoordSize, vtx::kNormalSize },
+		cfg::kArenaVertexCapacity, cfg::kArenaIndexBytes);
 
-	modelBuffer.emplace_back();
-	modelBuffer.emplace_back();
+	// Load mesh
+	AssetLoader loader(window, allocator, geometryArena, samplers, { cfg::materialtestObjectPath, cfg::newShipObjectPath },
+		(layouts.end() - 2)->handle, materialTable, bindlessTable ? &*bindlessTable : nullptr);
 
-	for (int i = 0; i < materialtestModel.meshes.size(); ++i)
-		modelBuffer[0].emplace_back(create_model_attribute_set(window, allocator, materialtestModel, (layouts.end() - 2)->handle, layouts.back().handle, dpool.handle, i));
-	for (int i = 0; i < newShipModel.meshes.size(); ++i)
-		modelBuffer[1].emplace_back(create_model_attribute_set(window, allocator, newShipModel, (layouts.end() - 2)->handle, layouts.back().handle, dpool.handle, i));
+	if (!cfg::kLoadAssetsInBackground)
+	{
+		while (!loader.done())
+		{
+			loader.poll(modelBuffer);
+			std::this_thread::yield();
+		}
+	}
 
 
 	// New for this course work ... >
 	
-	// Create attachments for render pass (and framebuffer)
-	Attachment colorAttachments[3] = {
-		{window, allocator, VK_FORMAT_R16G16B16A16_SFLOAT, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT },
-		{window, allocator, VK_FORMAT_R16G16B16A16_SFLOAT, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT },
-		{window, allocator, VK_FORMAT_R16G16B16A16_SFLOAT, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT }
-	};
-	
-	Attachment depthAttachment{ window, allocator, cfg::kDepthFormat, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT };
+	// Create the G-buffer attachments. They are only read by the lighting
+	// subpass, as input attachments, so they are transient.
+	VkImageUsageFlags const gbufferUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_INPUT_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT;
+	VkImageUsageFlags const depthUsage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_INPUT_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT;
+
+	// One G-buffer per frame slot, such that a frame's G-buffer subpass
+	// doesn't wait for the previous frame's lighting subpass. With lazily
+	// allocated memory, the extra copies take (almost) no memory.
+	constexpr unsigned int kGBufferAttachmentCount = 3;
+
+	std::vector<Attachment> gbufferAttachments; // [frame slot * 3 + i]
+	std::vector<Attachment> depthAttachments; // [frame slot]
+	gbufferAttachments.reserve(cfg::kFramesInFlight * kGBufferAttachmentCount);
+	depthAttachments.reserve(cfg::kFramesInFlight);
+
+	for (std::uint32_t i = 0; i < cfg::kFramesInFlight; ++i)
+	{
+		for (unsigned int j = 0; j < kGBufferAttachmentCount; ++j)
+			gbufferAttachments.emplace_back(window, allocator, VK_FORMAT_R16G16B16A16_SFLOAT, gbufferUsage);
 
-	// Framebuffer pack
-	FramebufferPack framebufferPack(window, colorAttachments, 3, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, &depthAttachment);
+		depthAttachments.emplace_back(window, allocator, cfg::kDepthFormat, depthUsage);
+	}
+
+	std::fprintf(stderr, depthAttachments[0].lazilyAllocated ? "G-buffer: lazily allocated\n" : "G-buffer: lazily allocated memory not supported, using device memory\n");
+
+	// The G-buffer of a frame slot is reused only after FrameScheduler has
+	// waited for the slot's previous frame, whose graphics timeline signal
+	// made its writes available, so the G-buffer subpass needs no external
+	// dependency. The swapchain image is written once the acquire semaphore,
+	// which the submission waits for at the color attachment output stage, is
+	// signalled.
+	VkSubpassDependency externalDeps[1]{};
+	externalDeps[0].srcSubpass = VK_SUBPASS_EXTERNAL;
+	externalDeps[0].dstSubpass = DeferredFramebufferPack::kLightingSubpass;
+	externalDeps[0].srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+	externalDeps[0].dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+	externalDeps[0].srcAccessMask = 0;
+	externalDeps[0].dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+
+	// G-buffer and lighting subpasses, one framebuffer per frame slot and
+	// swapchain image
+	DeferredFramebufferPack deferredPack(window, gbufferAttachments.data(), kGBufferAttachmentCount, depthAttachments.data(), cfg::kFramesInFlight, externalDeps, 1);
 	
 	// ... end new.
 
 	// [ Pipeline 0 ]
-	lut::PipelineLayout pipeLayout = create_pipeline_layout(window, layouts);
-	lut::Pipeline pipe = create_pipeline(window, framebufferPack.renderPass.handle, pipeLayout.handle, cfg::vertexInputInfo);
+	VkPushConstantRange meshPushConstantRange{};
+	meshPushConstantRange.stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT;
+	meshPushConstantRange.offset = 0;
+	meshPushConstantRange.size = sizeof(glsl::MeshPushConstants);
+
+	lut::PipelineLayout pipeLayout = create_pipeline_layout(window, layouts, { meshPushConstantRange });
+	lut::Pipeline pipe = create_pipeline(window, deferredPack.renderPass.handle, pipeLayout.handle, cfg::vertexInputInfo, textureCount);
 
 
 	//-------------//
 	// pipeline 01 // 
 	//-------------//
 	
-	// create new uniform buffer for light properties for the final render frag shader.
-	desc::Buffer lightBuffer = { lut::create_buffer(allocator, sizeof(glsl::LightSet),VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
-		VMA_MEMORY_USAGE_GPU_ONLY), sizeof(glsl::LightSet), &glsl::lightManager.lightset };
+	// create new uniform buffer for light properties for the final render frag shader, one per frame in flight.
+	std::vector<desc::Buffer> lightBuffers;
+	for (std::uint32_t i = 0; i < cfg::kFramesInFlight; ++i)
+	{
+		lightBuffers.emplace_back(desc::Buffer{ lut::create_buffer(allocator, sizeof(glsl::LightSet),VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+			VMA_MEMORY_USAGE_GPU_ONLY), sizeof(glsl::LightSet), &glsl::lightManager.lightset });
+	}
 	// set layout
 	VkDescriptorSetLayoutBinding layoutBindings[5];
 
-	layoutBindings[0] = desc::create_descriptor_layout_binding(0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT);
-	layoutBindings[1] = desc::create_descriptor_layout_binding(1, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT);
-	layoutBindings[2] = desc::create_descriptor_layout_binding(2, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT);
-	layoutBindings[3] = desc::create_descriptor_layout_binding(3, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT);
+	layoutBindings[0] = desc::create_descriptor_layout_binding(0, VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT, VK_SHADER_STAGE_FRAGMENT_BIT);
+	layoutBindings[1] = desc::create_descriptor_layout_binding(1, VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT, VK_SHADER_STAGE_FRAGMENT_BIT);
+	layoutBindings[2] = desc::create_descriptor_layout_binding(2, VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT, VK_SHADER_STAGE_FRAGMENT_BIT);
+	layoutBindings[3] = desc::create_descriptor_layout_binding(3, VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT, VK_SHADER_STAGE_FRAGMENT_BIT);
 	layoutBindings[4] = desc::create_descriptor_layout_binding(4, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_FRAGMENT_BIT);
 
 
@@ -1370,113 +1651,164 @@ int main() try
 	lut::DescriptorSetLayout setLayout;
 	setLayout = desc::create_descriptor_layout(window, layoutBindings, 5);
 
-	// create image / buffer info
-	desc::ImageInfo imageInfos[4];
-	labutils::Sampler sampler = labutils::create_default_sampler(window, VK_TRUE);
-	imageInfos[0] = { &colorAttachments[0].lutImage, desc::create_desc_image_info(colorAttachments[0].imageView.handle,sampler.handle), 0 };
-	imageInfos[1] = { &colorAttachments[1].lutImage, desc::create_desc_image_info(colorAttachments[1].imageView.handle,sampler.handle), 1 };
-	imageInfos[2] = { &colorAttachments[2].lutImage, desc::create_desc_image_info(colorAttachments[2].imageView.handle,sampler.handle), 2 };
-	imageInfos[3] = { &depthAttachment.lutImage, desc::create_desc_image_info(depthAttachment.imageView.handle,sampler.handle), 3 };
-
-	desc::BufferInfo bufferInfos[1];
+	std::vector<desc::BufferInfo> bufferInfos(cfg::kFramesInFlight);
 	
-	bufferInfos[0] = { &lightBuffer,  desc::create_desc_buffer_info(lightBuffer.buffer.buffer),    4 };
+	for (std::uint32_t i = 0; i < cfg::kFramesInFlight; ++i)
+		bufferInfos[i] = { &lightBuffers[i],  desc::create_desc_buffer_info(lightBuffers[i].buffer.buffer),    4 };
 	
 
 
-	// finally create descriptor set 
-	VkDescriptorSet descSet;
-	descSet = desc::create_descriptor_set(window, dpool.handle, setLayout.handle, bufferInfos, 1, imageInfos, 4);
+	// finally create descriptor set, one per frame in flight, with the frame's
+	// G-buffer and light buffer; input attachments have no sampler
+	auto const create_lighting_desc_set = [&](std::uint32_t aFrame)
+	{
+		Attachment* const gbuffer = &gbufferAttachments[aFrame * kGBufferAttachmentCount];
+		Attachment& depth = depthAttachments[aFrame];
 
+		desc::ImageInfo imageInfos[4];
+		imageInfos[0] = { &gbuffer[0].lutImage, desc::create_desc_image_info(gbuffer[0].imageView.handle, VK_NULL_HANDLE), 0, VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT };
+		imageInfos[1] = { &gbuffer[1].lutImage, desc::create_desc_image_info(gbuffer[1].imageView.handle, VK_NULL_HANDLE), 1, VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT };
+		imageInfos[2] = { &gbuffer[2].lutImage, desc::create_desc_image_info(gbuffer[2].imageView.handle, VK_NULL_HANDLE), 2, VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT };
+		imageInfos[3] = { &depth.lutImage, desc::create_desc_image_info(depth.imageView.handle, VK_NULL_HANDLE, VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL), 3, VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT };
+
+		return desc::create_descriptor_set(window, dpool.handle, setLayout.handle, &bufferInfos[aFrame], 1, imageInfos, 4);
+	};
+
+	std::vector<VkDescriptorSet> descSets(cfg::kFramesInFlight);
+	for (std::uint32_t i = 0; i < cfg::kFramesInFlight; ++i)
+		descSets[i] = create_lighting_desc_set(i);
 
-	// Framebuffer and Render pass for [ Pipeline 1 ]
-	SwapChainFramebufferPack swapChainFramebufferPack(window);
 
 	// [ Pipeline 1 ]
-	VkDescriptorSetLayout setLayouts[2] = { setLayout.handle, descriptorSetPacks[0].layout};
+	VkDescriptorSetLayout setLayouts[2] = { setLayout.handle, descriptorSetPacks[0][0].layout};
 
 	lut::PipelineLayout defPipeLayout = create_pipeline_layout(window, setLayouts, 2);
 	
-	lut::Pipeline defPipe = create_pipeline_without_vertex_input(window, swapChainFramebufferPack.renderPass.handle, defPipeLayout.handle);
+	lut::Pipeline defPipe = create_pipeline_without_vertex_input(window, deferredPack.renderPass.handle, DeferredFramebufferPack::kLightingSubpass, defPipeLayout.handle);
 
 
-	// Command
+	// Command buffers, fences and semaphores of each frame in flight
 	lut::CommandPool cpool = lut::create_command_pool(window, VK_COMMAND_POOL_CREATE_TRANSIENT_BIT | VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT);
-	std::vector<VkCommandBuffer> drawCmdbuffers;
-	std::vector<lut::Fence> drawCmdbfences;
+	FrameScheduler frames(window, cpool.handle, cfg::kFramesInFlight);
 
-	for (std::size_t i = 0; i < swapChainFramebufferPack.framebuffers.size(); ++i)
+	// G-buffer draws of each model, recorded in parallel once per frame slot
+	// and reused until they change. The camera only changes the draw
+	// commands that they read from the frame slot's indirect draw buffer.
+	CommandCache gbufferDraws(window, std::uint32_t(modelBuffer.size()), cfg::kFramesInFlight, cfg::kRecordThreads);
+	IndirectDrawBuffer drawCommands(window, allocator, cfg::kFramesInFlight);
+	drawCommands.reserve(assign_gbuffer_draw_commands(modelBuffer));
+
+	if (cfg::kBenchmarkCommandRecording)
 	{
-		drawCmdbuffers.emplace_back(lut::alloc_command_buffer(window, cpool.handle));
-		drawCmdbfences.emplace_back(lut::create_fence(window, VK_FENCE_CREATE_SIGNALED_BIT));
-	}
+		while (!loader.done())
+		{
+			loader.poll(modelBuffer);
+			std::this_thread::yield();
+		}
 
+		drawCommands.reserve(assign_gbuffer_draw_commands(modelBuffer));
 
-	VkCommandBuffer offscreenCmdBuffer = lut::alloc_command_buffer(window, cpool.handle);
-	
-	lut::Fence offscreenfence = lut::create_fence(window, VK_FENCE_CREATE_SIGNALED_BIT);
+		// Synthetic scene: the meshes of both models, repeated until there
+		// are kBenchmarkDrawCount of them
+		std::vector<ModelVertexTexturePack const*> sceneMeshes;
+		for (auto const& model : modelBuffer)
+		{
+			for (auto const& mesh : model)
+				sceneMeshes.emplace_back(&mesh);
+		}
 
-	
+		if (sceneMeshes.empty())
+			throw lut::Error("No meshes to benchmark command recording with");
+
+		VkCommandBufferInheritanceInfo inheritance{};
+		inheritance.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+		inheritance.renderPass = deferredPack.renderPass.handle;
+		inheritance.subpass = DeferredFramebufferPack::kGBufferSubpass;
+		inheritance.framebuffer = VK_NULL_HANDLE; // one per swapchain image
 
-	// Semaphores
-	lut::Semaphore imageAvailable = lut::create_semaphore(window);
-	lut::Semaphore offscreenFinished = lut::create_semaphore(window);
-	lut::Semaphore renderFinished = lut::create_semaphore(window);
+		benchmark_command_recording(window, inheritance, cfg::kBenchmarkDrawCount, [&](VkCommandBuffer aCmdBuff, std::size_t aFirst, std::size_t aEnd)
+		{
+			record_gbuffer_draws(aCmdBuff, descriptorSetPacks[0], pipe.handle, pipeLayout.handle, geometryArena, aFirst, aEnd,
+				[&](std::size_t aMesh) -> ModelVertexTexturePack const& { return *sceneMeshes[aMesh % sceneMeshes.size()]; },
+				drawCommands.buffer(0), window.maxDrawIndirectCount, bindlessTable ? bindlessTable->set() : VK_NULL_HANDLE, materialTable.set());
+		});
+
+		loader.stop();
+		vkDeviceWaitIdle(window.device);
+		return 0;
+	}
 
 
 	// Application main loop
 	bool recreateSwapchain = false;
+	bool firstFramePresented = false;
 
 
 	while (!glfwWindowShouldClose(window.window))
 	{
 		// window event check
 		glfwPollEvents();
+
+		// pick up meshes that have finished loading
+		if (!loader.done())
+		{
+			if (loader.poll(modelBuffer) > 0)
+			{
+				drawCommands.reserve(assign_gbuffer_draw_commands(modelBuffer));
+				gbufferDraws.invalidate();
+			}
+
+			if (loader.done())
+			{
+				auto const elapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime).count();
+				std::printf("All assets resident after %.1f ms\n", elapsed);
+			}
+		}
 		
 		// Recreate swap chain
 		if (recreateSwapchain)
 		{
 			//re-create swapchain and associated resources!
-			vkDeviceWaitIdle(window.device);
+			{
+				std::scoped_lock queueLock(window.queueMutex, window.transferQueueMutex);
+				vkDeviceWaitIdle(window.device);
+			}
 
 			auto const changes = recreate_swapchain(window);
 
 			// re-create render pass
 			if (changes.changedFormat)
 			{
-				swapChainFramebufferPack.create_render_pass(window);
-				framebufferPack.create_render_pass(window, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+				deferredPack.create_render_pass(window, externalDeps, 1);
 			}
 
 
 			// re-create pipeline
 			if (changes.changedSize)
 			{
-				pipe = create_pipeline(window, framebufferPack.renderPass.handle, pipeLayout.handle, cfg::vertexInputInfo);
-				defPipe = create_pipeline_without_vertex_input(window, swapChainFramebufferPack.renderPass.handle, defPipeLayout.handle);
+				pipe = create_pipeline(window, deferredPack.renderPass.handle, pipeLayout.handle, cfg::vertexInputInfo, textureCount);
+				defPipe = create_pipeline_without_vertex_input(window, deferredPack.renderPass.handle, DeferredFramebufferPack::kLightingSubpass, defPipeLayout.handle);
 				
 				//std::tie(depthAttachment.lutImage, depthAttachment.imageView) = create_depth_buffer(window, allocator);
 				
-				// resize images for offscreen rendering
-				colorAttachments[0].create_image_buffer(window, allocator, VK_FORMAT_R16G16B16A16_SFLOAT, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT);
-				colorAttachments[1].create_image_buffer(window, allocator, VK_FORMAT_R16G16B16A16_SFLOAT, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT);
-				colorAttachments[2].create_image_buffer(window, allocator, VK_FORMAT_R16G16B16A16_SFLOAT, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT);
-				depthAttachment.create_image_buffer( window, allocator, cfg::kDepthFormat, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT );
+				// resize the G-buffers of all frame slots
+				for (auto& attachment : gbufferAttachments)
+					attachment.create_image_buffer(window, allocator, VK_FORMAT_R16G16B16A16_SFLOAT, gbufferUsage);
+				for (auto& attachment : depthAttachments)
+					attachment.create_image_buffer( window, allocator, cfg::kDepthFormat, depthUsage );
 				
-
-				imageInfos[0] = { &colorAttachments[0].lutImage, desc::create_desc_image_info(colorAttachments[0].imageView.handle,sampler.handle), 0 };
-				imageInfos[1] = { &colorAttachments[1].lutImage, desc::create_desc_image_info(colorAttachments[1].imageView.handle,sampler.handle), 1 };
-				imageInfos[2] = { &colorAttachments[2].lutImage, desc::create_desc_image_info(colorAttachments[2].imageView.handle,sampler.handle), 2 };
-				imageInfos[3] = { &depthAttachment.lutImage, desc::create_desc_image_info(depthAttachment.imageView.handle,sampler.handle), 3 };
-				
-				descSet = desc::create_descriptor_set(window, dpool.handle, setLayout.handle, bufferInfos, 1, imageInfos, 4);
+				for (std::uint32_t i = 0; i < cfg::kFramesInFlight; ++i)
+					descSets[i] = create_lighting_desc_set(i);
 
 
 			}
 
 			// clear framebuffers in the vector and recreate a new vector of framebuffer
-			framebufferPack.create_framebuffer(window);
-			swapChainFramebufferPack.create_framebuffer(window);
+			deferredPack.create_framebuffer(window);
+
+			// the pipeline, render pass and framebuffer of the G-buffer draws
+			// may have changed
+			gbufferDraws.invalidate();
 
 			// disable recreate 
 			recreateSwapchain = false;
@@ -1491,118 +1823,108 @@ int main() try
 		update_scene_uniforms(matrixUniform, window.swapchainExtent.width,
 			window.swapchainExtent.height);
 
-		// wait for the commands are all not be used
-		if (auto const res = vkWaitForFences(window.device, 1, &offscreenfence.handle, VK_TRUE, std::numeric_limits<std::uint64_t>::max());
-			VK_SUCCESS != res)
-		{
-			throw lut::Error("Unable to wait for offscreen command buffer fence \n");
-		}
+		// wait until the GPU has finished the frame that last used this
+		// slot; its command buffers and uniform buffers are free again
+		FrameScheduler::Frame& frame = frames.begin_frame();
+		std::uint32_t const frameIndex = frames.index();
 
-		// reset the fences to be unsignalled
-		if (auto const res = vkResetFences(window.device, 1, &offscreenfence.handle)
-			; VK_SUCCESS != res)
-		{
-			throw lut::Error("Unable to reset offscreen command buffer fence\n"
-				"vkResetFences() returned %s", lut::to_string(res).c_str()
-			);
-		}
-
-		// record and submit commands
-		record_offscreen_commands(offscreenCmdBuffer, descriptorSetPacks, framebufferPack, pipe.handle, pipeLayout.handle, window.swapchainExtent, modelBuffer);
-
-
-
-		submit_commands(
-			window,
-			nullptr,
-			offscreenCmdBuffer,
-			offscreenfence.handle,
-			VK_NULL_HANDLE,
-			0,
-			offscreenFinished.handle
-		);
-		
-		
-		
 		// acquire swapchain image.
 		std::uint32_t imageIndex = 0;
 		auto const acquireRes = vkAcquireNextImageKHR(
 			window.device,
 			window.swapchain,
 			std::numeric_limits<std::uint64_t>::max(),
-			imageAvailable.handle,
+			frame.imageAvailable.handle,
 			VK_NULL_HANDLE,
 			&imageIndex
 		);
 
-		// make sure commands are not used
-		assert(std::size_t(imageIndex) < drawCmdbfences.size());
-
-		// check info for the swapchain image
-		if (VK_SUBOPTIMAL_KHR == acquireRes || VK_ERROR_OUT_OF_DATE_KHR == acquireRes)
+		// check info for the swapchain image. A suboptimal image has been
+		// acquired (and signals imageAvailable), so it is still rendered and
+		// presented; the swapchain is recreated after that.
+		if (VK_ERROR_OUT_OF_DATE_KHR == acquireRes)
 		{
 			recreateSwapchain = true;
 			continue;
 		}
-
+		else if (VK_SUBOPTIMAL_KHR == acquireRes)
+		{
+			recreateSwapchain = true;
+		}
 		else if (VK_SUCCESS != acquireRes)
 		{
 			throw lut::Error("Unable to acquire enxt swapchain image\n"
 				"vkAcquireNextImageKHR() returned %s", lut::to_string(acquireRes).c_str()
 			);
 		}
-		
 
-		// wait for the commands are all not be used
-		if (auto const res = vkWaitForFences(window.device, 1, &drawCmdbfences[imageIndex].handle, VK_TRUE, std::numeric_limits<std::uint64_t>::max());
-			VK_SUCCESS != res)
-		{
-			throw lut::Error("Unable to wait for command buffer fence %u\n"
-				"vkWaitForFences() returned %s", imageIndex, lut::to_string(res).c_str()
-			);
-		}
+		assert(std::size_t(imageIndex) < deferredPack.framebuffers[frameIndex].size());
 
-		// reset the fences to be unsignalled
-		if (auto const res = vkResetFences(window.device, 1, &drawCmdbfences[imageIndex].handle)
-			; VK_SUCCESS != res)
-		{
-			throw lut::Error("Unable to reset command buffer fence %u\n"
-				"vkResetFences() returned %s", imageIndex, lut::to_string(res).c_str()
-			);
-		}
-
-		assert(std::size_t(imageIndex) < drawCmdbuffers.size());
-		assert(std::size_t(imageIndex) < swapChainFramebufferPack.framebuffers.size());
-
-		VkDescriptorSet descSets[2] = {descSet, descriptorSetPacks[0].descriptorSet};
-		record_draw_commands(drawCmdbuffers[imageIndex], descSets, 2, &lightBuffer, 1,framebufferPack,swapChainFramebufferPack, imageIndex, defPipe.handle, defPipeLayout.handle, window.swapchainExtent);
-
-		VkSemaphore waitSemaphores[2] = { offscreenFinished.handle , imageAvailable.handle };
-		VkPipelineStageFlags stageFlags[2] = { VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT , VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT };
+		VkCommandBufferInheritanceInfo inheritance{};
+		inheritance.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+		inheritance.renderPass = deferredPack.renderPass.handle;
+		inheritance.subpass = DeferredFramebufferPack::kGBufferSubpass;
+		inheritance.framebuffer = VK_NULL_HANDLE; // one per swapchain image
 
-
-		submit_commands(
+		std::uint32_t const modelIndex = cfg::isNewShip ? 1 : 0;
+		MeshletCullInfo const cullInfo = make_meshlet_cull_info(matrixUniform.projCam, matrixUniform.camPos);
+		auto const& draws = gbufferDraws.get(modelIndex, frameIndex, inheritance, modelBuffer[modelIndex].size(), [&](VkCommandBuffer aCmdBuff, std::size_t aFirst, std::size_t aEnd)
+		{
+			record_gbuffer_draws(aCmdBuff, descriptorSetPacks[frameIndex], pipe.handle, pipeLayout.handle, geometryArena, aFirst, aEnd,
+				[&](std::size_t aMesh) -> ModelVertexTexturePack const& { return modelBuffer[modelIndex][aMesh]; },
+				drawCommands.buffer(frameIndex), window.maxDrawIndirectCount, bindlessTable ? bindlessTable->set() : VK_NULL_HANDLE, materialTable.set());
+		});
+
+		// The level of detail selection and the meshlet culling only change
+		// the draw commands; material edits go through the material table.
+		// The draws are thus recorded again only when the model, its
+		// resident meshes or the swapchain change.
+		write_gbuffer_draw_commands(drawCommands.commands(frameIndex), modelBuffer[modelIndex], window.swapchainExtent, cullInfo);
+		drawCommands.flush(frameIndex);
+
+		// record and submit commands. The G-buffer and the lighting are a
+		// single render pass, so a single submission
+		VkDescriptorSet lightingDescSets[2] = {descSets[frameIndex], descriptorSetPacks[frameIndex][0].descriptorSet};
+		record_frame_commands(frame.cmdBuffer, descriptorSetPacks[frameIndex], lightBuffers[frameIndex], deferredPack, frameIndex, imageIndex, draws,
+			lightingDescSets, 2, defPipe.handle, defPipeLayout.handle, window.swapchainExtent);
+
+		VkPipelineStageFlags waitStage = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+
+		// the frame's last submission signals its graphics timeline value
+		std::uint64_t const graphicsValue = submit_commands(
 			window,
-			stageFlags,
-			drawCmdbuffers[imageIndex],
-			drawCmdbfences[imageIndex].handle,
-			waitSemaphores,
-			2,
-			renderFinished.handle
+			&waitStage,
+			frame.cmdBuffer,
+			&frame.imageAvailable.handle,
+			1,
+			frame.renderFinished.handle
 		);
+		frames.mark_submitted(graphicsValue);
 
 		//DONE: present rendered images.
 		VkPresentInfoKHR presentInfo{};
 		presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
 		presentInfo.waitSemaphoreCount = 1;
-		presentInfo.pWaitSemaphores = &renderFinished.handle;
+		presentInfo.pWaitSemaphores = &frame.renderFinished.handle;
 		presentInfo.swapchainCount = 1;
 		presentInfo.pSwapchains = &window.swapchain;
 		presentInfo.pImageIndices = &imageIndex;
 		presentInfo.pResults = nullptr;
 
 
-		auto const presentRes = vkQueuePresentKHR(window.presentQueue, &presentInfo);
+		VkResult presentRes;
+		{
+			std::scoped_lock queueLock(window.queueMutex);
+			presentRes = vkQueuePresentKHR(window.presentQueue, &presentInfo);
+		}
+
+		if (!firstFramePresented)
+		{
+			auto const elapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime).count();
+			std::printf("Time to first frame: %.1f ms\n", elapsed);
+			firstFramePresented = true;
+		}
+
 		if (VK_SUBOPTIMAL_KHR == presentRes || VK_ERROR_OUT_OF_DATE_KHR == presentRes)
 		{
 			recreateSwapchain = true;
@@ -1618,10 +1940,26 @@ int main() try
 		// update rotation angle
 		glsl::lightManager.updateRadian();
 
+		// CPU time spent waiting for the GPU
+		if (cfg::kFrameStatsInterval && frames.wait_stats().frames >= cfg::kFrameStatsInterval)
+		{
+			auto const& stats = frames.wait_stats();
+			std::printf("CPU wait per frame (%u in flight): %.3f ms average, %.3f ms max over %u frames\n",
+				frames.frames_in_flight(), stats.totalMs / stats.frames, stats.maxMs, stats.frames);
+			frames.reset_wait_stats();
+
+			auto const& drawStats = gbufferDraws.stats();
+			std::printf("G-buffer draws: recorded %llu times, reused %llu times\n",
+				static_cast<unsigned long long>(drawStats.recorded), static_cast<unsigned long long>(drawStats.reused));
+			gbufferDraws.reset_stats();
+		}
+
 	}
 
 	// Cleanup takes place automatically in the destructors, but we sill need
-	// to ensure that all Vulkan commands have finished before that.
+	// to ensure that all Vulkan commands have finished before that. This
+	// includes the uploads of the loader thread.
+	loader.stop();
 	vkDeviceWaitIdle(window.device);
 	return 0;
 
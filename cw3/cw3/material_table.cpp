@@ -0,0 +1,138 @@
+#include "material_table.hpp"
+
+#include <algorithm>
+
+#include <cstring>
+
+#include "../labutils/error.hpp"
+#include "../labutils/vkutil.hpp"
+#include "../labutils/to_string.hpp"
+namespace lut = labutils;
+
+namespace
+{
+	constexpr VkDeviceSize kRecordSize = sizeof(block::MaterialRecord);
+}
+
+MaterialTable::MaterialTable( lut::VulkanContext const& aContext, lut::Allocator const& aAllocator, VkDescriptorSetLayout aLayout, std::uint32_t aCapacity )
+	: mCapacity( aCapacity )
+{
+	mBuffer = lut::create_buffer(
+		aAllocator,
+		aCapacity * kRecordSize,
+		VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+		VMA_MEMORY_USAGE_GPU_ONLY
+	);
+
+	VkDescriptorPoolSize poolSize{};
+	poolSize.type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+	poolSize.descriptorCount = 1;
+
+	VkDescriptorPoolCreateInfo poolInfo{};
+	poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+	poolInfo.maxSets = 1;
+	poolInfo.poolSizeCount = 1;
+	poolInfo.pPoolSizes = &poolSize;
+
+	VkDescriptorPool pool = VK_NULL_HANDLE;
+	if( auto const res = vkCreateDescriptorPool( aContext.device, &poolInfo, nullptr, &pool ); VK_SUCCESS != res )
+	{
+		throw lut::Error( "Unable to create material descriptor pool\n"
+			"vkCreateDescriptorPool() returned %s", lut::to_string(res).c_str() );
+	}
+
+	mPool = lut::DescriptorPool( aContext.device, pool );
+	mSet = lut::alloc_desc_set( aContext, mPool.handle, aLayout );
+
+	VkDescriptorBufferInfo bufferInfo{};
+	bufferInfo.buffer = mBuffer.buffer;
+	bufferInfo.offset = 0;
+	bufferInfo.range = VK_WHOLE_SIZE;
+
+	VkWriteDescriptorSet desc{};
+	desc.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+	desc.dstSet = mSet;
+	desc.dstBinding = 0;
+	desc.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+	desc.descriptorCount = 1;
+	desc.pBufferInfo = &bufferInfo;
+
+	vkUpdateDescriptorSets( aContext.device, 1, &desc, 0, nullptr );
+}
+
+
+std::uint32_t MaterialTable::add( block::MaterialRecord const& aMaterial, lut::UploadBatch& aBatch )
+{
+	std::uint32_t const index = mNext.fetch_add( 1, std::memory_order_relaxed );
+	if( index >= mCapacity )
+		throw lut::Error( "Material table is full (%u materials)", mCapacity );
+
+	lut::StagingRegion const source = aBatch.stage( kRecordSize );
+	std::memcpy( source.data, &aMaterial, kRecordSize );
+
+	aBatch.copy_to_buffer( source, mBuffer.buffer, index * kRecordSize,
+		VK_ACCESS_SHADER_READ_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT );
+
+	return index;
+}
+
+void MaterialTable::update( VkCommandBuffer aCmdBuff, std::uint32_t aIndex, block::MaterialRecord const& aMaterial ) const
+{
+	VkDeviceSize const offset = aIndex * kRecordSize;
+
+	// Earlier draws may still read the slot
+	lut::buffer_barrier( aCmdBuff, mBuffer.buffer,
+		VK_ACCESS_SHADER_READ_BIT,
+		VK_ACCESS_TRANSFER_WRITE_BIT,
+		VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+		VK_PIPELINE_STAGE_TRANSFER_BIT,
+		kRecordSize, offset
+	);
+
+	vkCmdUpdateBuffer( aCmdBuff, mBuffer.buffer, offset, kRecordSize, &aMaterial );
+
+	lut::buffer_barrier( aCmdBuff, mBuffer.buffer,
+		VK_ACCESS_TRANSFER_WRITE_BIT,
+		VK_ACCESS_SHADER_READ_BIT,
+		VK_PIPELINE_STAGE_TRANSFER_BIT,
+		VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+		kRecordSize, offset
+	);
+}
+
+VkDescriptorSet MaterialTable::set() const noexcept
+{
+	return mSet;
+}
+std::uint32_t MaterialTable::capacity() const noexcept
+{
+	return mCapacity;
+}
+std::uint32_t MaterialTable::size() const noexcept
+{
+	return std::min( mNext.load( std::memory_order_relaxed ), mCapacity );
+}
+
+
+lut::DescriptorSetLayout create_material_table_layout( lut::VulkanContext const& aContext )
+{
+	VkDescriptorSetLayoutBinding binding{};
+	binding.binding = 0;
+	binding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+	binding.descriptorCount = 1;
+	binding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+
+	VkDescriptorSetLayoutCreateInfo layoutInfo{};
+	layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+	layoutInfo.bindingCount = 1;
+	layoutInfo.pBindings = &binding;
+
+	VkDescriptorSetLayout layout = VK_NULL_HANDLE;
+	if( auto const res = vkCreateDescriptorSetLayout( aContext.device, &layoutInfo, nullptr, &layout ); VK_SUCCESS != res )
+	{
+		throw lut::Error( "Unable to create material descriptor set layout\n"
+			"vkCreateDescriptorSetLayout() returned %s", lut::to_string(res).c_str() );
+	}
+
+	return lut::DescriptorSetLayout( aContext.device, layout );
+}
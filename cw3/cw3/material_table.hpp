@@ -0,0 +1,64 @@
+#pragma once
+
+#include <volk/volk.h>
+
+#include <atomic>
+
+#include <cstdint>
+
+#include "../labutils/vkobject.hpp"
+#include "../labutils/vkbuffer.hpp"
+#include "../labutils/allocator.hpp"
+#include "../labutils/upload_batch.hpp"
+#include "../labutils/vulkan_context.hpp"
+
+#include "vertex_data.h"
+
+/* The materials of all meshes in one storage buffer, as an array of
+ * block::MaterialRecord that shaders index with a per-draw value
+ * (MeshPushConstants::materialIndex). The buffer's set is bound once per
+ * frame instead of binding one uniform buffer per mesh.
+ *
+ * add() is thread safe. Slots are never reused; the capacity is fixed when
+ * the table is created.
+ */
+class MaterialTable
+{
+	public:
+		// The layout (see create_material_table_layout()), the context and
+		// the allocator must outlive the table.
+		MaterialTable( labutils::VulkanContext const&, labutils::Allocator const&, VkDescriptorSetLayout, std::uint32_t aCapacity );
+
+		MaterialTable( MaterialTable const& ) = delete;
+		MaterialTable& operator= (MaterialTable const&) = delete;
+
+	public:
+		// Reserves a slot and records the upload of aMaterial into it. The
+		// slot may be used once the batch's submission has completed.
+		// Throws an Error if all slots are in use.
+		std::uint32_t add( block::MaterialRecord const& aMaterial, labutils::UploadBatch& );
+
+		// Overwrites the slot with aMaterial. Must be recorded outside of a
+		// render pass; draws recorded after it see the new material. Only the
+		// slot's bytes are transferred.
+		void update( VkCommandBuffer, std::uint32_t aIndex, block::MaterialRecord const& aMaterial ) const;
+
+		VkDescriptorSet set() const noexcept;
+		std::uint32_t capacity() const noexcept;
+		std::uint32_t size() const noexcept;
+
+	private:
+		std::uint32_t mCapacity;
+
+		labutils::Buffer mBuffer;
+		labutils::DescriptorPool mPool;
+		VkDescriptorSet mSet = VK_NULL_HANDLE;
+
+		std::atomic<std::uint32_t> mNext{ 0 }; // first slot that was never used
+};
+
+constexpr std::uint32_t kMaxMaterials = 16384;
+
+// Set layout with a single storage buffer binding (0), visible to fragment
+// shaders.
+labutils::DescriptorSetLayout create_material_table_layout( labutils::VulkanContext const& );
@@ -0,0 +1,547 @@
+#include "mesh_lod.hpp"
+
+#include <queue>
+#include <vector>
+#include <numeric>
+#include <algorithm>
+#include <functional>
+
+#include <cmath>
+#include <cstdio>
+#include <cassert>
+
+#include "mesh_optimizer.hpp"
+
+namespace
+{
+	// Meshes with fewer triangles are not simplified.
+	constexpr std::size_t kMinLodTriangles = 64;
+
+	// A level is only kept if it has at most this fraction of the triangles
+	// of the previous one. Otherwise the simplification has stalled (e.g.,
+	// because most vertices are on seams), and no further levels are made.
+	constexpr float kMinLodReduction = 0.8f;
+
+	// Weight of the constraint planes along seams, relative to the planes of
+	// the faces. These keep seams from drifting.
+	constexpr double kSeamWeight = 10.0;
+
+	// Collapses are rejected if they rotate the normal of a remaining
+	// triangle by more than acos(kMinFlipCosine) (about 78 degrees).
+	constexpr double kMinFlipCosine = 0.2;
+
+	// Symmetric 4x4 matrix, representing the sum of squared distances to a
+	// set of planes.
+	struct Quadric_
+	{
+		double a2, ab, ac, ad;
+		double b2, bc, bd;
+		double c2, cd;
+		double d2;
+		double weight; // sum of the weights of the planes
+
+		void add_plane( glm::dvec3 const& aNormal, double aD, double aWeight ) noexcept
+		{
+			auto const& n = aNormal;
+			a2 += aWeight * n.x*n.x; ab += aWeight * n.x*n.y; ac += aWeight * n.x*n.z; ad += aWeight * n.x*aD;
+			b2 += aWeight * n.y*n.y; bc += aWeight * n.y*n.z; bd += aWeight * n.y*aD;
+			c2 += aWeight * n.z*n.z; cd += aWeight * n.z*aD;
+			d2 += aWeight * aD*aD;
+			weight += aWeight;
+		}
+
+		Quadric_& operator+= (Quadric_ const& aOther) noexcept
+		{
+			a2 += aOther.a2; ab += aOther.ab; ac += aOther.ac; ad += aOther.ad;
+			b2 += aOther.b2; bc += aOther.bc; bd += aOther.bd;
+			c2 += aOther.c2; cd += aOther.cd;
+			d2 += aOther.d2;
+			weight += aOther.weight;
+			return *this;
+		}
+
+		double evaluate( glm::dvec3 const& aP ) const noexcept
+		{
+			auto const x = aP.x, y = aP.y, z = aP.z;
+			return a2*x*x + 2.*ab*x*y + 2.*ac*x*z + 2.*ad*x
+				+ b2*y*y + 2.*bc*y*z + 2.*bd*y
+				+ c2*z*z + 2.*cd*z
+				+ d2
+			;
+		}
+	};
+
+	struct Collapse_
+	{
+		double cost;
+		double error; // mean squared distance
+		std::uint32_t from, to; // positions
+		std::uint32_t fromVersion, toVersion;
+
+		bool operator> (Collapse_ const& aOther) const noexcept
+		{
+			return cost > aOther.cost;
+		}
+	};
+
+	// Half-edge collapse simplifier. The connectivity is tracked on unique
+	// positions, since a position may be shared by several vertices (with
+	// different normals or texture coordinates). The triangles refer to the
+	// vertices, and are remapped to the matching vertices of the target
+	// position when a position is collapsed.
+	class Simplifier_
+	{
+		public:
+			Simplifier_( std::uint32_t const* aIndices, std::size_t aIndexCount, glm::vec3 const* aPositions, std::size_t aVertexCount );
+
+			// Collapses edges until at most aTargetTriangles triangles remain
+			// or no further collapse is possible. Returns the number of
+			// remaining triangles.
+			std::size_t simplify( std::size_t aTargetTriangles );
+
+			void get_indices( std::vector<std::uint32_t>& aIndices ) const;
+
+			// Largest error of any collapse so far. The error of a collapse
+			// is the RMS distance of the new position to the planes in its
+			// quadric, i.e., an estimate of the distance to the original
+			// surface rather than a bound.
+			float error() const noexcept;
+
+		private:
+			void push_( std::uint32_t aFrom, std::uint32_t aTo );
+			bool collapse_( Collapse_ const& );
+
+			std::uint32_t corner_( std::uint32_t aTriangle, std::uint32_t aPosition ) const noexcept;
+
+		private:
+			std::vector<std::uint32_t> mPositionOf; // vertex -> position
+			std::vector<glm::dvec3> mPositions;
+
+			std::vector<std::uint32_t> mTriangles;
+			std::vector<char> mTriangleAlive;
+			std::size_t mAliveCount = 0;
+
+			std::vector<std::vector<std::uint32_t>> mPositionTriangles;
+			std::vector<Quadric_> mQuadrics;
+			std::vector<char> mLocked, mRemoved;
+			std::vector<std::uint32_t> mVersion;
+
+			std::priority_queue<Collapse_, std::vector<Collapse_>, std::greater<Collapse_>> mQueue;
+			double mMaxError = 0.; // squared
+
+			// Scratch space for collapse_()
+			std::vector<std::uint32_t> mWedgeFrom, mWedgeTo;
+			std::vector<std::uint32_t> mNeighboursFrom, mNeighboursTo, mCommon;
+	};
+
+	Simplifier_::Simplifier_( std::uint32_t const* aIndices, std::size_t aIndexCount, glm::vec3 const* aPositions, std::size_t aVertexCount )
+	{
+		// Find unique positions, by sorting the vertices by position
+		std::vector<std::uint32_t> sorted( aVertexCount );
+		std::iota( sorted.begin(), sorted.end(), 0u );
+
+		auto const less = [aPositions] (std::uint32_t aA, std::uint32_t aB) {
+			auto const& a = aPositions[aA];
+			auto const& b = aPositions[aB];
+			if( a.x != b.x ) return a.x < b.x;
+			if( a.y != b.y ) return a.y < b.y;
+			return a.z < b.z;
+		};
+		std::sort( sorted.begin(), sorted.end(), less );
+
+		mPositionOf.resize( aVertexCount );
+		for( std::size_t i = 0; i < aVertexCount; ++i )
+		{
+			if( 0 == i || aPositions[sorted[i]] != aPositions[sorted[i-1]] )
+				mPositions.emplace_back( aPositions[sorted[i]] );
+
+			mPositionOf[sorted[i]] = std::uint32_t(mPositions.size()-1);
+		}
+
+		std::size_t const positionCount = mPositions.size();
+		mPositionTriangles.resize( positionCount );
+		mQuadrics.resize( positionCount, Quadric_{} );
+		mLocked.resize( positionCount, 0 );
+		mRemoved.resize( positionCount, 0 );
+		mVersion.resize( positionCount, 0 );
+
+		// Triangles. Triangles that are degenerate to begin with are dropped.
+		std::size_t const triangleCount = aIndexCount / 3;
+		mTriangles.assign( aIndices, aIndices + triangleCount*3 );
+		mTriangleAlive.resize( triangleCount, 0 );
+
+		for( std::size_t t = 0; t < triangleCount; ++t )
+		{
+			auto const p0 = mPositionOf[mTriangles[t*3+0]];
+			auto const p1 = mPositionOf[mTriangles[t*3+1]];
+			auto const p2 = mPositionOf[mTriangles[t*3+2]];
+			if( p0 == p1 || p1 == p2 || p2 == p0 )
+				continue;
+
+			mTriangleAlive[t] = 1;
+			++mAliveCount;
+
+			for( auto const p : { p0, p1, p2 } )
+				mPositionTriangles[p].emplace_back( std::uint32_t(t) );
+
+			// Plane of the face
+			auto const n = glm::cross( mPositions[p1] - mPositions[p0], mPositions[p2] - mPositions[p0] );
+			auto const length = glm::length( n );
+			if( length > 0. )
+			{
+				auto const normal = n / length;
+				auto const d = -glm::dot( normal, mPositions[p0] );
+				for( auto const p : { p0, p1, p2 } )
+					mQuadrics[p].add_plane( normal, d, 1. );
+			}
+		}
+
+		// Classify edges. Each edge is listed once per triangle, as
+		// (lower position, higher position, triangle).
+		struct Edge_ { std::uint32_t a, b, triangle; };
+		std::vector<Edge_> edges;
+		edges.reserve( mAliveCount*3 );
+
+		for( std::size_t t = 0; t < triangleCount; ++t )
+		{
+			if( !mTriangleAlive[t] )
+				continue;
+
+			for( std::size_t k = 0; k < 3; ++k )
+			{
+				auto const a = mPositionOf[mTriangles[t*3+k]];
+				auto const b = mPositionOf[mTriangles[t*3+(k+1)%3]];
+				edges.push_back( { std::min( a, b ), std::max( a, b ), std::uint32_t(t) } );
+			}
+		}
+
+		std::sort( edges.begin(), edges.end(), [] (Edge_ const& aX, Edge_ const& aY) {
+			return aX.a != aY.a ? aX.a < aY.a : aX.b != aY.b ? aX.b < aY.b : aX.triangle < aY.triangle;
+		} );
+
+		for( std::size_t i = 0; i < edges.size(); )
+		{
+			std::size_t j = i+1;
+			while( j < edges.size() && edges[j].a == edges[i].a && edges[j].b == edges[i].b )
+				++j;
+
+			auto const a = edges[i].a, b = edges[i].b;
+
+			if( 2 != j-i )
+			{
+				// Open border, or non-manifold edge
+				mLocked[a] = mLocked[b] = 1;
+			}
+			else
+			{
+				auto const t0 = edges[i].triangle, t1 = edges[i+1].triangle;
+				bool const seam = mTriangles[corner_( t0, a )] != mTriangles[corner_( t1, a )]
+					|| mTriangles[corner_( t0, b )] != mTriangles[corner_( t1, b )];
+
+				if( seam )
+				{
+					// Add planes through the edge, perpendicular to the faces
+					auto const edge = mPositions[b] - mPositions[a];
+					for( auto const t : { t0, t1 } )
+					{
+						auto const& q0 = mPositions[mPositionOf[mTriangles[t*3+0]]];
+						auto const& q1 = mPositions[mPositionOf[mTriangles[t*3+1]]];
+						auto const& q2 = mPositions[mPositionOf[mTriangles[t*3+2]]];
+
+						auto const n = glm::cross( glm::cross( q1 - q0, q2 - q0 ), edge );
+						auto const length = glm::length( n );
+						if( length > 0. )
+						{
+							auto const normal = n / length;
+							auto const d = -glm::dot( normal, mPositions[a] );
+							mQuadrics[a].add_plane( normal, d, kSeamWeight );
+							mQuadrics[b].add_plane( normal, d, kSeamWeight );
+						}
+					}
+				}
+			}
+
+			i = j;
+		}
+
+		// Initial collapses
+		for( std::size_t i = 0; i < edges.size(); ++i )
+		{
+			if( i > 0 && edges[i].a == edges[i-1].a && edges[i].b == edges[i-1].b )
+				continue;
+
+			push_( edges[i].a, edges[i].b );
+			push_( edges[i].b, edges[i].a );
+		}
+	}
+
+	std::size_t Simplifier_::simplify( std::size_t aTargetTriangles )
+	{
+		while( mAliveCount > aTargetTriangles && !mQueue.empty() )
+		{
+			auto const collapse = mQueue.top();
+			mQueue.pop();
+
+			if( mRemoved[collapse.from] || mRemoved[collapse.to] )
+				continue;
+			if( mVersion[collapse.from] != collapse.fromVersion || mVersion[collapse.to] != collapse.toVersion )
+				continue;
+
+			collapse_( collapse );
+		}
+
+		return mAliveCount;
+	}
+
+	void Simplifier_::get_indices( std::vector<std::uint32_t>& aIndices ) const
+	{
+		aIndices.clear();
+		aIndices.reserve( mAliveCount*3 );
+
+		for( std::size_t t = 0; t < mTriangleAlive.size(); ++t )
+		{
+			if( mTriangleAlive[t] )
+				aIndices.insert( aIndices.end(), mTriangles.begin() + t*3, mTriangles.begin() + t*3 + 3 );
+		}
+	}
+
+	float Simplifier_::error() const noexcept
+	{
+		return float(std::sqrt( mMaxError ));
+	}
+
+	void Simplifier_::push_( std::uint32_t aFrom, std::uint32_t aTo )
+	{
+		if( mLocked[aFrom] )
+			return;
+
+		Quadric_ q = mQuadrics[aFrom];
+		q += mQuadrics[aTo];
+
+		auto const cost = std::max( q.evaluate( mPositions[aTo] ), 0. );
+		auto const error = q.weight > 0. ? cost / q.weight : 0.;
+		mQueue.push( { cost, error, aFrom, aTo, mVersion[aFrom], mVersion[aTo] } );
+	}
+
+	std::uint32_t Simplifier_::corner_( std::uint32_t aTriangle, std::uint32_t aPosition ) const noexcept
+	{
+		for( std::size_t k = 0; k < 3; ++k )
+		{
+			if( mPositionOf[mTriangles[aTriangle*3+k]] == aPosition )
+				return std::uint32_t(aTriangle*3+k);
+		}
+
+		return ~std::uint32_t(0);
+	}
+
+	bool Simplifier_::collapse_( Collapse_ const& aCollapse )
+	{
+		auto const from = aCollapse.from, to = aCollapse.to;
+		constexpr auto kNone = ~std::uint32_t(0);
+
+		// Match the vertices at the removed position to vertices at the
+		// target position, via the triangles that contain the edge. Each
+		// vertex must have exactly one match.
+		mWedgeFrom.clear();
+		mWedgeTo.clear();
+		std::size_t sharedTriangles = 0;
+
+		for( auto const t : mPositionTriangles[from] )
+		{
+			if( !mTriangleAlive[t] )
+				continue;
+
+			auto const cTo = corner_( t, to );
+			if( kNone == cTo )
+				continue;
+
+			++sharedTriangles;
+
+			auto const wFrom = mTriangles[corner_( t, from )];
+			auto const wTo = mTriangles[cTo];
+
+			auto const it = std::find( mWedgeFrom.begin(), mWedgeFrom.end(), wFrom );
+			if( mWedgeFrom.end() == it )
+			{
+				mWedgeFrom.emplace_back( wFrom );
+				mWedgeTo.emplace_back( wTo );
+			}
+			else if( mWedgeTo[it - mWedgeFrom.begin()] != wTo )
+			{
+				return false; // ambiguous
+			}
+		}
+
+		if( 0 == sharedTriangles )
+			return false;
+
+		for( auto const t : mPositionTriangles[from] )
+		{
+			if( mTriangleAlive[t] && mWedgeFrom.end() == std::find( mWedgeFrom.begin(), mWedgeFrom.end(), mTriangles[corner_( t, from )] ) )
+				return false; // would move a vertex across a seam
+		}
+
+		// Link condition: the two positions may only share the neighbours
+		// that are part of the triangles on the edge. Otherwise the collapse
+		// would make the mesh non-manifold.
+		auto const gather_neighbours = [&] (std::uint32_t aPosition, std::vector<std::uint32_t>& aOut) {
+			aOut.clear();
+			for( auto const t : mPositionTriangles[aPosition] )
+			{
+				if( !mTriangleAlive[t] )
+					continue;
+
+				for( std::size_t k = 0; k < 3; ++k )
+				{
+					auto const p = mPositionOf[mTriangles[t*3+k]];
+					if( p != aPosition )
+						aOut.emplace_back( p );
+				}
+			}
+
+			std::sort( aOut.begin(), aOut.end() );
+			aOut.erase( std::unique( aOut.begin(), aOut.end() ), aOut.end() );
+		};
+
+		gather_neighbours( from, mNeighboursFrom );
+		gather_neighbours( to, mNeighboursTo );
+
+		mCommon.clear();
+		std::set_intersection( mNeighboursFrom.begin(), mNeighboursFrom.end(), mNeighboursTo.begin(), mNeighboursTo.end(), std::back_inserter( mCommon ) );
+		if( mCommon.size() != sharedTriangles )
+			return false;
+
+		// Reject collapses that flip (or nearly flip) remaining triangles
+		for( auto const t : mPositionTriangles[from] )
+		{
+			if( !mTriangleAlive[t] || kNone != corner_( t, to ) )
+				continue;
+
+			glm::dvec3 p[3];
+			for( std::size_t k = 0; k < 3; ++k )
+				p[k] = mPositions[mPositionOf[mTriangles[t*3+k]]];
+
+			auto const before = glm::cross( p[1] - p[0], p[2] - p[0] );
+
+			auto const c = corner_( t, from ) - t*3;
+			p[c] = mPositions[to];
+
+			auto const after = glm::cross( p[1] - p[0], p[2] - p[0] );
+
+			auto const lengths = glm::length( before ) * glm::length( after );
+			if( !(lengths > 0.) || glm::dot( before, after ) < kMinFlipCosine * lengths )
+				return false;
+		}
+
+		// Perform the collapse
+		for( auto const t : mPositionTriangles[from] )
+		{
+			if( !mTriangleAlive[t] )
+				continue;
+
+			if( kNone != corner_( t, to ) )
+			{
+				mTriangleAlive[t] = 0;
+				--mAliveCount;
+				continue;
+			}
+
+			auto& vertex = mTriangles[corner_( t, from )];
+			vertex = mWedgeTo[std::find( mWedgeFrom.begin(), mWedgeFrom.end(), vertex ) - mWedgeFrom.begin()];
+			assert( mPositionOf[vertex] == to );
+
+			mPositionTriangles[to].emplace_back( t );
+		}
+
+		auto& toTriangles = mPositionTriangles[to];
+		toTriangles.erase( std::remove_if( toTriangles.begin(), toTriangles.end(), [this] (std::uint32_t aT) {
+			return !mTriangleAlive[aT];
+		} ), toTriangles.end() );
+
+		mPositionTriangles[from].clear();
+		mPositionTriangles[from].shrink_to_fit();
+		mRemoved[from] = 1;
+
+		mQuadrics[to] += mQuadrics[from];
+		++mVersion[to];
+
+		mMaxError = std::max( mMaxError, aCollapse.error );
+
+		// Update the collapses of the edges around the target position
+		gather_neighbours( to, mNeighboursTo );
+		for( auto const n : mNeighboursTo )
+		{
+			push_( to, n );
+			push_( n, to );
+		}
+
+		return true;
+	}
+
+
+	void generate_mesh_lods_( ModelData& aModel, MeshInfo& aMesh )
+	{
+		aMesh.lods.clear();
+
+		std::size_t const triangleCount = aMesh.numberOfIndices / 3;
+		if( triangleCount < kMinLodTriangles )
+			return;
+
+		auto const* positions = aModel.vertexPositions.data() + aMesh.vertexStartIndex;
+
+		Simplifier_ simplifier( aModel.indices.data() + aMesh.indexStartIndex, aMesh.numberOfIndices, positions, aMesh.numberOfVertices );
+
+		std::size_t previous = triangleCount;
+		std::vector<std::uint32_t> lodIndices;
+
+		for( auto const ratio : kLodTriangleRatios )
+		{
+			auto const remaining = simplifier.simplify( std::size_t(triangleCount * ratio) );
+			if( 0 == remaining || remaining > previous * kMinLodReduction )
+				break;
+
+			simplifier.get_indices( lodIndices );
+			optimize_triangle_order( lodIndices.data(), lodIndices.size(), positions, aMesh.numberOfVertices );
+
+			MeshLodInfo lod{};
+			lod.indexStartIndex  = aModel.indices.size();
+			lod.numberOfIndices  = lodIndices.size();
+			lod.error            = simplifier.error();
+
+			aModel.indices.insert( aModel.indices.end(), lodIndices.begin(), lodIndices.end() );
+			aMesh.lods.emplace_back( lod );
+
+			previous = remaining;
+		}
+	}
+}
+
+void generate_lods( ModelData& aModel )
+{
+	for( auto& mesh : aModel.meshes )
+		generate_mesh_lods_( aModel, mesh );
+
+	// Print the total number of triangles at each level
+	std::size_t triangles[kLodLevelCount+1] = {};
+	for( auto const& mesh : aModel.meshes )
+	{
+		for( std::size_t i = 0; i <= kLodLevelCount; ++i )
+		{
+			// Meshes without the level draw their coarsest one instead
+			auto const level = std::min( i, mesh.lods.size() );
+			triangles[i] += (0 == level ? mesh.numberOfIndices : mesh.lods[level-1].numberOfIndices) / 3;
+		}
+	}
+
+	std::printf( "  levels of detail: %zu", triangles[0] );
+	for( std::size_t i = 1; i <= kLodLevelCount; ++i )
+		std::printf( " -> %zu", triangles[i] );
+	std::printf( " triangles\n" );
+}
+
+float projected_error_pixels( float aError, float aDistance, float aFovY, float aViewportHeight ) noexcept
+{
+	// Pixels per unit length at distance 1
+	float const scale = aViewportHeight / (2.f * std::tan( 0.5f * aFovY ));
+	return aError * scale / aDistance;
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <cstddef>
+
+#include "model.hpp"
+
+/* Level of detail generation. generate_lods() simplifies each mesh with
+ * quadric error metrics [Garland & Heckbert 1997, "Surface Simplification
+ * Using Quadric Error Metrics"], and records the simplified mesh as it
+ * reaches each of the kLodTriangleRatios of the original triangle count.
+ *
+ * The simplification only collapses vertices onto neighbouring vertices; it
+ * never creates new ones. All levels thus share the vertex data of the
+ * full-detail mesh and only add index data (see MeshLodInfo). Vertices that
+ * exist several times with different attributes (e.g. along hard edges and
+ * texture seams) are only collapsed along the seam. Vertices on open borders
+ * are kept, so that meshes don't shrink away from their holes.
+ */
+
+constexpr std::size_t kLodLevelCount = 3; // in addition to the full-detail mesh
+constexpr float kLodTriangleRatios[kLodLevelCount] = { 0.5f, 0.25f, 0.125f };
+
+// Generates the levels of detail of all meshes of aModel, replacing any
+// existing ones. The new indices are appended to aModel.indices. Called by
+// load_obj_model().
+void generate_lods( ModelData& aModel );
+
+// Size in pixels of a geometric error aError seen at a distance aDistance,
+// with a perspective projection with the vertical field of view aFovY
+// (radians) onto a viewport that is aViewportHeight pixels high.
+float projected_error_pixels( float aError, float aDistance, float aFovY, float aViewportHeight ) noexcept;
@@ -0,0 +1,429 @@
+#include "mesh_optimizer.hpp"
+
+#include <vector>
+#include <numeric>
+#include <algorithm>
+#include <type_traits>
+
+#include <cstdio>
+#include <cassert>
+
+namespace
+{
+	// Soft cluster boundaries are introduced when the ACMR of the cluster so
+	// far drops below this factor times the ACMR of the whole cluster (the
+	// lambda parameter in the Tipsify paper). Larger values create more (and
+	// smaller) clusters, which helps overdraw at the cost of cache efficiency.
+	constexpr float kOverdrawThreshold = 1.05f;
+
+	// Timestamp-based FIFO cache simulation: a vertex is in the cache if fewer
+	// than aCacheSize vertices have been inserted since it was inserted.
+	struct FifoCache_
+	{
+		std::vector<std::size_t> time;
+		std::size_t timestamp;
+		std::size_t size;
+
+		FifoCache_( std::size_t aVertexCount, std::size_t aCacheSize )
+			: time( aVertexCount, 0 )
+			, timestamp( aCacheSize+1 )
+			, size( aCacheSize )
+		{}
+
+		bool contains( std::uint32_t aVertex ) const noexcept
+		{
+			return timestamp - time[aVertex] <= size;
+		}
+
+		// Returns true on a cache miss
+		bool access( std::uint32_t aVertex ) noexcept
+		{
+			if( contains( aVertex ) )
+				return false;
+
+			time[aVertex] = timestamp++;
+			return true;
+		}
+
+		void flush() noexcept
+		{
+			timestamp += size+1;
+		}
+	};
+
+	// Tipsify. Returns the reordered triangles (as triangle indices) in
+	// aOrder, and the start of each cluster in aClusters.
+	void tipsify_( std::uint32_t const* aIndices, std::size_t aTriangleCount, std::size_t aVertexCount, std::size_t aCacheSize, std::vector<std::uint32_t>& aOrder, std::vector<std::size_t>& aClusters )
+	{
+		// Vertex-triangle adjacency
+		std::vector<std::uint32_t> adjOffsets( aVertexCount+1, 0 );
+		for( std::size_t i = 0; i < aTriangleCount*3; ++i )
+			++adjOffsets[aIndices[i]+1];
+
+		std::partial_sum( adjOffsets.begin(), adjOffsets.end(), adjOffsets.begin() );
+
+		std::vector<std::uint32_t> adjacency( aTriangleCount*3 );
+		{
+			auto fill = adjOffsets;
+			for( std::size_t i = 0; i < aTriangleCount*3; ++i )
+				adjacency[fill[aIndices[i]]++] = std::uint32_t(i/3);
+		}
+
+		std::vector<std::uint32_t> live( aVertexCount );
+		for( std::size_t v = 0; v < aVertexCount; ++v )
+			live[v] = adjOffsets[v+1] - adjOffsets[v];
+
+		FifoCache_ cache( aVertexCount, aCacheSize );
+		std::vector<bool> emitted( aTriangleCount, false );
+		std::vector<std::uint32_t> deadEnd;
+		std::vector<std::uint32_t> candidates;
+
+		aOrder.clear();
+		aOrder.reserve( aTriangleCount );
+		aClusters.assign( 1, 0 );
+
+		std::size_t cursor = 0;
+		auto const skip_dead_end = [&] () -> std::int64_t {
+			// Recently referenced vertices with live triangles first ...
+			while( !deadEnd.empty() )
+			{
+				auto const v = deadEnd.back();
+				deadEnd.pop_back();
+
+				if( live[v] > 0 )
+					return v;
+			}
+
+			// ... and otherwise the next vertex in input order.
+			for( ; cursor < aVertexCount; ++cursor )
+			{
+				if( live[cursor] > 0 )
+					return std::int64_t(cursor);
+			}
+
+			return -1;
+		};
+
+		std::int64_t fanning = skip_dead_end();
+		while( fanning >= 0 )
+		{
+			candidates.clear();
+
+			// Emit all remaining triangles around the fanning vertex
+			for( auto a = adjOffsets[fanning]; a < adjOffsets[fanning+1]; ++a )
+			{
+				auto const tri = adjacency[a];
+				if( emitted[tri] )
+					continue;
+
+				for( int k = 0; k < 3; ++k )
+				{
+					auto const v = aIndices[tri*3+k];
+
+					deadEnd.emplace_back( v );
+					candidates.emplace_back( v );
+					--live[v];
+					cache.access( v );
+				}
+
+				emitted[tri] = true;
+				aOrder.emplace_back( tri );
+			}
+
+			// Pick the next fanning vertex: the candidate that remains in the
+			// cache for the longest time after its triangles have been
+			// emitted.
+			std::int64_t next = -1;
+			std::int64_t bestPriority = -1;
+			for( auto const v : candidates )
+			{
+				if( 0 == live[v] )
+					continue;
+
+				std::int64_t priority = 0;
+				auto const age = std::int64_t(cache.timestamp - cache.time[v]);
+				if( age + 2*std::int64_t(live[v]) <= std::int64_t(aCacheSize) )
+					priority = age;
+
+				if( priority > bestPriority )
+				{
+					bestPriority = priority;
+					next = v;
+				}
+			}
+
+			if( next < 0 )
+			{
+				next = skip_dead_end();
+
+				// Restarting from a vertex that has dropped out of the cache
+				// is a hard cluster boundary.
+				if( next >= 0 && !cache.contains( std::uint32_t(next) ) && aOrder.size() != aClusters.back() )
+					aClusters.emplace_back( aOrder.size() );
+			}
+
+			fanning = next;
+		}
+
+		assert( aOrder.size() == aTriangleCount );
+	}
+
+	// Splits clusters further at points where the cache efficiency of the
+	// partial cluster is close to that of the whole cluster.
+	void add_soft_boundaries_( std::uint32_t const* aIndices, std::size_t aVertexCount, std::size_t aCacheSize, std::vector<std::uint32_t> const& aOrder, std::vector<std::size_t>& aClusters )
+	{
+		FifoCache_ cache( aVertexCount, aCacheSize );
+
+		auto const misses_of = [&] (std::uint32_t aTri) {
+			return int(cache.access( aIndices[aTri*3+0] )) + int(cache.access( aIndices[aTri*3+1] )) + int(cache.access( aIndices[aTri*3+2] ));
+		};
+
+		std::vector<std::size_t> result;
+		for( std::size_t c = 0; c < aClusters.size(); ++c )
+		{
+			auto const beg = aClusters[c];
+			auto const end = c+1 < aClusters.size() ? aClusters[c+1] : aOrder.size();
+
+			// ACMR of the whole cluster, starting from an empty cache
+			cache.flush();
+			std::size_t clusterMisses = 0;
+			for( auto i = beg; i < end; ++i )
+				clusterMisses += misses_of( aOrder[i] );
+
+			float const threshold = kOverdrawThreshold * float(clusterMisses) / float(end-beg);
+
+			cache.flush();
+			result.emplace_back( beg );
+
+			std::size_t start = beg, misses = 0;
+			for( auto i = beg; i < end; ++i )
+			{
+				misses += misses_of( aOrder[i] );
+
+				if( i+1 < end && float(misses) / float(i-start+1) <= threshold )
+				{
+					result.emplace_back( i+1 );
+					start = i+1;
+					misses = 0;
+					cache.flush();
+				}
+			}
+		}
+
+		aClusters = std::move(result);
+	}
+
+	// Sorts clusters such that those that face outwards are drawn first.
+	void sort_clusters_( std::uint32_t const* aIndices, glm::vec3 const* aPositions, std::vector<std::uint32_t>& aOrder, std::vector<std::size_t> const& aClusters )
+	{
+		struct Cluster_
+		{
+			std::size_t beg, end;
+			float sortKey;
+		};
+
+		std::vector<Cluster_> clusters;
+		clusters.reserve( aClusters.size() );
+
+		// Area-weighted centroid of the mesh
+		glm::vec3 meshCentroid( 0.f );
+		float meshArea = 0.f;
+
+		std::vector<glm::vec3> centroids, normals;
+		for( std::size_t c = 0; c < aClusters.size(); ++c )
+		{
+			auto const beg = aClusters[c];
+			auto const end = c+1 < aClusters.size() ? aClusters[c+1] : aOrder.size();
+
+			glm::vec3 centroid( 0.f ), normal( 0.f );
+			float area = 0.f;
+			for( auto i = beg; i < end; ++i )
+			{
+				auto const tri = aOrder[i];
+				auto const& p0 = aPositions[aIndices[tri*3+0]];
+				auto const& p1 = aPositions[aIndices[tri*3+1]];
+				auto const& p2 = aPositions[aIndices[tri*3+2]];
+
+				auto const n = glm::cross( p1-p0, p2-p0 ); // length = 2*area
+				auto const a = glm::length( n );
+
+				centroid += (p0+p1+p2) * (a / 3.f);
+				normal += n;
+				area += a;
+			}
+
+			meshCentroid += centroid;
+			meshArea += area;
+
+			centroids.emplace_back( area > 0.f ? centroid / area : centroid );
+			normals.emplace_back( normal );
+			clusters.emplace_back( Cluster_{ beg, end, 0.f } );
+		}
+
+		if( meshArea > 0.f )
+			meshCentroid /= meshArea;
+
+		for( std::size_t c = 0; c < clusters.size(); ++c )
+		{
+			auto const len = glm::length( normals[c] );
+			clusters[c].sortKey = len > 0.f ? glm::dot( centroids[c] - meshCentroid, normals[c] / len ) : 0.f;
+		}
+
+		std::stable_sort( clusters.begin(), clusters.end(), [] (Cluster_ const& aA, Cluster_ const& aB) {
+			return aA.sortKey > aB.sortKey;
+		} );
+
+		std::vector<std::uint32_t> order;
+		order.reserve( aOrder.size() );
+		for( auto const& cluster : clusters )
+			order.insert( order.end(), aOrder.begin() + cluster.beg, aOrder.begin() + cluster.end );
+
+		aOrder = std::move(order);
+	}
+
+	void optimize_mesh_( ModelData& aModel, MeshInfo const& aMesh )
+	{
+		auto* indices = aModel.indices.data() + aMesh.indexStartIndex;
+		auto const indexCount = aMesh.numberOfIndices;
+		auto const triangleCount = indexCount / 3;
+		auto const vertexStart = aMesh.vertexStartIndex;
+		auto const vertexCount = aMesh.numberOfVertices;
+
+		if( triangleCount < 2 )
+			return;
+
+		// Reorder triangles, then vertices
+		optimize_triangle_order( indices, indexCount, aModel.vertexPositions.data() + vertexStart, vertexCount );
+		optimize_vertex_order( aModel, aMesh );
+	}
+
+	VertexCacheStats analyze_model_( ModelData const& aModel )
+	{
+		VertexCacheStats total{};
+		for( auto const& mesh : aModel.meshes )
+		{
+			auto const stats = analyze_vertex_cache( aModel.indices.data() + mesh.indexStartIndex, mesh.numberOfIndices, mesh.numberOfVertices );
+			total.triangleCount += stats.triangleCount;
+			total.vertexCount += stats.vertexCount;
+			total.transformCount += stats.transformCount;
+		}
+		return total;
+	}
+}
+
+double VertexCacheStats::acmr() const noexcept
+{
+	return triangleCount ? double(transformCount) / triangleCount : 0.;
+}
+double VertexCacheStats::atvr() const noexcept
+{
+	return vertexCount ? double(transformCount) / vertexCount : 0.;
+}
+
+VertexCacheStats analyze_vertex_cache( std::uint32_t const* aIndices, std::size_t aIndexCount, std::size_t aVertexCount, std::size_t aCacheSize )
+{
+	FifoCache_ cache( aVertexCount, aCacheSize );
+	std::vector<bool> referenced( aVertexCount, false );
+
+	VertexCacheStats stats{};
+	stats.triangleCount = aIndexCount / 3;
+
+	for( std::size_t i = 0; i < aIndexCount; ++i )
+	{
+		auto const v = aIndices[i];
+		assert( v < aVertexCount );
+
+		if( cache.access( v ) )
+			++stats.transformCount;
+
+		if( !referenced[v] )
+		{
+			referenced[v] = true;
+			++stats.vertexCount;
+		}
+	}
+
+	return stats;
+}
+
+void optimize_triangle_order( std::uint32_t* aIndices, std::size_t aIndexCount, glm::vec3 const* aPositions, std::size_t aVertexCount )
+{
+	auto const triangleCount = aIndexCount / 3;
+	if( triangleCount < 2 )
+		return;
+
+	std::vector<std::uint32_t> order;
+	std::vector<std::size_t> clusters;
+	tipsify_( aIndices, triangleCount, aVertexCount, kVertexCacheSize, order, clusters );
+	add_soft_boundaries_( aIndices, aVertexCount, kVertexCacheSize, order, clusters );
+	sort_clusters_( aIndices, aPositions, order, clusters );
+
+	std::vector<std::uint32_t> reordered( triangleCount*3 );
+	for( std::size_t i = 0; i < triangleCount; ++i )
+	{
+		for( int k = 0; k < 3; ++k )
+			reordered[i*3+k] = aIndices[order[i]*3+k];
+	}
+
+	std::copy( reordered.begin(), reordered.end(), aIndices );
+}
+
+void optimize_vertex_order( ModelData& aModel, MeshInfo const& aMesh )
+{
+	auto* indices = aModel.indices.data() + aMesh.indexStartIndex;
+	auto const indexCount = aMesh.numberOfIndices;
+	auto const vertexStart = aMesh.vertexStartIndex;
+	auto const vertexCount = aMesh.numberOfVertices;
+
+	std::vector<std::uint32_t> reordered( indices, indices + indexCount );
+
+	// Reorder vertices by first use. Vertices not referenced by any
+	// triangle (there shouldn't be any) are moved to the end.
+	constexpr std::uint32_t kUnused = ~std::uint32_t(0);
+	std::vector<std::uint32_t> remap( vertexCount, kUnused );
+
+	std::uint32_t nextVertex = 0;
+	for( auto& idx : reordered )
+	{
+		if( kUnused == remap[idx] )
+			remap[idx] = nextVertex++;
+
+		idx = remap[idx];
+	}
+
+	for( auto& r : remap )
+	{
+		if( kUnused == r )
+			r = nextVertex++;
+	}
+
+	std::copy( reordered.begin(), reordered.end(), indices );
+
+	auto const permute = [&] (auto& aAttribute) {
+		auto const beg = aAttribute.begin() + vertexStart;
+
+		std::vector<typename std::decay_t<decltype(aAttribute)>::value_type> tmp( beg, beg + vertexCount );
+		for( std::size_t v = 0; v < vertexCount; ++v )
+			beg[remap[v]] = tmp[v];
+	};
+
+	permute( aModel.vertexPositions );
+	permute( aModel.vertexNormals );
+	permute( aModel.vertexTextureCoords );
+}
+
+void optimize_meshes( ModelData& aModel )
+{
+	auto const before = analyze_model_( aModel );
+
+	for( auto const& mesh : aModel.meshes )
+		optimize_mesh_( aModel, mesh );
+
+	auto const after = analyze_model_( aModel );
+
+	std::printf( "  vertex cache (FIFO %zu): ACMR %.3f -> %.3f, ATVR %.3f -> %.3f\n",
+		kVertexCacheSize,
+		before.acmr(), after.acmr(),
+		before.atvr(), after.atvr()
+	);
+}
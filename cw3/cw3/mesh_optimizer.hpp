@@ -0,0 +1,58 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "model.hpp"
+
+/* Mesh optimization for the loaded models. optimize_meshes() reorders the
+ * triangles of each mesh for post-transform vertex cache locality and
+ * reduced overdraw, and then reorders the vertices in the order in which they
+ * are first referenced, for locality of vertex fetches.
+ *
+ * Triangles are reordered with Tipsify [Sander et al. 2007, "Fast Triangle
+ * Reordering for Vertex Locality and Reduced Overdraw"]. Tipsify produces
+ * clusters of triangles at the points where it has to restart from a dead
+ * end. These clusters are then sorted such that outward-facing clusters
+ * (which tend to occlude the rest of the mesh) are drawn first.
+ */
+
+// Size of the simulated FIFO vertex cache, used both for optimization and
+// for the statistics below.
+constexpr std::size_t kVertexCacheSize = 16;
+
+struct VertexCacheStats
+{
+	std::size_t triangleCount;
+	std::size_t vertexCount; // Number of distinct vertices referenced
+	std::size_t transformCount; // Number of cache misses
+
+	// Average cache miss ratio: vertex transforms per triangle (0.5 is the
+	// optimum for large regular meshes, 3.0 the worst case).
+	double acmr() const noexcept;
+
+	// Average transform to vertex ratio (1.0 is the optimum).
+	double atvr() const noexcept;
+};
+
+// Simulates a FIFO post-transform vertex cache with aCacheSize entries.
+VertexCacheStats analyze_vertex_cache(
+	std::uint32_t const* aIndices,
+	std::size_t aIndexCount,
+	std::size_t aVertexCount,
+	std::size_t aCacheSize = kVertexCacheSize
+);
+
+// Reorders the triangles given by aIndices for vertex cache locality and
+// reduced overdraw, without touching the vertices. Used by optimize_meshes(),
+// and for index buffers that share their vertices with another mesh.
+void optimize_triangle_order( std::uint32_t* aIndices, std::size_t aIndexCount, glm::vec3 const* aPositions, std::size_t aVertexCount );
+
+// Reorders the vertices of aMesh in the order in which its indices first
+// reference them, for locality of vertex fetches. Used by optimize_meshes(),
+// and again once build_meshlets() has reordered the triangles.
+void optimize_vertex_order( ModelData& aModel, MeshInfo const& aMesh );
+
+// Optimizes all meshes of aModel in place, and prints the ACMR/ATVR before
+// and after.
+void optimize_meshes( ModelData& aModel );
@@ -0,0 +1,429 @@
+#include "meshlet.hpp"
+
+#include <vector>
+#include <limits>
+#include <numeric>
+#include <algorithm>
+
+#include <cmath>
+#include <cstdio>
+#include <cassert>
+
+#include "mesh_optimizer.hpp"
+
+namespace
+{
+	// Weight of the deviation from the meshlet's average normal, relative to
+	// the distance from the meshlet's center, when choosing the next triangle.
+	constexpr float kConeWeight = 0.5f;
+
+	// When no adjacent triangle fits into the current meshlet, the meshlet is
+	// closed, unless it has fewer than this many triangles. In that case, it
+	// is continued with the next unused triangle instead. This avoids lots of
+	// tiny meshlets for meshes that consist of many small disconnected parts.
+	constexpr std::size_t kMeshletMinTriangles = kMeshletMaxTriangles / 4;
+
+	// Normal cones where some triangle deviates by more than acos(0.1) (about
+	// 84 degrees) from the axis can practically never be culled.
+	constexpr float kMinConeCosine = 0.1f;
+
+	inline glm::vec3 triangle_normal_( glm::vec3 const& aP0, glm::vec3 const& aP1, glm::vec3 const& aP2 ) noexcept
+	{
+		// Normal of the front face, as defined by the winding order. This is
+		// what the rasterizer culls against, regardless of the vertex normals.
+		auto const n = glm::cross( aP1 - aP0, aP2 - aP0 );
+		auto const length = glm::length( n );
+		return length > 0.f ? n / length : glm::vec3( 0.f );
+	}
+
+	void compute_bounds_( MeshletInfo& aMeshlet, std::uint32_t const* aIndices, glm::vec3 const* aPositions )
+	{
+		std::size_t const indexCount = aMeshlet.numberOfIndices;
+		assert( indexCount >= 3 );
+
+		// Bounding sphere [Ritter 1990]: start with the sphere spanned by two
+		// far-apart points, and grow it to include the remaining ones.
+		auto const farthest = [&] (glm::vec3 const& aFrom) {
+			glm::vec3 ret = aFrom;
+			float maxDist2 = -1.f;
+			for( std::size_t i = 0; i < indexCount; ++i )
+			{
+				auto const& p = aPositions[aIndices[i]];
+				auto const dist2 = glm::dot( p - aFrom, p - aFrom );
+				if( dist2 > maxDist2 )
+				{
+					maxDist2 = dist2;
+					ret = p;
+				}
+			}
+			return ret;
+		};
+
+		auto const a = farthest( aPositions[aIndices[0]] );
+		auto const b = farthest( a );
+
+		glm::vec3 center = 0.5f * (a + b);
+		float radius = 0.5f * glm::distance( a, b );
+
+		for( std::size_t i = 0; i < indexCount; ++i )
+		{
+			auto const& p = aPositions[aIndices[i]];
+			auto const dist = glm::distance( p, center );
+			if( dist > radius )
+			{
+				float const newRadius = 0.5f * (radius + dist);
+				center += (p - center) * ((newRadius - radius) / dist);
+				radius = newRadius;
+			}
+		}
+
+		aMeshlet.center = center;
+		aMeshlet.radius = radius;
+
+		// Normal cone. The axis is the average of the triangle normals.
+		glm::vec3 normalSum( 0.f );
+		for( std::size_t i = 0; i < indexCount; i += 3 )
+			normalSum += triangle_normal_( aPositions[aIndices[i]], aPositions[aIndices[i+1]], aPositions[aIndices[i+2]] );
+
+		aMeshlet.coneApex = center;
+		aMeshlet.coneAxis = glm::vec3( 0.f, 0.f, 1.f );
+		aMeshlet.coneCutoff = 1.f; // disabled
+
+		auto const axisLength = glm::length( normalSum );
+		if( !(axisLength > 0.f) )
+			return;
+
+		auto const axis = normalSum / axisLength;
+		aMeshlet.coneAxis = axis;
+
+		float minDot = 1.f;
+		for( std::size_t i = 0; i < indexCount; i += 3 )
+		{
+			auto const n = triangle_normal_( aPositions[aIndices[i]], aPositions[aIndices[i+1]], aPositions[aIndices[i+2]] );
+			if( n != glm::vec3( 0.f ) ) // degenerate triangles are never rasterized
+				minDot = std::min( minDot, glm::dot( axis, n ) );
+		}
+
+		if( minDot < kMinConeCosine )
+			return;
+
+		// Move the apex back along the axis until it lies behind the planes
+		// of all triangles. Any viewer within the cone of half-angle
+		// 90 - acos(minDot) degrees behind the apex then sees only back faces.
+		float maxT = 0.f;
+		for( std::size_t i = 0; i < indexCount; i += 3 )
+		{
+			auto const& p0 = aPositions[aIndices[i]];
+			auto const n = triangle_normal_( p0, aPositions[aIndices[i+1]], aPositions[aIndices[i+2]] );
+			if( n == glm::vec3( 0.f ) )
+				continue;
+
+			maxT = std::max( maxT, glm::dot( center - p0, n ) / glm::dot( axis, n ) );
+		}
+
+		aMeshlet.coneApex = center - axis * maxT;
+		aMeshlet.coneCutoff = std::sqrt( 1.f - minDot*minDot );
+	}
+
+	constexpr std::uint32_t kNoVertex_ = ~std::uint32_t(0);
+
+	// Reorders the triangles of one meshlet with optimize_triangle_order(), if
+	// that reduces its vertex cache misses. The meshlet references few of the
+	// mesh's vertices, so they are numbered locally; aLocal maps the mesh's
+	// vertices to local ones, and is all kNoVertex_ before and after.
+
+	void optimize_meshlet_triangles_( std::uint32_t* aIndices, std::size_t aIndexCount, glm::vec3 const* aPositions, std::vector<std::uint32_t>& aLocal )
+	{
+		std::vector<std::uint32_t> vertices; // mesh vertex of each local one
+		std::vector<glm::vec3> positions;
+		std::vector<std::uint32_t> local( aIndexCount );
+
+		for( std::size_t i = 0; i < aIndexCount; ++i )
+		{
+			auto const v = aIndices[i];
+			if( kNoVertex_ == aLocal[v] )
+			{
+				aLocal[v] = std::uint32_t(vertices.size());
+				vertices.emplace_back( v );
+				positions.emplace_back( aPositions[v] );
+			}
+
+			local[i] = aLocal[v];
+		}
+
+		// Tipsify isn't always better than the greedy order for the few
+		// triangles of a meshlet; keep whichever has the lower ACMR
+		std::vector<std::uint32_t> optimized( local );
+		optimize_triangle_order( optimized.data(), aIndexCount, positions.data(), vertices.size() );
+
+		auto const before = analyze_vertex_cache( local.data(), aIndexCount, vertices.size() );
+		auto const after = analyze_vertex_cache( optimized.data(), aIndexCount, vertices.size() );
+		if( after.transformCount < before.transformCount )
+		{
+			for( std::size_t i = 0; i < aIndexCount; ++i )
+				aIndices[i] = vertices[optimized[i]];
+		}
+
+		for( auto const v : vertices )
+			aLocal[v] = kNoVertex_;
+	}
+
+	void build_mesh_meshlets_( ModelData& aModel, MeshInfo& aMesh, bool aOptimize )
+	{
+		aMesh.meshletStartIndex = aModel.meshlets.size();
+		aMesh.numberOfMeshlets = 0;
+
+		std::uint32_t* const indices = aModel.indices.data() + aMesh.indexStartIndex;
+		glm::vec3 const* const positions = aModel.vertexPositions.data() + aMesh.vertexStartIndex;
+
+		std::size_t const triangleCount = aMesh.numberOfIndices / 3;
+		std::size_t const vertexCount = aMesh.numberOfVertices;
+
+		if( 0 == triangleCount )
+			return;
+
+		// Per-triangle normals and centroids
+		std::vector<glm::vec3> normals( triangleCount ), centroids( triangleCount );
+		for( std::size_t t = 0; t < triangleCount; ++t )
+		{
+			auto const& p0 = positions[indices[t*3+0]];
+			auto const& p1 = positions[indices[t*3+1]];
+			auto const& p2 = positions[indices[t*3+2]];
+
+			normals[t] = triangle_normal_( p0, p1, p2 );
+			centroids[t] = (p0 + p1 + p2) / 3.f;
+		}
+
+		// Vertex-triangle adjacency
+		std::vector<std::uint32_t> adjacencyOffsets( vertexCount+1, 0 );
+		for( std::size_t i = 0; i < triangleCount*3; ++i )
+			++adjacencyOffsets[indices[i]+1];
+
+		std::partial_sum( adjacencyOffsets.begin(), adjacencyOffsets.end(), adjacencyOffsets.begin() );
+
+		std::vector<std::uint32_t> adjacency( triangleCount*3 );
+		{
+			std::vector<std::uint32_t> fill( adjacencyOffsets.begin(), adjacencyOffsets.end()-1 );
+			for( std::size_t i = 0; i < triangleCount*3; ++i )
+				adjacency[fill[indices[i]]++] = std::uint32_t(i / 3);
+		}
+
+		// Greedily grow meshlets. A vertex is part of the current meshlet if
+		// its stamp matches the meshlet's.
+		std::vector<char> emitted( triangleCount, 0 );
+		std::vector<std::uint32_t> stamp( vertexCount, 0 );
+		std::uint32_t meshletStamp = 1;
+
+		std::vector<std::uint32_t> meshletVertices;
+		meshletVertices.reserve( kMeshletMaxVertices );
+
+		std::size_t meshletTriangles = 0;
+		glm::vec3 normalSum( 0.f ), centroidSum( 0.f );
+
+		std::vector<std::uint32_t> reordered;
+		reordered.reserve( triangleCount*3 );
+
+		auto const new_vertices = [&] (std::size_t aTriangle) {
+			auto const a = indices[aTriangle*3+0], b = indices[aTriangle*3+1], c = indices[aTriangle*3+2];
+			return std::size_t(stamp[a] != meshletStamp)
+				+ std::size_t(stamp[b] != meshletStamp && b != a)
+				+ std::size_t(stamp[c] != meshletStamp && c != a && c != b)
+			;
+		};
+
+		auto const emit = [&] (std::size_t aTriangle) {
+			for( std::size_t k = 0; k < 3; ++k )
+			{
+				auto const v = indices[aTriangle*3+k];
+				if( stamp[v] != meshletStamp )
+				{
+					stamp[v] = meshletStamp;
+					meshletVertices.emplace_back( v );
+				}
+
+				reordered.emplace_back( v );
+			}
+
+			emitted[aTriangle] = 1;
+			++meshletTriangles;
+			normalSum += normals[aTriangle];
+			centroidSum += centroids[aTriangle];
+		};
+
+		auto const flush = [&] {
+			assert( meshletTriangles > 0 );
+			assert( meshletVertices.size() <= kMeshletMaxVertices );
+
+			MeshletInfo meshlet{};
+			meshlet.indexStartIndex = std::uint32_t(reordered.size() - meshletTriangles*3);
+			meshlet.numberOfIndices = std::uint32_t(meshletTriangles*3);
+			meshlet.numberOfVertices = std::uint32_t(meshletVertices.size());
+			compute_bounds_( meshlet, reordered.data() + meshlet.indexStartIndex, positions );
+
+			aModel.meshlets.emplace_back( meshlet );
+
+			++meshletStamp;
+			meshletVertices.clear();
+			meshletTriangles = 0;
+			normalSum = centroidSum = glm::vec3( 0.f );
+		};
+
+		std::size_t cursor = 0; // all triangles before the cursor have been emitted
+		for( std::size_t emittedCount = 0; emittedCount < triangleCount; ++emittedCount )
+		{
+			// Find the best adjacent triangle that fits into the meshlet
+			std::size_t best = triangleCount;
+
+			if( meshletTriangles > 0 )
+			{
+				std::size_t const room = kMeshletMaxVertices - meshletVertices.size();
+
+				auto const center = centroidSum / float(meshletTriangles);
+				auto const normalLength = glm::length( normalSum );
+				auto const axis = normalLength > 0.f ? normalSum / normalLength : glm::vec3( 0.f );
+
+				std::size_t bestNew = 4;
+				float bestScore = std::numeric_limits<float>::max();
+
+				for( auto const v : meshletVertices )
+				{
+					for( auto i = adjacencyOffsets[v]; i < adjacencyOffsets[v+1]; ++i )
+					{
+						auto const t = adjacency[i];
+						if( emitted[t] )
+							continue;
+
+						auto const newCount = new_vertices( t );
+						if( newCount > room || newCount > bestNew )
+							continue;
+
+						float const score = glm::distance( centroids[t], center ) * (1.f + kConeWeight * (1.f - glm::dot( normals[t], axis )));
+						if( newCount < bestNew || score < bestScore )
+						{
+							best = t;
+							bestNew = newCount;
+							bestScore = score;
+						}
+					}
+				}
+			}
+
+			// Otherwise, continue with the next unused triangle
+			if( triangleCount == best )
+			{
+				if( meshletTriangles >= kMeshletMinTriangles )
+					flush();
+
+				while( emitted[cursor] )
+					++cursor;
+
+				best = cursor;
+
+				if( meshletTriangles > 0 && new_vertices( best ) > kMeshletMaxVertices - meshletVertices.size() )
+					flush();
+			}
+
+			emit( best );
+
+			if( kMeshletMaxTriangles == meshletTriangles )
+				flush();
+		}
+
+		if( meshletTriangles > 0 )
+			flush();
+
+		assert( reordered.size() == triangleCount*3 );
+		std::copy( reordered.begin(), reordered.end(), indices );
+
+		aMesh.numberOfMeshlets = aModel.meshlets.size() - aMesh.meshletStartIndex;
+
+		// Restore the vertex cache order within the meshlets, and the vertex
+		// fetch order that goes with it. Neither changes the meshlets' bounds.
+		if( aOptimize )
+		{
+			std::vector<std::uint32_t> local( vertexCount, kNoVertex_ );
+			for( std::size_t m = aMesh.meshletStartIndex; m < aModel.meshlets.size(); ++m )
+			{
+				auto const& meshlet = aModel.meshlets[m];
+				optimize_meshlet_triangles_( indices + meshlet.indexStartIndex, meshlet.numberOfIndices, positions, local );
+			}
+
+			optimize_vertex_order( aModel, aMesh );
+		}
+	}
+}
+
+void build_meshlets( ModelData& aModel, bool aOptimize )
+{
+	aModel.meshlets.clear();
+
+	VertexCacheStats cache{};
+	for( auto& mesh : aModel.meshes )
+	{
+		build_mesh_meshlets_( aModel, mesh, aOptimize );
+
+		auto const stats = analyze_vertex_cache( aModel.indices.data() + mesh.indexStartIndex, mesh.numberOfIndices, mesh.numberOfVertices );
+		cache.triangleCount += stats.triangleCount;
+		cache.transformCount += stats.transformCount;
+	}
+
+	std::size_t vertices = 0, triangles = 0, cullable = 0;
+	for( auto const& meshlet : aModel.meshlets )
+	{
+		vertices += meshlet.numberOfVertices;
+		triangles += meshlet.numberOfIndices / 3;
+		if( meshlet.coneCutoff < 1.f )
+			++cullable;
+	}
+
+	auto const count = std::max<std::size_t>( aModel.meshlets.size(), 1 );
+	std::printf( "  %zu meshlets: %.1f vertices, %.1f triangles on average, %zu with normal cones; ACMR %.3f\n",
+		aModel.meshlets.size(),
+		double(vertices) / count, double(triangles) / count,
+		cullable,
+		cache.acmr()
+	);
+}
+
+
+MeshletCullInfo make_meshlet_cull_info( glm::mat4 const& aProjCam, glm::vec3 const& aCameraPosition ) noexcept
+{
+	// [Gribb & Hartmann 2001]; glm matrices are indexed [column][row].
+	auto const row = [&aProjCam] (int aRow) {
+		return glm::vec4( aProjCam[0][aRow], aProjCam[1][aRow], aProjCam[2][aRow], aProjCam[3][aRow] );
+	};
+
+	MeshletCullInfo info{};
+	info.planes[0] = row(3) + row(0); // left
+	info.planes[1] = row(3) - row(0); // right
+	info.planes[2] = row(3) + row(1); // bottom (top with a mirrored Y axis)
+	info.planes[3] = row(3) - row(1); // top
+	info.planes[4] = row(2);          // near, for a [0,1] depth range
+	info.planes[5] = row(3) - row(2); // far
+
+	for( auto& plane : info.planes )
+		plane /= glm::length( glm::vec3( plane ) );
+
+	info.cameraPosition = aCameraPosition;
+	return info;
+}
+
+bool is_meshlet_visible( MeshletInfo const& aMeshlet, MeshletCullInfo const& aInfo ) noexcept
+{
+	for( auto const& plane : aInfo.planes )
+	{
+		if( glm::dot( glm::vec3( plane ), aMeshlet.center ) + plane.w < -aMeshlet.radius )
+			return false;
+	}
+
+	if( aMeshlet.coneCutoff < 1.f )
+	{
+		// dot( normalize( apex - camera ), axis ) >= cutoff, without the
+		// division
+		auto const toApex = aMeshlet.coneApex - aInfo.cameraPosition;
+		if( glm::dot( toApex, aMeshlet.coneAxis ) >= aMeshlet.coneCutoff * glm::length( toApex ) )
+			return false;
+	}
+
+	return true;
+}
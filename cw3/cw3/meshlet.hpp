@@ -0,0 +1,57 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include <glm/glm.hpp>
+
+#include "model.hpp"
+
+/* Meshlets partition each mesh into small clusters of triangles, such that
+ * parts of a mesh can be culled without looking at individual triangles.
+ *
+ * build_meshlets() groups the triangles of each mesh into meshlets with at
+ * most kMeshletMaxVertices distinct vertices and kMeshletMaxTriangles
+ * triangles (the limits commonly used with mesh shaders), and reorders the
+ * mesh's indices such that the triangles of each meshlet are contiguous.
+ * Each meshlet can thus be drawn with a single vkCmdDrawIndexed(), and runs
+ * of consecutive meshlets with a single one.
+ *
+ * Meshlets are grown greedily from a seed triangle by adding the adjacent
+ * triangle that references the fewest new vertices, preferring triangles
+ * that are close to the meshlet and that face in the same direction (the
+ * latter keeps the normal cones narrow).
+ *
+ * Each meshlet records a bounding sphere, for frustum culling, and a normal
+ * cone, for backface culling of the whole meshlet. The cone test follows the
+ * formulation in meshoptimizer (A. Kapoulkine), where the cone is given by an
+ * apex that lies behind all of the meshlet's triangles. See MeshletInfo.
+ */
+
+constexpr std::size_t kMeshletMaxVertices = 64;
+constexpr std::size_t kMeshletMaxTriangles = 124;
+
+// Builds the meshlets of all meshes of aModel, replacing any existing ones,
+// and prints some statistics. Called by load_obj_model().
+//
+// Growing the meshlets replaces the triangle order of optimize_meshes(). With
+// aOptimize, the triangles within each meshlet are reordered for vertex cache
+// locality again (see optimize_triangle_order()), and the vertices by first
+// use (see optimize_vertex_order()). The meshlets keep their index ranges.
+void build_meshlets( ModelData& aModel, bool aOptimize = false );
+
+
+// View frustum (world space planes, pointing inwards) and camera position.
+struct MeshletCullInfo
+{
+	glm::vec4 planes[6];
+	glm::vec3 cameraPosition;
+};
+
+// Extracts the frustum planes from a projection * view matrix with a [0,1]
+// depth range.
+MeshletCullInfo make_meshlet_cull_info( glm::mat4 const& aProjCam, glm::vec3 const& aCameraPosition ) noexcept;
+
+// Returns false if the meshlet is outside of the view frustum, or if all of
+// its triangles face away from the camera.
+bool is_meshlet_visible( MeshletInfo const&, MeshletCullInfo const& ) noexcept;
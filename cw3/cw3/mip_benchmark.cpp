@@ -0,0 +1,103 @@
+#include "mip_benchmark.hpp"
+
+#include <chrono>
+#include <limits>
+#include <algorithm>
+
+#include <cstdio>
+
+#include <stb_image.h>
+
+#include "../labutils/mipmap.hpp"
+#include "../labutils/vkimage.hpp"
+#include "../labutils/upload_batch.hpp"
+namespace lut = labutils;
+
+#include "model.hpp"
+
+namespace
+{
+	constexpr int kRepetitions = 5;
+
+	template< typename tFunc >
+	double best_ms_( tFunc const& aFunc )
+	{
+		using Clock_ = std::chrono::steady_clock;
+
+		double best = std::numeric_limits<double>::max();
+		for( int i = 0; i < kRepetitions; ++i )
+		{
+			auto const before = Clock_::now();
+			aFunc();
+			auto const after = Clock_::now();
+
+			best = std::min( best, std::chrono::duration<double, std::milli>( after - before ).count() );
+		}
+
+		return best;
+	}
+}
+
+void benchmark_mip_generation( lut::VulkanContext const& aContext, lut::Allocator const& aAllocator, std::vector<std::string> const& aModelPaths )
+{
+	// Distinct color textures of the models
+	std::vector<std::string> paths;
+	for( auto const& modelPath : aModelPaths )
+	{
+		auto const model = load_obj_model( modelPath );
+		for( auto const& material : model.materials )
+		{
+			if( !material.mapDiffuse.empty() && paths.end() == std::find( paths.begin(), paths.end(), material.mapDiffuse ) )
+				paths.emplace_back( material.mapDiffuse );
+		}
+	}
+
+	std::printf( "Mip generation, best of %d runs, in ms\n", kRepetitions );
+	std::printf( "%-40s %11s %8s %8s %12s %12s\n", "texture", "size", "box", "kaiser", "blit+upload", "cpu+upload" );
+
+	lut::UploadBatch batch( aContext, aAllocator );
+	for( auto const& path : paths )
+	{
+		int width, height, channels;
+		stbi_uc* data = stbi_load( path.c_str(), &width, &height, &channels, 4 /*4 channels = RGBA*/ );
+		if( !data )
+		{
+			std::printf( "%-40s unable to load (%s)\n", path.c_str(), stbi_failure_reason() );
+			continue;
+		}
+
+		auto const mipLevels = lut::compute_mip_level_count( std::uint32_t(width), std::uint32_t(height) );
+
+		std::vector<std::uint64_t> levelOffsets( mipLevels );
+		std::uint64_t sizeInBytes = 0;
+		for( std::uint32_t level = 0; level < mipLevels; ++level )
+		{
+			levelOffsets[level] = sizeInBytes;
+			sizeInBytes += std::uint64_t(std::max( std::uint32_t(width) >> level, 1u )) * std::max( std::uint32_t(height) >> level, 1u ) * 4;
+		}
+
+		std::vector<std::uint8_t> levels( sizeInBytes );
+		auto const cpu_ms = [&] (lut::MipFilter aFilter) {
+			return best_ms_( [&] {
+				lut::generate_mip_chain_srgb_rgba8( data, std::uint32_t(width), std::uint32_t(height), aFilter, levels.data(), levelOffsets );
+			} );
+		};
+
+		double const boxMs = cpu_ms( lut::MipFilter::box );
+		double const kaiserMs = cpu_ms( lut::MipFilter::kaiser );
+		stbi_image_free( data );
+
+		double const blitMs = best_ms_( [&] {
+			auto const image = lut::load_image_texture2d_with_bliting( path.c_str(), batch, aAllocator );
+			batch.flush();
+		} );
+		double const uploadMs = best_ms_( [&] {
+			auto const image = lut::load_image_texture2d_with_cpu_mips( path.c_str(), lut::MipFilter::kaiser, batch, aAllocator );
+			batch.flush();
+		} );
+
+		// Show the end of long paths
+		auto const name = path.size() > 40 ? "..." + path.substr( path.size() - 37 ) : path;
+		std::printf( "%-40s %5dx%-5d %8.2f %8.2f %12.2f %12.2f\n", name.c_str(), width, height, boxMs, kaiserMs, blitMs, uploadMs );
+	}
+}
@@ -0,0 +1,19 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "../labutils/allocator.hpp"
+#include "../labutils/vulkan_context.hpp"
+
+/* Compares the CPU mip generator (see labutils/mipmap.hpp) with the chain of
+ * vkCmdBlitImage() calls recorded by UploadBatch, for the color textures of
+ * the given models. For each texture, it prints
+ *  - the CPU time to generate the mip chain with the box and Kaiser filters,
+ *    from decoded pixels to host memory, and
+ *  - the time from decoding the image to having the complete mip chain on
+ *    the GPU, once with blits (load_image_texture2d_with_bliting()) and once
+ *    with the Kaiser filter on the CPU (load_image_texture2d_with_cpu_mips()).
+ * Each value is the best of a few runs.
+ */
+void benchmark_mip_generation( labutils::VulkanContext const&, labutils::Allocator const&, std::vector<std::string> const& aModelPaths );
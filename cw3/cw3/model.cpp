@@ -1,13 +1,104 @@
 #include "model.hpp"
 
+#include <chrono>
 #include <utility>
+#include <unordered_map>
 
 #include <cstdio>
 #include <cassert>
+#include <cstring>
 
 #include "../labutils/error.hpp"
 namespace lut = labutils;
 
+#include "model_cache.hpp"
+#include "obj_parser.hpp"
+#include "mesh_optimizer.hpp"
+#include "meshlet.hpp"
+#include "mesh_lod.hpp"
+
+// Uncomment to parse OBJ files with the single-threaded tinyobj::LoadObj()
+// instead of load_obj_parallel(). Both produce the same ModelData; see
+// obj_benchmark.hpp for a comparison.
+//#define OBJ_PARSER_TINYOBJ
+
+// Comment out to skip the mesh optimization pass (see mesh_optimizer.hpp).
+#define MESH_OPTIMIZE
+
+// Comment out to skip generating levels of detail (see mesh_lod.hpp).
+#define MESH_LODS
+
+namespace
+{
+	// Attribute values of a vertex. Vertices are deduplicated by value rather
+	// than by their OBJ index triple, since many exporters (including the one
+	// that produced NewShip.obj) write a fresh v/vt/vn index for every corner.
+	struct VertexKey_
+	{
+		glm::vec3 position;
+		glm::vec3 normal;
+		glm::vec2 texcoord;
+
+		bool operator== (VertexKey_ const& aOther) const noexcept
+		{
+			// Compare bit patterns, to match the hash below. 
+			return 0 == std::memcmp( this, &aOther, sizeof(VertexKey_) );
+		}
+	};
+
+	static_assert( sizeof(VertexKey_) == 8*sizeof(float), "VertexKey_ must not contain padding" );
+
+	struct VertexKeyHash_
+	{
+		std::size_t operator() (VertexKey_ const& aKey) const noexcept
+		{
+			// FNV-1a over the 32-bit words of the key
+			std::uint32_t words[8];
+			std::memcpy( words, &aKey, sizeof(words) );
+
+			std::uint64_t h = 0xcbf29ce484222325ull;
+			for( auto const w : words )
+			{
+				h ^= w;
+				h *= 0x100000001b3ull;
+			}
+			return std::size_t(h ^ (h >> 32));
+		}
+	};
+
+	// Splits aOBJPath into the directory, including the trailing separator,
+	// and the file name
+	void split_obj_path_( std::string_view const& aOBJPath, std::string& aDirectory, std::string& aFileName );
+
+	ModelData parse_obj_model_( std::string const& aNormalizedPath, std::string const& aDirectory, ObjParser );
+
+	constexpr ObjParser kObjParser_ =
+#		if defined(OBJ_PARSER_TINYOBJ)
+		ObjParser::tinyobj
+#		else // !OBJ_PARSER_TINYOBJ
+		ObjParser::parallel
+#		endif // ~ OBJ_PARSER_TINYOBJ
+	;
+
+	// Optional processing steps applied by load_obj_model(). These are
+	// recorded in the cooked models, such that changing them invalidates the
+	// cooked data.
+	enum ModelProcessing_ : std::uint32_t
+	{
+		kProcessingOptimize_ = 1u << 0,
+		kProcessingLods_ = 1u << 1,
+	};
+
+	constexpr std::uint32_t kModelProcessing_ = 0
+#		if defined(MESH_OPTIMIZE)
+		| kProcessingOptimize_
+#		endif // ~ MESH_OPTIMIZE
+#		if defined(MESH_LODS)
+		| kProcessingLods_
+#		endif // ~ MESH_LODS
+	;
+}
+
 // ModelData
 ModelData::ModelData() noexcept = default;
 
@@ -16,9 +107,18 @@ ModelData::ModelData( ModelData&& aOther ) noexcept
 	, modelSourcePath( std::exchange( aOther.modelSourcePath, {} ) )
 	, materials( std::move( aOther.materials ) )
 	, meshes( std::move( aOther.meshes ) )
+	, meshlets( std::move( aOther.meshlets ) )
 	, vertexPositions( std::move( aOther.vertexPositions ) )
 	, vertexNormals( std::move( aOther.vertexNormals ) )
 	, vertexTextureCoords( std::move( aOther.vertexTextureCoords ) )
+	, indices( std::move( aOther.indices ) )
+	, cookedFile( std::move( aOther.cookedFile ) )
+	, cookedPositions( std::exchange( aOther.cookedPositions, nullptr ) )
+	, cookedNormals( std::exchange( aOther.cookedNormals, nullptr ) )
+	, cookedTexcoords( std::exchange( aOther.cookedTexcoords, nullptr ) )
+	, cookedIndices( std::exchange( aOther.cookedIndices, nullptr ) )
+	, cookedVertexCount( std::exchange( aOther.cookedVertexCount, 0 ) )
+	, cookedIndexCount( std::exchange( aOther.cookedIndexCount, 0 ) )
 {}
 
 ModelData& ModelData::operator=( ModelData&& aOther ) noexcept
@@ -27,212 +127,441 @@ ModelData& ModelData::operator=( ModelData&& aOther ) noexcept
 	std::swap( modelSourcePath, aOther.modelSourcePath );
 	std::swap( materials, aOther.materials );
 	std::swap( meshes, aOther.meshes );
+	std::swap( meshlets, aOther.meshlets );
 	std::swap( vertexPositions, aOther.vertexPositions );
 	std::swap( vertexNormals, aOther.vertexNormals );
 	std::swap( vertexTextureCoords, aOther.vertexTextureCoords );
+	std::swap( indices, aOther.indices );
+	std::swap( cookedFile, aOther.cookedFile );
+	std::swap( cookedPositions, aOther.cookedPositions );
+	std::swap( cookedNormals, aOther.cookedNormals );
+	std::swap( cookedTexcoords, aOther.cookedTexcoords );
+	std::swap( cookedIndices, aOther.cookedIndices );
+	std::swap( cookedVertexCount, aOther.cookedVertexCount );
+	std::swap( cookedIndexCount, aOther.cookedIndexCount );
 	return *this;
 }
 
+std::size_t ModelData::vertex_count() const noexcept
+{
+	return cookedPositions ? cookedVertexCount : vertexPositions.size();
+}
+std::size_t ModelData::index_count() const noexcept
+{
+	return cookedIndices ? cookedIndexCount : indices.size();
+}
+
+glm::vec3 const* ModelData::position_data() const noexcept
+{
+	return cookedPositions ? cookedPositions : vertexPositions.data();
+}
+glm::vec3 const* ModelData::normal_data() const noexcept
+{
+	return cookedNormals ? cookedNormals : vertexNormals.data();
+}
+glm::vec2 const* ModelData::texcoord_data() const noexcept
+{
+	return cookedTexcoords ? cookedTexcoords : vertexTextureCoords.data();
+}
+std::uint32_t const* ModelData::index_data() const noexcept
+{
+	return cookedIndices ? cookedIndices : indices.data();
+}
+
 
 // load_obj_model()
 ModelData load_obj_model( std::string_view const& aOBJPath )
 {
 	// "Decode" path
-	std::string fileName, directory;
+	std::string directory, fileName;
+	split_obj_path_( aOBJPath, directory, fileName );
+
+	std::string const normalizedPath = directory + fileName;
+
+	auto const startTime = std::chrono::steady_clock::now();
+	auto const elapsed_ms = [&startTime] {
+		return std::chrono::duration<double, std::milli>( std::chrono::steady_clock::now() - startTime ).count();
+	};
+
+	// Try the cooked version of the model first
+	std::string const cookedPath = cooked_model_path( normalizedPath );
+
+	if( auto cooked = load_cooked_model( cookedPath, kModelProcessing_ ) )
+	{
+		cooked->modelName = aOBJPath;
+
+		std::printf( "Loading: '%s' ... OK (cooked, %.1f ms)\n", normalizedPath.c_str(), elapsed_ms() );
+		std::printf( "  %zu unique vertices, %zu indices, %zu meshes, %zu meshlets\n", 
+			cooked->vertex_count(), cooked->index_count(), cooked->meshes.size(), cooked->meshlets.size()
+		);
+		return std::move(*cooked);
+	}
+
+	// Otherwise, load the OBJ and cook it for the next time around
+	auto model = parse_obj_model_( normalizedPath, directory, kObjParser_ );
+	model.modelName = aOBJPath;
+
+	std::printf( "  parsed in %.1f ms\n", elapsed_ms() );
+
+	merge_meshes_by_material( model );
+
+	if constexpr( kModelProcessing_ & kProcessingOptimize_ )
+		optimize_meshes( model );
+
+	build_meshlets( model, 0 != (kModelProcessing_ & kProcessingOptimize_) );
+
+	if constexpr( kModelProcessing_ & kProcessingLods_ )
+		generate_lods( model );
 
-	if( auto const separator = aOBJPath.find_last_of( "/\\" ); std::string_view::npos != separator )
+	try
 	{
-		fileName = aOBJPath.substr( separator+1 );
-		directory = aOBJPath.substr( 0, separator+1 );
+		write_cooked_model( cookedPath, model, kModelProcessing_ );
 	}
-	else
+	catch( lut::Error const& eErr )
 	{
-		fileName = aOBJPath;
-		directory = "./";
+		// Not fatal; we'll just have to parse the OBJ again on the next launch.
+		std::fprintf( stderr, "Warning: unable to write cooked model: %s\n", eErr.what() );
 	}
 
-	std::string const normalizedPath = directory + fileName;
+	return model;
+}
+
+// parse_obj_model()
+ModelData parse_obj_model( std::string_view const& aOBJPath, ObjParser aParser )
+{
+	std::string directory, fileName;
+	split_obj_path_( aOBJPath, directory, fileName );
 
-	// Load model
-	std::printf( "Loading: '%s' ...", normalizedPath.c_str() );
-	std::fflush( stdout );
+	auto model = parse_obj_model_( directory + fileName, directory, aParser );
+	model.modelName = aOBJPath;
+	return model;
+}
 
-	tinyobj::attrib_t attrib;
-	std::vector<tinyobj::shape_t> shapes;
-	std::vector<tinyobj::material_t> materials;
-	std::string err;
+// merge_meshes_by_material()
+void merge_meshes_by_material( ModelData& aModel )
+{
+	// Group meshes by material, in the order in which the materials are
+	// first encountered.
+	std::vector<std::vector<std::size_t>> groups;
+	std::vector<std::size_t> groupOfMaterial( aModel.materials.size(), ~std::size_t(0) );
 
-	if( !tinyobj::LoadObj( &attrib, &shapes, &materials, &err, normalizedPath.c_str(), directory.c_str(), true ) )
+	for( std::size_t i = 0; i < aModel.meshes.size(); ++i )
 	{
-		throw lut::Error( "Unable to load OBJ '%s':\n%s", normalizedPath.c_str(), err.c_str() );
+		auto& group = groupOfMaterial[aModel.meshes[i].materialIndex];
+		if( ~std::size_t(0) == group )
+		{
+			group = groups.size();
+			groups.emplace_back();
+		}
+
+		groups[group].emplace_back( i );
 	}
 
-	// Apparently this can include some warnings:
-	if( !err.empty() )
-		std::printf( "\n%s\n... OK", err.c_str() );
-	else
-		std::printf( " OK\n" );
+	if( groups.size() == aModel.meshes.size() )
+		return; // nothing to merge
+
+	// Rebuild vertex and index data such that each group is contiguous. The
+	// indices of each mesh are rebased to the start of its group.
+	std::vector<MeshInfo> meshes;
+	meshes.reserve( groups.size() );
 
-	// Transfer into our ModelData structures
-	ModelData model;
-	model.modelName        = aOBJPath;
-	model.modelSourcePath  = normalizedPath;
+	std::vector<glm::vec3> positions, normals;
+	std::vector<glm::vec2> texcoords;
+	std::vector<std::uint32_t> indices;
 
-	// ... copy over material data ...
-	for( auto const& m : materials )
+	positions.reserve( aModel.vertexPositions.size() );
+	normals.reserve( aModel.vertexNormals.size() );
+	texcoords.reserve( aModel.vertexTextureCoords.size() );
+	indices.reserve( aModel.indices.size() );
+
+	for( auto const& group : groups )
 	{
-		MaterialInfo info{};
-		info.materialName      = m.name;
+		auto const& first = aModel.meshes[group.front()];
+
+		MeshInfo merged{};
+		merged.materialIndex     = first.materialIndex;
+		merged.meshName          = 1 == group.size() ? first.meshName : "*::" + aModel.materials[first.materialIndex].materialName;
+		merged.vertexStartIndex  = positions.size();
+		merged.indexStartIndex   = indices.size();
+
+		for( auto const meshIndex : group )
+		{
+			auto const& mesh = aModel.meshes[meshIndex];
 
-		info.color  = glm::vec3( m.diffuse[0], m.diffuse[1], m.diffuse[2] );
+			auto const vbeg = mesh.vertexStartIndex, vend = vbeg + mesh.numberOfVertices;
+			auto const base = std::uint32_t(positions.size() - merged.vertexStartIndex);
 
-		info.emissive  = glm::vec3( m.emission[0], m.emission[1], m.emission[2] );
-		info.diffuse  = glm::vec3( m.diffuse[0], m.diffuse[1], m.diffuse[2] );
-		info.specular  = glm::vec3( m.specular[0], m.specular[1], m.specular[2] );
-		info.shininess  = m.roughness;
+			positions.insert( positions.end(), aModel.vertexPositions.begin() + vbeg, aModel.vertexPositions.begin() + vend );
+			normals.insert( normals.end(), aModel.vertexNormals.begin() + vbeg, aModel.vertexNormals.begin() + vend );
+			texcoords.insert( texcoords.end(), aModel.vertexTextureCoords.begin() + vbeg, aModel.vertexTextureCoords.begin() + vend );
 
-		info.albedo  = glm::vec3( m.diffuse[0], m.diffuse[1], m.diffuse[2] );
-		info.metalness  = m.metallic;
+			auto const ibeg = mesh.indexStartIndex, iend = ibeg + mesh.numberOfIndices;
+			for( auto i = ibeg; i < iend; ++i )
+				indices.emplace_back( base + aModel.indices[i] );
+		}
 
-		if( !m.diffuse_texname.empty() ) info.mapDiffuse = directory + m.diffuse_texname;
-		if( !m.specular_texname.empty() ) info.mapSpecular = directory + m.specular_texname;
-		if( !m.alpha_texname.empty() ) info.mapAlpha = directory + m.alpha_texname;
-		if( !m.normal_texname.empty() ) info.mapNormals = directory + m.normal_texname;
+		merged.numberOfVertices  = positions.size() - merged.vertexStartIndex;
+		merged.numberOfIndices   = indices.size() - merged.indexStartIndex;
 
-		model.materials.emplace_back( info );
+		meshes.emplace_back( std::move(merged) );
 	}
 
-	// ... copy over mesh data ...
-	// Note: this converts the mesh into a triangle soup. OBJ meshes use
-	// separate indices for vertex positions, texture coordinates and normals.
-	// This is not compatible with the default draw modes of OpenGL or Vulkan,
-	// where each vertex has a single index that refers to all attributes.
-	//
-	// tinyobjloader additionally complicates the situation by specifying a
-	// per-face material indices, which is rather impractical.
-	//
-	// In short- The OBJ format isn't exactly a great format (in a modern
-	// context), and tinyobjloader is not making the situation a lot better.
-	std::size_t totalVertices = 0;
-	for( auto const& s : shapes )
+	std::printf( "  merged %zu meshes into %zu (one per material)\n", aModel.meshes.size(), meshes.size() );
+
+	aModel.meshes = std::move(meshes);
+	aModel.vertexPositions = std::move(positions);
+	aModel.vertexNormals = std::move(normals);
+	aModel.vertexTextureCoords = std::move(texcoords);
+	aModel.indices = std::move(indices);
+}
+
+
+namespace
+{
+	void split_obj_path_( std::string_view const& aOBJPath, std::string& aDirectory, std::string& aFileName )
 	{
-		totalVertices += s.mesh.indices.size();
+		if( auto const separator = aOBJPath.find_last_of( "/\\" ); std::string_view::npos != separator )
+		{
+			aFileName = aOBJPath.substr( separator+1 );
+			aDirectory = aOBJPath.substr( 0, separator+1 );
+		}
+		else
+		{
+			aFileName = aOBJPath;
+			aDirectory = "./";
+		}
 	}
 
-	model.vertexPositions.reserve( totalVertices );
-	model.vertexNormals.reserve( totalVertices );
-	model.vertexTextureCoords.reserve( totalVertices );
-
-	std::size_t currentIndex = 0;
-	for( auto const& s : shapes )
+	ModelData parse_obj_model_( std::string const& aNormalizedPath, std::string const& aDirectory, ObjParser aParser )
 	{
-		auto const& objMesh = s.mesh;
+		auto const& normalizedPath = aNormalizedPath;
+		auto const& directory = aDirectory;
+
+		// Load model
+		std::printf( "Loading: '%s' ...", normalizedPath.c_str() );
+		std::fflush( stdout );
+
+		tinyobj::attrib_t attrib;
+		std::vector<tinyobj::shape_t> shapes;
+		std::vector<tinyobj::material_t> materials;
+		std::string err;
+
+		if( ObjParser::tinyobj == aParser )
+		{
+			if( !tinyobj::LoadObj( &attrib, &shapes, &materials, &err, normalizedPath.c_str(), directory.c_str(), true ) )
+			{
+				throw lut::Error( "Unable to load OBJ '%s':\n%s", normalizedPath.c_str(), err.c_str() );
+			}
+		}
+		else
+		{
+			load_obj_parallel( attrib, shapes, materials, err, normalizedPath, directory );
+		}
+
+		// Apparently this can include some warnings:
+		if( !err.empty() )
+			std::printf( "\n%s\n... OK", err.c_str() );
+		else
+			std::printf( " OK\n" );
+
+		// Transfer into our ModelData structures
+		ModelData model;
+		model.modelSourcePath  = normalizedPath;
+
+		// ... copy over material data ...
+		for( auto const& m : materials )
+		{
+			MaterialInfo info{};
+			info.materialName      = m.name;
 
-		if( objMesh.indices.empty() )
-			continue;
+			info.color  = glm::vec3( m.diffuse[0], m.diffuse[1], m.diffuse[2] );
 
-		assert( !objMesh.material_ids.empty() );
+			info.emissive  = glm::vec3( m.emission[0], m.emission[1], m.emission[2] );
+			info.diffuse  = glm::vec3( m.diffuse[0], m.diffuse[1], m.diffuse[2] );
+			info.specular  = glm::vec3( m.specular[0], m.specular[1], m.specular[2] );
+			info.shininess  = m.roughness;
 
-		// The OBJ format allows for general polygons and not just triangles.
-		// However, this code only deals with triangles. Check that we only
-		// have triangles (debug mode only).
-		assert( objMesh.indices.size() % 3 == 0 );
-#		ifndef NDEBUG
-		for( auto faceVerts : objMesh.num_face_vertices )
-			assert( 3 == faceVerts );
-#		endif // ~ NDEBUG
+			info.albedo  = glm::vec3( m.diffuse[0], m.diffuse[1], m.diffuse[2] );
+			info.metalness  = m.metallic;
 
-		// Each of our rendered objMeshes can only have a single material. 
-		// Split the OBJ objMesh into multiple objMeshes if there are multiple 
-		// materials. 
+			if( !m.diffuse_texname.empty() ) info.mapDiffuse = directory + m.diffuse_texname;
+			if( !m.specular_texname.empty() ) info.mapSpecular = directory + m.specular_texname;
+			if( !m.alpha_texname.empty() ) info.mapAlpha = directory + m.alpha_texname;
+			if( !m.normal_texname.empty() ) info.mapNormals = directory + m.normal_texname;
+
+			model.materials.emplace_back( info );
+		}
+
+		// ... copy over mesh data ...
+		// Note: OBJ meshes use separate indices for vertex positions, texture
+		// coordinates and normals. This is not compatible with the default draw
+		// modes of OpenGL or Vulkan, where each vertex has a single index that
+		// refers to all attributes. We therefore create one vertex for each unique
+		// (position, normal, texcoord) combination found in a mesh, and emit an
+		// index buffer that refers to these.
+		//
+		// tinyobjloader additionally complicates the situation by specifying a
+		// per-face material indices, which is rather impractical.
 		//
-		// Note: if a single material is repeated multiple times, this will
-		// generate a new objMesh for each time the material is encountered.
-		int currentMaterial = -1; // start a new material!
+		// In short- The OBJ format isn't exactly a great format (in a modern
+		// context), and tinyobjloader is not making the situation a lot better.
+		std::size_t totalCorners = 0;
+		for( auto const& s : shapes )
+		{
+			totalCorners += s.mesh.indices.size();
+		}
+
+		// Worst case: every corner is a unique vertex. The vectors are shrunk
+		// after deduplication.
+		model.vertexPositions.reserve( totalCorners );
+		model.vertexNormals.reserve( totalCorners );
+		model.vertexTextureCoords.reserve( totalCorners );
+		model.indices.reserve( totalCorners );
+
+		// Map from vertex attributes to the vertex created for them. Indices are
+		// local to the current mesh, so the map is cleared whenever a mesh ends.
+		std::unordered_map<VertexKey_, std::uint32_t, VertexKeyHash_> uniqueVertices;
 
-		std::size_t indices = 0;
+		std::size_t meshVertexStart = 0, meshIndexStart = 0;
+		auto const flush_mesh = [&] ( std::string const& aShapeName, int aMaterial )
+		{
+			if( model.indices.size() == meshIndexStart )
+				return;
+
+			assert( aMaterial >= 0 ); 
+
+			MeshInfo mesh{};
+			mesh.materialIndex     = aMaterial;
+			mesh.meshName          = aShapeName + "::" + model.materials[aMaterial].materialName;
+			mesh.vertexStartIndex  = meshVertexStart;
+			mesh.numberOfVertices  = model.vertexPositions.size() - meshVertexStart;
+			mesh.indexStartIndex   = meshIndexStart;
+			mesh.numberOfIndices   = model.indices.size() - meshIndexStart;
 
-		std::size_t face = 0, vert = 0;
-		for( auto const& objIdx : objMesh.indices )
+			model.meshes.emplace_back( mesh );
+
+			meshVertexStart = model.vertexPositions.size();
+			meshIndexStart = model.indices.size();
+			uniqueVertices.clear();
+		};
+
+		for( auto const& s : shapes )
 		{
-			// check if material changed
-			auto const matId = objMesh.material_ids[face];
-			if( matId != currentMaterial )
+			auto const& objMesh = s.mesh;
+
+			if( objMesh.indices.empty() )
+				continue;
+
+			assert( !objMesh.material_ids.empty() );
+
+			// The OBJ format allows for general polygons and not just triangles.
+			// However, this code only deals with triangles. Check that we only
+			// have triangles (debug mode only).
+			assert( objMesh.indices.size() % 3 == 0 );
+	#		ifndef NDEBUG
+			for( auto faceVerts : objMesh.num_face_vertices )
+				assert( 3 == faceVerts );
+	#		endif // ~ NDEBUG
+
+			// Each of our rendered objMeshes can only have a single material. 
+			// Split the OBJ objMesh into multiple objMeshes if there are multiple 
+			// materials. 
+			//
+			// Note: if a single material is repeated multiple times, this will
+			// generate a new objMesh for each time the material is encountered.
+			// merge_meshes_by_material() coalesces these afterwards.
+			int currentMaterial = -1; // start a new material!
+
+			std::size_t face = 0, vert = 0;
+			for( auto const& objIdx : objMesh.indices )
 			{
-				if( indices )
+				// check if material changed
+				auto const matId = objMesh.material_ids[face];
+				if( matId != currentMaterial )
 				{
-					assert( currentMaterial >= 0 ); 
-
-					MeshInfo mesh{};
-					mesh.materialIndex     = currentMaterial;
-					mesh.meshName          = s.name + "::" + model.materials[currentMaterial].materialName;
-					mesh.vertexStartIndex  = currentIndex;
-					mesh.numberOfVertices  = indices;
+					flush_mesh( s.name, currentMaterial );
+					currentMaterial = matId;
+				}
 
-					model.meshes.emplace_back( mesh );
+				// gather the attributes of this corner
+				VertexKey_ key;
+				key.position = glm::vec3(
+					attrib.vertices[ objIdx.vertex_index * 3 + 0 ],
+					attrib.vertices[ objIdx.vertex_index * 3 + 1 ],
+					attrib.vertices[ objIdx.vertex_index * 3 + 2 ]
+				);
+
+				assert( objIdx.normal_index >= 0 ); // must have a normal!
+				key.normal = glm::vec3(
+					attrib.normals[ objIdx.normal_index * 3 + 0 ],
+					attrib.normals[ objIdx.normal_index * 3 + 1 ],
+					attrib.normals[ objIdx.normal_index * 3 + 2 ]
+				);
+
+				if( objIdx.texcoord_index >= 0 )
+				{
+					key.texcoord = glm::vec2(
+						attrib.texcoords[ objIdx.texcoord_index * 2 + 0 ],
+						attrib.texcoords[ objIdx.texcoord_index * 2 + 1 ]
+					);
+				}
+				else
+				{
+					key.texcoord = glm::vec2( 0.f, 0.f );
 				}
 
-				currentIndex += indices;
-				currentMaterial = matId;
-				indices = 0;
-			}
+				// find or create the vertex for this corner
+				auto const [it, isNew] = uniqueVertices.emplace( key, std::uint32_t(model.vertexPositions.size() - meshVertexStart) );
 
-			// copy over data
-			model.vertexPositions.emplace_back( glm::vec3(
-				attrib.vertices[ objIdx.vertex_index * 3 + 0 ],
-				attrib.vertices[ objIdx.vertex_index * 3 + 1 ],
-				attrib.vertices[ objIdx.vertex_index * 3 + 2 ]
-			) );
-
-			assert( objIdx.normal_index >= 0 ); // must have a normal!
-			model.vertexNormals.emplace_back( glm::vec3(
-				attrib.normals[ objIdx.normal_index * 3 + 0 ],
-				attrib.normals[ objIdx.normal_index * 3 + 1 ],
-				attrib.normals[ objIdx.normal_index * 3 + 2 ]
-			) );
-
-			if( objIdx.texcoord_index >= 0 )
-			{
-				model.vertexTextureCoords.emplace_back( glm::vec2(
-					attrib.texcoords[ objIdx.texcoord_index * 2 + 0 ],
-					attrib.texcoords[ objIdx.texcoord_index * 2 + 1 ]
-				) );
-			}
-			else
-			{
-				model.vertexTextureCoords.emplace_back( glm::vec2( 0.f, 0.f ) );
-			}
+				if( isNew )
+				{
+					// copy over data
+					model.vertexPositions.emplace_back( key.position );
+					model.vertexNormals.emplace_back( key.normal );
+					model.vertexTextureCoords.emplace_back( key.texcoord );
+				}
 
-			++indices;
+				model.indices.emplace_back( it->second );
 
-			// accounting: next vertex
-			++vert;
-			if( 3 == vert )
-			{
-				++face;
-				vert = 0;
+				// accounting: next vertex
+				++vert;
+				if( 3 == vert )
+				{
+					++face;
+					vert = 0;
+				}
 			}
+
+			flush_mesh( s.name, currentMaterial );
 		}
 
-		if( indices )
-		{
-			assert( currentMaterial >= 0 ); 
+		assert( model.indices.size() == totalCorners );
+		assert( model.vertexNormals.size() == model.vertexPositions.size() );
+		assert( model.vertexTextureCoords.size() == model.vertexPositions.size() );
 
-			MeshInfo mesh{};
-			mesh.materialIndex     = currentMaterial;
-			mesh.meshName          = s.name + "::" + model.materials[currentMaterial].materialName;
-			mesh.vertexStartIndex  = currentIndex;
-			mesh.numberOfVertices  = indices;
+		model.vertexPositions.shrink_to_fit();
+		model.vertexNormals.shrink_to_fit();
+		model.vertexTextureCoords.shrink_to_fit();
 
-			currentIndex += indices;
+		// Report how much the indexing saved compared to a triangle soup
+		std::size_t constexpr kVertexBytes = sizeof(glm::vec3) + sizeof(glm::vec3) + sizeof(glm::vec2);
 
-			model.meshes.emplace_back( mesh );
-		}
-	}
+		std::size_t indexedBytes = model.vertexPositions.size() * kVertexBytes;
+		for( auto const& mesh : model.meshes )
+			indexedBytes += mesh.numberOfIndices * (mesh.numberOfVertices <= 0x10000 ? sizeof(std::uint16_t) : sizeof(std::uint32_t));
 
-	assert( model.vertexPositions.size() == totalVertices );
-	assert( model.vertexNormals.size() == totalVertices );
-	assert( model.vertexTextureCoords.size() == totalVertices );
-	
-	return model;
+		std::size_t const soupBytes = totalCorners * kVertexBytes;
+
+		std::printf( "  %zu corners -> %zu unique vertices (dedup ratio %.2f:1), %zu meshes\n", 
+			totalCorners, model.vertexPositions.size(), 
+			model.vertexPositions.empty() ? 0. : double(totalCorners) / model.vertexPositions.size(),
+			model.meshes.size()
+		);
+		std::printf( "  vertex+index data: %.2f MiB (triangle soup: %.2f MiB, saved %.2f MiB)\n",
+			indexedBytes / (1024.*1024.), soupBytes / (1024.*1024.), 
+			(double(soupBytes) - double(indexedBytes)) / (1024.*1024.)
+		);
+
+		return model;
+	}
 }
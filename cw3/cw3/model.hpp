@@ -13,6 +13,8 @@
 #include <glm/glm.hpp>
 #include <tiny_obj_loader.h>
 
+#include "../labutils/mapped_file.hpp"
+
 /* The structures here are intended to be used during loading only. At runtime,
  * you probably want to use a different set of structures that instead hold e.g.
  * references to the Vulkan resources in which a subset of the data resides. At
@@ -55,6 +57,19 @@ struct MaterialInfo
 	std::string mapNormals; // In some models, this is a bump map instead.
 };
 
+struct MeshLodInfo
+{
+	// A simplified version of a mesh, given by numberOfIndices indices
+	// starting at indexStartIndex in ModelData::indices. The indices refer to
+	// the vertices of the full-detail mesh (i.e., they are relative to its
+	// vertexStartIndex).
+	std::size_t indexStartIndex;
+	std::size_t numberOfIndices;
+
+	// Approximate geometric error of the simplified mesh, in model units.
+	float error;
+};
+
 struct MeshInfo
 {
 	std::string meshName;
@@ -69,6 +84,46 @@ struct MeshInfo
 	// ModelData.
 	std::size_t vertexStartIndex;
 	std::size_t numberOfVertices;
+
+	// The triangles of the mesh are given by numberOfIndices indices, starting
+	// at indexStartIndex in ModelData::indices. Indices are relative to
+	// vertexStartIndex, so a mesh with at most 65536 vertices can be drawn
+	// with 16-bit indices.
+	std::size_t indexStartIndex;
+	std::size_t numberOfIndices;
+
+	// The mesh is partitioned into numberOfMeshlets meshlets, starting at
+	// meshletStartIndex in ModelData::meshlets. See meshlet.hpp.
+	std::size_t meshletStartIndex;
+	std::size_t numberOfMeshlets;
+
+	// Progressively coarser levels of detail, not including the full-detail
+	// mesh itself. See mesh_lod.hpp.
+	std::vector<MeshLodInfo> lods;
+};
+
+struct MeshletInfo
+{
+	// The triangles of the meshlet are given by numberOfIndices indices,
+	// starting at indexStartIndex. indexStartIndex is relative to the
+	// MeshInfo::indexStartIndex of the mesh that the meshlet belongs to.
+	std::uint32_t indexStartIndex;
+	std::uint32_t numberOfIndices;
+
+	// Number of distinct vertices referenced by the meshlet.
+	std::uint32_t numberOfVertices;
+
+	// Bounding sphere
+	glm::vec3 center;
+	float radius;
+
+	// Normal cone. All triangles of the meshlet face away from any viewer at
+	// a position v for which
+	//   dot( normalize( coneApex - v ), coneAxis ) >= coneCutoff
+	// A coneCutoff of 1 (or larger) disables the test.
+	glm::vec3 coneApex;
+	glm::vec3 coneAxis;
+	float coneCutoff;
 };
 
 
@@ -88,10 +143,50 @@ struct ModelData
 
 	std::vector<MaterialInfo> materials;
 	std::vector<MeshInfo> meshes;
+	std::vector<MeshletInfo> meshlets;
 
 	std::vector<glm::vec3> vertexPositions;
 	std::vector<glm::vec3> vertexNormals;
 	std::vector<glm::vec2> vertexTextureCoords;
+
+	std::vector<std::uint32_t> indices;
+
+	// Cooked models (see model_cache.hpp) don't copy their vertex and index
+	// arrays into the vectors above. The arrays are instead read directly
+	// from the memory-mapped cooked file, which cookedFile keeps open. The
+	// accessors below return the arrays in either case.
+	labutils::MappedFile cookedFile;
+	glm::vec3 const* cookedPositions = nullptr;
+	glm::vec3 const* cookedNormals = nullptr;
+	glm::vec2 const* cookedTexcoords = nullptr;
+	std::uint32_t const* cookedIndices = nullptr;
+	std::size_t cookedVertexCount = 0;
+	std::size_t cookedIndexCount = 0;
+
+	std::size_t vertex_count() const noexcept;
+	std::size_t index_count() const noexcept;
+
+	glm::vec3 const* position_data() const noexcept;
+	glm::vec3 const* normal_data() const noexcept;
+	glm::vec2 const* texcoord_data() const noexcept;
+	std::uint32_t const* index_data() const noexcept;
 };
 
 ModelData load_obj_model( std::string_view const& aOBJPath );
+
+// Front ends for reading OBJ files
+enum class ObjParser
+{
+	tinyobj,  // tinyobj::LoadObj(), single-threaded
+	parallel  // load_obj_parallel(), see obj_parser.hpp
+};
+
+// Parses an OBJ file into indexed meshes, i.e., the first step of
+// load_obj_model(), without the cooked models and the further processing.
+// Both parsers produce the same ModelData.
+ModelData parse_obj_model( std::string_view const& aOBJPath, ObjParser );
+
+// Coalesces all meshes that share a material into a single mesh, such that
+// each material can be drawn with a single draw call. Called by
+// load_obj_model().
+void merge_meshes_by_material( ModelData& );
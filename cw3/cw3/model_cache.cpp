@@ -0,0 +1,658 @@
+#include "model_cache.hpp"
+
+#include <filesystem>
+#include <type_traits>
+
+#include <cctype>
+#include <cstdio>
+#include <cstring>
+
+#include "../labutils/error.hpp"
+#include "../labutils/mapped_file.hpp"
+namespace lut = labutils;
+
+namespace
+{
+	// Increment kCookedVersion whenever the layout below or the contents of
+	// ModelData (e.g., the way vertices are deduplicated) change.
+	constexpr std::uint32_t kCookedMagic = 0x4d335743; // 'CW3M'
+	constexpr std::uint32_t kCookedVersion = 6;
+
+	constexpr std::size_t kBlobAlignment = 16;
+
+	struct CookedString_
+	{
+		std::uint32_t offset; // into the string table
+		std::uint32_t length;
+	};
+
+	struct CookedHeader_
+	{
+		std::uint32_t magic;
+		std::uint32_t version;
+
+		CookedString_ modelName;
+		CookedString_ modelSourcePath;
+
+		std::uint32_t dependencyCount;
+		std::uint32_t materialCount;
+		std::uint32_t meshCount;
+		std::uint32_t processingFlags;
+
+		std::uint64_t vertexCount;
+		std::uint64_t indexCount;
+		std::uint64_t meshletCount;
+		std::uint64_t lodCount;
+
+		std::uint64_t stringsOffset, stringsSize;
+		std::uint64_t dependenciesOffset;
+		std::uint64_t materialsOffset;
+		std::uint64_t meshesOffset;
+		std::uint64_t positionsOffset;
+		std::uint64_t normalsOffset;
+		std::uint64_t texcoordsOffset;
+		std::uint64_t indicesOffset;
+		std::uint64_t meshletsOffset;
+		std::uint64_t lodsOffset;
+	};
+
+	struct CookedDependency_
+	{
+		CookedString_ path;
+		std::uint64_t size;
+		std::int64_t mtime;
+		std::uint64_t hash;
+	};
+
+	struct CookedMaterial_
+	{
+		CookedString_ materialName;
+		CookedString_ mapDiffuse, mapSpecular, mapAlpha, mapNormals;
+
+		float color[3];
+		float emissive[3];
+		float diffuse[3];
+		float specular[3];
+		float albedo[3];
+		float shininess;
+		float metalness;
+	};
+
+	struct CookedMesh_
+	{
+		CookedString_ meshName;
+		std::uint32_t materialIndex;
+		std::uint32_t numberOfLods;
+
+		std::uint64_t vertexStartIndex, numberOfVertices;
+		std::uint64_t indexStartIndex, numberOfIndices;
+		std::uint64_t meshletStartIndex, numberOfMeshlets;
+		std::uint64_t lodStartIndex;
+	};
+
+	struct CookedLod_
+	{
+		std::uint64_t indexStartIndex, numberOfIndices;
+		float error;
+		std::uint32_t reserved;
+	};
+
+	struct CookedMeshlet_
+	{
+		std::uint32_t indexStartIndex, numberOfIndices;
+		std::uint32_t numberOfVertices;
+
+		float center[3];
+		float radius;
+
+		float coneApex[3];
+		float coneAxis[3];
+		float coneCutoff;
+	};
+
+	// The structures are written to disk as-is. Make sure their layout does not
+	// depend on the compiler.
+	static_assert( sizeof(CookedHeader_) == 160, "Unexpected padding in CookedHeader_" );
+	static_assert( sizeof(CookedDependency_) == 32, "Unexpected padding in CookedDependency_" );
+	static_assert( sizeof(CookedMaterial_) == 108, "Unexpected padding in CookedMaterial_" );
+	static_assert( sizeof(CookedMesh_) == 72, "Unexpected padding in CookedMesh_" );
+	static_assert( sizeof(CookedLod_) == 24, "Unexpected padding in CookedLod_" );
+	static_assert( sizeof(CookedMeshlet_) == 56, "Unexpected padding in CookedMeshlet_" );
+
+	static_assert( sizeof(glm::vec3) == 3*sizeof(float), "glm::vec3 must be tightly packed" );
+	static_assert( sizeof(glm::vec2) == 2*sizeof(float), "glm::vec2 must be tightly packed" );
+
+
+	struct SourceInfo_
+	{
+		std::uint64_t size;
+		std::int64_t mtime;
+	};
+
+	bool stat_source_( std::string const& aPath, SourceInfo_& aInfo )
+	{
+		std::error_code ec;
+		auto const size = std::filesystem::file_size( aPath, ec );
+		if( ec ) return false;
+
+		auto const mtime = std::filesystem::last_write_time( aPath, ec );
+		if( ec ) return false;
+
+		aInfo.size = size;
+		aInfo.mtime = std::int64_t(mtime.time_since_epoch().count());
+		return true;
+	}
+
+	std::uint64_t hash_bytes_( void const* aData, std::size_t aSize ) noexcept
+	{
+		// Simple multiply-rotate hash over 64-bit words. This is only used to
+		// detect changed source files, so it does not need to be particularly
+		// strong, but it needs to be fast for large OBJ files.
+		auto const* bytes = static_cast<unsigned char const*>(aData);
+
+		std::uint64_t h = 0x9e3779b97f4a7c15ull ^ aSize;
+		auto const mix = [&h] (std::uint64_t aWord) {
+			h ^= aWord * 0xff51afd7ed558ccdull;
+			h = (h << 31) | (h >> 33);
+			h *= 0xc4ceb9fe1a85ec53ull;
+		};
+
+		std::size_t i = 0;
+		for( ; i + sizeof(std::uint64_t) <= aSize; i += sizeof(std::uint64_t) )
+		{
+			std::uint64_t word;
+			std::memcpy( &word, bytes+i, sizeof(word) );
+			mix( word );
+		}
+
+		if( i < aSize )
+		{
+			std::uint64_t tail = 0;
+			std::memcpy( &tail, bytes+i, aSize-i );
+			mix( tail );
+		}
+
+		return h ^ (h >> 29);
+	}
+
+	std::uint64_t hash_file_( std::string const& aPath )
+	{
+		auto const file = lut::map_file( aPath.c_str() );
+		return hash_bytes_( file.data, file.size );
+	}
+
+	// Lists the files that a model was loaded from: the OBJ itself and the
+	// material libraries referenced via "mtllib". Texture images are not
+	// included, as only their paths end up in the ModelData.
+	std::vector<std::string> find_dependencies_( std::string const& aOBJPath )
+	{
+		std::string directory;
+		if( auto const separator = aOBJPath.find_last_of( "/\\" ); std::string::npos != separator )
+			directory = aOBJPath.substr( 0, separator+1 );
+
+		std::vector<std::string> deps{ aOBJPath };
+
+		auto const file = lut::map_file( aOBJPath.c_str() );
+		auto const* beg = static_cast<char const*>(file.data);
+		auto const* const end = beg + file.size;
+
+		constexpr char kMtllib[] = "mtllib";
+		constexpr std::size_t kMtllibLength = sizeof(kMtllib)-1;
+
+		while( beg < end )
+		{
+			auto const* eol = static_cast<char const*>(std::memchr( beg, '\n', end-beg ));
+			if( !eol ) eol = end;
+
+			auto const* ptr = beg;
+			while( ptr < eol && (' ' == *ptr || '\t' == *ptr) ) ++ptr;
+
+			if( std::size_t(eol-ptr) > kMtllibLength && 0 == std::memcmp( ptr, kMtllib, kMtllibLength ) && (' ' == ptr[kMtllibLength] || '\t' == ptr[kMtllibLength]) )
+			{
+				// Like tinyobjloader, accept multiple whitespace-separated
+				// file names per mtllib line.
+				ptr += kMtllibLength;
+				while( ptr < eol )
+				{
+					while( ptr < eol && std::isspace( static_cast<unsigned char>(*ptr) ) ) ++ptr;
+					auto const* nameBeg = ptr;
+					while( ptr < eol && !std::isspace( static_cast<unsigned char>(*ptr) ) ) ++ptr;
+
+					if( nameBeg != ptr )
+						deps.emplace_back( directory + std::string( nameBeg, ptr ) );
+				}
+			}
+
+			beg = eol+1;
+		}
+
+		return deps;
+	}
+
+
+	// Incrementally builds the cooked file in memory.
+	class CookedWriter_
+	{
+		public:
+			template< typename tType >
+			std::uint64_t append( tType const* aData, std::size_t aCount )
+			{
+				static_assert( std::is_trivially_copyable_v<tType> );
+
+				std::size_t const offset = (mBytes.size() + kBlobAlignment-1) & ~(kBlobAlignment-1);
+				std::size_t const size = aCount * sizeof(tType);
+
+				mBytes.resize( offset + size );
+				if( size )
+					std::memcpy( mBytes.data() + offset, aData, size );
+
+				return offset;
+			}
+
+			CookedString_ string( std::string const& aString )
+			{
+				CookedString_ ret{};
+				ret.offset = std::uint32_t(mStrings.size());
+				ret.length = std::uint32_t(aString.size());
+				mStrings += aString;
+				return ret;
+			}
+
+			std::string const& strings() const noexcept { return mStrings; }
+			std::vector<char>& bytes() noexcept { return mBytes; }
+
+		private:
+			std::vector<char> mBytes;
+			std::string mStrings;
+	};
+
+	// Validates the tables of a cooked file and reads back its strings.
+	class CookedReader_
+	{
+		public:
+			explicit CookedReader_( lut::MappedFile const& aFile ) noexcept
+				: mBytes( static_cast<char const*>(aFile.data) )
+				, mSize( aFile.size )
+			{}
+
+			template< typename tType >
+			tType const* blob( std::uint64_t aOffset, std::uint64_t aCount ) const noexcept
+			{
+				if( aOffset % kBlobAlignment ) return nullptr;
+				if( aCount > mSize / sizeof(tType) ) return nullptr;
+				if( aOffset > mSize - aCount*sizeof(tType) ) return nullptr;
+				return reinterpret_cast<tType const*>(mBytes + aOffset);
+			}
+
+			bool set_strings( std::uint64_t aOffset, std::uint64_t aSize ) noexcept
+			{
+				mStrings = blob<char>( aOffset, aSize );
+				mStringsSize = aSize;
+				return nullptr != mStrings || 0 == aSize;
+			}
+
+			bool string( CookedString_ const& aString, std::string& aOut ) const
+			{
+				if( std::uint64_t(aString.offset) + aString.length > mStringsSize )
+					return false;
+
+				aOut.assign( mStrings + aString.offset, aString.length );
+				return true;
+			}
+
+		private:
+			char const* mBytes;
+			std::size_t mSize;
+
+			char const* mStrings = nullptr;
+			std::uint64_t mStringsSize = 0;
+	};
+
+	bool dependency_is_current_( CookedDependency_ const& aDep, std::string const& aPath )
+	{
+		SourceInfo_ info;
+		if( !stat_source_( aPath, info ) )
+			return false;
+
+		if( info.size != aDep.size )
+			return false;
+
+		if( info.mtime == aDep.mtime )
+			return true;
+
+		// Same size, different modification time: the file may have been
+		// touched without being changed. Compare contents.
+		return hash_file_( aPath ) == aDep.hash;
+	}
+
+	// Indices are relative to their mesh's first vertex. Out-of-range ones
+	// would reach the GPU unchecked, or be truncated to 16 bits by
+	// create_mesh_data(), so a file that contains any is rejected.
+	bool indices_in_range_( std::uint32_t const* aIndices, std::uint64_t aCount, std::uint64_t aVertexCount )
+	{
+		for( std::uint64_t i = 0; i < aCount; ++i )
+		{
+			if( aIndices[i] >= aVertexCount )
+				return false;
+		}
+
+		return true;
+	}
+
+}
+
+std::string cooked_model_path( std::string const& aOBJPath )
+{
+	return aOBJPath + ".cooked";
+}
+
+std::optional<ModelData> load_cooked_model( std::string const& aCookedPath, std::uint32_t aProcessingFlags ) try
+{
+	std::error_code ec;
+	if( !std::filesystem::is_regular_file( aCookedPath, ec ) )
+		return {};
+
+	auto file = lut::map_file( aCookedPath.c_str() );
+	CookedReader_ reader( file );
+
+	auto const* header = reader.blob<CookedHeader_>( 0, 1 );
+	if( !header || kCookedMagic != header->magic || kCookedVersion != header->version )
+		return {};
+
+	if( aProcessingFlags != header->processingFlags )
+		return {};
+
+	if( !reader.set_strings( header->stringsOffset, header->stringsSize ) )
+		return {};
+
+	auto const* deps = reader.blob<CookedDependency_>( header->dependenciesOffset, header->dependencyCount );
+	auto const* materials = reader.blob<CookedMaterial_>( header->materialsOffset, header->materialCount );
+	auto const* meshes = reader.blob<CookedMesh_>( header->meshesOffset, header->meshCount );
+	auto const* positions = reader.blob<glm::vec3>( header->positionsOffset, header->vertexCount );
+	auto const* normals = reader.blob<glm::vec3>( header->normalsOffset, header->vertexCount );
+	auto const* texcoords = reader.blob<glm::vec2>( header->texcoordsOffset, header->vertexCount );
+	auto const* indices = reader.blob<std::uint32_t>( header->indicesOffset, header->indexCount );
+	auto const* meshlets = reader.blob<CookedMeshlet_>( header->meshletsOffset, header->meshletCount );
+	auto const* lods = reader.blob<CookedLod_>( header->lodsOffset, header->lodCount );
+
+	if( !deps || !materials || !meshes || !positions || !normals || !texcoords || !indices || !meshlets || !lods )
+		return {};
+
+	// Check that the sources are unchanged
+	std::string path;
+	for( std::uint32_t i = 0; i < header->dependencyCount; ++i )
+	{
+		if( !reader.string( deps[i].path, path ) || !dependency_is_current_( deps[i], path ) )
+			return {};
+	}
+
+	// Read back model
+	ModelData model;
+	if( !reader.string( header->modelName, model.modelName ) || !reader.string( header->modelSourcePath, model.modelSourcePath ) )
+		return {};
+
+	model.materials.reserve( header->materialCount );
+	for( std::uint32_t i = 0; i < header->materialCount; ++i )
+	{
+		auto const& cm = materials[i];
+
+		MaterialInfo info{};
+		if( !reader.string( cm.materialName, info.materialName ) ||
+			!reader.string( cm.mapDiffuse, info.mapDiffuse ) ||
+			!reader.string( cm.mapSpecular, info.mapSpecular ) ||
+			!reader.string( cm.mapAlpha, info.mapAlpha ) ||
+			!reader.string( cm.mapNormals, info.mapNormals ) )
+		{
+			return {};
+		}
+
+		info.color     = glm::vec3( cm.color[0], cm.color[1], cm.color[2] );
+		info.emissive  = glm::vec3( cm.emissive[0], cm.emissive[1], cm.emissive[2] );
+		info.diffuse   = glm::vec3( cm.diffuse[0], cm.diffuse[1], cm.diffuse[2] );
+		info.specular  = glm::vec3( cm.specular[0], cm.specular[1], cm.specular[2] );
+		info.shininess = cm.shininess;
+		info.albedo    = glm::vec3( cm.albedo[0], cm.albedo[1], cm.albedo[2] );
+		info.metalness = cm.metalness;
+
+		model.materials.emplace_back( std::move(info) );
+	}
+
+	model.meshes.reserve( header->meshCount );
+	for( std::uint32_t i = 0; i < header->meshCount; ++i )
+	{
+		auto const& cm = meshes[i];
+
+		if( cm.materialIndex >= header->materialCount )
+			return {};
+		if( cm.vertexStartIndex > header->vertexCount || cm.numberOfVertices > header->vertexCount - cm.vertexStartIndex )
+			return {};
+		if( cm.indexStartIndex > header->indexCount || cm.numberOfIndices > header->indexCount - cm.indexStartIndex )
+			return {};
+		if( !indices_in_range_( indices + cm.indexStartIndex, cm.numberOfIndices, cm.numberOfVertices ) )
+			return {};
+		if( cm.meshletStartIndex > header->meshletCount || cm.numberOfMeshlets > header->meshletCount - cm.meshletStartIndex )
+			return {};
+
+		for( std::uint64_t j = cm.meshletStartIndex; j < cm.meshletStartIndex + cm.numberOfMeshlets; ++j )
+		{
+			if( meshlets[j].indexStartIndex > cm.numberOfIndices || meshlets[j].numberOfIndices > cm.numberOfIndices - meshlets[j].indexStartIndex )
+				return {};
+		}
+
+		if( cm.lodStartIndex > header->lodCount || cm.numberOfLods > header->lodCount - cm.lodStartIndex )
+			return {};
+
+		MeshInfo mesh{};
+		if( !reader.string( cm.meshName, mesh.meshName ) )
+			return {};
+
+		mesh.materialIndex     = cm.materialIndex;
+		mesh.vertexStartIndex  = std::size_t(cm.vertexStartIndex);
+		mesh.numberOfVertices  = std::size_t(cm.numberOfVertices);
+		mesh.indexStartIndex   = std::size_t(cm.indexStartIndex);
+		mesh.numberOfIndices   = std::size_t(cm.numberOfIndices);
+		mesh.meshletStartIndex = std::size_t(cm.meshletStartIndex);
+		mesh.numberOfMeshlets  = std::size_t(cm.numberOfMeshlets);
+
+		for( std::uint64_t j = cm.lodStartIndex; j < cm.lodStartIndex + cm.numberOfLods; ++j )
+		{
+			if( lods[j].indexStartIndex > header->indexCount || lods[j].numberOfIndices > header->indexCount - lods[j].indexStartIndex )
+				return {};
+			if( !indices_in_range_( indices + lods[j].indexStartIndex, lods[j].numberOfIndices, cm.numberOfVertices ) )
+				return {};
+
+			MeshLodInfo lod{};
+			lod.indexStartIndex  = std::size_t(lods[j].indexStartIndex);
+			lod.numberOfIndices  = std::size_t(lods[j].numberOfIndices);
+			lod.error            = lods[j].error;
+			mesh.lods.emplace_back( lod );
+		}
+
+		model.meshes.emplace_back( std::move(mesh) );
+	}
+
+	// The vertex and index arrays stay in the mapped file, from where they
+	// are written to staging memory when the meshes are uploaded
+	model.cookedPositions    = positions;
+	model.cookedNormals      = normals;
+	model.cookedTexcoords    = texcoords;
+	model.cookedIndices      = indices;
+	model.cookedVertexCount  = std::size_t(header->vertexCount);
+	model.cookedIndexCount   = std::size_t(header->indexCount);
+
+	model.meshlets.reserve( std::size_t(header->meshletCount) );
+	for( std::uint64_t i = 0; i < header->meshletCount; ++i )
+	{
+		auto const& cm = meshlets[i];
+
+		MeshletInfo meshlet{};
+		meshlet.indexStartIndex   = cm.indexStartIndex;
+		meshlet.numberOfIndices   = cm.numberOfIndices;
+		meshlet.numberOfVertices  = cm.numberOfVertices;
+		meshlet.center            = glm::vec3( cm.center[0], cm.center[1], cm.center[2] );
+		meshlet.radius            = cm.radius;
+		meshlet.coneApex          = glm::vec3( cm.coneApex[0], cm.coneApex[1], cm.coneApex[2] );
+		meshlet.coneAxis          = glm::vec3( cm.coneAxis[0], cm.coneAxis[1], cm.coneAxis[2] );
+		meshlet.coneCutoff        = cm.coneCutoff;
+
+		model.meshlets.emplace_back( meshlet );
+	}
+
+	model.cookedFile = std::move(file);
+	return model;
+}
+catch( lut::Error const& )
+{
+	// Unreadable cooked files are treated like missing ones; the caller will
+	// just cook the model again.
+	return {};
+}
+
+void write_cooked_model( std::string const& aCookedPath, ModelData const& aModel, std::uint32_t aProcessingFlags )
+{
+	CookedWriter_ writer;
+
+	CookedHeader_ header{};
+	header.magic    = kCookedMagic;
+	header.version  = kCookedVersion;
+	header.processingFlags = aProcessingFlags;
+
+	header.modelName        = writer.string( aModel.modelName );
+	header.modelSourcePath  = writer.string( aModel.modelSourcePath );
+
+	// Record the state of the source files
+	std::vector<CookedDependency_> deps;
+	for( auto const& path : find_dependencies_( aModel.modelSourcePath ) )
+	{
+		SourceInfo_ info;
+		if( !stat_source_( path, info ) )
+			continue; // tinyobjloader tolerates missing material libraries, so do we
+
+		CookedDependency_ dep{};
+		dep.path   = writer.string( path );
+		dep.size   = info.size;
+		dep.mtime  = info.mtime;
+		dep.hash   = hash_file_( path );
+		deps.emplace_back( dep );
+	}
+
+	std::vector<CookedMaterial_> materials;
+	materials.reserve( aModel.materials.size() );
+	for( auto const& m : aModel.materials )
+	{
+		CookedMaterial_ cm{};
+		cm.materialName  = writer.string( m.materialName );
+		cm.mapDiffuse    = writer.string( m.mapDiffuse );
+		cm.mapSpecular   = writer.string( m.mapSpecular );
+		cm.mapAlpha      = writer.string( m.mapAlpha );
+		cm.mapNormals    = writer.string( m.mapNormals );
+
+		std::memcpy( cm.color, &m.color, sizeof(cm.color) );
+		std::memcpy( cm.emissive, &m.emissive, sizeof(cm.emissive) );
+		std::memcpy( cm.diffuse, &m.diffuse, sizeof(cm.diffuse) );
+		std::memcpy( cm.specular, &m.specular, sizeof(cm.specular) );
+		std::memcpy( cm.albedo, &m.albedo, sizeof(cm.albedo) );
+		cm.shininess  = m.shininess;
+		cm.metalness  = m.metalness;
+
+		materials.emplace_back( cm );
+	}
+
+	std::vector<CookedMesh_> meshes;
+	std::vector<CookedLod_> lods;
+	meshes.reserve( aModel.meshes.size() );
+	for( auto const& m : aModel.meshes )
+	{
+		CookedMesh_ cm{};
+		cm.meshName          = writer.string( m.meshName );
+		cm.materialIndex     = m.materialIndex;
+		cm.vertexStartIndex  = m.vertexStartIndex;
+		cm.numberOfVertices  = m.numberOfVertices;
+		cm.indexStartIndex   = m.indexStartIndex;
+		cm.numberOfIndices   = m.numberOfIndices;
+		cm.meshletStartIndex = m.meshletStartIndex;
+		cm.numberOfMeshlets  = m.numberOfMeshlets;
+		cm.lodStartIndex     = lods.size();
+		cm.numberOfLods      = std::uint32_t(m.lods.size());
+
+		for( auto const& lod : m.lods )
+		{
+			CookedLod_ cl{};
+			cl.indexStartIndex  = lod.indexStartIndex;
+			cl.numberOfIndices  = lod.numberOfIndices;
+			cl.error            = lod.error;
+			lods.emplace_back( cl );
+		}
+
+		meshes.emplace_back( cm );
+	}
+
+	std::vector<CookedMeshlet_> meshlets;
+	meshlets.reserve( aModel.meshlets.size() );
+	for( auto const& m : aModel.meshlets )
+	{
+		CookedMeshlet_ cm{};
+		cm.indexStartIndex   = m.indexStartIndex;
+		cm.numberOfIndices   = m.numberOfIndices;
+		cm.numberOfVertices  = m.numberOfVertices;
+		cm.radius            = m.radius;
+		cm.coneCutoff        = m.coneCutoff;
+
+		std::memcpy( cm.center, &m.center, sizeof(cm.center) );
+		std::memcpy( cm.coneApex, &m.coneApex, sizeof(cm.coneApex) );
+		std::memcpy( cm.coneAxis, &m.coneAxis, sizeof(cm.coneAxis) );
+
+		meshlets.emplace_back( cm );
+	}
+
+	header.dependencyCount  = std::uint32_t(deps.size());
+	header.materialCount    = std::uint32_t(materials.size());
+	header.meshCount        = std::uint32_t(meshes.size());
+	header.vertexCount      = aModel.vertexPositions.size();
+	header.indexCount       = aModel.indices.size();
+	header.meshletCount     = aModel.meshlets.size();
+	header.lodCount         = lods.size();
+
+	// Lay out file. The header is written last, once all offsets are known.
+	writer.append( &header, 1 );
+
+	header.stringsSize         = writer.strings().size();
+	header.stringsOffset       = writer.append( writer.strings().data(), writer.strings().size() );
+	header.dependenciesOffset  = writer.append( deps.data(), deps.size() );
+	header.materialsOffset     = writer.append( materials.data(), materials.size() );
+	header.meshesOffset        = writer.append( meshes.data(), meshes.size() );
+	header.meshletsOffset      = writer.append( meshlets.data(), meshlets.size() );
+	header.lodsOffset          = writer.append( lods.data(), lods.size() );
+	header.positionsOffset     = writer.append( aModel.vertexPositions.data(), aModel.vertexPositions.size() );
+	header.normalsOffset       = writer.append( aModel.vertexNormals.data(), aModel.vertexNormals.size() );
+	header.texcoordsOffset     = writer.append( aModel.vertexTextureCoords.data(), aModel.vertexTextureCoords.size() );
+	header.indicesOffset       = writer.append( aModel.indices.data(), aModel.indices.size() );
+
+	auto& bytes = writer.bytes();
+	std::memcpy( bytes.data(), &header, sizeof(header) );
+
+	// Write to a temporary file first, such that an interrupted write never
+	// leaves a truncated cooked file behind.
+	std::string const tempPath = aCookedPath + ".tmp";
+
+	std::FILE* fof = std::fopen( tempPath.c_str(), "wb" );
+	if( !fof )
+		throw lut::Error( "Unable to open '%s' for writing", tempPath.c_str() );
+
+	auto const written = std::fwrite( bytes.data(), 1, bytes.size(), fof );
+	auto const closed = std::fclose( fof );
+
+	if( written != bytes.size() || 0 != closed )
+	{
+		std::remove( tempPath.c_str() );
+		throw lut::Error( "Unable to write cooked model '%s'", tempPath.c_str() );
+	}
+
+	std::error_code ec;
+	std::filesystem::rename( tempPath, aCookedPath, ec );
+	if( ec )
+	{
+		std::remove( tempPath.c_str() );
+		throw lut::Error( "Unable to rename '%s' to '%s':\n%s", tempPath.c_str(), aCookedPath.c_str(), ec.message().c_str() );
+	}
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <string>
+#include <optional>
+
+#include <cstdint>
+
+#include "model.hpp"
+
+/* Cooked models are a binary version of the ModelData produced by
+ * load_obj_model(). The file starts with a versioned header, followed by a
+ * string table, the list of source files the model was cooked from, the
+ * material, mesh, meshlet and level of detail tables, and the position,
+ * normal, texture coordinate and index arrays. Each of the blobs is aligned
+ * to 16 bytes, so that the arrays can be used directly from the
+ * memory-mapped file (see ModelData::cookedFile).
+ *
+ * A cooked model is only used if all of its source files (the OBJ and any
+ * material libraries it references) are unchanged. A source file is
+ * considered unchanged if its size and modification time match the recorded
+ * values, or, failing that, if the hash of its contents does (this keeps the
+ * cache valid e.g. across a fresh checkout of the assets).
+ *
+ * The processing flags identify the optional processing steps that were
+ * applied to the model after loading (see load_obj_model()). A cooked model
+ * is only used if its flags match the requested ones.
+ */
+
+// Path of the cooked model that corresponds to aOBJPath.
+std::string cooked_model_path( std::string const& aOBJPath );
+
+// Loads the cooked model at aCookedPath. Returns an empty optional if the
+// file doesn't exist, is of a different version or with different processing
+// flags, or is out of date with respect to its sources.
+std::optional<ModelData> load_cooked_model( std::string const& aCookedPath, std::uint32_t aProcessingFlags );
+
+// Writes aModel to aCookedPath. The source files are determined from
+// aModel.modelSourcePath. Throws labutils::Error on failure.
+void write_cooked_model( std::string const& aCookedPath, ModelData const& aModel, std::uint32_t aProcessingFlags );
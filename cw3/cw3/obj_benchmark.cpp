@@ -0,0 +1,262 @@
+#include "obj_benchmark.hpp"
+
+#include <chrono>
+#include <limits>
+#include <algorithm>
+#include <filesystem>
+#include <system_error>
+
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+
+#include <tiny_obj_loader.h>
+
+#include "../labutils/error.hpp"
+namespace lut = labutils;
+
+#include "model.hpp"
+#include "obj_parser.hpp"
+
+namespace
+{
+	// Parsing the synthetic OBJ takes seconds, so fewer runs than in the
+	// other benchmarks
+	constexpr int kRepetitions = 3;
+
+	// Shape of the synthetic OBJ: rows of kGridColumns_ vertices, with a new
+	// group every kRowsPerGroup_ rows
+	constexpr std::uint32_t kGridColumns_ = 1024;
+	constexpr std::uint32_t kRowsPerGroup_ = 256;
+
+	template< typename tFunc >
+	double best_ms_( tFunc const& aFunc )
+	{
+		using Clock_ = std::chrono::steady_clock;
+
+		double best = std::numeric_limits<double>::max();
+		for( int i = 0; i < kRepetitions; ++i )
+		{
+			auto const before = Clock_::now();
+			aFunc();
+			auto const after = Clock_::now();
+
+			best = std::min( best, std::chrono::duration<double, std::milli>( after - before ).count() );
+		}
+
+		return best;
+	}
+
+	// Writes the synthetic OBJ, aBytes in size (rounded up to whole rows),
+	// and its material library aMtlName in the same directory
+	void write_synthetic_obj_( std::filesystem::path const& aOBJPath, std::string const& aMtlName, std::uint64_t aBytes )
+	{
+		if( std::FILE* mtl = std::fopen( (aOBJPath.parent_path() / aMtlName).string().c_str(), "wb" ) )
+		{
+			std::fprintf( mtl, "newmtl rock\nKd 0.5 0.45 0.4\n\nnewmtl moss\nKd 0.2 0.5 0.2\n" );
+			std::fclose( mtl );
+		}
+		else
+		{
+			throw lut::Error( "Unable to write '%s'", aMtlName.c_str() );
+		}
+
+		std::FILE* obj = std::fopen( aOBJPath.string().c_str(), "wb" );
+		if( !obj )
+			throw lut::Error( "Unable to write '%s'", aOBJPath.string().c_str() );
+
+		std::uint64_t written = 0;
+		auto const print = [&] (auto... aArgs) {
+			if( int const count = std::fprintf( obj, aArgs... ); count > 0 )
+				written += std::uint64_t(count);
+		};
+
+		print( "# synthetic height field, see obj_benchmark.hpp\nmtllib %s\n", aMtlName.c_str() );
+
+		for( std::uint32_t row = 0; written < aBytes; ++row )
+		{
+			if( 0 == row % kRowsPerGroup_ )
+				print( "g part%u\nusemtl %s\n", row / kRowsPerGroup_, (row / kRowsPerGroup_) % 2 ? "moss" : "rock" );
+
+			for( std::uint32_t col = 0; col < kGridColumns_; ++col )
+			{
+				float const x = col * 0.01f, z = row * 0.01f;
+				float const dx = 0.7f * std::cos( 7.f * x ) * std::cos( 5.f * z );
+				float const dz = -0.5f * std::sin( 7.f * x ) * std::sin( 5.f * z );
+				float const len = std::sqrt( dx*dx + 1.f + dz*dz );
+
+				print( "v %f %f %f\n", x, 0.1f * std::sin( 7.f * x ) * std::cos( 5.f * z ), z );
+				print( "vt %f %f\n", col / float(kGridColumns_-1), (row % kRowsPerGroup_) / float(kRowsPerGroup_) );
+				print( "vn %f %f %f\n", -dx / len, 1.f / len, -dz / len );
+			}
+
+			if( 0 == row )
+				continue;
+
+			// Faces between the previous row and this one. Odd rows use
+			// relative indices.
+			long long const first = (long long)row * kGridColumns_ + 1; // of this row, 1-based
+			long long const base = row % 2 ? first - (long long)(row+1) * kGridColumns_ - 1 : first;
+
+			for( std::uint32_t col = 0; col+1 < kGridColumns_; ++col )
+			{
+				long long const a = base - kGridColumns_ + col, b = a + 1;
+				long long const c = base + col, d = c + 1;
+
+				print( "f %lld/%lld/%lld %lld/%lld/%lld %lld/%lld/%lld\n", a, a, a, d, d, d, b, b, b );
+				print( "f %lld/%lld/%lld %lld/%lld/%lld %lld/%lld/%lld\n", a, a, a, c, c, c, d, d, d );
+			}
+		}
+
+		bool const failed = 0 != std::ferror( obj );
+		std::fclose( obj );
+
+		if( failed )
+			throw lut::Error( "Unable to write '%s'", aOBJPath.string().c_str() );
+	}
+
+	// Removes the synthetic OBJ and its material library again
+	struct SyntheticFiles_
+	{
+		std::filesystem::path obj, mtl;
+
+		~SyntheticFiles_()
+		{
+			std::error_code ec;
+			std::filesystem::remove( obj, ec );
+			std::filesystem::remove( mtl, ec );
+		}
+	};
+
+	bool same_model_data_( ModelData const&, ModelData const& );
+
+	template< typename tT >
+	bool same_bits_( std::vector<tT> const& aA, std::vector<tT> const& aB )
+	{
+		return aA.size() == aB.size() && (aA.empty() || 0 == std::memcmp( aA.data(), aB.data(), aA.size() * sizeof(tT) ));
+	}
+}
+
+void benchmark_obj_parsing( std::vector<std::string> const& aOBJPaths, std::uint64_t aSyntheticBytes )
+{
+	std::vector<std::string> paths = aOBJPaths;
+
+	std::filesystem::path const tempDir = std::filesystem::temp_directory_path();
+	std::string const syntheticMtl = "cw3-obj-benchmark.mtl";
+
+	SyntheticFiles_ synthetic;
+	if( aSyntheticBytes > 0 )
+	{
+		synthetic.obj = tempDir / "cw3-obj-benchmark.obj";
+		synthetic.mtl = tempDir / syntheticMtl;
+
+		std::printf( "Writing synthetic OBJ '%s' ...", synthetic.obj.string().c_str() );
+		std::fflush( stdout );
+
+		write_synthetic_obj_( synthetic.obj, syntheticMtl, aSyntheticBytes );
+		paths.emplace_back( synthetic.obj.string() );
+
+		std::printf( " OK\n" );
+	}
+
+	struct Result_
+	{
+		std::string path;
+		std::uintmax_t bytes;
+		double tinyobjMs, parallelMs;
+		bool same;
+	};
+
+	std::vector<Result_> results;
+	for( auto const& path : paths )
+	{
+		std::error_code ec;
+		auto const bytes = std::filesystem::file_size( path, ec );
+		if( ec )
+		{
+			std::printf( "Skipping '%s': %s\n", path.c_str(), ec.message().c_str() );
+			continue;
+		}
+
+		auto const separator = path.find_last_of( "/\\" );
+		std::string const directory = std::string::npos != separator ? path.substr( 0, separator+1 ) : "./";
+
+		double const tinyobjMs = best_ms_( [&] {
+			tinyobj::attrib_t attrib;
+			std::vector<tinyobj::shape_t> shapes;
+			std::vector<tinyobj::material_t> materials;
+			std::string err;
+
+			if( !tinyobj::LoadObj( &attrib, &shapes, &materials, &err, path.c_str(), directory.c_str(), true ) )
+				throw lut::Error( "Unable to load OBJ '%s':\n%s", path.c_str(), err.c_str() );
+		} );
+		double const parallelMs = best_ms_( [&] {
+			tinyobj::attrib_t attrib;
+			std::vector<tinyobj::shape_t> shapes;
+			std::vector<tinyobj::material_t> materials;
+			std::string warnings;
+
+			load_obj_parallel( attrib, shapes, materials, warnings, path, directory );
+		} );
+
+		bool const same = same_model_data_( parse_obj_model( path, ObjParser::tinyobj ), parse_obj_model( path, ObjParser::parallel ) );
+
+		results.emplace_back( Result_{ path, bytes, tinyobjMs, parallelMs, same } );
+	}
+
+	std::printf( "\nOBJ parsing, best of %d runs, in ms\n", kRepetitions );
+	std::printf( "%-40s %10s %10s %10s %8s %9s\n", "file", "MiB", "tinyobj", "parallel", "speedup", "ModelData" );
+
+	bool allSame = true;
+	for( auto const& result : results )
+	{
+		// Show the end of long paths
+		auto const name = result.path.size() > 40 ? "..." + result.path.substr( result.path.size() - 37 ) : result.path;
+		std::printf( "%-40s %10.1f %10.1f %10.1f %7.2fx %9s\n", name.c_str(), result.bytes / (1024.0*1024.0),
+			result.tinyobjMs, result.parallelMs, result.tinyobjMs / result.parallelMs, result.same ? "same" : "DIFFERS" );
+
+		allSame = allSame && result.same;
+	}
+
+	if( !allSame )
+		throw lut::Error( "load_obj_parallel() and tinyobj::LoadObj() produced different ModelData" );
+}
+
+namespace
+{
+	bool same_model_data_( ModelData const& aA, ModelData const& aB )
+	{
+		if( aA.materials.size() != aB.materials.size() || aA.meshes.size() != aB.meshes.size() )
+			return false;
+
+		for( std::size_t i = 0; i < aA.materials.size(); ++i )
+		{
+			auto const& a = aA.materials[i];
+			auto const& b = aB.materials[i];
+
+			if( a.materialName != b.materialName || a.mapDiffuse != b.mapDiffuse || a.mapSpecular != b.mapSpecular
+				|| a.mapAlpha != b.mapAlpha || a.mapNormals != b.mapNormals )
+				return false;
+
+			if( a.color != b.color || a.emissive != b.emissive || a.diffuse != b.diffuse || a.specular != b.specular
+				|| a.shininess != b.shininess || a.albedo != b.albedo || a.metalness != b.metalness )
+				return false;
+		}
+
+		for( std::size_t i = 0; i < aA.meshes.size(); ++i )
+		{
+			auto const& a = aA.meshes[i];
+			auto const& b = aB.meshes[i];
+
+			if( a.meshName != b.meshName || a.materialIndex != b.materialIndex
+				|| a.vertexStartIndex != b.vertexStartIndex || a.numberOfVertices != b.numberOfVertices
+				|| a.indexStartIndex != b.indexStartIndex || a.numberOfIndices != b.numberOfIndices )
+				return false;
+		}
+
+		return same_bits_( aA.vertexPositions, aB.vertexPositions )
+			&& same_bits_( aA.vertexNormals, aB.vertexNormals )
+			&& same_bits_( aA.vertexTextureCoords, aB.vertexTextureCoords )
+			&& same_bits_( aA.indices, aB.indices );
+	}
+}
@@ -0,0 +1,20 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include <cstdint>
+
+/* Compares load_obj_parallel() (see obj_parser.hpp) with tinyobj::LoadObj(),
+ * on the given OBJ files and on a synthetic OBJ of about aSyntheticBytes
+ * bytes. The synthetic OBJ resembles a scanned height field: a large grid of
+ * v/vt/vn lines and triangles, split into groups with alternating materials,
+ * using absolute and relative indices. It is written to the temporary
+ * directory first, and removed afterwards; 0 skips it.
+ *
+ * For each file, it prints the best time of a few runs of either parser and
+ * the speedup of load_obj_parallel(). It then checks that parse_obj_model()
+ * produces the same ModelData with either parser, and throws labutils::Error
+ * if it does not for any of the files.
+ */
+void benchmark_obj_parsing( std::vector<std::string> const& aOBJPaths, std::uint64_t aSyntheticBytes );
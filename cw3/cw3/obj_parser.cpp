@@ -0,0 +1,659 @@
+#include "obj_parser.hpp"
+
+#include <map>
+#include <thread>
+#include <sstream>
+#include <utility>
+#include <algorithm>
+
+#include <cmath>
+#include <cctype>
+#include <cstring>
+#include <cstdint>
+
+#include "../labutils/mapped_file.hpp"
+#include "../labutils/parallel_for.hpp"
+namespace lut = labutils;
+
+namespace
+{
+	// Chunks are at least this large; smaller files are parsed by a single
+	// thread. Beyond that, we create a few chunks per thread to even out the
+	// load, since the lines in different parts of a file can differ a lot.
+	constexpr std::size_t kMinChunkSize = 1024*1024;
+	constexpr std::size_t kChunksPerThread = 4;
+
+	struct ObjEvent_
+	{
+		enum class Kind { useMaterial, materialLibrary, group, object };
+
+		Kind kind;
+
+		// Number of faces and triangles in the chunk before this event
+		std::size_t face, triangle;
+
+		std::string argument;
+	};
+
+	struct ObjChunk_
+	{
+		std::vector<tinyobj::real_t> positions, normals, texcoords;
+
+		// Triangulated faces, three corners per triangle
+		std::vector<tinyobj::index_t> corners;
+
+		// Relative (negative) indices are resolved against the chunk-local
+		// attribute counts first; this lists them as corner*3 + component,
+		// such that the number of attributes in the previous chunks can be
+		// added during the merge.
+		std::vector<std::size_t> relativeIndices;
+
+		std::vector<ObjEvent_> events;
+		std::size_t faceCount = 0;
+	};
+
+	struct ObjSegment_
+	{
+		// Triangles [triBegin, triEnd) of a chunk end up in shape at
+		// dstTriangle, with the given material.
+		std::size_t chunk, triBegin, triEnd;
+		std::size_t shape, dstTriangle;
+		int material;
+	};
+
+	// The following mirror the helpers in tinyobjloader, but operate on a
+	// [begin,end) range rather than on null-terminated strings. Lines never
+	// contain '\r' or '\n' (see parse_chunk_()), which simplifies matters.
+	inline bool is_space_( char aChar ) noexcept
+	{
+		return ' ' == aChar || '\t' == aChar;
+	}
+	inline bool is_digit_( char aChar ) noexcept
+	{
+		return static_cast<unsigned>(aChar - '0') < 10u;
+	}
+
+	inline char const* skip_space_( char const* aBeg, char const* aEnd ) noexcept
+	{
+		while( aBeg < aEnd && is_space_( *aBeg ) ) ++aBeg;
+		return aBeg;
+	}
+	inline char const* skip_token_( char const* aBeg, char const* aEnd ) noexcept
+	{
+		while( aBeg < aEnd && !is_space_( *aBeg ) ) ++aBeg;
+		return aBeg;
+	}
+	inline char const* skip_index_( char const* aBeg, char const* aEnd ) noexcept
+	{
+		while( aBeg < aEnd && '/' != *aBeg && !is_space_( *aBeg ) ) ++aBeg;
+		return aBeg;
+	}
+
+	// Same algorithm as tinyobj's tryParseDouble(). Note that this is not
+	// correctly rounded. We need the exact same results as tinyobjloader, so
+	// std::strtod() or std::from_chars() are not an option.
+	bool parse_double_( char const* aBeg, char const* aEnd, double& aResult ) noexcept
+	{
+		if( aBeg >= aEnd )
+			return false;
+
+		double mantissa = 0.0;
+		int exponent = 0;
+		char sign = '+', expSign = '+';
+		char const* curr = aBeg;
+
+		if( '+' == *curr || '-' == *curr )
+			sign = *curr++;
+		else if( !is_digit_( *curr ) )
+			return false;
+
+		// integer part
+		int read = 0;
+		while( curr != aEnd && is_digit_( *curr ) )
+		{
+			mantissa *= 10;
+			mantissa += static_cast<int>(*curr - '0');
+			++curr;
+			++read;
+		}
+
+		if( 0 == read )
+			return false;
+
+		if( curr != aEnd )
+		{
+			// decimal part
+			bool hasExponent = false;
+			if( '.' == *curr )
+			{
+				static constexpr double kPowLut[] = {
+					1.0, 0.1, 0.01, 0.001, 0.0001, 0.00001, 0.000001, 0.0000001
+				};
+				constexpr int kLutEntries = sizeof(kPowLut) / sizeof(kPowLut[0]);
+
+				++curr;
+				read = 1;
+				while( curr != aEnd && is_digit_( *curr ) )
+				{
+					mantissa += static_cast<int>(*curr - '0') * (read < kLutEntries ? kPowLut[read] : std::pow( 10.0, -read ));
+					++read;
+					++curr;
+				}
+
+				hasExponent = curr != aEnd && ('e' == *curr || 'E' == *curr);
+			}
+			else
+			{
+				hasExponent = 'e' == *curr || 'E' == *curr;
+			}
+
+			// exponent part
+			if( hasExponent )
+			{
+				++curr;
+				if( curr != aEnd && ('+' == *curr || '-' == *curr) )
+					expSign = *curr++;
+				else if( curr == aEnd || !is_digit_( *curr ) )
+					return false;
+
+				read = 0;
+				while( curr != aEnd && is_digit_( *curr ) )
+				{
+					exponent *= 10;
+					exponent += static_cast<int>(*curr - '0');
+					++curr;
+					++read;
+				}
+
+				exponent *= ('+' == expSign ? 1 : -1);
+				if( 0 == read )
+					return false;
+			}
+		}
+
+		aResult = ('+' == sign ? 1 : -1) * (exponent ? std::ldexp( mantissa * std::pow( 5.0, exponent ), exponent ) : mantissa);
+		return true;
+	}
+
+	inline tinyobj::real_t parse_real_( char const*& aPtr, char const* aEnd, double aDefault = 0.0 ) noexcept
+	{
+		aPtr = skip_space_( aPtr, aEnd );
+		char const* const end = skip_token_( aPtr, aEnd );
+
+		double value = aDefault;
+		parse_double_( aPtr, end, value );
+
+		aPtr = end;
+		return static_cast<tinyobj::real_t>(value);
+	}
+
+	// Like std::atoi(): skips leading whitespace and stops at the first
+	// non-digit.
+	inline int parse_int_( char const* aPtr, char const* aEnd ) noexcept
+	{
+		while( aPtr < aEnd && std::isspace( static_cast<unsigned char>(*aPtr) ) ) ++aPtr;
+
+		bool negative = false;
+		if( aPtr < aEnd && ('+' == *aPtr || '-' == *aPtr) )
+			negative = '-' == *aPtr++;
+
+		unsigned value = 0;
+		while( aPtr < aEnd && is_digit_( *aPtr ) )
+			value = value*10u + unsigned(*aPtr++ - '0');
+
+		return negative ? -int(value) : int(value);
+	}
+
+	// First whitespace-separated word, like sscanf( "%s" )
+	std::string parse_word_( char const* aPtr, char const* aEnd )
+	{
+		while( aPtr < aEnd && std::isspace( static_cast<unsigned char>(*aPtr) ) ) ++aPtr;
+		char const* beg = aPtr;
+		while( aPtr < aEnd && !std::isspace( static_cast<unsigned char>(*aPtr) ) ) ++aPtr;
+		return std::string( beg, aPtr );
+	}
+
+	struct FaceVertex_
+	{
+		// position, normal, texcoord; -1 if not present
+		int index[3] = { -1, -1, -1 };
+		bool relative[3] = { false, false, false };
+	};
+
+	// tinyobj's fixIndex(), with relative indices resolved against the local
+	// counts
+	inline void fix_index_( FaceVertex_& aVert, int aComponent, int aIndex, std::size_t aLocalCount ) noexcept
+	{
+		if( aIndex > 0 )
+			aVert.index[aComponent] = aIndex - 1;
+		else if( 0 == aIndex )
+			aVert.index[aComponent] = 0;
+		else
+		{
+			aVert.index[aComponent] = int(aLocalCount) + aIndex;
+			aVert.relative[aComponent] = true;
+		}
+	}
+
+	// Same as tinyobj's parseTriple(): i, i/j/k, i//k, i/j
+	FaceVertex_ parse_face_vertex_( char const*& aPtr, char const* aEnd, ObjChunk_ const& aChunk ) noexcept
+	{
+		FaceVertex_ ret;
+
+		fix_index_( ret, 0, parse_int_( aPtr, aEnd ), aChunk.positions.size() / 3 );
+		aPtr = skip_index_( aPtr, aEnd );
+		if( aPtr == aEnd || '/' != *aPtr )
+			return ret;
+
+		++aPtr;
+
+		// i//k
+		if( aPtr != aEnd && '/' == *aPtr )
+		{
+			++aPtr;
+			fix_index_( ret, 1, parse_int_( aPtr, aEnd ), aChunk.normals.size() / 3 );
+			aPtr = skip_index_( aPtr, aEnd );
+			return ret;
+		}
+
+		// i/j/k or i/j
+		fix_index_( ret, 2, parse_int_( aPtr, aEnd ), aChunk.texcoords.size() / 2 );
+		aPtr = skip_index_( aPtr, aEnd );
+		if( aPtr == aEnd || '/' != *aPtr )
+			return ret;
+
+		// i/j/k
+		++aPtr;
+		fix_index_( ret, 1, parse_int_( aPtr, aEnd ), aChunk.normals.size() / 3 );
+		aPtr = skip_index_( aPtr, aEnd );
+		return ret;
+	}
+
+	void emit_corner_( ObjChunk_& aChunk, FaceVertex_ const& aVert )
+	{
+		std::size_t const corner = aChunk.corners.size();
+
+		tinyobj::index_t idx;
+		idx.vertex_index = aVert.index[0];
+		idx.normal_index = aVert.index[1];
+		idx.texcoord_index = aVert.index[2];
+		aChunk.corners.emplace_back( idx );
+
+		for( int i = 0; i < 3; ++i )
+		{
+			if( aVert.relative[i] )
+				aChunk.relativeIndices.emplace_back( corner*3 + i );
+		}
+	}
+
+	bool starts_with_keyword_( char const* aPtr, char const* aEnd, char const* aKeyword, std::size_t aLength ) noexcept
+	{
+		return std::size_t(aEnd - aPtr) > aLength && 0 == std::memcmp( aPtr, aKeyword, aLength ) && is_space_( aPtr[aLength] );
+	}
+
+	void parse_chunk_( char const* aBeg, char const* aEnd, ObjChunk_& aChunk )
+	{
+		// Rough estimate to avoid most of the reallocations; a typical line is
+		// somewhere around 30-40 bytes.
+		std::size_t const estimatedLines = std::size_t(aEnd - aBeg) / 32;
+		aChunk.positions.reserve( estimatedLines );
+		aChunk.corners.reserve( estimatedLines );
+
+		std::vector<FaceVertex_> face;
+
+		auto const add_event = [&aChunk] (ObjEvent_::Kind aKind, std::string aArgument) {
+			aChunk.events.emplace_back( ObjEvent_{ aKind, aChunk.faceCount, aChunk.corners.size() / 3, std::move(aArgument) } );
+		};
+
+		while( aBeg < aEnd )
+		{
+			// Find end of line. Like tinyobjloader, accept "\n", "\r\n" and
+			// a lone "\r" as line endings.
+			char const* eol = aBeg;
+			while( eol < aEnd && '\n' != *eol && '\r' != *eol ) ++eol;
+
+			char const* const lineEnd = eol;
+			char const* next = eol+1;
+			if( eol < aEnd && '\r' == *eol && next < aEnd && '\n' == *next )
+				++next;
+
+			char const* ptr = skip_space_( aBeg, lineEnd );
+			aBeg = next;
+
+			if( ptr == lineEnd || '#' == *ptr )
+				continue;
+
+			std::size_t const length = std::size_t(lineEnd - ptr);
+
+			// vertex
+			if( 'v' == ptr[0] && length > 1 && is_space_( ptr[1] ) )
+			{
+				ptr += 2;
+				auto const x = parse_real_( ptr, lineEnd );
+				auto const y = parse_real_( ptr, lineEnd );
+				auto const z = parse_real_( ptr, lineEnd );
+				aChunk.positions.insert( aChunk.positions.end(), { x, y, z } );
+				continue;
+			}
+
+			// normal
+			if( 'v' == ptr[0] && length > 2 && 'n' == ptr[1] && is_space_( ptr[2] ) )
+			{
+				ptr += 3;
+				auto const x = parse_real_( ptr, lineEnd );
+				auto const y = parse_real_( ptr, lineEnd );
+				auto const z = parse_real_( ptr, lineEnd );
+				aChunk.normals.insert( aChunk.normals.end(), { x, y, z } );
+				continue;
+			}
+
+			// texcoord
+			if( 'v' == ptr[0] && length > 2 && 't' == ptr[1] && is_space_( ptr[2] ) )
+			{
+				ptr += 3;
+				auto const u = parse_real_( ptr, lineEnd );
+				auto const v = parse_real_( ptr, lineEnd );
+				aChunk.texcoords.insert( aChunk.texcoords.end(), { u, v } );
+				continue;
+			}
+
+			// face
+			if( 'f' == ptr[0] && length > 1 && is_space_( ptr[1] ) )
+			{
+				ptr = skip_space_( ptr+2, lineEnd );
+
+				face.clear();
+				while( ptr < lineEnd )
+				{
+					face.emplace_back( parse_face_vertex_( ptr, lineEnd, aChunk ) );
+					ptr = skip_space_( ptr, lineEnd );
+				}
+
+				// Triangulate as a fan, like tinyobjloader
+				for( std::size_t k = 2; k < face.size(); ++k )
+				{
+					emit_corner_( aChunk, face[0] );
+					emit_corner_( aChunk, face[k-1] );
+					emit_corner_( aChunk, face[k] );
+				}
+
+				++aChunk.faceCount;
+				continue;
+			}
+
+			if( starts_with_keyword_( ptr, lineEnd, "usemtl", 6 ) )
+			{
+				add_event( ObjEvent_::Kind::useMaterial, parse_word_( ptr+7, lineEnd ) );
+				continue;
+			}
+
+			if( starts_with_keyword_( ptr, lineEnd, "mtllib", 6 ) )
+			{
+				add_event( ObjEvent_::Kind::materialLibrary, std::string( ptr+7, lineEnd ) );
+				continue;
+			}
+
+			// group name: the first name after the 'g', if any
+			if( 'g' == ptr[0] && length > 1 && is_space_( ptr[1] ) )
+			{
+				ptr = skip_space_( ptr+1, lineEnd );
+				add_event( ObjEvent_::Kind::group, std::string( ptr, skip_token_( ptr, lineEnd ) ) );
+				continue;
+			}
+
+			// object name
+			if( 'o' == ptr[0] && length > 1 && is_space_( ptr[1] ) )
+			{
+				add_event( ObjEvent_::Kind::object, parse_word_( ptr+2, lineEnd ) );
+				continue;
+			}
+
+			// Ignore anything else (including tags, which we don't use).
+		}
+	}
+
+	// Splits the file into chunks that end on line boundaries.
+	std::vector<char const*> find_chunks_( char const* aBeg, char const* aEnd )
+	{
+		std::size_t const size = std::size_t(aEnd - aBeg);
+		std::size_t const hwThreads = std::max( 1u, std::thread::hardware_concurrency() );
+		std::size_t const chunkSize = std::max( kMinChunkSize, size / (hwThreads*kChunksPerThread) );
+
+		std::vector<char const*> bounds{ aBeg };
+		while( std::size_t(aEnd - bounds.back()) > chunkSize )
+		{
+			auto const* const nl = static_cast<char const*>(std::memchr( bounds.back() + chunkSize, '\n', aEnd - bounds.back() - chunkSize ));
+			if( !nl || nl+1 == aEnd )
+				break;
+
+			bounds.emplace_back( nl+1 );
+		}
+
+		bounds.emplace_back( aEnd );
+		return bounds;
+	}
+
+	// Concatenates one attribute array of all chunks.
+	void merge_attribute_( std::vector<tinyobj::real_t>& aOut, std::vector<ObjChunk_> const& aChunks, std::vector<tinyobj::real_t> ObjChunk_::* aMember, std::vector<std::size_t>& aBase )
+	{
+		aBase.resize( aChunks.size() );
+
+		std::size_t total = 0;
+		for( std::size_t i = 0; i < aChunks.size(); ++i )
+		{
+			aBase[i] = total;
+			total += (aChunks[i].*aMember).size();
+		}
+
+		aOut.resize( total );
+		lut::parallel_for( aChunks.size(), [&] (std::size_t aChunk) {
+			auto const& src = aChunks[aChunk].*aMember;
+			std::copy( src.begin(), src.end(), aOut.begin() + aBase[aChunk] );
+		} );
+	}
+}
+
+void load_obj_parallel( tinyobj::attrib_t& aAttrib, std::vector<tinyobj::shape_t>& aShapes, std::vector<tinyobj::material_t>& aMaterials, std::string& aWarnings, std::string const& aOBJPath, std::string const& aMtlBaseDir )
+{
+	aShapes.clear();
+
+	auto const file = lut::map_file( aOBJPath.c_str() );
+	auto const* fileBeg = static_cast<char const*>(file.data);
+	auto const* fileEnd = fileBeg + file.size;
+
+	// Parse chunks
+	auto const bounds = find_chunks_( fileBeg, fileEnd );
+	std::vector<ObjChunk_> chunks( bounds.size()-1 );
+
+	lut::parallel_for( chunks.size(), [&] (std::size_t aChunk) {
+		parse_chunk_( bounds[aChunk], bounds[aChunk+1], chunks[aChunk] );
+	} );
+
+	// Merge attributes. The prefix sums give the number of attributes that
+	// precede each chunk, which is needed to resolve relative indices.
+	std::vector<std::size_t> positionBase, normalBase, texcoordBase;
+	merge_attribute_( aAttrib.vertices, chunks, &ObjChunk_::positions, positionBase );
+	merge_attribute_( aAttrib.normals, chunks, &ObjChunk_::normals, normalBase );
+	merge_attribute_( aAttrib.texcoords, chunks, &ObjChunk_::texcoords, texcoordBase );
+
+	lut::parallel_for( chunks.size(), [&] (std::size_t aChunk) {
+		auto& chunk = chunks[aChunk];
+		for( auto const rel : chunk.relativeIndices )
+		{
+			auto& corner = chunk.corners[rel / 3];
+			switch( rel % 3 )
+			{
+				case 0: corner.vertex_index += int(positionBase[aChunk] / 3); break;
+				case 1: corner.normal_index += int(normalBase[aChunk] / 3); break;
+				case 2: corner.texcoord_index += int(texcoordBase[aChunk] / 2); break;
+			}
+		}
+	} );
+
+	// Reconstruct shapes by replaying the state changes in file order. This
+	// follows the logic of tinyobj::LoadObj() exactly, including its quirks:
+	// faces are collected into a face group, which is appended to the current
+	// shape whenever the material changes. A 'g' or 'o' line only emits the
+	// current shape if the face group is non-empty at that point.
+	struct Piece_
+	{
+		std::size_t chunk, triBegin, triEnd;
+	};
+
+	std::vector<Piece_> faceGroup;
+	std::size_t faceGroupFaces = 0;
+
+	std::vector<ObjSegment_> shapeSegments;
+	std::size_t shapeTriangles = 0;
+	std::string shapeName;
+
+	std::vector<ObjSegment_> segments;
+	std::vector<std::size_t> shapeSizes;
+
+	std::string name;
+	int material = -1;
+
+	std::map<std::string, int> materialMap;
+	tinyobj::MaterialFileReader materialReader( aMtlBaseDir );
+
+	auto const export_face_group = [&] {
+		if( 0 == faceGroupFaces )
+			return false;
+
+		for( auto const& piece : faceGroup )
+		{
+			if( piece.triBegin == piece.triEnd )
+				continue;
+
+			shapeSegments.emplace_back( ObjSegment_{ piece.chunk, piece.triBegin, piece.triEnd, 0, shapeTriangles, material } );
+			shapeTriangles += piece.triEnd - piece.triBegin;
+		}
+
+		faceGroup.clear();
+		faceGroupFaces = 0;
+
+		shapeName = name;
+		return true;
+	};
+
+	auto const push_shape = [&] {
+		std::size_t const shapeIndex = aShapes.size();
+		for( auto& seg : shapeSegments )
+		{
+			seg.shape = shapeIndex;
+			segments.emplace_back( seg );
+		}
+
+		aShapes.emplace_back();
+		aShapes.back().name = shapeName;
+		shapeSizes.emplace_back( shapeTriangles );
+	};
+
+	auto const reset_shape = [&] {
+		shapeSegments.clear();
+		shapeTriangles = 0;
+		shapeName.clear();
+	};
+
+	for( std::size_t c = 0; c < chunks.size(); ++c )
+	{
+		auto const& chunk = chunks[c];
+
+		std::size_t face = 0, tri = 0;
+		auto const add_faces = [&] (std::size_t aFaceEnd, std::size_t aTriEnd) {
+			if( aFaceEnd != face )
+				faceGroup.emplace_back( Piece_{ c, tri, aTriEnd } );
+
+			faceGroupFaces += aFaceEnd - face;
+			face = aFaceEnd;
+			tri = aTriEnd;
+		};
+
+		for( auto const& ev : chunk.events )
+		{
+			add_faces( ev.face, ev.triangle );
+
+			switch( ev.kind )
+			{
+				case ObjEvent_::Kind::useMaterial:
+				{
+					int newMaterial = -1;
+					if( auto const it = materialMap.find( ev.argument ); materialMap.end() != it )
+						newMaterial = it->second;
+
+					if( newMaterial != material )
+					{
+						export_face_group();
+						material = newMaterial;
+					}
+				} break;
+
+				case ObjEvent_::Kind::materialLibrary:
+				{
+					// Same splitting as tinyobjloader; the first file that
+					// can be loaded wins.
+					std::vector<std::string> fileNames;
+					std::istringstream iss( ev.argument );
+					for( std::string item; std::getline( iss, item, ' ' ); )
+						fileNames.emplace_back( std::move(item) );
+
+					if( fileNames.empty() )
+					{
+						aWarnings += "WARN: Looks like empty filename for mtllib. Use default material. \n";
+						break;
+					}
+
+					bool found = false;
+					for( auto const& fileName : fileNames )
+					{
+						std::string warn;
+						bool const ok = materialReader( fileName, &aMaterials, &materialMap, &warn );
+						aWarnings += warn;
+
+						if( ok )
+						{
+							found = true;
+							break;
+						}
+					}
+
+					if( !found )
+						aWarnings += "WARN: Failed to load material file(s). Use default material.\n";
+				} break;
+
+				case ObjEvent_::Kind::group:
+				case ObjEvent_::Kind::object:
+				{
+					if( export_face_group() )
+						push_shape();
+
+					reset_shape();
+					name = ev.argument;
+				} break;
+			}
+		}
+
+		add_faces( chunk.faceCount, chunk.corners.size() / 3 );
+	}
+
+	if( export_face_group() || shapeTriangles > 0 )
+		push_shape();
+
+	// Copy faces to their shapes
+	for( std::size_t i = 0; i < aShapes.size(); ++i )
+	{
+		auto& mesh = aShapes[i].mesh;
+		mesh.indices.resize( shapeSizes[i] * 3 );
+		mesh.num_face_vertices.assign( shapeSizes[i], 3 );
+		mesh.material_ids.resize( shapeSizes[i] );
+	}
+
+	lut::parallel_for( segments.size(), [&] (std::size_t aSegment) {
+		auto const& seg = segments[aSegment];
+		auto const& src = chunks[seg.chunk].corners;
+		auto& mesh = aShapes[seg.shape].mesh;
+
+		std::copy( src.begin() + seg.triBegin*3, src.begin() + seg.triEnd*3, mesh.indices.begin() + seg.dstTriangle*3 );
+		std::fill_n( mesh.material_ids.begin() + seg.dstTriangle, seg.triEnd - seg.triBegin, seg.material );
+	} );
+}
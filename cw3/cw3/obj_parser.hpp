@@ -0,0 +1,31 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include <tiny_obj_loader.h>
+
+/* Multi-threaded replacement for tinyobj::LoadObj(). The OBJ file is mapped
+ * into memory and split into chunks on line boundaries. Each chunk is parsed
+ * by a separate thread (v/vn/vt/f lines, and the positions of usemtl, mtllib,
+ * g and o lines). The per-chunk results are then merged: relative indices are
+ * resolved using a prefix sum over the attribute counts of the preceding
+ * chunks, the shapes are reconstructed by replaying the usemtl/g/o state
+ * changes in file order, and the faces are copied into their final locations
+ * in parallel.
+ *
+ * The results are identical to those of tinyobj::LoadObj() with triangulation
+ * enabled, with the exception of the (unused) per-shape tags. Material
+ * libraries are still parsed with tinyobjloader.
+ *
+ * Throws labutils::Error if the OBJ file cannot be read. Warnings (e.g.,
+ * about missing material libraries) are returned in aWarnings.
+ */
+void load_obj_parallel(
+	tinyobj::attrib_t& aAttrib,
+	std::vector<tinyobj::shape_t>& aShapes,
+	std::vector<tinyobj::material_t>& aMaterials,
+	std::string& aWarnings,
+	std::string const& aOBJPath,
+	std::string const& aMtlBaseDir
+);
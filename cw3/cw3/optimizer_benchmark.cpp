@@ -0,0 +1,245 @@
+#include "optimizer_benchmark.hpp"
+
+#include <array>
+#include <chrono>
+#include <limits>
+#include <random>
+#include <numeric>
+#include <utility>
+#include <algorithm>
+
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+
+#include "../labutils/error.hpp"
+namespace lut = labutils;
+
+#include "model.hpp"
+#include "meshlet.hpp"
+#include "mesh_optimizer.hpp"
+
+namespace
+{
+	constexpr int kRepetitions = 5;
+
+	// Vertices per side of the synthetic grid
+	constexpr std::uint32_t kGridSize_ = 256;
+
+	// Attributes of a corner (position, normal, texture coordinates), and a
+	// triangle with the index of its mesh
+	using Corner_ = std::array<float, 8>;
+	using Triangle_ = std::pair<std::size_t, std::array<Corner_, 3>>;
+
+	ModelData make_grid_( bool aShuffled );
+	ModelData copy_geometry_( ModelData const& );
+
+	std::vector<Triangle_> triangle_multiset_( ModelData const& );
+
+	VertexCacheStats analyze_model_( ModelData const& );
+}
+
+void benchmark_mesh_optimization( std::vector<std::string> const& aModelPaths )
+{
+	std::vector<ModelData> inputs;
+	inputs.emplace_back( make_grid_( false ) );
+	inputs.emplace_back( make_grid_( true ) );
+
+	for( auto const& path : aModelPaths )
+	{
+		try
+		{
+			inputs.emplace_back( parse_obj_model( path, ObjParser::parallel ) );
+			merge_meshes_by_material( inputs.back() );
+		}
+		catch( lut::Error const& eErr )
+		{
+			std::printf( "Skipping '%s': %s\n", path.c_str(), eErr.what() );
+		}
+	}
+
+	struct Result_
+	{
+		std::string name;
+		VertexCacheStats before, after, meshlets;
+		double ms;
+		bool sameTriangles;
+	};
+
+	std::vector<Result_> results;
+	for( auto const& input : inputs )
+	{
+		using Clock_ = std::chrono::steady_clock;
+
+		// Each run optimizes a fresh copy; the last one is checked
+		ModelData optimized;
+		double best = std::numeric_limits<double>::max();
+		for( int i = 0; i < kRepetitions; ++i )
+		{
+			optimized = copy_geometry_( input );
+
+			auto const before = Clock_::now();
+			optimize_meshes( optimized );
+			auto const after = Clock_::now();
+
+			best = std::min( best, std::chrono::duration<double, std::milli>( after - before ).count() );
+		}
+
+		// Meshlets replace the triangle order, and restore it within each
+		// meshlet, as in load_obj_model()
+		ModelData meshlets = copy_geometry_( optimized );
+		build_meshlets( meshlets, true );
+
+		auto const inputTriangles = triangle_multiset_( input );
+		bool const sameTriangles = inputTriangles == triangle_multiset_( optimized ) && inputTriangles == triangle_multiset_( meshlets );
+		results.emplace_back( Result_{ input.modelName, analyze_model_( input ), analyze_model_( optimized ), analyze_model_( meshlets ), best, sameTriangles } );
+	}
+
+	std::printf( "\nMesh optimization (FIFO %zu), best of %d runs\n", kVertexCacheSize, kRepetitions );
+	std::printf( "%-30s %10s %15s %15s %14s %10s %10s\n", "mesh", "triangles", "ACMR", "ATVR", "meshlet ACMR", "ms", "triangles" );
+
+	bool allPassed = true;
+	for( auto const& result : results )
+	{
+		bool const acmrKept = result.after.acmr() <= result.before.acmr() && result.meshlets.acmr() <= result.before.acmr();
+
+		// Show the end of long names
+		auto const name = result.name.size() > 30 ? "..." + result.name.substr( result.name.size() - 27 ) : result.name;
+		std::printf( "%-30s %10zu %6.3f -> %5.3f %6.3f -> %5.3f %14.3f %10.2f %10s%s\n", name.c_str(), result.before.triangleCount,
+			result.before.acmr(), result.after.acmr(), result.before.atvr(), result.after.atvr(), result.meshlets.acmr(), result.ms,
+			result.sameTriangles ? "same" : "CHANGED", acmrKept ? "" : " (ACMR increased)" );
+
+		allPassed = allPassed && result.sameTriangles && acmrKept;
+	}
+
+	if( !allPassed )
+		throw lut::Error( "optimize_meshes() changed the triangles or increased the ACMR" );
+}
+
+namespace
+{
+	ModelData make_grid_( bool aShuffled )
+	{
+		ModelData model;
+		model.modelName = aShuffled ? "shuffled grid" : "grid";
+		model.materials.emplace_back( MaterialInfo{} );
+
+		// A gently curved height field, such that the triangles don't all
+		// face the same way
+		for( std::uint32_t y = 0; y < kGridSize_; ++y )
+		{
+			for( std::uint32_t x = 0; x < kGridSize_; ++x )
+			{
+				model.vertexPositions.emplace_back( float(x), 2.f * std::sin( 0.05f * x ) * std::cos( 0.07f * y ), float(y) );
+				model.vertexNormals.emplace_back( 0.f, 1.f, 0.f );
+				model.vertexTextureCoords.emplace_back( x / float(kGridSize_-1), y / float(kGridSize_-1) );
+			}
+		}
+
+		for( std::uint32_t y = 0; y+1 < kGridSize_; ++y )
+		{
+			for( std::uint32_t x = 0; x+1 < kGridSize_; ++x )
+			{
+				std::uint32_t const a = y * kGridSize_ + x, b = a + 1;
+				std::uint32_t const c = a + kGridSize_, d = c + 1;
+
+				model.indices.insert( model.indices.end(), { a, c, b, b, c, d } );
+			}
+		}
+
+		if( aShuffled )
+		{
+			std::mt19937 rng( 5822 );
+
+			// Shuffle the vertices...
+			std::vector<std::uint32_t> remap( model.vertexPositions.size() );
+			std::iota( remap.begin(), remap.end(), 0u );
+			std::shuffle( remap.begin(), remap.end(), rng );
+
+			auto const permute = [&] (auto& aAttribute) {
+				auto const tmp = aAttribute;
+				for( std::size_t v = 0; v < tmp.size(); ++v )
+					aAttribute[remap[v]] = tmp[v];
+			};
+
+			permute( model.vertexPositions );
+			permute( model.vertexNormals );
+			permute( model.vertexTextureCoords );
+
+			for( auto& idx : model.indices )
+				idx = remap[idx];
+
+			// ... and the triangles
+			std::vector<std::array<std::uint32_t, 3>> triangles( model.indices.size() / 3 );
+			std::memcpy( triangles.data(), model.indices.data(), model.indices.size() * sizeof(std::uint32_t) );
+			std::shuffle( triangles.begin(), triangles.end(), rng );
+			std::memcpy( model.indices.data(), triangles.data(), model.indices.size() * sizeof(std::uint32_t) );
+		}
+
+		MeshInfo mesh{};
+		mesh.meshName          = model.modelName;
+		mesh.materialIndex     = 0;
+		mesh.vertexStartIndex  = 0;
+		mesh.numberOfVertices  = model.vertexPositions.size();
+		mesh.indexStartIndex   = 0;
+		mesh.numberOfIndices   = model.indices.size();
+		model.meshes.emplace_back( mesh );
+
+		return model;
+	}
+
+	ModelData copy_geometry_( ModelData const& aModel )
+	{
+		ModelData ret;
+		ret.modelName = aModel.modelName;
+		ret.materials = aModel.materials;
+		ret.meshes = aModel.meshes;
+		ret.vertexPositions = aModel.vertexPositions;
+		ret.vertexNormals = aModel.vertexNormals;
+		ret.vertexTextureCoords = aModel.vertexTextureCoords;
+		ret.indices = aModel.indices;
+		return ret;
+	}
+
+	std::vector<Triangle_> triangle_multiset_( ModelData const& aModel )
+	{
+		std::vector<Triangle_> ret;
+		ret.reserve( aModel.indices.size() / 3 );
+
+		for( std::size_t meshIndex = 0; meshIndex < aModel.meshes.size(); ++meshIndex )
+		{
+			auto const& mesh = aModel.meshes[meshIndex];
+			for( std::size_t i = 0; i+2 < mesh.numberOfIndices; i += 3 )
+			{
+				std::array<Corner_, 3> corners;
+				for( std::size_t k = 0; k < 3; ++k )
+				{
+					auto const v = mesh.vertexStartIndex + aModel.indices[mesh.indexStartIndex + i + k];
+					std::memcpy( corners[k].data() + 0, &aModel.vertexPositions[v], sizeof(glm::vec3) );
+					std::memcpy( corners[k].data() + 3, &aModel.vertexNormals[v], sizeof(glm::vec3) );
+					std::memcpy( corners[k].data() + 6, &aModel.vertexTextureCoords[v], sizeof(glm::vec2) );
+				}
+
+				// Start at the smallest corner; rotating keeps the winding
+				std::rotate( corners.begin(), std::min_element( corners.begin(), corners.end() ), corners.end() );
+				ret.emplace_back( meshIndex, corners );
+			}
+		}
+
+		std::sort( ret.begin(), ret.end() );
+		return ret;
+	}
+
+	VertexCacheStats analyze_model_( ModelData const& aModel )
+	{
+		VertexCacheStats total{};
+		for( auto const& mesh : aModel.meshes )
+		{
+			auto const stats = analyze_vertex_cache( aModel.indices.data() + mesh.indexStartIndex, mesh.numberOfIndices, mesh.numberOfVertices );
+			total.triangleCount += stats.triangleCount;
+			total.vertexCount += stats.vertexCount;
+			total.transformCount += stats.transformCount;
+		}
+		return total;
+	}
+}
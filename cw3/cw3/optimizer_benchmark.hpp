@@ -0,0 +1,19 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+/* Runs optimize_meshes() (see mesh_optimizer.hpp) on a regular grid, on the
+ * same grid with shuffled vertices and triangles, and on the given models
+ * (parsed and merged by material, as in load_obj_model()). For each, it
+ * prints the ACMR and ATVR before and after, the ACMR once build_meshlets()
+ * has reordered the triangles into meshlets, and the best time of a few runs.
+ *
+ * It also checks that the optimization, and the meshlets after it,
+ *  - keep each mesh's triangles, with their winding, as a multiset of
+ *    vertex attributes, and
+ *  - do not increase the ACMR,
+ * and throws labutils::Error if either fails for any of the inputs. Models
+ * that cannot be read are skipped.
+ */
+void benchmark_mesh_optimization( std::vector<std::string> const& aModelPaths );
@@ -0,0 +1,149 @@
+#include "parallel_recorder.hpp"
+
+#include <mutex>
+#include <thread>
+#include <algorithm>
+#include <exception>
+#include <condition_variable>
+
+#include <cassert>
+
+#include "../labutils/error.hpp"
+#include "../labutils/vkutil.hpp"
+#include "../labutils/to_string.hpp"
+namespace lut = labutils;
+
+ParallelRecorder::ParallelRecorder( lut::VulkanContext const& aContext, std::uint32_t aTargetCount, std::size_t aThreadCount )
+	: mContext( aContext )
+	, mThreadCount( aThreadCount ? aThreadCount : std::max( 1u, std::thread::hardware_concurrency() ) )
+	, mChunks( aTargetCount )
+	, mRecorded( aTargetCount )
+{
+	for( auto& chunks : mChunks )
+	{
+		for( std::size_t i = 0; i < mThreadCount; ++i )
+		{
+			lut::CommandPool pool = lut::create_command_pool( aContext, VK_COMMAND_POOL_CREATE_TRANSIENT_BIT );
+
+			VkCommandBufferAllocateInfo allocInfo{};
+			allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+			allocInfo.commandPool = pool.handle;
+			allocInfo.level = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+			allocInfo.commandBufferCount = 1;
+
+			VkCommandBuffer buffer = VK_NULL_HANDLE;
+			if( auto const res = vkAllocateCommandBuffers( aContext.device, &allocInfo, &buffer ); VK_SUCCESS != res )
+			{
+				throw lut::Error( "Unable to allocate secondary command buffer\n"
+					"vkAllocateCommandBuffers() returned %s", lut::to_string(res).c_str() );
+			}
+
+			chunks.emplace_back( Chunk_{ std::move(pool), buffer } );
+		}
+	}
+
+	if( mThreadCount > 1 )
+		mWorkers.emplace( mThreadCount-1 );
+}
+
+
+std::vector<VkCommandBuffer> const& ParallelRecorder::record( std::uint32_t aTarget, VkCommandBufferInheritanceInfo const& aInheritance, std::size_t aCount, RangeRecorder const& aRecord )
+{
+	assert( aTarget < mChunks.size() );
+	auto& chunks = mChunks[aTarget];
+
+	std::size_t const chunkCount = std::clamp<std::size_t>( (aCount + kMinItemsPerChunk - 1) / kMinItemsPerChunk, 1, mThreadCount );
+	auto const chunk_begin = [&] (std::size_t aChunk) { return aCount * aChunk / chunkCount; };
+
+	// Chunks 1 and up go to the workers
+	std::mutex mutex;
+	std::condition_variable finished;
+	std::size_t pending = chunkCount-1;
+	std::exception_ptr error;
+
+	for( std::size_t i = 1; i < chunkCount; ++i )
+	{
+		mWorkers->submit( [&, i] {
+			std::exception_ptr chunkError;
+			try
+			{
+				record_chunk_( chunks[i], aInheritance, chunk_begin( i ), chunk_begin( i+1 ), aRecord );
+			}
+			catch( ... )
+			{
+				chunkError = std::current_exception();
+			}
+
+			std::lock_guard<std::mutex> lock( mutex );
+			if( chunkError && !error )
+				error = chunkError;
+
+			if( 0 == --pending )
+				finished.notify_one();
+		} );
+	}
+
+	// The workers reference the locals above, so wait for them even if the
+	// first chunk fails
+	std::exception_ptr firstError;
+	try
+	{
+		record_chunk_( chunks[0], aInheritance, 0, chunk_begin( 1 ), aRecord );
+	}
+	catch( ... )
+	{
+		firstError = std::current_exception();
+	}
+
+	{
+		std::unique_lock<std::mutex> lock( mutex );
+		finished.wait( lock, [&] { return 0 == pending; } );
+	}
+
+	if( firstError )
+		std::rethrow_exception( firstError );
+	if( error )
+		std::rethrow_exception( error );
+
+	auto& recorded = mRecorded[aTarget];
+	recorded.clear();
+	for( std::size_t i = 0; i < chunkCount; ++i )
+		recorded.emplace_back( chunks[i].buffer );
+
+	return recorded;
+}
+
+std::size_t ParallelRecorder::thread_count() const noexcept
+{
+	return mThreadCount;
+}
+
+
+void ParallelRecorder::record_chunk_( Chunk_& aChunk, VkCommandBufferInheritanceInfo const& aInheritance, std::size_t aFirst, std::size_t aEnd, RangeRecorder const& aRecord )
+{
+	// Resetting the pool is cheaper than resetting its buffers one by one
+	if( auto const res = vkResetCommandPool( mContext.device, aChunk.pool.handle, 0 ); VK_SUCCESS != res )
+	{
+		throw lut::Error( "Unable to reset command pool\n"
+			"vkResetCommandPool() returned %s", lut::to_string(res).c_str() );
+	}
+
+	VkCommandBufferBeginInfo begInfo{};
+	begInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	begInfo.flags = VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT;
+	begInfo.pInheritanceInfo = &aInheritance;
+
+	if( auto const res = vkBeginCommandBuffer( aChunk.buffer, &begInfo ); VK_SUCCESS != res )
+	{
+		throw lut::Error( "Unable to begin recording secondary command buffer\n"
+			"vkBeginCommandBuffer() returned %s", lut::to_string(res).c_str() );
+	}
+
+	aRecord( aChunk.buffer, aFirst, aEnd );
+
+	if( auto const res = vkEndCommandBuffer( aChunk.buffer ); VK_SUCCESS != res )
+	{
+		throw lut::Error( "Unable to end recording secondary command buffer\n"
+			"vkEndCommandBuffer() returned %s", lut::to_string(res).c_str() );
+	}
+}
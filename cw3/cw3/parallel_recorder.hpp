@@ -0,0 +1,71 @@
+#pragma once
+
+#include <volk/volk.h>
+
+#include <vector>
+#include <optional>
+#include <functional>
+
+#include <cstddef>
+#include <cstdint>
+
+#include "../labutils/vkobject.hpp"
+#include "../labutils/thread_pool.hpp"
+#include "../labutils/vulkan_context.hpp"
+
+/* Records a list of items (e.g., draws) into secondary command buffers, split
+ * into contiguous chunks that are recorded in parallel. The calling thread
+ * records the first chunk and a ThreadPool the others.
+ *
+ * Command pools are externally synchronized, so each chunk has its own pool,
+ * with a single secondary buffer, per target. A target is a set of buffers
+ * that is used by one primary command buffer at a time, e.g., one per frame
+ * in flight. record() resets the target's pools, so the buffers that it
+ * returned for the target the last time must no longer be pending.
+ */
+class ParallelRecorder
+{
+	public:
+		// Records the items [aFirst, aEnd) into the buffer. Called
+		// concurrently for different chunks.
+		using RangeRecorder = std::function<void (VkCommandBuffer, std::size_t aFirst, std::size_t aEnd)>;
+
+		// Chunks have at least this many items, unless there are fewer items
+		// in total; smaller chunks aren't worth a thread.
+		static constexpr std::size_t kMinItemsPerChunk = 64;
+
+	public:
+		// One chunk per hardware thread by default. The context must outlive
+		// the recorder.
+		ParallelRecorder( labutils::VulkanContext const&, std::uint32_t aTargetCount, std::size_t aThreadCount = 0 );
+
+		ParallelRecorder( ParallelRecorder const& ) = delete;
+		ParallelRecorder& operator= (ParallelRecorder const&) = delete;
+
+	public:
+		// Records aCount items into the buffers of aTarget, in the subpass
+		// described by aInheritance, and returns the buffers in item order.
+		// There is at least one buffer, even if aCount is 0. Exceptions from
+		// aRecord are rethrown once all chunks have finished.
+		std::vector<VkCommandBuffer> const& record( std::uint32_t aTarget, VkCommandBufferInheritanceInfo const&, std::size_t aCount, RangeRecorder const& aRecord );
+
+		std::size_t thread_count() const noexcept;
+
+	private:
+		struct Chunk_
+		{
+			labutils::CommandPool pool;
+			VkCommandBuffer buffer;
+		};
+
+		void record_chunk_( Chunk_&, VkCommandBufferInheritanceInfo const&, std::size_t aFirst, std::size_t aEnd, RangeRecorder const& );
+
+	private:
+		labutils::VulkanContext const& mContext;
+		std::size_t mThreadCount;
+
+		std::vector<std::vector<Chunk_>> mChunks;          // [target][chunk]
+		std::vector<std::vector<VkCommandBuffer>> mRecorded; // [target]
+
+		std::optional<labutils::ThreadPool> mWorkers; // mThreadCount-1 threads
+};
@@ -0,0 +1,189 @@
+#include "quantize_check.hpp"
+
+#include <random>
+#include <string>
+#include <vector>
+#include <utility>
+#include <algorithm>
+
+#include <cstdio>
+#include <cstdint>
+
+#include "../labutils/error.hpp"
+namespace lut = labutils;
+
+#include "vertex_quantize.hpp"
+
+namespace
+{
+	constexpr std::size_t kRandomVertexCount_ = 100000;
+
+	struct VertexSet_
+	{
+		std::string name;
+
+		std::vector<glm::vec3> positions;
+		std::vector<glm::vec3> normals;
+		std::vector<glm::vec2> texcoords;
+
+		void add( glm::vec3 const& aPosition, glm::vec3 const& aNormal, glm::vec2 const& aTexcoord )
+		{
+			positions.emplace_back( aPosition );
+			normals.emplace_back( aNormal );
+			texcoords.emplace_back( aTexcoord );
+		}
+	};
+
+	std::vector<VertexSet_> make_vertex_sets_();
+
+	// Quantizes aSet, prints the largest round-trip errors, and checks them
+	// with check_quantization_error()
+	bool check_set_( VertexSet_ const& );
+}
+
+void check_vertex_quantization()
+{
+	std::printf( "Vertex quantization, largest round-trip errors\n" );
+	std::printf( "%-26s %8s %12s %12s %14s %8s\n", "set", "vertices", "position", "normal", "texcoord (rel)", "result" );
+
+	bool allPassed = true;
+	for( auto const& set : make_vertex_sets_() )
+		allPassed = check_set_( set ) && allPassed;
+
+	if( !allPassed )
+		throw lut::Error( "Vertex quantization exceeds its error bounds" );
+}
+
+namespace
+{
+	std::vector<VertexSet_> make_vertex_sets_()
+	{
+		std::mt19937 rng( 5822 );
+		std::uniform_real_distribution<float> unit( -1.f, 1.f );
+		std::normal_distribution<float> gauss;
+
+		auto const random_normal = [&] {
+			glm::vec3 n( 0.f );
+			while( glm::length( n ) < 1e-3f )
+				n = glm::vec3( gauss( rng ), gauss( rng ), gauss( rng ) );
+			return glm::normalize( n );
+		};
+
+		std::vector<VertexSet_> sets;
+
+		// Random vertices in a few boxes, from small to large and far from
+		// the origin
+		std::pair<char const*, float> const scales[] = { { "random, 1mm box", 1e-3f }, { "random, 1m box", 1.f }, { "random, 1km box", 1e3f } };
+		for( auto const& [name, scale] : scales )
+		{
+			auto& set = sets.emplace_back();
+			set.name = name;
+
+			glm::vec3 const offset( 10.f * scale * unit( rng ), 10.f * scale * unit( rng ), 10.f * scale * unit( rng ) );
+			for( std::size_t i = 0; i < kRandomVertexCount_; ++i )
+			{
+				glm::vec3 const position = offset + scale * glm::vec3( unit( rng ), 0.5f * unit( rng ), 2.f * unit( rng ) );
+				set.add( position, random_normal(), glm::vec2( 0.5f + 0.5f * unit( rng ), 0.5f + 0.5f * unit( rng ) ) );
+			}
+		}
+
+		// Zero extent along one axis (a flat mesh), and along all axes
+		{
+			auto& set = sets.emplace_back();
+			set.name = "zero extent (plane)";
+			for( std::size_t i = 0; i < 1000; ++i )
+				set.add( glm::vec3( unit( rng ), 3.25f, unit( rng ) ), glm::vec3( 0.f, 1.f, 0.f ), glm::vec2( 0.f ) );
+		}
+		{
+			auto& set = sets.emplace_back();
+			set.name = "zero extent (point)";
+			for( std::size_t i = 0; i < 16; ++i )
+				set.add( glm::vec3( -7.5f, 1e4f, 0.1f ), random_normal(), glm::vec2( 0.f ) );
+		}
+
+		// Normals along the axes, on the edges of the octahedron and in the
+		// centers of its faces; the positions are the corners of the box
+		{
+			auto& set = sets.emplace_back();
+			set.name = "axis and diagonal normals";
+
+			std::vector<glm::vec3> normals;
+			for( int axis = 0; axis < 3; ++axis )
+			{
+				for( float const sign : { 1.f, -1.f } )
+				{
+					glm::vec3 n( 0.f );
+					n[axis] = sign;
+					normals.emplace_back( n );
+				}
+			}
+			for( float const x : { -1.f, 0.f, 1.f } )
+			{
+				for( float const y : { -1.f, 0.f, 1.f } )
+				{
+					for( float const z : { -1.f, 0.f, 1.f } )
+					{
+						if( 0.f != x*x + y*y + z*z )
+							normals.emplace_back( glm::normalize( glm::vec3( x, y, z ) ) );
+					}
+				}
+			}
+
+			for( std::size_t i = 0; i < normals.size(); ++i )
+			{
+				glm::vec3 const corner( i & 1 ? 2.f : -1.f, i & 2 ? 0.5f : -0.5f, i & 4 ? 100.f : 99.f );
+				set.add( corner, normals[i], glm::vec2( 0.f ) );
+			}
+		}
+
+		// Texture coordinates outside of [0,1], for repeating textures, and
+		// close to zero
+		{
+			auto& set = sets.emplace_back();
+			set.name = "texcoords outside [0,1]";
+
+			float const values[] = { 0.f, 1.f, -1.f, 1.5f, -0.25f, 7.3f, -12.9f, 255.99f, -1023.7f, 1e-3f, -3e-5f, 1e-6f, -1e-7f };
+			for( float const u : values )
+			{
+				for( float const v : values )
+					set.add( glm::vec3( u, v, 0.f ), glm::vec3( 0.f, 0.f, 1.f ), glm::vec2( u, v ) );
+			}
+		}
+
+		return sets;
+	}
+
+	bool check_set_( VertexSet_ const& aSet )
+	{
+		auto const count = aSet.positions.size();
+		auto const bounds = compute_quantization_bounds( aSet.positions.data(), count );
+
+		std::vector<std::uint16_t> positions( count * 4 );
+		std::vector<std::int16_t> normals( count * 2 );
+		std::vector<std::uint16_t> texcoords( count * 2 );
+
+		quantize_positions( positions.data(), aSet.positions.data(), count, bounds );
+		quantize_normals( normals.data(), aSet.normals.data(), count );
+		quantize_texcoords( texcoords.data(), aSet.texcoords.data(), count );
+
+		float posErr = 0.f, nrmErr = 0.f, texErr = 0.f;
+		for( std::size_t i = 0; i < count; ++i )
+		{
+			auto const pos = glm::abs( dequantize_position( positions.data() + i*4, bounds ) - aSet.positions[i] );
+			posErr = std::max( { posErr, pos.x, pos.y, pos.z } );
+
+			nrmErr = std::max( nrmErr, glm::length( dequantize_normal( normals.data() + i*2 ) - aSet.normals[i] ) );
+
+			// Relative to the value, or to the smallest normal half float
+			auto const tex = glm::abs( dequantize_texcoord( texcoords.data() + i*2 ) - aSet.texcoords[i] )
+				/ glm::max( glm::abs( aSet.texcoords[i] ), glm::vec2( 1.f / 16384.f ) );
+			texErr = std::max( { texErr, tex.x, tex.y } );
+		}
+
+		bool const passed = check_quantization_error( positions.data(), normals.data(), texcoords.data(),
+			aSet.positions.data(), aSet.normals.data(), aSet.texcoords.data(), count, bounds );
+
+		std::printf( "%-26s %8zu %12.3g %12.3g %14.3g %8s\n", aSet.name.c_str(), count, posErr, nrmErr, texErr, passed ? "OK" : "FAILED" );
+		return passed;
+	}
+}
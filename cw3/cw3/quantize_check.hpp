@@ -0,0 +1,16 @@
+#pragma once
+
+/* Self-test of the vertex quantization (see vertex_quantize.hpp). Encodes and
+ * decodes sets of random and edge-case vertices, and checks each with
+ * check_quantization_error(), i.e., that the error stays within
+ *  - half a quantization step of the mesh's bounding box per position
+ *    component, plus float rounding,
+ *  - 2*sqrt(2)/32767 in the length of the difference of unit normals,
+ *  - 2^-11 relative (2^-24 absolute, for subnormals) per texture coordinate.
+ *
+ * The edge cases include bounding boxes with a zero extent, normals along
+ * and between the axes, and texture coordinates outside of [0,1]. Prints the
+ * largest error of each attribute per set, and throws labutils::Error if any
+ * set exceeds the bounds.
+ */
+void check_vertex_quantization();
@@ -0,0 +1,65 @@
+#include "record_benchmark.hpp"
+
+#include <chrono>
+#include <limits>
+#include <thread>
+#include <vector>
+#include <algorithm>
+
+#include <cstdio>
+
+namespace lut = labutils;
+
+namespace
+{
+	constexpr int kRepetitions = 5;
+
+	template< typename tFunc >
+	double best_ms_( tFunc const& aFunc )
+	{
+		using Clock_ = std::chrono::steady_clock;
+
+		double best = std::numeric_limits<double>::max();
+		for( int i = 0; i < kRepetitions; ++i )
+		{
+			auto const before = Clock_::now();
+			aFunc();
+			auto const after = Clock_::now();
+
+			best = std::min( best, std::chrono::duration<double, std::milli>( after - before ).count() );
+		}
+
+		return best;
+	}
+}
+
+void benchmark_command_recording( lut::VulkanContext const& aContext, VkCommandBufferInheritanceInfo const& aInheritance, std::size_t aCount, ParallelRecorder::RangeRecorder const& aRecord )
+{
+	std::size_t const hwThreads = std::max( 1u, std::thread::hardware_concurrency() );
+
+	std::vector<std::size_t> threadCounts;
+	for( std::size_t count = 1; count < hwThreads; count *= 2 )
+		threadCounts.emplace_back( count );
+	threadCounts.emplace_back( hwThreads );
+
+	std::printf( "Command recording of %zu items, best of %d runs, in ms\n", aCount, kRepetitions );
+	std::printf( "%8s %10s %8s\n", "threads", "record", "speedup" );
+
+	double singleMs = 0.0;
+	for( std::size_t const threads : threadCounts )
+	{
+		ParallelRecorder recorder( aContext, 1, threads );
+
+		// The first recording allocates the pools' memory
+		recorder.record( 0, aInheritance, aCount, aRecord );
+
+		double const ms = best_ms_( [&] {
+			recorder.record( 0, aInheritance, aCount, aRecord );
+		} );
+
+		if( 1 == threads )
+			singleMs = ms;
+
+		std::printf( "%8zu %10.3f %7.2fx\n", threads, ms, singleMs / ms );
+	}
+}
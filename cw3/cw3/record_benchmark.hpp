@@ -0,0 +1,17 @@
+#pragma once
+
+#include <volk/volk.h>
+
+#include <cstddef>
+
+#include "../labutils/vulkan_context.hpp"
+
+#include "parallel_recorder.hpp"
+
+/* Measures how recording aCount items with a ParallelRecorder scales with the
+ * number of recording threads: 1, 2, 4, ... up to the number of hardware
+ * threads. For each thread count, it prints the best time of a few runs of
+ * ParallelRecorder::record(), and the speedup over a single thread. The
+ * buffers are recorded but never submitted.
+ */
+void benchmark_command_recording( labutils::VulkanContext const&, VkCommandBufferInheritanceInfo const&, std::size_t aCount, ParallelRecorder::RangeRecorder const& aRecord );
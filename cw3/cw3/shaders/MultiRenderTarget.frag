@@ -11,19 +11,45 @@ layout( location = 0 ) out vec4 oColor;
 layout( location = 1 ) out vec4 oNormal;
 layout( location = 2 ) out vec4 oMaterial;
 
-// PBR material
-layout( set = 2, binding = 0, std140) uniform UMaterial
+// Textures. With bindless textures, this is the table of all textures, and
+// the mesh's texture is at uMesh.textureIndex. Otherwise, each mesh binds a
+// set with just its own texture, and the index is 0. Like before, the
+// G-buffer doesn't sample them yet, so neither the table nor the index is
+// read here. The per-set fallback also runs on devices without
+// shaderSampledImageArrayDynamicIndexing, so it may only index with a
+// constant.
+layout( constant_id = 1 ) const int kTextureCount = 1;
+layout( set = 1, binding = 0 ) uniform sampler2D uTextures[kTextureCount];
+
+layout( push_constant ) uniform UMesh
+{
+
+	vec3 positionMin;
+	vec3 positionExtent;
+	uint textureIndex;
+	uint materialIndex;
+
+}uMesh;
+
+// PBR materials of all meshes; the mesh's material is at uMesh.materialIndex
+struct Material
 {
 	vec4 emissive;
 	vec4 albedo;
 	float shininess;
 	float metalness;
-} uMaterial;
+};
+
+layout( set = 2, binding = 0, std430 ) readonly buffer SMaterials
+{
+	Material materials[];
+} sMaterials;
 
 void main()
 {
+	Material material = sMaterials.materials[uMesh.materialIndex];
 
-	oColor = vec4(uMaterial.albedo.xyz, uMaterial.shininess);
+	oColor = vec4(material.albedo.xyz, material.shininess);
 	oNormal = vec4( inNormal,1.0);
-	oMaterial = vec4(uMaterial.emissive.xyz, uMaterial.metalness);
+	oMaterial = vec4(material.emissive.xyz, material.metalness);
 }
\ No newline at end of file
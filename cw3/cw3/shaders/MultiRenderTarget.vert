@@ -5,6 +5,10 @@ layout( location = 0 ) in vec3 inPosition;
 layout( location = 1 ) in vec2 inTexcoord;
 layout( location = 2 ) in vec3 inNormal;
 
+// Quantized vertices (see vertex_quantize.hpp): the position is stored
+// relative to the mesh bounds, the normal is octahedral encoded in .xy
+layout( constant_id = 0 ) const bool kQuantizedVertices = false;
+
 // outputs
 layout( location = 0 ) out vec3 outNormal;
 layout( location = 1 ) out vec3 outPosition;
@@ -19,22 +23,54 @@ layout(set = 0, binding = 0, std140) uniform UScene
 	
 }uScene;
 
+// position bounds of the mesh, its texture and its material (see
+// MultiRenderTarget.frag)
+layout( push_constant ) uniform UMesh
+{
+
+	vec3 positionMin;
+	vec3 positionExtent;
+	uint textureIndex;
+	uint materialIndex;
+
+}uMesh;
+
+
+vec3 decode_octahedral( vec2 e )
+{
+	vec3 n = vec3( e.xy, 1.0 - abs( e.x ) - abs( e.y ) );
+	if( n.z < 0.0 )
+	{
+		vec2 signNotZero = vec2( n.x >= 0.0 ? 1.0 : -1.0, n.y >= 0.0 ? 1.0 : -1.0 );
+		n.xy = ( 1.0 - abs( n.yx ) ) * signNotZero;
+	}
+	return normalize( n );
+}
 
 
 void main()
 {
 
 	// Vertex attribute
-	outNormal = inNormal;
+	vec3 position = inPosition;
+	vec3 normal = inNormal;
+
+	if( kQuantizedVertices )
+	{
+		position = uMesh.positionMin + inPosition * uMesh.positionExtent;
+		normal = decode_octahedral( inNormal.xy );
+	}
+
+	outNormal = normal;
 
 	// Get view coordinate
-	vec4 screenPosition = uScene.projCam * vec4(inPosition, 1.0);
+	vec4 screenPosition = uScene.projCam * vec4(position, 1.0);
 
 	screenPosition  = screenPosition /screenPosition .w;
 
 
-	outPosition = inPosition;
+	outPosition = position;
 
 
-	gl_Position = uScene.projCam * vec4( inPosition.xyz, 1.f ); 
+	gl_Position = uScene.projCam * vec4( position.xyz, 1.f ); 
 }
\ No newline at end of file
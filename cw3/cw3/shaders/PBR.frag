@@ -19,10 +19,12 @@ struct Light
 layout( location = 0) in vec2 uv;
 
 //[ uniform ]
-layout( set = 0,binding = 0 ) uniform sampler2D inAlbedo;
-layout( set = 0,binding = 1 ) uniform sampler2D inNormal;
-layout( set = 0,binding = 2 ) uniform sampler2D inMaterial;
-layout( set = 0,binding = 3 ) uniform sampler2D inDepth;
+// The G-buffer is written by the previous subpass, and read at this fragment
+// only
+layout( input_attachment_index = 0, set = 0,binding = 0 ) uniform subpassInput inAlbedo;
+layout( input_attachment_index = 1, set = 0,binding = 1 ) uniform subpassInput inNormal;
+layout( input_attachment_index = 2, set = 0,binding = 2 ) uniform subpassInput inMaterial;
+layout( input_attachment_index = 3, set = 0,binding = 3 ) uniform subpassInput inDepth;
 layout( set = 0,binding = 4, std140) uniform ULight
 {
 	int lightCount;
@@ -40,7 +42,7 @@ layout( location = 0 ) out vec4 oColor;
 
 vec4 GetPosition()
 {
-	float depth = texture(inDepth,uv).r ;
+	float depth = subpassLoad(inDepth).r ;
 
 	vec4 position = inverse(uScene.projCam) * vec4((uv.xy)*2.0 -1.0, depth, 1.0);
 
@@ -77,10 +79,10 @@ mat4 rotationY(float angle)
 vec3 GetLight(Light light)
 {
 	vec3 inPosition = GetPosition().xyz;
-	vec3 albedo = texture(inAlbedo, uv).xyz;
-	float shininess = texture(inAlbedo, uv).w;
-	float metalness = texture(inMaterial, uv).w;
-	vec3 normal = texture(inNormal, uv).xyz;
+	vec3 albedo = subpassLoad(inAlbedo).xyz;
+	float shininess = subpassLoad(inAlbedo).w;
+	float metalness = subpassLoad(inMaterial).w;
+	vec3 normal = subpassLoad(inNormal).xyz;
 
 	// View direction
 	vec3 viewDir = normalize( uScene.camPos - inPosition);
@@ -130,11 +132,11 @@ vec3 GetLight(Light light)
 void main()
 {
 
-	vec3 albedo = texture(inAlbedo, uv).xyz;
+	vec3 albedo = subpassLoad(inAlbedo).xyz;
 	
 	vec3 la = uLight.ambient.xyz * albedo.xyz;
 	
-	vec3 emissive = texture(inMaterial, uv).xyz;
+	vec3 emissive = subpassLoad(inMaterial).xyz;
 
 	vec3 lightSum = emissive + la;
 
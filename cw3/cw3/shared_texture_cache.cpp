@@ -0,0 +1,214 @@
+#include "shared_texture_cache.hpp"
+
+#include <utility>
+#include <exception>
+
+#include "../labutils/vkutil.hpp"
+#include "../labutils/texture_cache.hpp"
+namespace lut = labutils;
+
+namespace
+{
+	// Block compression for color textures. BC7 keeps the most detail at one
+	// byte per pixel; BC1 halves that but drops alpha, BC3 keeps a separate
+	// alpha channel at the same size as BC7.
+	constexpr lut::BlockFormat kColorTextureFormat = lut::BlockFormat::bc7;
+
+	// Uncompressed textures get their mip levels from the CPU generator,
+	// rather than from a chain of blits on the GPU (see
+	// decode_image_texture2d_with_cpu_mips()).
+	constexpr bool kGenerateMipsOnCpu = true;
+	constexpr lut::MipFilter kMipFilter = lut::MipFilter::kaiser;
+
+	// The RGBA8 value that create_image_texture2d_with_solid_color() stores
+	std::uint32_t color_key_( glm::vec4 aColor ) noexcept
+	{
+		glm::vec4 const scaled = glm::clamp( aColor, 0.f, 1.f ) * 255.f;
+		return std::uint32_t(std::uint8_t(scaled[0])) | std::uint32_t(std::uint8_t(scaled[1])) << 8
+			| std::uint32_t(std::uint8_t(scaled[2])) << 16 | std::uint32_t(std::uint8_t(scaled[3])) << 24;
+	}
+}
+
+SharedTexture::~SharedTexture()
+{
+	if( bindless )
+		bindless->release( textureIndex );
+}
+
+
+SharedTextureCache::SharedTextureCache( lut::VulkanWindow const& aWindow, lut::Allocator const& aAllocator, lut::SamplerCache& aSamplers, VkDescriptorSetLayout aTextureSetLayout, VkDescriptorPool aPool, BindlessTextureTable* aBindless )
+	: mWindow( aWindow )
+	, mAllocator( aAllocator )
+	, mTextureSetLayout( aTextureSetLayout )
+	, mPool( aPool )
+	, mBindless( aBindless )
+	, mSampler( aSamplers.get_default( VK_TRUE ) )
+{
+	// Block-compressed textures are used if the device can sample them;
+	// otherwise, textures are uploaded as uncompressed RGBA8
+	VkFormatProperties compressedProperties;
+	vkGetPhysicalDeviceFormatProperties( mWindow.physicalDevice, lut::block_format_srgb( kColorTextureFormat ), &compressedProperties );
+
+	VkFormatProperties formatProperties;
+	vkGetPhysicalDeviceFormatProperties( mWindow.physicalDevice, VK_FORMAT_R8G8B8A8_SRGB, &formatProperties );
+
+	VkFormatFeatureFlags const compressedFeatures = VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT | VK_FORMAT_FEATURE_TRANSFER_DST_BIT;
+
+	mCompressed = compressedFeatures == (compressedProperties.optimalTilingFeatures & compressedFeatures);
+	mLinearFilter = 0 != (formatProperties.optimalTilingFeatures & VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT);
+}
+
+
+void SharedTextureCache::prefetch( std::string const& aPath )
+{
+	if( mPending.count( aPath ) || mPrefetched.count( aPath ) )
+		return;
+
+	if( auto const it = mByPath.find( aPath ); mByPath.end() != it && !it->second.expired() )
+		return;
+
+	mPending.emplace( aPath );
+
+	mDecoders.submit( [this, path = aPath] {
+		Decoded_ result{ path, {}, nullptr };
+
+		try
+		{
+			result.texture = decode_( path );
+		}
+		catch( ... )
+		{
+			result.error = std::current_exception();
+		}
+
+		{
+			std::lock_guard<std::mutex> lock( mDecodedMutex );
+			mDecoded.emplace_back( std::move(result) );
+		}
+
+		mDecodedAvailable.notify_one();
+	} );
+}
+
+std::shared_ptr<SharedTexture const> SharedTextureCache::load( std::string const& aPath, lut::UploadBatch& aBatch )
+{
+	++mRequests;
+
+	auto& slot = mByPath[aPath];
+	if( auto texture = slot.lock() )
+		return texture;
+
+	prefetch( aPath );
+
+	// Upload whatever finishes decoding first, until aPath is among it
+	for( ;; )
+	{
+		if( auto const it = mPrefetched.find( aPath ); mPrefetched.end() != it )
+		{
+			auto texture = std::move(it->second);
+			mPrefetched.erase( it );
+
+			slot = texture;
+			return texture;
+		}
+
+		upload_( wait_decoded_(), aBatch );
+	}
+}
+
+std::shared_ptr<SharedTexture const> SharedTextureCache::solid_color( glm::vec4 aColor, lut::UploadBatch& aBatch )
+{
+	++mRequests;
+
+	auto& slot = mByColor[color_key_( aColor )];
+	if( auto texture = slot.lock() )
+		return texture;
+
+	auto texture = make_shared_( lut::create_image_texture2d_with_solid_color( "", aBatch, mAllocator, aColor ), VK_FORMAT_R8G8B8A8_SRGB );
+
+	slot = texture;
+	return texture;
+}
+
+std::size_t SharedTextureCache::requests() const noexcept
+{
+	return mRequests;
+}
+std::size_t SharedTextureCache::created() const noexcept
+{
+	return mCreated;
+}
+
+
+lut::DecodedTexture SharedTextureCache::decode_( std::string const& aPath ) const
+{
+	if( mCompressed )
+		return lut::decode_compressed_texture2d( aPath.c_str(), kColorTextureFormat );
+
+	if( mLinearFilter )
+	{
+		return kGenerateMipsOnCpu
+			? lut::decode_image_texture2d_with_cpu_mips( aPath.c_str(), kMipFilter )
+			: lut::decode_image_texture2d( aPath.c_str(), true );
+	}
+
+	return lut::decode_image_texture2d( aPath.c_str(), false );
+}
+
+SharedTextureCache::Decoded_ SharedTextureCache::wait_decoded_()
+{
+	std::unique_lock<std::mutex> lock( mDecodedMutex );
+	mDecodedAvailable.wait( lock, [this] { return !mDecoded.empty(); } );
+
+	Decoded_ ret = std::move(mDecoded.front());
+	mDecoded.pop_front();
+	return ret;
+}
+
+void SharedTextureCache::upload_( Decoded_ aDecoded, lut::UploadBatch& aBatch )
+{
+	mPending.erase( aDecoded.path );
+
+	if( aDecoded.error )
+		std::rethrow_exception( aDecoded.error );
+
+	auto const format = aDecoded.texture.format;
+	mPrefetched[aDecoded.path] = make_shared_( lut::upload_texture2d( aDecoded.texture, aBatch, mAllocator ), format );
+}
+
+std::shared_ptr<SharedTexture const> SharedTextureCache::make_shared_( lut::Image aImage, VkFormat aFormat )
+{
+	++mCreated;
+
+	auto texture = std::make_shared<SharedTexture>();
+	texture->view = lut::create_image_view_texture2d( mWindow, aImage.image, aFormat );
+	texture->image = std::move(aImage);
+	texture->sampler = mSampler;
+
+	if( mBindless )
+	{
+		texture->bindless = mBindless;
+		texture->textureIndex = mBindless->add( texture->view.handle, mSampler->handle );
+		return texture;
+	}
+
+	// Allocate and initialize descriptor set for the texture
+	texture->descriptorSet = lut::alloc_desc_set( mWindow, mPool, mTextureSetLayout );
+
+	VkDescriptorImageInfo imageInfo{};
+	imageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+	imageInfo.imageView = texture->view.handle;
+	imageInfo.sampler = mSampler->handle;
+
+	VkWriteDescriptorSet desc{};
+	desc.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+	desc.dstSet = texture->descriptorSet;
+	desc.dstBinding = 0;
+	desc.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	desc.descriptorCount = 1;
+	desc.pImageInfo = &imageInfo;
+
+	vkUpdateDescriptorSets( mWindow.device, 1, &desc, 0, nullptr );
+
+	return texture;
+}
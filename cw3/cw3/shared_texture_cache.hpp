@@ -0,0 +1,133 @@
+#pragma once
+
+#include <deque>
+#include <mutex>
+#include <memory>
+#include <string>
+#include <exception>
+#include <unordered_map>
+#include <unordered_set>
+#include <condition_variable>
+
+#include <cstddef>
+#include <cstdint>
+
+#include <glm/glm.hpp>
+
+#include "../labutils/vkimage.hpp"
+#include "../labutils/vkobject.hpp"
+#include "../labutils/allocator.hpp"
+#include "../labutils/upload_batch.hpp"
+#include "../labutils/thread_pool.hpp"
+#include "../labutils/sampler_cache.hpp"
+#include "../labutils/vulkan_window.hpp"
+
+#include "bindless_textures.hpp"
+
+// A texture and its descriptor, shared by all meshes that use the same
+// image file or solid color.
+struct SharedTexture
+{
+	~SharedTexture();
+
+	labutils::Image image;
+	labutils::ImageView view;
+
+	// From the SamplerCache; all textures currently use the default sampler
+	std::shared_ptr<labutils::Sampler const> sampler;
+
+	// With a BindlessTextureTable, the texture's slot in the table.
+	// Otherwise, a texture set with the view and sampler, allocated from the
+	// cache's descriptor pool, and textureIndex is 0.
+	BindlessTextureTable* bindless = nullptr;
+	std::uint32_t textureIndex = 0;
+	VkDescriptorSet descriptorSet = VK_NULL_HANDLE;
+};
+
+/* Hands out textures by image path, or by color for meshes without a
+ * texture, such that each distinct texture is loaded, uploaded and bound
+ * once. Textures are reference counted: the cache only keeps weak
+ * references, and a texture is released with the last mesh that uses it.
+ *
+ * Solid colors are keyed by their RGBA8 value and get a 1x1 image each. The
+ * number of distinct colors is small, and unlike a palette texture, 1x1
+ * images need no per-mesh texture coordinates.
+ *
+ * Image files are decoded on the cache's worker threads. prefetch() starts
+ * decoding a file ahead of its use; load() waits for the file, and uploads
+ * every texture that finishes decoding in the meantime, in the order in
+ * which they finish. Prefetched textures are kept until they are loaded.
+ *
+ * Other than the decoding, the cache is not thread safe; the AssetLoader
+ * uses it from its thread. A texture's upload is recorded into the batch
+ * that is passed to the load() call that encounters the decoded image, and
+ * can be used once that batch's submission completes.
+ */
+class SharedTextureCache
+{
+	public:
+		// The window, allocator, sampler cache, layout, pool and bindless
+		// table must outlive the cache. If aBindless is given, textures are
+		// added to it, and aTextureSetLayout and the pool are not used.
+		SharedTextureCache( labutils::VulkanWindow const&, labutils::Allocator const&, labutils::SamplerCache&, VkDescriptorSetLayout aTextureSetLayout, VkDescriptorPool, BindlessTextureTable* aBindless = nullptr );
+
+		SharedTextureCache( SharedTextureCache const& ) = delete;
+		SharedTextureCache& operator= (SharedTextureCache const&) = delete;
+
+	public:
+		// Starts decoding the image at aPath, unless it is already loaded or
+		// being decoded.
+		void prefetch( std::string const& aPath );
+
+		std::shared_ptr<SharedTexture const> load( std::string const& aPath, labutils::UploadBatch& );
+		std::shared_ptr<SharedTexture const> solid_color( glm::vec4 aColor, labutils::UploadBatch& );
+
+		// Number of requests, and number of textures created
+		std::size_t requests() const noexcept;
+		std::size_t created() const noexcept;
+
+	private:
+		struct Decoded_
+		{
+			std::string path;
+			labutils::DecodedTexture texture;
+			std::exception_ptr error;
+		};
+
+		labutils::DecodedTexture decode_( std::string const& aPath ) const; // on a worker
+		Decoded_ wait_decoded_();
+		void upload_( Decoded_, labutils::UploadBatch& );
+
+		std::shared_ptr<SharedTexture const> make_shared_( labutils::Image, VkFormat );
+
+	private:
+		labutils::VulkanWindow const& mWindow;
+		labutils::Allocator const& mAllocator;
+		VkDescriptorSetLayout mTextureSetLayout;
+		VkDescriptorPool mPool;
+		BindlessTextureTable* mBindless;
+
+		std::shared_ptr<labutils::Sampler const> mSampler;
+
+		// How images are turned into textures, depending on the formats that
+		// the device can sample
+		bool mCompressed;
+		bool mLinearFilter;
+
+		std::unordered_map<std::string, std::weak_ptr<SharedTexture const>> mByPath;
+		std::unordered_map<std::uint32_t, std::weak_ptr<SharedTexture const>> mByColor;
+
+		std::unordered_set<std::string> mPending; // being decoded
+		std::unordered_map<std::string, std::shared_ptr<SharedTexture const>> mPrefetched; // uploaded, not yet loaded
+
+		std::mutex mDecodedMutex;
+		std::condition_variable mDecodedAvailable;
+		std::deque<Decoded_> mDecoded; // by the workers, in completion order
+
+		std::size_t mRequests = 0;
+		std::size_t mCreated = 0;
+
+		// Declared last, such that the workers are stopped before the
+		// members that they use are destroyed.
+		labutils::ThreadPool mDecoders;
+};
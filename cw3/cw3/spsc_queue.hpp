@@ -0,0 +1,86 @@
+#pragma once
+
+#include <atomic>
+#include <vector>
+#include <utility>
+#include <optional>
+
+#include <cassert>
+#include <cstddef>
+
+/* Bounded lock-free queue with a single producer and a single consumer
+ * thread. The items are kept in a ring buffer; the producer only writes the
+ * tail and the consumer only writes the head, so that each side needs a
+ * single acquire load of the other side's index and a single release store
+ * of its own. The two indices live on separate cache lines to avoid false
+ * sharing between the threads.
+ *
+ * The indices count items since construction and are reduced modulo the
+ * capacity (a power of two) when accessing the ring buffer.
+ */
+template< typename tItem >
+class SpscQueue
+{
+	public:
+		explicit SpscQueue( std::size_t aCapacity );
+
+		SpscQueue( SpscQueue const& ) = delete;
+		SpscQueue& operator= (SpscQueue const&) = delete;
+
+	public:
+		// Producer. Returns false (and leaves aItem untouched) if the queue is
+		// full.
+		bool try_push( tItem&& aItem );
+
+		// Consumer. Returns an empty optional if the queue is empty.
+		std::optional<tItem> try_pop();
+
+	private:
+		std::vector<std::optional<tItem>> mSlots;
+		std::size_t mMask;
+
+		alignas(64) std::atomic<std::size_t> mHead{ 0 }; // next item to pop
+		alignas(64) std::atomic<std::size_t> mTail{ 0 }; // next item to push
+};
+
+
+template< typename tItem > inline
+SpscQueue<tItem>::SpscQueue( std::size_t aCapacity )
+{
+	std::size_t capacity = 1;
+	while( capacity < aCapacity )
+		capacity *= 2;
+
+	mSlots.resize( capacity );
+	mMask = capacity - 1;
+}
+
+template< typename tItem > inline
+bool SpscQueue<tItem>::try_push( tItem&& aItem )
+{
+	auto const tail = mTail.load( std::memory_order_relaxed );
+	if( tail - mHead.load( std::memory_order_acquire ) == mSlots.size() )
+		return false;
+
+	auto& slot = mSlots[tail & mMask];
+	assert( !slot.has_value() );
+	slot.emplace( std::move(aItem) );
+
+	mTail.store( tail+1, std::memory_order_release );
+	return true;
+}
+
+template< typename tItem > inline
+std::optional<tItem> SpscQueue<tItem>::try_pop()
+{
+	auto const head = mHead.load( std::memory_order_relaxed );
+	if( head == mTail.load( std::memory_order_acquire ) )
+		return {};
+
+	auto& slot = mSlots[head & mMask];
+	std::optional<tItem> ret( std::move(slot) );
+	slot.reset();
+
+	mHead.store( head+1, std::memory_order_release );
+	return ret;
+}
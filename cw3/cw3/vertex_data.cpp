@@ -1,309 +1,206 @@
 #include "vertex_data.h"
 
-#include <limits>
 #include <iostream>
+#include <cassert>
+#include <cstddef>
 #include <cstring> // for std::memcpy()
 #include "../labutils/error.hpp"
 #include "../labutils/vkutil.hpp"
 #include "../labutils/to_string.hpp"
 
+#include "vertex_quantize.hpp"
+#include "material_table.hpp"
+
 
 namespace lut = labutils;
 
 
-Mesh create_mesh_data(labutils::VulkanContext const& aContext, labutils::Allocator const& aAllocator, ModelData& const modelData, unsigned int subMeshIndex)
+Mesh create_mesh_data(labutils::UploadBatch& aBatch, ModelData const& modelData, unsigned int subMeshIndex)
 {
 	
 	// Store the number of vertices for the first object
 	unsigned int numberOfVertices = modelData.meshes[subMeshIndex].numberOfVertices;
 	unsigned int vertexStartIndex = modelData.meshes[subMeshIndex].vertexStartIndex;
 	unsigned int materialIndex = modelData.meshes[subMeshIndex].materialIndex;
+	unsigned int numberOfIndices = modelData.meshes[subMeshIndex].numberOfIndices;
+	unsigned int indexStartIndex = modelData.meshes[subMeshIndex].indexStartIndex;
+	std::size_t meshletStartIndex = modelData.meshes[subMeshIndex].meshletStartIndex;
+	std::size_t numberOfMeshlets = modelData.meshes[subMeshIndex].numberOfMeshlets;
+
+	// The levels of detail are stored after the full-detail indices
+	std::vector<MeshLod> lods;
+	unsigned int indexBufferCount = numberOfIndices;
+	for (MeshLodInfo const& lodInfo : modelData.meshes[subMeshIndex].lods)
+	{
+		lods.push_back({ indexBufferCount, std::uint32_t(lodInfo.numberOfIndices), lodInfo.error });
+		indexBufferCount += std::uint32_t(lodInfo.numberOfIndices);
+	}
 
-	// Resize the vector for texture coordinate
-	if (modelData.vertexTextureCoords.empty())
-		modelData.vertexTextureCoords.resize(numberOfVertices,glm::vec2(0,0));
+	// Mesh-local indices fit into 16 bits if the mesh has few enough vertices
+	VkIndexType const indexType = numberOfVertices <= 0x10000 ? VK_INDEX_TYPE_UINT16 : VK_INDEX_TYPE_UINT32;
+	std::size_t const indexSize = VK_INDEX_TYPE_UINT16 == indexType ? sizeof(std::uint16_t) : sizeof(std::uint32_t);
 
 	// Get materials
-	block::MaterialUniform materialUniform{};
+	block::MaterialRecord material{};
 
 
-	materialUniform.emissive = glm::vec4(modelData.materials[materialIndex].emissive, 1.0f);
-	materialUniform.shininess = modelData.materials[materialIndex].shininess;
+	material.emissive = glm::vec4(modelData.materials[materialIndex].emissive, 1.0f);
+	material.shininess = modelData.materials[materialIndex].shininess;
 	
 #ifdef BLINN_PHONG_MODE
-	materialUniform.diffuse = glm::vec4(modelData.materials[materialIndex].diffuse, 1.0f);
-	materialUniform.specular = glm::vec4(modelData.materials[materialIndex].specular, 1.0f);
+	material.diffuse = glm::vec4(modelData.materials[materialIndex].diffuse, 1.0f);
+	material.specular = glm::vec4(modelData.materials[materialIndex].specular, 1.0f);
 #endif
 
 #ifdef PBR_MODE
-	materialUniform.metalness = modelData.materials[materialIndex].metalness;
-	materialUniform.albedo = glm::vec4(modelData.materials[materialIndex].albedo, 1.f);
+	material.metalness = modelData.materials[materialIndex].metalness;
+	material.albedo = glm::vec4(modelData.materials[materialIndex].albedo, 1.f);
 #endif
 
 	
-	// Vertex data
-	lut::Buffer posStaging = lut::create_buffer(
-		aAllocator,
-		numberOfVertices * sizeof(glm::vec3),
-		VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-		VMA_MEMORY_USAGE_CPU_TO_GPU
-	);
-
-	lut::Buffer texcoordStaging = lut::create_buffer(
-		aAllocator,
-		numberOfVertices * sizeof(glm::vec2),
-		VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-		VMA_MEMORY_USAGE_CPU_TO_GPU
-	);
-
-	lut::Buffer normalStaging = lut::create_buffer(
-		aAllocator,
-		numberOfVertices * sizeof(glm::vec3),
-		VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-		VMA_MEMORY_USAGE_CPU_TO_GPU
-	);
-
-	// map the buffer with a pointer
-
-	// Position
-	void* posPtr = nullptr;
-	if (auto const res = vmaMapMemory(aAllocator.allocator, posStaging.allocation, &posPtr); VK_SUCCESS != res)
-	{
-		throw lut::Error("Mapping memory for writing\nvmaMapMemory() returned %s", lut::to_string(res).c_str());
-	}
-	// copy the data into buffer pointed by the pointer
-	std::memcpy(posPtr, &modelData.vertexPositions[vertexStartIndex], numberOfVertices * sizeof(glm::vec3));
+	// Bounds, for position quantization and level of detail selection
+	QuantizationBounds const bounds = compute_quantization_bounds(modelData.position_data() + vertexStartIndex, numberOfVertices);
 
-	// un map buffer
-	vmaUnmapMemory(aAllocator.allocator, posStaging.allocation);
+	// All vertex attributes and the indices share one staging region. Each
+	// array starts at a multiple of 16 bytes.
+	auto const align16 = [](VkDeviceSize aOffset) { return (aOffset + 15) & ~VkDeviceSize(15); };
 
-	// Texture Coordinate
-	void* texcoordPtr = nullptr;
-	if (auto const res = vmaMapMemory(aAllocator.allocator, texcoordStaging.allocation, &texcoordPtr); VK_SUCCESS != res)
-	{
-		throw lut::Error("Mapping memory for writing\nvmaMapMemory() returned % s", lut::to_string(res).c_str());
-	}
+	VkDeviceSize const positionOffset = 0;
+	VkDeviceSize const texcoordOffset = align16(positionOffset + numberOfVertices * vtx::kPositionSize);
+	VkDeviceSize const normalOffset = align16(texcoordOffset + numberOfVertices * vtx::kTexcoordSize);
+	VkDeviceSize const indexOffset = align16(normalOffset + numberOfVertices * vtx::kNormalSize);
+	VkDeviceSize const stagingSize = indexOffset + indexBufferCount * indexSize;
 
-	std::memcpy(texcoordPtr, &modelData.vertexTextureCoords[vertexStartIndex], numberOfVertices * sizeof(glm::vec2));
+	lut::StagingRegion const staging = aBatch.stage(stagingSize);
 
-	vmaUnmapMemory(aAllocator.allocator, texcoordStaging.allocation);
+	void* posPtr = static_cast<std::byte*>(staging.data) + positionOffset;
+	void* texcoordPtr = static_cast<std::byte*>(staging.data) + texcoordOffset;
+	void* normalPtr = static_cast<std::byte*>(staging.data) + normalOffset;
+	void* indexPtr = static_cast<std::byte*>(staging.data) + indexOffset;
 
-	// Normal
-	void* normalPtr = nullptr;
-	if (auto const res = vmaMapMemory(aAllocator.allocator, normalStaging.allocation, &normalPtr); VK_SUCCESS != res)
-	{
-		throw lut::Error("Mapping memory for writing\nvmaMapMemory() returned % s", lut::to_string(res).c_str());
-	}
+	// For cooked models, these point into the mapped file, so the data is
+	// written to staging memory without an intermediate copy
+	glm::vec3 const* positions = modelData.position_data() + vertexStartIndex;
+	glm::vec2 const* texcoords = modelData.texcoord_data() + vertexStartIndex;
+	glm::vec3 const* normals = modelData.normal_data() + vertexStartIndex;
+	std::uint32_t const* indices = modelData.index_data();
+
+	// copy the data into buffer pointed by the pointer
+#ifdef QUANTIZED_VERTEX_MODE
+	quantize_positions(static_cast<std::uint16_t*>(posPtr), positions, numberOfVertices, bounds);
+	quantize_texcoords(static_cast<std::uint16_t*>(texcoordPtr), texcoords, numberOfVertices);
+	quantize_normals(static_cast<std::int16_t*>(normalPtr), normals, numberOfVertices);
+#else
+	std::memcpy(posPtr, positions, numberOfVertices * sizeof(glm::vec3));
+	std::memcpy(texcoordPtr, texcoords, numberOfVertices * sizeof(glm::vec2));
+	std::memcpy(normalPtr, normals, numberOfVertices * sizeof(glm::vec3));
+#endif
 
-	std::memcpy(normalPtr, &modelData.vertexNormals[vertexStartIndex], numberOfVertices * sizeof(glm::vec3));
+	// Index
+	auto const copy_indices = [&](std::size_t aFirst, std::size_t aCount, std::size_t aOffset)
+	{
+		if (VK_INDEX_TYPE_UINT16 == indexType)
+		{
+			// narrow the indices while copying
+			auto* indexPtr16 = static_cast<std::uint16_t*>(indexPtr) + aOffset;
+			for (std::size_t i = 0; i < aCount; ++i)
+				indexPtr16[i] = std::uint16_t(indices[aFirst + i]);
+		}
+		else
+		{
+			std::memcpy(static_cast<std::uint32_t*>(indexPtr) + aOffset, indices + aFirst, aCount * sizeof(std::uint32_t));
+		}
+	};
 
-	vmaUnmapMemory(aAllocator.allocator, normalStaging.allocation);
+	copy_indices(indexStartIndex, numberOfIndices, 0);
+	for (std::size_t i = 0; i < lods.size(); ++i)
+		copy_indices(modelData.meshes[subMeshIndex].lods[i].indexStartIndex, lods[i].indexCount, lods[i].firstIndex);
 
 	// return mesh
 	return Mesh{
-		std::move(posStaging),
-		std::move(texcoordStaging),
-		std::move(normalStaging),
-		"",
+		staging,
+		positionOffset,
+		texcoordOffset,
+		normalOffset,
+		indexOffset,
+		modelData.materials[materialIndex].mapDiffuse,
 		modelData.materials[materialIndex].color,
-		std::move(materialUniform),
-		numberOfVertices
+		material,
+		numberOfVertices,
+		numberOfIndices,
+		indexType,
+		bounds.positionMin,
+		bounds.positionExtent,
+		std::vector<MeshletInfo>(modelData.meshlets.begin() + meshletStartIndex, modelData.meshlets.begin() + meshletStartIndex + numberOfMeshlets),
+		std::move(lods),
+		indexBufferCount
 	};
 }
 
 
-ModelVertexTexturePack create_model_attribute_set(labutils::VulkanWindow const& window, labutils::Allocator const& allocator,
-	ModelData& const modelData, VkDescriptorSetLayout textureSetLayout, VkDescriptorSetLayout materialSetLayout, VkDescriptorPool dpool, unsigned int subMeshIndex)
+ModelVertexTexturePack create_model_attribute_set(labutils::GeometryArena& arena, labutils::UploadBatch& batch, ModelData const& modelData,
+	SharedTextureCache& textures, MaterialTable& materials, unsigned int subMeshIndex)
 {
 	// get mesh data
-	Mesh mesh = create_mesh_data(window, allocator, modelData, subMeshIndex);
+	Mesh mesh = create_mesh_data(batch, modelData, subMeshIndex);
 
-	// load textures into image
-	labutils::Image image;
-	{
-		// check if the device image format can support 
-		VkFormatProperties formatProperties;
-		vkGetPhysicalDeviceFormatProperties(window.physicalDevice, VK_FORMAT_R8G8B8A8_SRGB, &formatProperties);
-		
-		// create command pool
-		labutils::CommandPool loadCmdPool = labutils::create_command_pool(window,VK_COMMAND_POOL_CREATE_TRANSIENT_BIT);
-
-		// load a texture for the model
-		if (mesh.colorTexturePath != "")
-		{
-			if (formatProperties.optimalTilingFeatures & VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT) 
-			{
-				image = labutils::load_image_texture2d_with_bliting(mesh.colorTexturePath.c_str(), window, loadCmdPool.handle, allocator);
-			}
-			else
-			{
-				image = labutils::load_image_texture2d_no_minmap(mesh.colorTexturePath.c_str(), window, loadCmdPool.handle, allocator);
-			}
-		}
-		else
-			image = create_image_texture2d_with_solid_color(mesh.colorTexturePath.c_str(), window, loadCmdPool.handle, allocator, glm::vec4(mesh.color,1.f));
-	}
+	// space in the geometry arena. The attribute buffers of the arena are in
+	// the order position, texcoord, normal; see main.cpp.
+	VkDeviceSize const indexSize = VK_INDEX_TYPE_UINT16 == mesh.indexType ? sizeof(std::uint16_t) : sizeof(std::uint32_t);
+	VkDeviceSize const indexBytes = mesh.indexBufferCount * indexSize;
 
-	// create image view for texture image
-	labutils::ImageView view  = labutils::create_image_view_texture2d(window, image.image, VK_FORMAT_R8G8B8A8_SRGB);
-	
-	labutils::Sampler sampler = labutils::create_default_sampler(window, VK_TRUE);
-	
+	assert(3 == arena.attributes.size());
+	lut::GeometryRange const geometry = arena.allocate(mesh.vertexCount, indexBytes, indexSize);
 
-	// allocate and initialize descriptor sets for texture
-	VkDescriptorSet texDescriptors = labutils::alloc_desc_set(window, dpool, textureSetLayout);
+	// copy data in staging memory into the arena. The copies are recorded
+	// before the textures reserve further staging memory; see
+	// UploadBatch::stage().
+	VkDeviceSize const stagingOffsets[3] = { mesh.positionOffset, mesh.texcoordOffset, mesh.normalOffset };
+	for (std::size_t i = 0; i < 3; ++i)
 	{
-		// Write descriptor set
-		VkWriteDescriptorSet desc[1]{};
-
-		// Descriptor Buffer Info 
-		VkDescriptorImageInfo imageInfo{};
-		imageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-		imageInfo.imageView = view.handle;
-		imageInfo.sampler = sampler.handle;
-
-		desc[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-		desc[0].dstSet = texDescriptors;
-		desc[0].dstBinding = 0;
-		desc[0].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-		desc[0].descriptorCount = 1;
-		desc[0].pImageInfo = &imageInfo;
-
-		constexpr auto numSets = sizeof(desc) / sizeof(desc[0]);
-		vkUpdateDescriptorSets(window.device, numSets, desc, 0, nullptr);
+		lut::StagingRegion const source{
+			static_cast<std::byte*>(mesh.staging.data) + stagingOffsets[i],
+			mesh.staging.buffer,
+			mesh.staging.offset + stagingOffsets[i],
+			mesh.vertexCount * arena.strides[i]
+		};
+
+		batch.copy_to_buffer(source, arena.attributes[i].buffer, geometry.vertexOffset * arena.strides[i],
+			VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT, VK_PIPELINE_STAGE_VERTEX_INPUT_BIT);
 	}
 
-	// descriptor set pack
-	desc::DescriptorSetPack materialDescSetPack = desc::create_descriptor_set_for_uniform_buffer(window, allocator, dpool,
-		materialSetLayout, { sizeof(block::MaterialUniform) }, 1);
-	materialDescSetPack.data.emplace_back(& mesh.materialUniform);
-
-	// vertex gpu buffer
-	lut::Buffer vertexPosGPU = lut::create_buffer(
-		allocator,
-		mesh.vertexCount * sizeof(glm::vec3),
-		VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
-		VMA_MEMORY_USAGE_GPU_ONLY
-	);
-
-	lut::Buffer vertexTexcoordGPU = lut::create_buffer(
-		allocator,
-		mesh.vertexCount * sizeof(glm::vec2),
-		VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
-		VMA_MEMORY_USAGE_GPU_ONLY
-	);
-
-	lut::Buffer vertexNormalGPU = lut::create_buffer(
-		allocator,
-		mesh.vertexCount * sizeof(glm::vec3),
-		VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
-		VMA_MEMORY_USAGE_GPU_ONLY
-	);
-
-
-
-	//------ Begin command state -------//
-
-	// create fence
-	lut::Fence uploadComplete = create_fence(window);
-
-	// create command pool and buffer
-	lut::CommandPool uploadPool = create_command_pool(window);
-
-	VkCommandBuffer uploadCmd = alloc_command_buffer(window, uploadPool.handle);
-
-	VkCommandBufferBeginInfo beginInfo{};
-
-	beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-	beginInfo.flags = 0;
-	beginInfo.pInheritanceInfo = nullptr;
-
-	if (auto const res = vkBeginCommandBuffer(uploadCmd, &beginInfo); VK_SUCCESS != res)
-	{
-		throw lut::Error("Beginning command buffer recording\nvkBeginCommandBuffer() returned %s", lut::to_string(res).c_str());
-	}
-
-	// copy data in stage buffer into buffer for GPU only
-	VkBufferCopy pcopy{};
-	pcopy.size = mesh.vertexCount * sizeof(glm::vec3);
-	vkCmdCopyBuffer(uploadCmd, mesh.posStaging.buffer, vertexPosGPU.buffer, 1, &pcopy);
-
-	// create barrier
-	lut::buffer_barrier(uploadCmd,
-		vertexPosGPU.buffer,
-		VK_ACCESS_TRANSFER_WRITE_BIT,
-		VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT,
-		VK_PIPELINE_STAGE_TRANSFER_BIT,
-		VK_PIPELINE_STAGE_VERTEX_INPUT_BIT
-	);
-
-	// copy data in stage buffer into buffer for GPU only
-	VkBufferCopy ccopy{};
-	ccopy.size = mesh.vertexCount * sizeof(glm::vec2);
-	vkCmdCopyBuffer(uploadCmd, mesh.texcoordStaging.buffer, vertexTexcoordGPU.buffer, 1, &ccopy);
-
-	// create barrier
-	lut::buffer_barrier(uploadCmd,
-		vertexTexcoordGPU.buffer,
-		VK_ACCESS_TRANSFER_WRITE_BIT,
-		VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT,
-		VK_PIPELINE_STAGE_TRANSFER_BIT,
-		VK_PIPELINE_STAGE_VERTEX_INPUT_BIT
-	);
-
-
-	// copy data in stage buffer into buffer for GPU only
-	VkBufferCopy ncopy{};
-	ncopy.size = mesh.vertexCount * sizeof(glm::vec3);
-	vkCmdCopyBuffer(uploadCmd, mesh.normalStaging.buffer, vertexNormalGPU.buffer, 1, &ncopy);
-
-	// create barrier
-	lut::buffer_barrier(uploadCmd,
-		vertexNormalGPU.buffer,
-		VK_ACCESS_TRANSFER_WRITE_BIT,
-		VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT,
-		VK_PIPELINE_STAGE_TRANSFER_BIT,
-		VK_PIPELINE_STAGE_VERTEX_INPUT_BIT
-	);
-
-	materialDescSetPack.update_ubo_data(uploadCmd);
-
-	if (auto const res = vkEndCommandBuffer(uploadCmd); VK_SUCCESS != res)
-	{
-		throw lut::Error("Ending command buffer recording\nvkEndCommandBuffer() returned %s", lut::to_string(res).c_str());
-	}
-
-	// submit command
-
-	VkSubmitInfo submitInfo{};
-	submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-	submitInfo.commandBufferCount = 1;
-	submitInfo.pCommandBuffers = &uploadCmd;
+	lut::StagingRegion const indexSource{
+		static_cast<std::byte*>(mesh.staging.data) + mesh.indexOffset,
+		mesh.staging.buffer,
+		mesh.staging.offset + mesh.indexOffset,
+		indexBytes
+	};
 
-	if (auto const res = vkQueueSubmit(window.graphicsQueue, 1, &submitInfo, uploadComplete.handle)
-		; VK_SUCCESS != res)
-	{
-		throw lut::Error("Submitting commands\nvkQueueSubmit() returned %s", lut::to_string(res).c_str());
-	}
+	batch.copy_to_buffer(indexSource, arena.indices.buffer, geometry.indexOffset,
+		VK_ACCESS_INDEX_READ_BIT, VK_PIPELINE_STAGE_VERTEX_INPUT_BIT);
 
-	if (auto const res = vkWaitForFences(window.device, 1, &uploadComplete.handle, VK_TRUE, std::numeric_limits<std::uint64_t>::max())
-		; VK_SUCCESS != res)
-	{
-		throw lut::Error("Waiting for upload to complete\nvkWaitForFences() returned %s", lut::to_string(res).c_str());
-	}
+	// texture, shared with the other meshes that use the same image. The
+	// G-buffer shader doesn't sample it; meshes without a texture get a white
+	// 1x1 one only to fill their descriptor slot.
+	std::shared_ptr<SharedTexture const> texture = mesh.colorTexturePath.empty()
+		? textures.solid_color(glm::vec4(1.f), batch)
+		: textures.load(mesh.colorTexturePath, batch);
 
-	//------ End command state -------//
+	// material, in its own slot of the table
+	std::uint32_t const materialIndex = materials.add(mesh.material, batch);
 
 	return ModelVertexTexturePack{
-		std::move(vertexPosGPU),
-		std::move(vertexTexcoordGPU),
-		std::move(vertexNormalGPU),
-		std::move(materialSetLayout),
-		std::move(texDescriptors),
-		std::move(image),
-		std::move(view),
-		std::move(sampler),
-		std::move(materialDescSetPack),
-		mesh.vertexCount
+		geometry,
+		std::uint32_t(geometry.indexOffset / indexSize),
+		texture->descriptorSet,
+		std::move(texture),
+		materialIndex,
+		mesh.vertexCount,
+		mesh.indexCount,
+		mesh.indexType,
+		mesh.positionMin,
+		mesh.positionExtent,
+		std::move(mesh.meshlets),
+		std::move(mesh.lods)
 	};
 }
\ No newline at end of file
@@ -6,11 +6,20 @@
 #include "../cw3/model.hpp"
 #include "../labutils/vkutil.hpp"
 #include "../labutils/vkimage.hpp"
+#include "../labutils/geometry_arena.hpp"
+#include "../labutils/upload_batch.hpp"
 #include "DescriptorSetHelper.h"
+#include "shared_texture_cache.hpp"
+
+class MaterialTable;
 
 //#define BLINN_PHONG_MODE
 #define PBR_MODE
 
+// Store vertex attributes in the compressed layout described in
+// vertex_quantize.hpp. Comment out to use 32-bit floats instead.
+#define QUANTIZED_VERTEX_MODE
+
 struct VertexInputInfo
 {
 	std::uint32_t bufferCount;
@@ -19,79 +28,152 @@ struct VertexInputInfo
 };
 
 
+// Per-vertex size and format of each vertex attribute stream
+namespace vtx
+{
+#ifdef QUANTIZED_VERTEX_MODE
+	constexpr std::uint32_t kPositionSize = 4 * sizeof(std::uint16_t);
+	constexpr std::uint32_t kTexcoordSize = 2 * sizeof(std::uint16_t);
+	constexpr std::uint32_t kNormalSize = 2 * sizeof(std::int16_t);
+
+	constexpr VkFormat kPositionFormat = VK_FORMAT_R16G16B16A16_UNORM;
+	constexpr VkFormat kTexcoordFormat = VK_FORMAT_R16G16_SFLOAT;
+	constexpr VkFormat kNormalFormat = VK_FORMAT_R16G16_SNORM;
+#else
+	constexpr std::uint32_t kPositionSize = sizeof(glm::vec3);
+	constexpr std::uint32_t kTexcoordSize = sizeof(glm::vec2);
+	constexpr std::uint32_t kNormalSize = sizeof(glm::vec3);
+
+	constexpr VkFormat kPositionFormat = VK_FORMAT_R32G32B32_SFLOAT;
+	constexpr VkFormat kTexcoordFormat = VK_FORMAT_R32G32_SFLOAT;
+	constexpr VkFormat kNormalFormat = VK_FORMAT_R32G32B32_SFLOAT;
+#endif
+}
+
+
 namespace block
 {
 
 #ifdef BLINN_PHONG_MODE
-	struct MaterialUniform
+	struct alignas(16) MaterialRecord
 	{
-		// Note: must map to the std140 uniform interface in the fragment
+		// Note: must map to the std430 array element in the fragment
 		// shader, so need to be careful about the packing/alignment here!
 		glm::vec4 emissive;
 		glm::vec4 diffuse;
 		glm::vec4 specular;
 		float shininess;
 	};
+
+	static_assert(sizeof(MaterialRecord) == 64, "MaterialRecord must match the std430 array stride in the shaders.");
 #endif
 
 
 #ifdef PBR_MODE
-	struct MaterialUniform
+	struct alignas(16) MaterialRecord
 	{
-		// Note: must map to the std140 uniform interface in the fragment
+		// Note: must map to the std430 array element in the fragment
 		// shader, so need to be careful about the packing/alignment here!
 		glm::vec4 emissive;
 		glm::vec4 albedo;
 		float shininess;
 		float metalness;
 	};
+
+	static_assert(sizeof(MaterialRecord) == 48, "MaterialRecord must match the std430 array stride in the shaders.");
 #endif
 
 }
 
 
+// Index range of a level of detail within the index buffer of a mesh
+struct MeshLod
+{
+	std::uint32_t firstIndex;
+	std::uint32_t indexCount;
+	float error; // see MeshLodInfo
+};
+
 struct Mesh
 {
-	// buffer
-	labutils::Buffer posStaging;
-	labutils::Buffer texcoordStaging;
-	labutils::Buffer normalStaging;
+	// staging memory, holding the vertex attributes and the indices at the
+	// offsets (in bytes) below
+	labutils::StagingRegion staging;
+	VkDeviceSize positionOffset;
+	VkDeviceSize texcoordOffset;
+	VkDeviceSize normalOffset;
+	VkDeviceSize indexOffset;
 
 	// data
 	std::string colorTexturePath;
 	glm::vec3 color;
-	block::MaterialUniform materialUniform;
+	block::MaterialRecord material;
 
-	// vertex count
+	// vertex and index count
 	std::uint32_t vertexCount;
+	std::uint32_t indexCount;
+	VkIndexType indexType;
+
+	// bounds of the mesh. With QUANTIZED_VERTEX_MODE, positions are stored
+	// relative to these; see vertex_quantize.hpp
+	glm::vec3 positionMin;
+	glm::vec3 positionExtent;
+
+	// meshlets of the mesh, for culling; see meshlet.hpp
+	std::vector<MeshletInfo> meshlets;
+
+	// coarser levels of detail, and the total number of indices including
+	// them; see mesh_lod.hpp
+	std::vector<MeshLod> lods;
+	std::uint32_t indexBufferCount;
 };
 
 struct ModelVertexTexturePack
 {
 
-	// vertex input
-	labutils::Buffer positions;
-	labutils::Buffer texcoords;
-	labutils::Buffer normals;
+	// vertex input: location in the geometry arena, and the first index of
+	// the mesh in the arena's index buffer
+	labutils::GeometryRange geometry;
+	std::uint32_t firstIndex;
 	
-	// texture
-	VkDescriptorSetLayout textureSetLayout;
+	// texture. With bindless textures, there is no per-mesh set
+	// (textureDescriptorSet is VK_NULL_HANDLE); the shader indexes the
+	// table with texture->textureIndex instead.
 	VkDescriptorSet textureDescriptorSet;
 	
-	labutils::Image image;
-	labutils::ImageView view;
-	labutils::Sampler sampler;
+	std::shared_ptr<SharedTexture const> texture;
 
-	// material
-	desc::DescriptorSetPack materialDescSetPack;
+	// material: slot in the MaterialTable, which the shader indexes
+	std::uint32_t materialIndex;
 
-	// vertex count
+	// vertex and index count
 	std::uint32_t vertexCount;
+	std::uint32_t indexCount;
+	VkIndexType indexType;
+
+	// bounds, and position dequantization
+	glm::vec3 positionMin;
+	glm::vec3 positionExtent;
+
+	// meshlets
+	std::vector<MeshletInfo> meshlets;
+
+	// levels of detail
+	std::vector<MeshLod> lods;
+
+	// first of the mesh's commands in the IndirectDrawBuffer, assigned once
+	// the mesh is resident
+	std::uint32_t firstDrawCommand = 0;
 };
 
 
 
-Mesh create_mesh_data(labutils::VulkanContext const&, labutils::Allocator const&, ModelData& const modelData, unsigned int subMeshIndex);
+// Writes the vertex attributes and indices of the mesh to staging memory of
+// the batch
+Mesh create_mesh_data(labutils::UploadBatch&, ModelData const& modelData, unsigned int subMeshIndex);
 
-ModelVertexTexturePack create_model_attribute_set(labutils::VulkanWindow const& window, labutils::Allocator const& allocator,
-	ModelData& const modelData, VkDescriptorSetLayout textureSetLayout, VkDescriptorSetLayout materialSetLayout, VkDescriptorPool dpool, unsigned int subMeshIndex);
+// Records the uploads of the mesh into the batch. The mesh's texture comes
+// from the cache, and its material goes into the table. The returned pack
+// may be drawn once the batch's submission has completed.
+ModelVertexTexturePack create_model_attribute_set(labutils::GeometryArena& arena, labutils::UploadBatch& batch, ModelData const& modelData,
+	SharedTextureCache& textures, MaterialTable& materials, unsigned int subMeshIndex);
@@ -0,0 +1,182 @@
+#include "vertex_quantize.hpp"
+
+#include <limits>
+#include <algorithm>
+
+#include <cmath>
+#include <cstdio>
+
+#include <glm/gtc/packing.hpp>
+
+namespace
+{
+	constexpr float kUnorm16Max = 65535.f;
+	constexpr float kSnorm16Max = 32767.f;
+
+	// Maximal distance between a unit normal and its decoded octahedral
+	// encoding with 16-bit components. The quantization error is at most
+	// 0.5/32767 per component in the octahedral domain; the mapping to the
+	// sphere stretches this by at most a factor of about 2 per component.
+	constexpr float kNormalErrorBound = 2.f * 1.4143f / kSnorm16Max;
+
+	// Half floats have 11 significant bits
+	constexpr float kHalfRelativeError = 1.f / 2048.f;
+	constexpr float kHalfAbsoluteError = 1.f / 16777216.f; // subnormals
+
+	inline float sign_not_zero_( float aX ) noexcept
+	{
+		return aX >= 0.f ? 1.f : -1.f;
+	}
+
+	inline std::int16_t to_snorm16_( float aX ) noexcept
+	{
+		return std::int16_t(std::lround( std::clamp( aX, -1.f, 1.f ) * kSnorm16Max ));
+	}
+
+	inline float from_snorm16_( std::int16_t aX ) noexcept
+	{
+		// Vulkan maps both -32768 and -32767 to -1
+		return std::max( float(aX) / kSnorm16Max, -1.f );
+	}
+}
+
+QuantizationBounds compute_quantization_bounds( glm::vec3 const* aPositions, std::size_t aCount )
+{
+	if( 0 == aCount )
+		return { glm::vec3( 0.f ), glm::vec3( 0.f ) };
+
+	glm::vec3 bmin( std::numeric_limits<float>::max() );
+	glm::vec3 bmax( std::numeric_limits<float>::lowest() );
+
+	for( std::size_t i = 0; i < aCount; ++i )
+	{
+		bmin = glm::min( bmin, aPositions[i] );
+		bmax = glm::max( bmax, aPositions[i] );
+	}
+
+	return { bmin, bmax - bmin };
+}
+
+void quantize_positions( std::uint16_t* aOut, glm::vec3 const* aPositions, std::size_t aCount, QuantizationBounds const& aBounds )
+{
+	// A zero extent (flat mesh) maps everything to the minimum.
+	glm::vec3 scale;
+	for( int c = 0; c < 3; ++c )
+		scale[c] = aBounds.positionExtent[c] > 0.f ? kUnorm16Max / aBounds.positionExtent[c] : 0.f;
+
+	for( std::size_t i = 0; i < aCount; ++i )
+	{
+		auto const rel = (aPositions[i] - aBounds.positionMin) * scale;
+		for( int c = 0; c < 3; ++c )
+			aOut[i*4+c] = std::uint16_t(std::lround( std::clamp( rel[c], 0.f, kUnorm16Max ) ));
+
+		aOut[i*4+3] = 0;
+	}
+}
+
+void quantize_normals( std::int16_t* aOut, glm::vec3 const* aNormals, std::size_t aCount )
+{
+	for( std::size_t i = 0; i < aCount; ++i )
+	{
+		auto const& n = aNormals[i];
+
+		// Project onto the octahedron, and fold the lower hemisphere over
+		float const l1 = std::abs( n.x ) + std::abs( n.y ) + std::abs( n.z );
+		glm::vec2 oct = l1 > 0.f ? glm::vec2( n.x, n.y ) / l1 : glm::vec2( 0.f );
+
+		if( n.z < 0.f )
+		{
+			oct = glm::vec2(
+				(1.f - std::abs( oct.y )) * sign_not_zero_( oct.x ),
+				(1.f - std::abs( oct.x )) * sign_not_zero_( oct.y )
+			);
+		}
+
+		aOut[i*2+0] = to_snorm16_( oct.x );
+		aOut[i*2+1] = to_snorm16_( oct.y );
+	}
+}
+
+void quantize_texcoords( std::uint16_t* aOut, glm::vec2 const* aTexcoords, std::size_t aCount )
+{
+	for( std::size_t i = 0; i < aCount; ++i )
+	{
+		aOut[i*2+0] = glm::packHalf1x16( aTexcoords[i].x );
+		aOut[i*2+1] = glm::packHalf1x16( aTexcoords[i].y );
+	}
+}
+
+
+glm::vec3 dequantize_position( std::uint16_t const* aIn, QuantizationBounds const& aBounds )
+{
+	glm::vec3 const unorm( aIn[0] / kUnorm16Max, aIn[1] / kUnorm16Max, aIn[2] / kUnorm16Max );
+	return aBounds.positionMin + unorm * aBounds.positionExtent;
+}
+
+glm::vec3 dequantize_normal( std::int16_t const* aIn )
+{
+	glm::vec3 n( from_snorm16_( aIn[0] ), from_snorm16_( aIn[1] ), 0.f );
+	n.z = 1.f - std::abs( n.x ) - std::abs( n.y );
+
+	if( n.z < 0.f )
+	{
+		n = glm::vec3(
+			(1.f - std::abs( n.y )) * sign_not_zero_( n.x ),
+			(1.f - std::abs( n.x )) * sign_not_zero_( n.y ),
+			n.z
+		);
+	}
+
+	return glm::normalize( n );
+}
+
+glm::vec2 dequantize_texcoord( std::uint16_t const* aIn )
+{
+	return glm::vec2( glm::unpackHalf1x16( aIn[0] ), glm::unpackHalf1x16( aIn[1] ) );
+}
+
+
+bool check_quantization_error( std::uint16_t const* aPositions, std::int16_t const* aNormals, std::uint16_t const* aTexcoords, glm::vec3 const* aRefPositions, glm::vec3 const* aRefNormals, glm::vec2 const* aRefTexcoords, std::size_t aCount, QuantizationBounds const& aBounds )
+{
+	// Half a quantization step, plus some slack for the float arithmetic
+	auto const eps = std::numeric_limits<float>::epsilon();
+	glm::vec3 const posBound = aBounds.positionExtent * (0.5f / kUnorm16Max)
+		+ 4.f * eps * (glm::abs( aBounds.positionMin ) + aBounds.positionExtent);
+
+	for( std::size_t i = 0; i < aCount; ++i )
+	{
+		auto const pos = dequantize_position( aPositions + i*4, aBounds );
+		auto const posErr = glm::abs( pos - aRefPositions[i] );
+		if( glm::any( glm::greaterThan( posErr, posBound ) ) )
+		{
+			std::fprintf( stderr, "Quantization: vertex %zu: position error (%g, %g, %g) exceeds bound (%g, %g, %g)\n",
+				i, posErr.x, posErr.y, posErr.z, posBound.x, posBound.y, posBound.z );
+			return false;
+		}
+
+		// Only unit normals are expected to round-trip; the encoding
+		// normalizes its input.
+		auto const refLength = glm::length( aRefNormals[i] );
+		if( refLength > 0.f )
+		{
+			auto const nrmErr = glm::length( dequantize_normal( aNormals + i*2 ) - aRefNormals[i] / refLength );
+			if( nrmErr > kNormalErrorBound )
+			{
+				std::fprintf( stderr, "Quantization: vertex %zu: normal error %g exceeds bound %g\n", i, nrmErr, kNormalErrorBound );
+				return false;
+			}
+		}
+
+		auto const tex = dequantize_texcoord( aTexcoords + i*2 );
+		auto const texErr = glm::abs( tex - aRefTexcoords[i] );
+		auto const texBound = glm::max( glm::abs( aRefTexcoords[i] ) * kHalfRelativeError, glm::vec2( kHalfAbsoluteError ) );
+		if( glm::any( glm::greaterThan( texErr, texBound ) ) )
+		{
+			std::fprintf( stderr, "Quantization: vertex %zu: texcoord error (%g, %g) exceeds bound (%g, %g)\n",
+				i, texErr.x, texErr.y, texBound.x, texBound.y );
+			return false;
+		}
+	}
+
+	return true;
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include <glm/glm.hpp>
+
+/* Compressed vertex attributes, used with QUANTIZED_VERTEX_MODE (see
+ * vertex_data.h). Per vertex, this stores
+ *
+ *  - the position relative to the mesh's bounding box, as four 16-bit UNORM
+ *    values (R16G16B16A16_UNORM; the fourth value is unused padding),
+ *  - the normal in octahedral encoding, as two 16-bit SNORM values
+ *    (R16G16_SNORM),
+ *  - the texture coordinates as two half floats (R16G16_SFLOAT),
+ *
+ * for a total of 16 bytes, compared to 32 bytes for the float layout. The
+ * position is reconstructed as positionMin + value * positionExtent in the
+ * vertex shader (MultiRenderTarget.vert), where the bounds are passed via
+ * push constants.
+ */
+
+struct QuantizationBounds
+{
+	glm::vec3 positionMin;
+	glm::vec3 positionExtent;
+};
+
+QuantizationBounds compute_quantization_bounds( glm::vec3 const* aPositions, std::size_t aCount );
+
+// Encoders. aOut must have room for 4 (positions) or 2 (normals, texcoords)
+// values per vertex.
+void quantize_positions( std::uint16_t* aOut, glm::vec3 const* aPositions, std::size_t aCount, QuantizationBounds const& );
+void quantize_normals( std::int16_t* aOut, glm::vec3 const* aNormals, std::size_t aCount );
+void quantize_texcoords( std::uint16_t* aOut, glm::vec2 const* aTexcoords, std::size_t aCount );
+
+// Decoders, matching the decoding performed by the GPU and the vertex shader.
+glm::vec3 dequantize_position( std::uint16_t const* aIn, QuantizationBounds const& );
+glm::vec3 dequantize_normal( std::int16_t const* aIn );
+glm::vec2 dequantize_texcoord( std::uint16_t const* aIn );
+
+// Checks that the round-trip error of the quantized data stays within the
+// error bounds of the respective encodings. Returns false (and prints the
+// offending vertex) otherwise. See quantize_check.hpp.
+bool check_quantization_error(
+	std::uint16_t const* aPositions, std::int16_t const* aNormals, std::uint16_t const* aTexcoords,
+	glm::vec3 const* aRefPositions, glm::vec3 const* aRefNormals, glm::vec2 const* aRefTexcoords,
+	std::size_t aCount,
+	QuantizationBounds const&
+);
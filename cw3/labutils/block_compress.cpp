@@ -0,0 +1,435 @@
+#include "block_compress.hpp"
+
+#include <utility>
+#include <algorithm>
+
+#include <cmath>
+#include <cassert>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#	define LUT_BLOCK_COMPRESS_SSE2 1
+#	include <emmintrin.h>
+#else
+#	define LUT_BLOCK_COMPRESS_SSE2 0
+#endif
+
+namespace
+{
+	// A 4x4 block of pixels, stored by channel. The encoders work on floats
+	// in the range [0,255], which lets them handle four pixels at once with
+	// SSE2.
+	struct Block_
+	{
+		alignas(16) float c[4][16]; // [channel][pixel]
+	};
+
+	void load_block_( std::uint8_t const* aRGBA, std::uint32_t aWidth, std::uint32_t aHeight, std::uint32_t aBlockX, std::uint32_t aBlockY, Block_& aBlock ) noexcept
+	{
+		for( std::uint32_t y = 0; y < 4; ++y )
+		{
+			auto const sy = std::min( aBlockY*4 + y, aHeight-1 );
+			for( std::uint32_t x = 0; x < 4; ++x )
+			{
+				auto const sx = std::min( aBlockX*4 + x, aWidth-1 );
+				auto const* pixel = aRGBA + (std::size_t(sy)*aWidth + sx) * 4;
+
+				for( std::size_t ch = 0; ch < 4; ++ch )
+					aBlock.c[ch][y*4+x] = float(pixel[ch]);
+			}
+		}
+	}
+
+
+	// Fits a line through the first aChannels channels of the pixels. Returns
+	// the mean and the principal axis (unit length, or zero if all pixels are
+	// the same).
+	void principal_axis_( Block_ const& aBlock, std::size_t aChannels, float aMean[4], float aAxis[4] ) noexcept
+	{
+		float lo[4] = {}, hi[4] = {};
+		for( std::size_t ch = 0; ch < 4; ++ch )
+		{
+			aMean[ch] = aAxis[ch] = 0.f;
+			if( ch >= aChannels )
+				continue;
+
+			lo[ch] = hi[ch] = aBlock.c[ch][0];
+			for( std::size_t i = 0; i < 16; ++i )
+			{
+				aMean[ch] += aBlock.c[ch][i];
+				lo[ch] = std::min( lo[ch], aBlock.c[ch][i] );
+				hi[ch] = std::max( hi[ch], aBlock.c[ch][i] );
+			}
+			aMean[ch] /= 16.f;
+		}
+
+		float cov[4][4] = {};
+		for( std::size_t i = 0; i < 16; ++i )
+		{
+			for( std::size_t a = 0; a < aChannels; ++a )
+			{
+				for( std::size_t b = a; b < aChannels; ++b )
+					cov[a][b] += (aBlock.c[a][i] - aMean[a]) * (aBlock.c[b][i] - aMean[b]);
+			}
+		}
+		for( std::size_t a = 0; a < aChannels; ++a )
+		{
+			for( std::size_t b = 0; b < a; ++b )
+				cov[a][b] = cov[b][a];
+		}
+
+		// Power iteration, starting from the diagonal of the bounding box. A
+		// few iterations are plenty for 16 points.
+		float axis[4] = {};
+		for( std::size_t ch = 0; ch < aChannels; ++ch )
+			axis[ch] = hi[ch] - lo[ch];
+
+		for( int iter = 0; iter < 8; ++iter )
+		{
+			float next[4] = {};
+			float length2 = 0.f;
+			for( std::size_t a = 0; a < aChannels; ++a )
+			{
+				for( std::size_t b = 0; b < aChannels; ++b )
+					next[a] += cov[a][b] * axis[b];
+				length2 += next[a] * next[a];
+			}
+
+			if( length2 < 1e-12f )
+				break;
+
+			float const scale = 1.f / std::sqrt( length2 );
+			for( std::size_t ch = 0; ch < aChannels; ++ch )
+				axis[ch] = next[ch] * scale;
+		}
+
+		float length2 = 0.f;
+		for( std::size_t ch = 0; ch < aChannels; ++ch )
+			length2 += axis[ch] * axis[ch];
+
+		if( length2 < 1e-12f )
+			return;
+
+		float const scale = 1.f / std::sqrt( length2 );
+		for( std::size_t ch = 0; ch < aChannels; ++ch )
+			aAxis[ch] = axis[ch] * scale;
+	}
+
+	// Projects the pixels onto the line aOrigin + t*aAxis, over the first
+	// aChannels channels: aT[i] = dot(p[i] - aOrigin, aAxis).
+	void project_( Block_ const& aBlock, std::size_t aChannels, float const aOrigin[4], float const aAxis[4], float aT[16] ) noexcept
+	{
+#		if LUT_BLOCK_COMPRESS_SSE2
+		for( std::size_t i = 0; i < 16; i += 4 )
+		{
+			__m128 t = _mm_setzero_ps();
+			for( std::size_t ch = 0; ch < aChannels; ++ch )
+			{
+				__m128 const d = _mm_sub_ps( _mm_load_ps( aBlock.c[ch]+i ), _mm_set1_ps( aOrigin[ch] ) );
+				t = _mm_add_ps( t, _mm_mul_ps( d, _mm_set1_ps( aAxis[ch] ) ) );
+			}
+
+			_mm_storeu_ps( aT+i, t );
+		}
+#		else // !SSE2
+		for( std::size_t i = 0; i < 16; ++i )
+		{
+			aT[i] = 0.f;
+			for( std::size_t ch = 0; ch < aChannels; ++ch )
+				aT[i] += (aBlock.c[ch][i] - aOrigin[ch]) * aAxis[ch];
+		}
+#		endif // ~ SSE2
+	}
+
+	// Picks, for each pixel, the closest of aSteps evenly spaced points from
+	// aE0 (step 0) to aE1 (step aSteps-1), by projecting it onto the line
+	// through the two.
+	void fit_steps_( Block_ const& aBlock, std::size_t aChannels, float const aE0[4], float const aE1[4], int aSteps, std::uint8_t aOut[16] ) noexcept
+	{
+		float axis[4] = {};
+		float length2 = 0.f;
+		for( std::size_t ch = 0; ch < aChannels; ++ch )
+		{
+			axis[ch] = aE1[ch] - aE0[ch];
+			length2 += axis[ch] * axis[ch];
+		}
+
+		if( length2 <= 0.f )
+		{
+			std::fill_n( aOut, 16, std::uint8_t(0) );
+			return;
+		}
+
+		// Scale the axis such that the projection is measured in steps
+		float const scale = float(aSteps-1) / length2;
+		for( std::size_t ch = 0; ch < aChannels; ++ch )
+			axis[ch] *= scale;
+
+		alignas(16) float t[16];
+		project_( aBlock, aChannels, aE0, axis, t );
+
+#		if LUT_BLOCK_COMPRESS_SSE2
+		__m128 const lo = _mm_setzero_ps();
+		__m128 const hi = _mm_set1_ps( float(aSteps-1) );
+		for( std::size_t i = 0; i < 16; i += 4 )
+		{
+			__m128 const clamped = _mm_min_ps( _mm_max_ps( _mm_load_ps( t+i ), lo ), hi );
+			__m128i const steps = _mm_cvtps_epi32( clamped ); // rounds to nearest
+
+			alignas(16) std::int32_t out[4];
+			_mm_store_si128( reinterpret_cast<__m128i*>(out), steps );
+			for( std::size_t j = 0; j < 4; ++j )
+				aOut[i+j] = std::uint8_t(out[j]);
+		}
+#		else // !SSE2
+		for( std::size_t i = 0; i < 16; ++i )
+		{
+			float const clamped = std::clamp( t[i], 0.f, float(aSteps-1) );
+			aOut[i] = std::uint8_t(std::lround( clamped ));
+		}
+#		endif // ~ SSE2
+	}
+
+	// Endpoints along the principal axis that cover the pixels, moved inwards
+	// by 1/aInset of the range. The extreme pixels are rarely worth the
+	// precision lost for all the others.
+	void fit_endpoints_( Block_ const& aBlock, std::size_t aChannels, float aInset, float aE0[4], float aE1[4] ) noexcept
+	{
+		float mean[4], axis[4];
+		principal_axis_( aBlock, aChannels, mean, axis );
+
+		float t[16];
+		project_( aBlock, aChannels, mean, axis, t );
+
+		float const tmin = *std::min_element( t, t+16 );
+		float const tmax = *std::max_element( t, t+16 );
+		float const inset = (tmax - tmin) / aInset;
+
+		for( std::size_t ch = 0; ch < 4; ++ch )
+		{
+			aE0[ch] = std::clamp( mean[ch] + axis[ch] * (tmax - inset), 0.f, 255.f );
+			aE1[ch] = std::clamp( mean[ch] + axis[ch] * (tmin + inset), 0.f, 255.f );
+		}
+	}
+
+
+	std::uint16_t to_565_( float const aColor[3] ) noexcept
+	{
+		auto const r = std::uint16_t(std::lround( aColor[0] * (31.f / 255.f) ));
+		auto const g = std::uint16_t(std::lround( aColor[1] * (63.f / 255.f) ));
+		auto const b = std::uint16_t(std::lround( aColor[2] * (31.f / 255.f) ));
+		return std::uint16_t((r << 11) | (g << 5) | b);
+	}
+	void from_565_( std::uint16_t aColor, float aOut[4] ) noexcept
+	{
+		std::uint32_t const r = (aColor >> 11) & 31, g = (aColor >> 5) & 63, b = aColor & 31;
+		aOut[0] = float((r << 3) | (r >> 2));
+		aOut[1] = float((g << 2) | (g >> 4));
+		aOut[2] = float((b << 3) | (b >> 2));
+		aOut[3] = 0.f;
+	}
+
+	void encode_bc1_( Block_ const& aBlock, std::uint8_t* aOut ) noexcept
+	{
+		float e0[4], e1[4];
+		fit_endpoints_( aBlock, 3, 16.f, e0, e1 );
+
+		std::uint16_t c0 = to_565_( e0 ), c1 = to_565_( e1 );
+
+		// The block is decoded with four colors if c0 > c1. With c0 == c1,
+		// all pixels use c0.
+		std::uint32_t indices = 0;
+		if( c0 != c1 )
+		{
+			if( c0 < c1 )
+				std::swap( c0, c1 );
+
+			from_565_( c0, e0 );
+			from_565_( c1, e1 );
+
+			std::uint8_t steps[16];
+			fit_steps_( aBlock, 3, e0, e1, 4, steps );
+
+			// Colors 2 and 3 are at 1/3 and 2/3 from c0 to c1
+			constexpr std::uint8_t kIndexOfStep[4] = { 0, 2, 3, 1 };
+			for( std::size_t i = 0; i < 16; ++i )
+				indices |= std::uint32_t(kIndexOfStep[steps[i]]) << (2*i);
+		}
+
+		aOut[0] = std::uint8_t(c0 & 0xff);
+		aOut[1] = std::uint8_t(c0 >> 8);
+		aOut[2] = std::uint8_t(c1 & 0xff);
+		aOut[3] = std::uint8_t(c1 >> 8);
+		for( std::size_t i = 0; i < 4; ++i )
+			aOut[4+i] = std::uint8_t(indices >> (8*i));
+	}
+
+	void encode_alpha_( Block_ const& aBlock, std::uint8_t* aOut ) noexcept
+	{
+		float const* alpha = aBlock.c[3];
+		float const lo = *std::min_element( alpha, alpha+16 );
+		float const hi = *std::max_element( alpha, alpha+16 );
+
+		// With a0 > a1, the block interpolates six values between the two
+		auto const a0 = std::uint8_t(std::lround( hi ));
+		auto const a1 = std::uint8_t(std::lround( lo ));
+
+		std::uint64_t indices = 0;
+		if( a0 > a1 )
+		{
+			float const scale = 7.f / float(a0 - a1);
+			for( std::size_t i = 0; i < 16; ++i )
+			{
+				auto const step = std::lround( std::clamp( (float(a0) - alpha[i]) * scale, 0.f, 7.f ) );
+				std::uint64_t const index = 0 == step ? 0 : (7 == step ? 1 : std::uint64_t(step+1));
+				indices |= index << (3*i);
+			}
+		}
+
+		aOut[0] = a0;
+		aOut[1] = a1;
+		for( std::size_t i = 0; i < 6; ++i )
+			aOut[2+i] = std::uint8_t(indices >> (8*i));
+	}
+
+	void encode_bc3_( Block_ const& aBlock, std::uint8_t* aOut ) noexcept
+	{
+		encode_alpha_( aBlock, aOut );
+		encode_bc1_( aBlock, aOut+8 );
+	}
+
+
+	// Writes a 128-bit block, least significant bit first
+	class BitWriter_
+	{
+		public:
+			void write( std::uint32_t aValue, std::uint32_t aBits ) noexcept
+			{
+				for( std::uint32_t i = 0; i < aBits; ++i, ++mPos )
+				{
+					if( aValue & (1u << i) )
+						mBits[mPos/8] |= std::uint8_t(1u << (mPos%8));
+				}
+			}
+
+			void store( std::uint8_t* aOut ) const noexcept
+			{
+				assert( 128 == mPos );
+				std::copy( mBits, mBits+16, aOut );
+			}
+
+		private:
+			std::uint8_t mBits[16] = {};
+			std::uint32_t mPos = 0;
+	};
+
+	void encode_bc7_( Block_ const& aBlock, std::uint8_t* aOut ) noexcept
+	{
+		float e[2][4];
+		fit_endpoints_( aBlock, 4, 32.f, e[0], e[1] );
+
+		// Mode 6 endpoints have seven bits per channel, and a low bit ("p-bit")
+		// shared by the channels. Pick the p-bit that fits each endpoint best.
+		std::uint32_t q[2][4], p[2];
+		float decoded[2][4];
+		for( std::size_t k = 0; k < 2; ++k )
+		{
+			float bestError = -1.f;
+			for( std::uint32_t pbit = 0; pbit < 2; ++pbit )
+			{
+				std::uint32_t cand[4];
+				float error = 0.f;
+				for( std::size_t ch = 0; ch < 4; ++ch )
+				{
+					cand[ch] = std::uint32_t(std::clamp( std::lround( (e[k][ch] - float(pbit)) * .5f ), 0l, 127l ));
+
+					float const d = float((cand[ch] << 1) | pbit) - e[k][ch];
+					error += d*d;
+				}
+
+				if( bestError < 0.f || error < bestError )
+				{
+					bestError = error;
+					p[k] = pbit;
+					std::copy( cand, cand+4, q[k] );
+				}
+			}
+
+			for( std::size_t ch = 0; ch < 4; ++ch )
+				decoded[k][ch] = float((q[k][ch] << 1) | p[k]);
+		}
+
+		// The 4-bit weights are (nearly) evenly spaced; see the BC7 weight
+		// table 0, 4, 9, 13, ..., 64.
+		std::uint8_t indices[16];
+		fit_steps_( aBlock, 4, decoded[0], decoded[1], 16, indices );
+
+		// The first index is stored without its top bit, which must be zero.
+		// Otherwise, swap the endpoints.
+		if( indices[0] & 8 )
+		{
+			std::swap( q[0], q[1] );
+			std::swap( p[0], p[1] );
+			for( auto& index : indices )
+				index = std::uint8_t(15 - index);
+		}
+
+		BitWriter_ bits;
+		bits.write( 1u << 6, 7 ); // mode 6
+		for( std::size_t ch = 0; ch < 4; ++ch )
+		{
+			bits.write( q[0][ch], 7 );
+			bits.write( q[1][ch], 7 );
+		}
+		bits.write( p[0], 1 );
+		bits.write( p[1], 1 );
+
+		bits.write( indices[0], 3 );
+		for( std::size_t i = 1; i < 16; ++i )
+			bits.write( indices[i], 4 );
+
+		bits.store( aOut );
+	}
+}
+
+namespace labutils
+{
+	std::size_t block_size( BlockFormat aFormat ) noexcept
+	{
+		return BlockFormat::bc1 == aFormat ? 8 : 16;
+	}
+
+	std::size_t compressed_size( BlockFormat aFormat, std::uint32_t aWidth, std::uint32_t aHeight ) noexcept
+	{
+		std::size_t const blocksX = (std::size_t(aWidth) + 3) / 4;
+		std::size_t const blocksY = (std::size_t(aHeight) + 3) / 4;
+		return blocksX * blocksY * block_size( aFormat );
+	}
+
+	void compress_image( BlockFormat aFormat, std::uint8_t const* aRGBA, std::uint32_t aWidth, std::uint32_t aHeight, void* aDst )
+	{
+		assert( aWidth > 0 && aHeight > 0 );
+
+		auto* out = static_cast<std::uint8_t*>(aDst);
+		std::size_t const blockBytes = block_size( aFormat );
+
+		Block_ block;
+		for( std::uint32_t by = 0; by < (aHeight+3)/4; ++by )
+		{
+			for( std::uint32_t bx = 0; bx < (aWidth+3)/4; ++bx )
+			{
+				load_block_( aRGBA, aWidth, aHeight, bx, by, block );
+
+				switch( aFormat )
+				{
+					case BlockFormat::bc1: encode_bc1_( block, out ); break;
+					case BlockFormat::bc3: encode_bc3_( block, out ); break;
+					case BlockFormat::bc7: encode_bc7_( block, out ); break;
+				}
+
+				out += blockBytes;
+			}
+		}
+	}
+}
+
+//EOF vim:syntax=cpp:foldmethod=marker:ts=4:noexpandtab:
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace labutils
+{
+	// Block-compressed texture formats. Each stores a 4x4 block of pixels in
+	// a fixed number of bytes:
+	//  - BC1: 8 bytes. Two RGB 5:6:5 endpoints and 2-bit indices; no alpha.
+	//  - BC3: 16 bytes. A BC1 color block and an alpha block with two 8-bit
+	//         endpoints and 3-bit indices.
+	//  - BC7: 16 bytes. The encoder only uses mode 6: one RGBA line with
+	//         7.7.7.7 endpoints (plus a shared low bit each) and 4-bit indices.
+	enum class BlockFormat : std::uint32_t
+	{
+		bc1,
+		bc3,
+		bc7
+	};
+
+	std::size_t block_size( BlockFormat ) noexcept;
+
+	// Size of an aWidth x aHeight image in the given format. Partial blocks
+	// at the right and bottom edges take up a whole block.
+	std::size_t compressed_size( BlockFormat, std::uint32_t aWidth, std::uint32_t aHeight ) noexcept;
+
+	// Compresses the aWidth x aHeight RGBA8 image at aRGBA to aDst, which must
+	// hold compressed_size() bytes. Blocks are stored row by row; partial
+	// blocks repeat the last row/column of pixels. The values are compressed
+	// as they are, i.e., sRGB images are compressed in sRGB space.
+	void compress_image( BlockFormat, std::uint8_t const* aRGBA, std::uint32_t aWidth, std::uint32_t aHeight, void* aDst );
+}
+
+//EOF vim:syntax=cpp:foldmethod=marker:ts=4:noexpandtab:
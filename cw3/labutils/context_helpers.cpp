@@ -163,4 +163,27 @@ namespace labutils::detail
 
 		return ret;
 	}
+
+	bool supports_timeline_semaphores( VkPhysicalDevice aPhysicalDev, bool& aNeedsExtension )
+	{
+		VkPhysicalDeviceProperties props;
+		vkGetPhysicalDeviceProperties( aPhysicalDev, &props );
+
+		bool const core = VK_API_VERSION_MAJOR(props.apiVersion) > 1 || VK_API_VERSION_MINOR(props.apiVersion) >= 2;
+		aNeedsExtension = !core;
+
+		if( !core && !get_device_extensions( aPhysicalDev ).count( VK_KHR_TIMELINE_SEMAPHORE_EXTENSION_NAME ) )
+			return false;
+
+		VkPhysicalDeviceTimelineSemaphoreFeatures timelineFeatures{};
+		timelineFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_TIMELINE_SEMAPHORE_FEATURES;
+
+		VkPhysicalDeviceFeatures2 features{};
+		features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+		features.pNext = &timelineFeatures;
+
+		vkGetPhysicalDeviceFeatures2( aPhysicalDev, &features );
+
+		return VK_TRUE == timelineFeatures.timelineSemaphore;
+	}
 }
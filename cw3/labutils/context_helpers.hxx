@@ -30,5 +30,11 @@ namespace labutils
 
 
 		std::unordered_set<std::string> get_device_extensions( VkPhysicalDevice );
+
+		// Timeline semaphores (see Timeline) are required. They are core in
+		// Vulkan 1.2, and otherwise provided by VK_KHR_timeline_semaphore.
+		// Returns false if the device supports neither; aNeedsExtension is
+		// set if the extension must be enabled.
+		bool supports_timeline_semaphores( VkPhysicalDevice, bool& aNeedsExtension );
 	}
 }
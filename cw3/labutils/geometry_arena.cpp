@@ -0,0 +1,144 @@
+#include "geometry_arena.hpp"
+
+#include <utility>
+#include <iterator>
+
+#include <cassert>
+
+#include "error.hpp"
+
+namespace labutils
+{
+	RangeAllocator::RangeAllocator( VkDeviceSize aCapacity )
+		: mCapacity( aCapacity )
+	{
+		if( aCapacity > 0 )
+			mFree.emplace( 0, aCapacity );
+	}
+
+	std::optional<VkDeviceSize> RangeAllocator::allocate( VkDeviceSize aSize, VkDeviceSize aAlignment )
+	{
+		assert( aAlignment > 0 );
+
+		if( 0 == aSize )
+			return 0;
+
+		for( auto it = mFree.begin(); it != mFree.end(); ++it )
+		{
+			auto const [freeOffset, freeSize] = *it;
+
+			auto const offset = (freeOffset + aAlignment - 1) / aAlignment * aAlignment;
+			auto const padding = offset - freeOffset;
+			if( freeSize < padding + aSize )
+				continue;
+
+			// Keep the padding before and the rest after the new range
+			mFree.erase( it );
+			if( padding > 0 )
+				mFree.emplace( freeOffset, padding );
+			if( auto const rest = freeSize - padding - aSize; rest > 0 )
+				mFree.emplace( offset + aSize, rest );
+
+			mUsed += aSize;
+			return offset;
+		}
+
+		return {};
+	}
+
+	void RangeAllocator::free( VkDeviceSize aOffset, VkDeviceSize aSize )
+	{
+		if( 0 == aSize )
+			return;
+
+		assert( aOffset + aSize <= mCapacity );
+		assert( mUsed >= aSize );
+		mUsed -= aSize;
+
+		auto [it, inserted] = mFree.emplace( aOffset, aSize );
+		assert( inserted );
+		(void)inserted;
+
+		// Merge with the following free range
+		if( auto next = std::next( it ); next != mFree.end() && it->first + it->second == next->first )
+		{
+			it->second += next->second;
+			mFree.erase( next );
+		}
+
+		// Merge with the preceding free range
+		if( it != mFree.begin() )
+		{
+			if( auto prev = std::prev( it ); prev->first + prev->second == it->first )
+			{
+				prev->second += it->second;
+				mFree.erase( it );
+			}
+		}
+	}
+
+	VkDeviceSize RangeAllocator::capacity() const noexcept
+	{
+		return mCapacity;
+	}
+	VkDeviceSize RangeAllocator::used() const noexcept
+	{
+		return mUsed;
+	}
+}
+
+namespace labutils
+{
+	GeometryArena::GeometryArena( Allocator const& aAllocator, std::vector<VkDeviceSize> aAttributeStrides, VkDeviceSize aVertexCapacity, VkDeviceSize aIndexCapacity )
+		: strides( std::move(aAttributeStrides) )
+		, mVertices( aVertexCapacity )
+		, mIndices( aIndexCapacity )
+	{
+		for( auto const stride : strides )
+		{
+			attributes.emplace_back( create_buffer(
+				aAllocator,
+				aVertexCapacity * stride,
+				VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+				VMA_MEMORY_USAGE_GPU_ONLY
+			) );
+		}
+
+		indices = create_buffer(
+			aAllocator,
+			aIndexCapacity,
+			VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+			VMA_MEMORY_USAGE_GPU_ONLY
+		);
+	}
+
+	GeometryRange GeometryArena::allocate( std::uint32_t aVertexCount, VkDeviceSize aIndexBytes, VkDeviceSize aIndexSize )
+	{
+		std::scoped_lock lock( mMutex );
+
+		auto const vertexOffset = mVertices.allocate( aVertexCount );
+		if( !vertexOffset )
+		{
+			throw Error( "Geometry arena: out of vertex space (%u vertices requested, %llu of %llu in use)",
+				aVertexCount, (unsigned long long)mVertices.used(), (unsigned long long)mVertices.capacity() );
+		}
+
+		auto const indexOffset = mIndices.allocate( aIndexBytes, aIndexSize );
+		if( !indexOffset )
+		{
+			mVertices.free( *vertexOffset, aVertexCount );
+			throw Error( "Geometry arena: out of index space (%llu bytes requested, %llu of %llu in use)",
+				(unsigned long long)aIndexBytes, (unsigned long long)mIndices.used(), (unsigned long long)mIndices.capacity() );
+		}
+
+		return { std::uint32_t(*vertexOffset), aVertexCount, *indexOffset, aIndexBytes };
+	}
+
+	void GeometryArena::free( GeometryRange const& aRange )
+	{
+		std::scoped_lock lock( mMutex );
+
+		mVertices.free( aRange.vertexOffset, aRange.vertexCount );
+		mIndices.free( aRange.indexOffset, aRange.indexBytes );
+	}
+}
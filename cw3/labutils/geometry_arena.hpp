@@ -0,0 +1,98 @@
+#pragma once
+
+#include <volk/volk.h>
+
+#include <map>
+#include <mutex>
+#include <vector>
+#include <optional>
+
+#include <cstdint>
+
+#include "vkbuffer.hpp"
+#include "allocator.hpp"
+
+namespace labutils
+{
+	// First-fit allocator of ranges within [0, capacity). The units are up to
+	// the user (e.g. vertices or bytes). Free ranges are kept sorted by their
+	// offset, and are merged with their neighbours when released. Not
+	// thread-safe.
+	class RangeAllocator
+	{
+		public:
+			explicit RangeAllocator( VkDeviceSize aCapacity = 0 );
+
+		public:
+			// Returns the offset of a new range of aSize units, aligned to
+			// aAlignment, or an empty optional if no free range is large
+			// enough.
+			std::optional<VkDeviceSize> allocate( VkDeviceSize aSize, VkDeviceSize aAlignment = 1 );
+
+			// Releases a range returned by allocate().
+			void free( VkDeviceSize aOffset, VkDeviceSize aSize );
+
+			VkDeviceSize capacity() const noexcept;
+			VkDeviceSize used() const noexcept;
+
+		private:
+			std::map<VkDeviceSize, VkDeviceSize> mFree; // offset -> size
+			VkDeviceSize mCapacity = 0;
+			VkDeviceSize mUsed = 0;
+	};
+
+
+	// Location of a mesh within a GeometryArena. The vertices of the mesh
+	// start at vertexOffset in each of the attribute buffers; its indices
+	// occupy indexBytes bytes at indexOffset in the index buffer.
+	struct GeometryRange
+	{
+		std::uint32_t vertexOffset = 0;
+		std::uint32_t vertexCount = 0;
+		VkDeviceSize indexOffset = 0;
+		VkDeviceSize indexBytes = 0;
+	};
+
+	// Device-local vertex and index storage shared by many meshes. Each vertex
+	// attribute lives in its own buffer, and all meshes share a single index
+	// buffer. A mesh is thus drawn by binding the buffers once and passing
+	// the offsets from its GeometryRange to vkCmdDrawIndexed() (vertexOffset,
+	// and firstIndex = indexOffset / index size).
+	//
+	// allocate() and free() may be called from several threads. Filling the
+	// allocated ranges (e.g. with vkCmdCopyBuffer()) is up to the user.
+	class GeometryArena
+	{
+		public:
+			// Creates one buffer of aVertexCapacity elements for each of the
+			// attribute strides (in bytes) and an index buffer of
+			// aIndexCapacity bytes.
+			GeometryArena( Allocator const&, std::vector<VkDeviceSize> aAttributeStrides, VkDeviceSize aVertexCapacity, VkDeviceSize aIndexCapacity );
+
+			GeometryArena( GeometryArena const& ) = delete;
+			GeometryArena& operator= (GeometryArena const&) = delete;
+
+		public:
+			// Allocates aVertexCount vertices and aIndexBytes bytes of
+			// indices. The index range is aligned to aIndexSize (2 or 4), so
+			// that it starts at a whole index. Throws an Error if the arena
+			// is full.
+			GeometryRange allocate( std::uint32_t aVertexCount, VkDeviceSize aIndexBytes, VkDeviceSize aIndexSize );
+
+			// Releases a range returned by allocate(). The caller must ensure
+			// that the GPU no longer uses it.
+			void free( GeometryRange const& );
+
+		public:
+			std::vector<Buffer> attributes;
+			std::vector<VkDeviceSize> strides;
+			Buffer indices;
+
+		private:
+			std::mutex mMutex;
+			RangeAllocator mVertices;
+			RangeAllocator mIndices;
+	};
+}
+
+//EOF vim:syntax=cpp:foldmethod=marker:ts=4:noexpandtab:
@@ -0,0 +1,129 @@
+#include "mapped_file.hpp"
+
+#include <utility>
+
+#include <cassert>
+
+#if defined(_WIN32)
+#	if !defined(WIN32_LEAN_AND_MEAN)
+#		define WIN32_LEAN_AND_MEAN 1
+#	endif
+#	if !defined(NOMINMAX)
+#		define NOMINMAX 1
+#	endif
+#	include <windows.h>
+#else // !_WIN32
+#	include <fcntl.h>
+#	include <unistd.h>
+#	include <sys/mman.h>
+#	include <sys/stat.h>
+#endif // ~ _WIN32
+
+#include "error.hpp"
+
+namespace labutils
+{
+	MappedFile::MappedFile() noexcept = default;
+
+	MappedFile::~MappedFile()
+	{
+#		if defined(_WIN32)
+		if( data )
+			UnmapViewOfFile( data );
+		if( mMapping )
+			CloseHandle( mMapping );
+#		else // !_WIN32
+		if( data )
+			munmap( const_cast<void*>(data), size );
+#		endif // ~ _WIN32
+	}
+
+	MappedFile::MappedFile( MappedFile&& aOther ) noexcept
+		: data( std::exchange( aOther.data, nullptr ) )
+		, size( std::exchange( aOther.size, 0 ) )
+		, mMapping( std::exchange( aOther.mMapping, nullptr ) )
+	{}
+	MappedFile& MappedFile::operator=( MappedFile&& aOther ) noexcept
+	{
+		std::swap( data, aOther.data );
+		std::swap( size, aOther.size );
+		std::swap( mMapping, aOther.mMapping );
+		return *this;
+	}
+}
+
+namespace labutils
+{
+	MappedFile map_file( char const* aPath )
+	{
+		assert( aPath );
+
+		MappedFile ret;
+
+#		if defined(_WIN32)
+		HANDLE file = CreateFileA( aPath, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr );
+		if( INVALID_HANDLE_VALUE == file )
+			throw Error( "Unable to open '%s' for mapping (GetLastError() = %lu)", aPath, GetLastError() );
+
+		LARGE_INTEGER fileSize{};
+		if( !GetFileSizeEx( file, &fileSize ) )
+		{
+			auto const err = GetLastError();
+			CloseHandle( file );
+			throw Error( "Unable to get size of '%s' (GetLastError() = %lu)", aPath, err );
+		}
+
+		if( 0 == fileSize.QuadPart )
+		{
+			CloseHandle( file );
+			return ret;
+		}
+
+		// The mapping object keeps the file open; the file handle itself is
+		// no longer needed once the mapping exists.
+		HANDLE mapping = CreateFileMappingA( file, nullptr, PAGE_READONLY, 0, 0, nullptr );
+		CloseHandle( file );
+
+		if( !mapping )
+			throw Error( "Unable to map '%s' (GetLastError() = %lu)", aPath, GetLastError() );
+
+		ret.mMapping = mapping;
+		ret.size = std::size_t(fileSize.QuadPart);
+		ret.data = MapViewOfFile( mapping, FILE_MAP_READ, 0, 0, 0 );
+
+		if( !ret.data )
+			throw Error( "Unable to map view of '%s' (GetLastError() = %lu)", aPath, GetLastError() );
+#		else // !_WIN32
+		int const fd = open( aPath, O_RDONLY );
+		if( -1 == fd )
+			throw Error( "Unable to open '%s' for mapping", aPath );
+
+		struct stat st{};
+		if( 0 != fstat( fd, &st ) )
+		{
+			close( fd );
+			throw Error( "Unable to get size of '%s'", aPath );
+		}
+
+		if( 0 == st.st_size )
+		{
+			close( fd );
+			return ret;
+		}
+
+		// The mapping stays valid after the file descriptor is closed.
+		void* ptr = mmap( nullptr, std::size_t(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0 );
+		close( fd );
+
+		if( MAP_FAILED == ptr )
+			throw Error( "Unable to map '%s'", aPath );
+
+		ret.data = ptr;
+		ret.size = std::size_t(st.st_size);
+#		endif // ~ _WIN32
+
+		return ret;
+	}
+}
+
+//EOF vim:syntax=cpp:foldmethod=marker:ts=4:noexpandtab: 
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <utility>
+
+#include <cstddef>
+
+namespace labutils
+{
+	// Read-only memory mapping of a whole file. Like the other labutils
+	// wrappers, MappedFile is move-only and releases the mapping when it goes
+	// out of scope.
+	class MappedFile
+	{
+		public:
+			MappedFile() noexcept, ~MappedFile();
+
+			MappedFile( MappedFile const& ) = delete;
+			MappedFile& operator= (MappedFile const&) = delete;
+
+			MappedFile( MappedFile&& ) noexcept;
+			MappedFile& operator = (MappedFile&&) noexcept;
+
+		public:
+			void const* data = nullptr;
+			std::size_t size = 0;
+
+		private:
+			friend MappedFile map_file( char const* );
+
+			// Platform handle for the mapping object (Windows only)
+			void* mMapping = nullptr;
+	};
+
+	// Maps the file at aPath. Throws an Error if the file cannot be opened or
+	// mapped. An empty file results in a MappedFile with data == nullptr.
+	MappedFile map_file( char const* aPath );
+}
+
+//EOF vim:syntax=cpp:foldmethod=marker:ts=4:noexpandtab: 
@@ -0,0 +1,343 @@
+#include "mipmap.hpp"
+
+#include <algorithm>
+
+#include <cmath>
+#include <cassert>
+#include <cstddef>
+
+#include "parallel_for.hpp"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#	define LUT_MIPMAP_SSE2 1
+#	include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(_M_ARM64)
+#	define LUT_MIPMAP_NEON 1
+#	include <arm_neon.h>
+#endif
+
+namespace
+{
+	// One RGBA pixel in linear space. The filters weight whole pixels, so a
+	// pixel maps naturally onto one 128-bit register.
+	struct Pixel_
+	{
+#		if defined(LUT_MIPMAP_SSE2)
+		__m128 v;
+#		elif defined(LUT_MIPMAP_NEON)
+		float32x4_t v;
+#		else
+		float v[4];
+#		endif
+	};
+
+#	if defined(LUT_MIPMAP_SSE2)
+	inline Pixel_ load_( float const* aPtr ) noexcept { return { _mm_loadu_ps( aPtr ) }; }
+	inline void store_( float* aPtr, Pixel_ aPixel ) noexcept { _mm_storeu_ps( aPtr, aPixel.v ); }
+	inline Pixel_ zero_() noexcept { return { _mm_setzero_ps() }; }
+	inline Pixel_ madd_( Pixel_ aAcc, Pixel_ aPixel, float aWeight ) noexcept
+	{
+		return { _mm_add_ps( aAcc.v, _mm_mul_ps( aPixel.v, _mm_set1_ps( aWeight ) ) ) };
+	}
+	inline Pixel_ saturate_( Pixel_ aPixel ) noexcept
+	{
+		return { _mm_min_ps( _mm_max_ps( aPixel.v, _mm_setzero_ps() ), _mm_set1_ps( 1.f ) ) };
+	}
+#	elif defined(LUT_MIPMAP_NEON)
+	inline Pixel_ load_( float const* aPtr ) noexcept { return { vld1q_f32( aPtr ) }; }
+	inline void store_( float* aPtr, Pixel_ aPixel ) noexcept { vst1q_f32( aPtr, aPixel.v ); }
+	inline Pixel_ zero_() noexcept { return { vdupq_n_f32( 0.f ) }; }
+	inline Pixel_ madd_( Pixel_ aAcc, Pixel_ aPixel, float aWeight ) noexcept
+	{
+		return { vmlaq_n_f32( aAcc.v, aPixel.v, aWeight ) };
+	}
+	inline Pixel_ saturate_( Pixel_ aPixel ) noexcept
+	{
+		return { vminq_f32( vmaxq_f32( aPixel.v, vdupq_n_f32( 0.f ) ), vdupq_n_f32( 1.f ) ) };
+	}
+#	else // scalar
+	inline Pixel_ load_( float const* aPtr ) noexcept { return { { aPtr[0], aPtr[1], aPtr[2], aPtr[3] } }; }
+	inline void store_( float* aPtr, Pixel_ aPixel ) noexcept { std::copy( aPixel.v, aPixel.v+4, aPtr ); }
+	inline Pixel_ zero_() noexcept { return {}; }
+	inline Pixel_ madd_( Pixel_ aAcc, Pixel_ aPixel, float aWeight ) noexcept
+	{
+		for( std::size_t i = 0; i < 4; ++i )
+			aAcc.v[i] += aPixel.v[i] * aWeight;
+		return aAcc;
+	}
+	inline Pixel_ saturate_( Pixel_ aPixel ) noexcept
+	{
+		for( auto& x : aPixel.v )
+			x = std::clamp( x, 0.f, 1.f );
+		return aPixel;
+	}
+#	endif // ~ SIMD
+
+
+	// Conversion between 8-bit sRGB values and linear floats. Linear values
+	// are converted back via a table indexed by the value at 16 bits. The
+	// table is filled by searching the midpoints between the linear values of
+	// neighbouring sRGB codes, so each entry is the nearest code.
+	struct SrgbTables_
+	{
+		static constexpr std::size_t kLinearSteps = 1 << 16;
+
+		float toLinear[256];
+		std::uint8_t fromLinear[kLinearSteps];
+
+		SrgbTables_() noexcept
+		{
+			for( std::size_t i = 0; i < 256; ++i )
+			{
+				float const c = float(i) / 255.f;
+				toLinear[i] = c <= 0.04045f ? c / 12.92f : std::pow( (c + 0.055f) / 1.055f, 2.4f );
+			}
+
+			float midpoints[255];
+			for( std::size_t i = 0; i < 255; ++i )
+				midpoints[i] = .5f * (toLinear[i] + toLinear[i+1]);
+
+			for( std::size_t i = 0; i < kLinearSteps; ++i )
+			{
+				float const linear = float(i) / float(kLinearSteps-1);
+				fromLinear[i] = std::uint8_t(std::upper_bound( midpoints, midpoints+255, linear ) - midpoints);
+			}
+		}
+	};
+
+	SrgbTables_ const& srgb_tables_() noexcept
+	{
+		static SrgbTables_ const tables;
+		return tables;
+	}
+
+
+	// Calls aFunc(begin, end) over row ranges of [0, aRows), in parallel if
+	// there are enough pixels to make that worthwhile.
+	constexpr std::size_t kMinPixelsPerTask = 64*1024;
+
+	template< typename tFunc >
+	void for_rows_( std::uint32_t aRows, std::uint32_t aWidth, tFunc const& aFunc )
+	{
+		std::size_t const rowsPerTask = std::max<std::size_t>( 1, kMinPixelsPerTask / std::max( aWidth, 1u ) );
+		std::size_t const tasks = (aRows + rowsPerTask - 1) / rowsPerTask;
+
+		if( tasks <= 1 )
+		{
+			aFunc( std::uint32_t(0), aRows );
+			return;
+		}
+
+		labutils::parallel_for( tasks, [&] (std::size_t aTask) {
+			auto const begin = std::uint32_t(aTask * rowsPerTask);
+			auto const end = std::uint32_t(std::min<std::size_t>( aRows, begin + rowsPerTask ));
+			aFunc( begin, end );
+		} );
+	}
+
+
+	// The taps of a separable filter for one output pixel. Sources outside of
+	// the image are clamped to the edge, i.e., their weight goes to the edge
+	// pixel.
+	struct Taps_
+	{
+		std::uint32_t first;
+		std::vector<float> weights;
+	};
+
+	// Kaiser window with the given support, as in NVIDIA Texture Tools
+	constexpr float kKaiserRadius = 3.f; // in destination pixels
+	constexpr float kKaiserAlpha = 4.f;
+
+	float bessel_i0_( float aX ) noexcept
+	{
+		// Power series; converges quickly for the small arguments used here
+		float sum = 1.f, term = 1.f;
+		for( int k = 1; k < 32 && term > sum * 1e-7f; ++k )
+		{
+			float const t = aX / (2.f * float(k));
+			term *= t * t;
+			sum += term;
+		}
+		return sum;
+	}
+
+	float kaiser_( float aT ) noexcept
+	{
+		float const x = aT / kKaiserRadius;
+		if( x <= -1.f || x >= 1.f )
+			return 0.f;
+
+		float const sinc = 0.f == aT ? 1.f : std::sin( 3.14159265f * aT ) / (3.14159265f * aT);
+		return sinc * bessel_i0_( kKaiserAlpha * std::sqrt( 1.f - x*x ) ) / bessel_i0_( kKaiserAlpha );
+	}
+
+	std::vector<Taps_> kaiser_taps_( std::uint32_t aSrcSize, std::uint32_t aDstSize )
+	{
+		float const scale = float(aSrcSize) / float(aDstSize);
+		float const radius = kKaiserRadius * scale;
+
+		std::vector<Taps_> ret( aDstSize );
+		for( std::uint32_t i = 0; i < aDstSize; ++i )
+		{
+			float const center = (float(i) + .5f) * scale;
+			auto const lo = std::int64_t(std::floor( center - radius ));
+			auto const hi = std::int64_t(std::ceil( center + radius ));
+
+			auto const first = std::clamp<std::int64_t>( lo, 0, aSrcSize-1 );
+			auto const last = std::clamp<std::int64_t>( hi, 0, aSrcSize-1 );
+
+			auto& taps = ret[i];
+			taps.first = std::uint32_t(first);
+			taps.weights.assign( std::size_t(last - first + 1), 0.f );
+
+			float total = 0.f;
+			for( std::int64_t j = lo; j <= hi; ++j )
+			{
+				float const w = kaiser_( (float(j) + .5f - center) / scale );
+				taps.weights[std::size_t(std::clamp<std::int64_t>( j, first, last ) - first)] += w;
+				total += w;
+			}
+
+			for( auto& w : taps.weights )
+				w /= total;
+		}
+
+		return ret;
+	}
+
+
+	// Level computation. Images are linear RGBA floats, four per pixel.
+	void downsample_box_( float const* aSrc, std::uint32_t aWidth, std::uint32_t aHeight, float* aDst, std::uint32_t aDstWidth, std::uint32_t aDstHeight )
+	{
+		for_rows_( aDstHeight, aDstWidth, [&] (std::uint32_t aBegin, std::uint32_t aEnd) {
+			for( std::uint32_t y = aBegin; y < aEnd; ++y )
+			{
+				// Clamp for sources that are a single pixel high/wide
+				std::uint32_t const y0 = std::min( 2*y, aHeight-1 ), y1 = std::min( 2*y+1, aHeight-1 );
+
+				for( std::uint32_t x = 0; x < aDstWidth; ++x )
+				{
+					std::uint32_t const x0 = std::min( 2*x, aWidth-1 ), x1 = std::min( 2*x+1, aWidth-1 );
+
+					Pixel_ sum = zero_();
+					sum = madd_( sum, load_( aSrc + (std::size_t(y0)*aWidth + x0) * 4 ), .25f );
+					sum = madd_( sum, load_( aSrc + (std::size_t(y0)*aWidth + x1) * 4 ), .25f );
+					sum = madd_( sum, load_( aSrc + (std::size_t(y1)*aWidth + x0) * 4 ), .25f );
+					sum = madd_( sum, load_( aSrc + (std::size_t(y1)*aWidth + x1) * 4 ), .25f );
+					store_( aDst + (std::size_t(y)*aDstWidth + x) * 4, sum );
+				}
+			}
+		} );
+	}
+
+	void downsample_kaiser_( float const* aSrc, std::uint32_t aWidth, std::uint32_t aHeight, float* aDst, std::uint32_t aDstWidth, std::uint32_t aDstHeight, std::vector<float>& aScratch )
+	{
+		auto const horizontal = kaiser_taps_( aWidth, aDstWidth );
+		auto const vertical = kaiser_taps_( aHeight, aDstHeight );
+
+		// Horizontal pass: aDstWidth x aHeight
+		aScratch.resize( std::size_t(aDstWidth) * aHeight * 4 );
+		float* tmp = aScratch.data();
+
+		for_rows_( aHeight, aDstWidth, [&] (std::uint32_t aBegin, std::uint32_t aEnd) {
+			for( std::uint32_t y = aBegin; y < aEnd; ++y )
+			{
+				float const* row = aSrc + std::size_t(y)*aWidth*4;
+				for( std::uint32_t x = 0; x < aDstWidth; ++x )
+				{
+					auto const& taps = horizontal[x];
+
+					Pixel_ sum = zero_();
+					for( std::size_t i = 0; i < taps.weights.size(); ++i )
+						sum = madd_( sum, load_( row + (taps.first + i) * 4 ), taps.weights[i] );
+
+					store_( tmp + (std::size_t(y)*aDstWidth + x) * 4, sum );
+				}
+			}
+		} );
+
+		// Vertical pass. The negative lobes of the filter can overshoot.
+		for_rows_( aDstHeight, aDstWidth, [&] (std::uint32_t aBegin, std::uint32_t aEnd) {
+			for( std::uint32_t y = aBegin; y < aEnd; ++y )
+			{
+				auto const& taps = vertical[y];
+				for( std::uint32_t x = 0; x < aDstWidth; ++x )
+				{
+					Pixel_ sum = zero_();
+					for( std::size_t i = 0; i < taps.weights.size(); ++i )
+						sum = madd_( sum, load_( tmp + ((taps.first + i)*aDstWidth + x) * 4 ), taps.weights[i] );
+
+					store_( aDst + (std::size_t(y)*aDstWidth + x) * 4, saturate_( sum ) );
+				}
+			}
+		} );
+	}
+
+	void to_srgb_( float const* aSrc, std::uint32_t aWidth, std::uint32_t aHeight, std::uint8_t* aDst )
+	{
+		auto const& tables = srgb_tables_();
+		constexpr float kScale = float(SrgbTables_::kLinearSteps - 1);
+
+		for_rows_( aHeight, aWidth, [&] (std::uint32_t aBegin, std::uint32_t aEnd) {
+			for( std::size_t i = std::size_t(aBegin)*aWidth; i < std::size_t(aEnd)*aWidth; ++i )
+			{
+				float const* src = aSrc + i*4;
+				std::uint8_t* dst = aDst + i*4;
+
+				for( std::size_t ch = 0; ch < 3; ++ch )
+					dst[ch] = tables.fromLinear[std::size_t(src[ch] * kScale + .5f)];
+
+				dst[3] = std::uint8_t(src[3] * 255.f + .5f);
+			}
+		} );
+	}
+}
+
+namespace labutils
+{
+	void generate_mip_chain_srgb_rgba8( std::uint8_t const* aBase, std::uint32_t aWidth, std::uint32_t aHeight, MipFilter aFilter, void* aDst, std::vector<std::uint64_t> const& aLevelOffsets )
+	{
+		assert( aWidth > 0 && aHeight > 0 );
+		if( aLevelOffsets.size() <= 1 )
+			return;
+
+		auto const& tables = srgb_tables_();
+
+		// Convert base level to linear
+		std::vector<float> src( std::size_t(aWidth) * aHeight * 4 );
+		for_rows_( aHeight, aWidth, [&] (std::uint32_t aBegin, std::uint32_t aEnd) {
+			for( std::size_t i = std::size_t(aBegin)*aWidth*4; i < std::size_t(aEnd)*aWidth*4; i += 4 )
+			{
+				src[i+0] = tables.toLinear[aBase[i+0]];
+				src[i+1] = tables.toLinear[aBase[i+1]];
+				src[i+2] = tables.toLinear[aBase[i+2]];
+				src[i+3] = float(aBase[i+3]) / 255.f;
+			}
+		} );
+
+		// Each level is computed from the previous one
+		std::vector<float> dst, scratch;
+
+		std::uint32_t width = aWidth, height = aHeight;
+		for( std::size_t i = 1; i < aLevelOffsets.size(); ++i )
+		{
+			std::uint32_t const dstWidth = std::max( width / 2, 1u );
+			std::uint32_t const dstHeight = std::max( height / 2, 1u );
+
+			dst.resize( std::size_t(dstWidth) * dstHeight * 4 );
+			if( MipFilter::kaiser == aFilter )
+				downsample_kaiser_( src.data(), width, height, dst.data(), dstWidth, dstHeight, scratch );
+			else
+				downsample_box_( src.data(), width, height, dst.data(), dstWidth, dstHeight );
+
+			to_srgb_( dst.data(), dstWidth, dstHeight, static_cast<std::uint8_t*>(aDst) + aLevelOffsets[i] );
+
+			std::swap( src, dst );
+			width = dstWidth;
+			height = dstHeight;
+		}
+	}
+}
+
+//EOF vim:syntax=cpp:foldmethod=marker:ts=4:noexpandtab:
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <vector>
+
+#include <cstdint>
+
+namespace labutils
+{
+	// Filters for generating mip levels. box averages 2x2 blocks of pixels,
+	// like a linear vkCmdBlitImage() does. kaiser is a Kaiser-windowed sinc,
+	// which keeps more detail and aliases less, at a higher cost.
+	enum class MipFilter
+	{
+		box,
+		kaiser
+	};
+
+	// Generates the mip chain of the aWidth x aHeight sRGB RGBA8 image at
+	// aBase. Level i (for i >= 1) is written to aDst + aLevelOffsets[i], i.e.,
+	// aLevelOffsets has one entry per level, including the base level, which
+	// is not written. aDst is only written to, never read, so it may point to
+	// write-combined staging memory.
+	//
+	// Levels are computed in linear space from the previous level, at float
+	// precision; alpha is treated as linear. Large levels are split across
+	// threads.
+	void generate_mip_chain_srgb_rgba8( std::uint8_t const* aBase, std::uint32_t aWidth, std::uint32_t aHeight,
+		MipFilter, void* aDst, std::vector<std::uint64_t> const& aLevelOffsets );
+}
+
+//EOF vim:syntax=cpp:foldmethod=marker:ts=4:noexpandtab:
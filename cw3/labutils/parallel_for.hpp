@@ -0,0 +1,45 @@
+#pragma once
+
+#include <atomic>
+#include <thread>
+#include <vector>
+#include <algorithm>
+
+#include <cstddef>
+
+namespace labutils
+{
+	namespace detail
+	{
+		// Set on the workers of a ThreadPool
+		inline thread_local bool tIsWorkerThread = false;
+	}
+
+	// Calls aFunc(i) for i in [0, aCount), spread over up to one thread per
+	// hardware thread. The calling thread takes part. Items are handed out
+	// one at a time, so a few items per thread even out uneven work. On a
+	// ThreadPool worker, all items run on the calling thread.
+	template< typename tFunc >
+	void parallel_for( std::size_t aCount, tFunc const& aFunc )
+	{
+		std::size_t const hwThreads = detail::tIsWorkerThread ? 1 : std::max( 1u, std::thread::hardware_concurrency() );
+		std::size_t const threadCount = std::min( aCount, hwThreads );
+
+		std::atomic<std::size_t> next{ 0 };
+		auto const worker = [&] {
+			for( std::size_t i; (i = next.fetch_add( 1 )) < aCount; )
+				aFunc( i );
+		};
+
+		std::vector<std::thread> threads;
+		for( std::size_t i = 1; i < threadCount; ++i )
+			threads.emplace_back( worker );
+
+		worker();
+
+		for( auto& thread : threads )
+			thread.join();
+	}
+}
+
+//EOF vim:syntax=cpp:foldmethod=marker:ts=4:noexpandtab:
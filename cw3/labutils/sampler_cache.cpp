@@ -0,0 +1,120 @@
+#include "sampler_cache.hpp"
+
+#include <cstdint>
+#include <cstring>
+
+#include "error.hpp"
+#include "vkutil.hpp"
+
+namespace
+{
+	// Floats are compared and hashed by their bits, such that the two always
+	// agree (e.g. for 0.f and -0.f).
+	std::uint32_t bits_( float aValue ) noexcept
+	{
+		std::uint32_t ret;
+		std::memcpy( &ret, &aValue, sizeof(ret) );
+		return ret;
+	}
+
+	void hash_combine_( std::size_t& aSeed, std::uint32_t aValue ) noexcept
+	{
+		aSeed ^= std::size_t(aValue) + 0x9e3779b9u + (aSeed << 6) + (aSeed >> 2);
+	}
+}
+
+namespace labutils
+{
+	SamplerCache::SamplerCache( VulkanContext const& aContext )
+		: mContext( aContext )
+	{}
+
+
+	std::shared_ptr<Sampler const> SamplerCache::get( VkSamplerCreateInfo const& aInfo )
+	{
+		if( aInfo.pNext )
+			throw Error( "SamplerCache: VkSamplerCreateInfo::pNext must be null" );
+
+		Key_ const key{
+			aInfo.flags,
+			aInfo.magFilter, aInfo.minFilter,
+			aInfo.mipmapMode,
+			aInfo.addressModeU, aInfo.addressModeV, aInfo.addressModeW,
+			aInfo.mipLodBias,
+			aInfo.anisotropyEnable,
+			aInfo.maxAnisotropy,
+			aInfo.compareEnable,
+			aInfo.compareOp,
+			aInfo.minLod, aInfo.maxLod,
+			aInfo.borderColor,
+			aInfo.unnormalizedCoordinates
+		};
+
+		std::lock_guard<std::mutex> lock( mMutex );
+		++mRequests;
+
+		auto& slot = mSamplers[key];
+		if( !slot )
+			slot = std::make_shared<Sampler const>( create_sampler( mContext, aInfo ) );
+
+		return slot;
+	}
+
+	std::shared_ptr<Sampler const> SamplerCache::get_default( VkBool32 aUseAnisotropy )
+	{
+		return get( default_sampler_info( mContext, aUseAnisotropy ) );
+	}
+
+	std::size_t SamplerCache::requests() const
+	{
+		std::lock_guard<std::mutex> lock( mMutex );
+		return mRequests;
+	}
+	std::size_t SamplerCache::created() const
+	{
+		std::lock_guard<std::mutex> lock( mMutex );
+		return mSamplers.size();
+	}
+
+
+	bool SamplerCache::Key_::operator== (Key_ const& aOther) const noexcept
+	{
+		return flags == aOther.flags
+			&& magFilter == aOther.magFilter && minFilter == aOther.minFilter
+			&& mipmapMode == aOther.mipmapMode
+			&& addressModeU == aOther.addressModeU && addressModeV == aOther.addressModeV && addressModeW == aOther.addressModeW
+			&& bits_( mipLodBias ) == bits_( aOther.mipLodBias )
+			&& anisotropyEnable == aOther.anisotropyEnable
+			&& bits_( maxAnisotropy ) == bits_( aOther.maxAnisotropy )
+			&& compareEnable == aOther.compareEnable
+			&& compareOp == aOther.compareOp
+			&& bits_( minLod ) == bits_( aOther.minLod ) && bits_( maxLod ) == bits_( aOther.maxLod )
+			&& borderColor == aOther.borderColor
+			&& unnormalizedCoordinates == aOther.unnormalizedCoordinates
+		;
+	}
+
+	std::size_t SamplerCache::KeyHash_::operator() (Key_ const& aKey) const noexcept
+	{
+		std::size_t seed = 0;
+		hash_combine_( seed, aKey.flags );
+		hash_combine_( seed, std::uint32_t(aKey.magFilter) );
+		hash_combine_( seed, std::uint32_t(aKey.minFilter) );
+		hash_combine_( seed, std::uint32_t(aKey.mipmapMode) );
+		hash_combine_( seed, std::uint32_t(aKey.addressModeU) );
+		hash_combine_( seed, std::uint32_t(aKey.addressModeV) );
+		hash_combine_( seed, std::uint32_t(aKey.addressModeW) );
+		hash_combine_( seed, bits_( aKey.mipLodBias ) );
+		hash_combine_( seed, aKey.anisotropyEnable );
+		hash_combine_( seed, bits_( aKey.maxAnisotropy ) );
+		hash_combine_( seed, aKey.compareEnable );
+		hash_combine_( seed, std::uint32_t(aKey.compareOp) );
+		hash_combine_( seed, bits_( aKey.minLod ) );
+		hash_combine_( seed, bits_( aKey.maxLod ) );
+		hash_combine_( seed, std::uint32_t(aKey.borderColor) );
+		hash_combine_( seed, aKey.unnormalizedCoordinates );
+		return seed;
+	}
+}
+
+//EOF vim:syntax=cpp:foldmethod=marker:ts=4:noexpandtab:
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <volk/volk.h>
+
+#include <mutex>
+#include <memory>
+#include <unordered_map>
+
+#include <cstddef>
+
+#include "vkobject.hpp"
+#include "vulkan_context.hpp"
+
+namespace labutils
+{
+	/* Hands out samplers by their creation parameters, such that each
+	 * distinct sampler is created once. Samplers are shared: the cache keeps
+	 * a reference to every sampler it has created, and users hold on to
+	 * theirs, so a sampler lives until both the cache and its last user are
+	 * gone. Devices have a limit on the number of samplers
+	 * (maxSamplerAllocationCount), and only a handful of distinct ones are
+	 * ever needed.
+	 *
+	 * Samplers are keyed on the fields of VkSamplerCreateInfo. Extension
+	 * structures are not supported, i.e., pNext must be null.
+	 *
+	 * The cache is thread safe.
+	 */
+	class SamplerCache
+	{
+		public:
+			// The context must outlive the cache and all samplers from it
+			explicit SamplerCache( VulkanContext const& );
+
+			SamplerCache( SamplerCache const& ) = delete;
+			SamplerCache& operator= (SamplerCache const&) = delete;
+
+		public:
+			std::shared_ptr<Sampler const> get( VkSamplerCreateInfo const& );
+
+			// Sampler with the parameters from default_sampler_info()
+			std::shared_ptr<Sampler const> get_default( VkBool32 aUseAnisotropy );
+
+			// Number of requests, and number of samplers created
+			std::size_t requests() const;
+			std::size_t created() const;
+
+		private:
+			struct Key_
+			{
+				VkSamplerCreateFlags flags;
+				VkFilter magFilter, minFilter;
+				VkSamplerMipmapMode mipmapMode;
+				VkSamplerAddressMode addressModeU, addressModeV, addressModeW;
+				float mipLodBias;
+				VkBool32 anisotropyEnable;
+				float maxAnisotropy;
+				VkBool32 compareEnable;
+				VkCompareOp compareOp;
+				float minLod, maxLod;
+				VkBorderColor borderColor;
+				VkBool32 unnormalizedCoordinates;
+
+				bool operator== (Key_ const&) const noexcept;
+			};
+
+			struct KeyHash_
+			{
+				std::size_t operator() (Key_ const&) const noexcept;
+			};
+
+		private:
+			VulkanContext const& mContext;
+
+			mutable std::mutex mMutex;
+			std::unordered_map<Key_, std::shared_ptr<Sampler const>, KeyHash_> mSamplers;
+			std::size_t mRequests = 0;
+	};
+}
+
+//EOF vim:syntax=cpp:foldmethod=marker:ts=4:noexpandtab:
@@ -0,0 +1,270 @@
+#include "texture_cache.hpp"
+
+#include <limits>
+#include <algorithm>
+#include <filesystem>
+
+#include <cstdio>
+#include <cstring>
+
+#include <stb_image.h>
+
+#include "error.hpp"
+#include "mipmap.hpp"
+#include "vkimage.hpp"
+#include "parallel_for.hpp"
+
+namespace
+{
+	// Increment kTextureVersion whenever the layout below or the encoders
+	// change.
+	constexpr std::uint32_t kTextureMagic = 0x54335743; // 'CW3T'
+	constexpr std::uint32_t kTextureVersion = 2;
+
+	constexpr std::size_t kLevelAlignment = 16;
+
+	// Levels are compressed in bands of about this many pixels
+	constexpr std::uint32_t kBandPixels = 64*1024;
+
+	struct TextureHeader_
+	{
+		std::uint32_t magic;
+		std::uint32_t version;
+		std::uint32_t vkFormat;
+		std::uint32_t width;
+		std::uint32_t height;
+		std::uint32_t levelCount;
+
+		std::uint64_t sourceSize;
+		std::int64_t sourceMtime;
+
+		std::uint64_t reserved;
+	};
+
+	struct TextureLevel_
+	{
+		std::uint64_t byteOffset;
+		std::uint64_t byteLength;
+	};
+
+	// The structures are written to disk as-is. Make sure their layout does not
+	// depend on the compiler.
+	static_assert( sizeof(TextureHeader_) == 48, "Unexpected padding in TextureHeader_" );
+	static_assert( sizeof(TextureLevel_) == 16, "Unexpected padding in TextureLevel_" );
+
+	bool stat_source_( char const* aPath, std::uint64_t& aSize, std::int64_t& aMtime )
+	{
+		std::error_code ec;
+		auto const size = std::filesystem::file_size( aPath, ec );
+		if( ec ) return false;
+
+		auto const mtime = std::filesystem::last_write_time( aPath, ec );
+		if( ec ) return false;
+
+		aSize = size;
+		aMtime = std::int64_t(mtime.time_since_epoch().count());
+		return true;
+	}
+
+	std::size_t align_( std::size_t aOffset ) noexcept
+	{
+		return (aOffset + kLevelAlignment-1) & ~(kLevelAlignment-1);
+	}
+}
+
+namespace labutils
+{
+	VkFormat block_format_srgb( BlockFormat aFormat ) noexcept
+	{
+		switch( aFormat )
+		{
+			case BlockFormat::bc1: return VK_FORMAT_BC1_RGB_SRGB_BLOCK;
+			case BlockFormat::bc3: return VK_FORMAT_BC3_SRGB_BLOCK;
+			case BlockFormat::bc7: return VK_FORMAT_BC7_SRGB_BLOCK;
+		}
+
+		return VK_FORMAT_UNDEFINED;
+	}
+
+	std::string cooked_texture_path( char const* aSourcePath, BlockFormat aFormat )
+	{
+		char const* const kSuffix[] = { ".bc1.cooked", ".bc3.cooked", ".bc7.cooked" };
+		return std::string( aSourcePath ) + kSuffix[std::size_t(aFormat)];
+	}
+
+	std::optional<CookedTexture> load_cooked_texture( char const* aCookedPath, char const* aSourcePath, BlockFormat aFormat ) try
+	{
+		std::error_code ec;
+		if( !std::filesystem::is_regular_file( aCookedPath, ec ) )
+			return {};
+
+		CookedTexture ret;
+		ret.file = map_file( aCookedPath );
+
+		auto const* bytes = static_cast<std::byte const*>(ret.file.data);
+		auto const fileSize = ret.file.size;
+
+		if( fileSize < sizeof(TextureHeader_) )
+			return {};
+
+		TextureHeader_ header;
+		std::memcpy( &header, bytes, sizeof(header) );
+
+		if( kTextureMagic != header.magic || kTextureVersion != header.version )
+			return {};
+		if( std::uint32_t(block_format_srgb( aFormat )) != header.vkFormat )
+			return {};
+		if( 0 == header.width || 0 == header.height || compute_mip_level_count( header.width, header.height ) != header.levelCount )
+			return {};
+
+		// Check that the source is unchanged
+		std::uint64_t sourceSize;
+		std::int64_t sourceMtime;
+		if( !stat_source_( aSourcePath, sourceSize, sourceMtime ) )
+			return {};
+		if( sourceSize != header.sourceSize || sourceMtime != header.sourceMtime )
+			return {};
+
+		// Read level index
+		if( (fileSize - sizeof(TextureHeader_)) / sizeof(TextureLevel_) < header.levelCount )
+			return {};
+
+		ret.format = VkFormat(header.vkFormat);
+		ret.width = header.width;
+		ret.height = header.height;
+
+		for( std::uint32_t level = 0; level < header.levelCount; ++level )
+		{
+			TextureLevel_ entry;
+			std::memcpy( &entry, bytes + sizeof(TextureHeader_) + level*sizeof(TextureLevel_), sizeof(entry) );
+
+			auto const expectedSize = compressed_size( aFormat, std::max( header.width >> level, 1u ), std::max( header.height >> level, 1u ) );
+			if( entry.byteLength != expectedSize || entry.byteOffset % kLevelAlignment )
+				return {};
+			if( entry.byteOffset > fileSize || entry.byteLength > fileSize - entry.byteOffset )
+				return {};
+
+			ret.levels.emplace_back( CookedTexture::Level{ bytes + entry.byteOffset, std::size_t(entry.byteLength) } );
+		}
+
+		return ret;
+	}
+	catch( Error const& )
+	{
+		// Unreadable cooked files are treated like missing ones; the caller
+		// will just cook the texture again.
+		return {};
+	}
+
+	void cook_texture( char const* aSourcePath, char const* aCookedPath, BlockFormat aFormat )
+	{
+		TextureHeader_ header{};
+		header.magic = kTextureMagic;
+		header.version = kTextureVersion;
+		header.vkFormat = std::uint32_t(block_format_srgb( aFormat ));
+
+		if( !stat_source_( aSourcePath, header.sourceSize, header.sourceMtime ) )
+			throw Error( "%s: unable to stat source image", aSourcePath );
+
+		// Decode the source image
+		auto const source = map_file( aSourcePath );
+		if( source.size > std::size_t(std::numeric_limits<int>::max()) )
+			throw Error( "%s: image file too large", aSourcePath );
+
+		int widthi, heighti, channelsi;
+		stbi_uc* data = stbi_load_from_memory( static_cast<stbi_uc const*>(source.data), int(source.size), &widthi, &heighti, &channelsi, 4 /*4 channels = RGBA*/ );
+		if( !data )
+			throw Error( "%s: unable to load image (%s)", aSourcePath, stbi_failure_reason() );
+
+		header.width = std::uint32_t(widthi);
+		header.height = std::uint32_t(heighti);
+		header.levelCount = compute_mip_level_count( header.width, header.height );
+
+		// Generate mip chain
+		std::vector<std::uint64_t> pixelOffsets( header.levelCount );
+		std::size_t pixelBytes = 0;
+		for( std::uint32_t level = 0; level < header.levelCount; ++level )
+		{
+			pixelOffsets[level] = pixelBytes;
+			pixelBytes += std::size_t(std::max( header.width >> level, 1u )) * std::max( header.height >> level, 1u ) * 4;
+		}
+
+		std::vector<std::uint8_t> pixels( pixelBytes );
+		std::memcpy( pixels.data(), data, std::size_t(header.width) * header.height * 4 );
+		stbi_image_free( data );
+
+		generate_mip_chain_srgb_rgba8( pixels.data(), header.width, header.height, MipFilter::kaiser, pixels.data(), pixelOffsets );
+
+		// Lay out file: header, level index, levels
+		std::vector<TextureLevel_> levels( header.levelCount );
+
+		std::size_t fileSize = align_( sizeof(TextureHeader_) + levels.size() * sizeof(TextureLevel_) );
+		for( std::uint32_t level = 0; level < header.levelCount; ++level )
+		{
+			levels[level].byteOffset = fileSize;
+			levels[level].byteLength = compressed_size( aFormat, std::max( header.width >> level, 1u ), std::max( header.height >> level, 1u ) );
+			fileSize = align_( fileSize + std::size_t(levels[level].byteLength) );
+		}
+
+		std::vector<std::byte> bytes( fileSize );
+		std::memcpy( bytes.data(), &header, sizeof(header) );
+		for( std::size_t level = 0; level < levels.size(); ++level )
+			std::memcpy( bytes.data() + sizeof(header) + level*sizeof(TextureLevel_), &levels[level], sizeof(TextureLevel_) );
+
+		// Compress the levels in bands of block rows, all in parallel
+		struct Band_
+		{
+			std::uint32_t level;
+			std::uint32_t firstRow, rows; // in pixels; firstRow is a multiple of 4
+		};
+
+		std::vector<Band_> bands;
+		for( std::uint32_t level = 0; level < header.levelCount; ++level )
+		{
+			std::uint32_t const width = std::max( header.width >> level, 1u );
+			std::uint32_t const height = std::max( header.height >> level, 1u );
+			std::uint32_t const bandRows = std::max( 4u, kBandPixels / width & ~3u );
+
+			for( std::uint32_t row = 0; row < height; row += bandRows )
+				bands.emplace_back( Band_{ level, row, std::min( bandRows, height - row ) } );
+		}
+
+		parallel_for( bands.size(), [&] (std::size_t aBand) {
+			auto const& band = bands[aBand];
+			std::uint32_t const width = std::max( header.width >> band.level, 1u );
+
+			compress_image( aFormat,
+				pixels.data() + pixelOffsets[band.level] + std::size_t(band.firstRow) * width * 4,
+				width, band.rows,
+				bytes.data() + levels[band.level].byteOffset + compressed_size( aFormat, width, band.firstRow )
+			);
+		} );
+
+		// Write to a temporary file first, such that an interrupted write never
+		// leaves a truncated cooked file behind.
+		std::string const tempPath = std::string( aCookedPath ) + ".tmp";
+
+		std::FILE* fof = std::fopen( tempPath.c_str(), "wb" );
+		if( !fof )
+			throw Error( "Unable to open '%s' for writing", tempPath.c_str() );
+
+		auto const written = std::fwrite( bytes.data(), 1, bytes.size(), fof );
+		auto const closed = std::fclose( fof );
+
+		if( written != bytes.size() || 0 != closed )
+		{
+			std::remove( tempPath.c_str() );
+			throw Error( "Unable to write cooked texture '%s'", tempPath.c_str() );
+		}
+
+		std::error_code ec;
+		std::filesystem::rename( tempPath, aCookedPath, ec );
+		if( ec )
+		{
+			std::remove( tempPath.c_str() );
+			throw Error( "Unable to rename '%s' to '%s':\n%s", tempPath.c_str(), aCookedPath, ec.message().c_str() );
+		}
+	}
+}
+
+//EOF vim:syntax=cpp:foldmethod=marker:ts=4:noexpandtab:
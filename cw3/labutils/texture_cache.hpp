@@ -0,0 +1,60 @@
+#pragma once
+
+#include <volk/volk.h>
+
+#include <string>
+#include <vector>
+#include <optional>
+
+#include <cstddef>
+#include <cstdint>
+
+#include "mapped_file.hpp"
+#include "block_compress.hpp"
+
+/* Cooked textures hold the full mip chain of an sRGB image, block-compressed
+ * ahead of time. The container follows KTX2 in spirit: a header with the
+ * VkFormat and the size of the base level, followed by an index with the
+ * offset and size of each level, and the level data, each aligned to 16
+ * bytes. The levels can be copied straight from the memory-mapped file to
+ * staging memory.
+ *
+ * The header records the size and modification time of the source image; a
+ * cooked texture is only used if these still match.
+ */
+
+namespace labutils
+{
+	// The sRGB VkFormat for aFormat
+	VkFormat block_format_srgb( BlockFormat aFormat ) noexcept;
+
+	// Path of the cooked version of the image at aSourcePath, in aFormat.
+	std::string cooked_texture_path( char const* aSourcePath, BlockFormat aFormat );
+
+	struct CookedTexture
+	{
+		struct Level
+		{
+			void const* data;
+			std::size_t size;
+		};
+
+		MappedFile file;
+
+		VkFormat format;
+		std::uint32_t width, height;
+		std::vector<Level> levels; // point into file
+	};
+
+	// Maps the cooked texture at aCookedPath. Returns an empty optional if the
+	// file doesn't exist, is of a different version or format, or is out of
+	// date with respect to aSourcePath.
+	std::optional<CookedTexture> load_cooked_texture( char const* aCookedPath, char const* aSourcePath, BlockFormat aFormat );
+
+	// Decodes the image at aSourcePath, generates its mip levels with the
+	// Kaiser filter (see generate_mip_chain_srgb_rgba8()), compresses them to
+	// aFormat and writes the result to aCookedPath. Throws an Error on failure.
+	void cook_texture( char const* aSourcePath, char const* aCookedPath, BlockFormat aFormat );
+}
+
+//EOF vim:syntax=cpp:foldmethod=marker:ts=4:noexpandtab:
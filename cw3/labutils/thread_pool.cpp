@@ -0,0 +1,74 @@
+#include "thread_pool.hpp"
+
+#include <utility>
+#include <algorithm>
+
+#include "parallel_for.hpp"
+
+namespace labutils
+{
+	ThreadPool::ThreadPool( std::size_t aThreadCount )
+	{
+		if( 0 == aThreadCount )
+			aThreadCount = std::max( 1u, std::thread::hardware_concurrency() );
+
+		for( std::size_t i = 0; i < aThreadCount; ++i )
+			mThreads.emplace_back( [this] { run_(); } );
+	}
+
+	ThreadPool::~ThreadPool()
+	{
+		{
+			std::lock_guard<std::mutex> lock( mMutex );
+			mStopping = true;
+			mJobs.clear();
+		}
+
+		mJobAvailable.notify_all();
+
+		for( auto& thread : mThreads )
+			thread.join();
+	}
+
+
+	void ThreadPool::submit( std::function<void()> aJob )
+	{
+		{
+			std::lock_guard<std::mutex> lock( mMutex );
+			mJobs.emplace_back( std::move(aJob) );
+		}
+
+		mJobAvailable.notify_one();
+	}
+
+	std::size_t ThreadPool::thread_count() const noexcept
+	{
+		return mThreads.size();
+	}
+
+
+	void ThreadPool::run_()
+	{
+		detail::tIsWorkerThread = true;
+
+		for( ;; )
+		{
+			std::function<void()> job;
+
+			{
+				std::unique_lock<std::mutex> lock( mMutex );
+				mJobAvailable.wait( lock, [this] { return mStopping || !mJobs.empty(); } );
+
+				if( mStopping )
+					return;
+
+				job = std::move(mJobs.front());
+				mJobs.pop_front();
+			}
+
+			job();
+		}
+	}
+}
+
+//EOF vim:syntax=cpp:foldmethod=marker:ts=4:noexpandtab:
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <functional>
+#include <condition_variable>
+
+#include <cstddef>
+
+namespace labutils
+{
+	/* A fixed set of worker threads that run jobs in the order they were
+	 * submitted. Jobs must not throw; a job that reports results to another
+	 * thread should catch and forward its exceptions, too.
+	 *
+	 * parallel_for() runs serially when called from a job, since the pool
+	 * already keeps all hardware threads busy.
+	 */
+	class ThreadPool
+	{
+		public:
+			// One worker per hardware thread by default
+			explicit ThreadPool( std::size_t aThreadCount = 0 );
+
+			// Waits for the running jobs. Jobs that haven't started yet are
+			// discarded.
+			~ThreadPool();
+
+			ThreadPool( ThreadPool const& ) = delete;
+			ThreadPool& operator= (ThreadPool const&) = delete;
+
+		public:
+			void submit( std::function<void()> aJob );
+
+			std::size_t thread_count() const noexcept;
+
+		private:
+			void run_();
+
+		private:
+			std::mutex mMutex;
+			std::condition_variable mJobAvailable;
+			std::deque<std::function<void()>> mJobs;
+			bool mStopping = false;
+
+			std::vector<std::thread> mThreads;
+	};
+}
+
+//EOF vim:syntax=cpp:foldmethod=marker:ts=4:noexpandtab:
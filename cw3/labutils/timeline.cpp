@@ -0,0 +1,135 @@
+#include "timeline.hpp"
+
+#include <limits>
+
+#include <cassert>
+
+#include "error.hpp"
+#include "to_string.hpp"
+#include "vulkan_context.hpp"
+
+namespace
+{
+	// Other threads may have seen a later value in the meantime
+	void raise_to_( std::atomic<std::uint64_t>& aCompleted, std::uint64_t aValue ) noexcept
+	{
+		auto seen = aCompleted.load( std::memory_order_relaxed );
+		while( seen < aValue && !aCompleted.compare_exchange_weak( seen, aValue, std::memory_order_release, std::memory_order_relaxed ) )
+			;
+	}
+}
+
+namespace labutils
+{
+	Timeline::Timeline( VulkanContext const& aContext )
+		: mDevice( aContext.device )
+	{
+		// Timeline semaphores are core in Vulkan 1.2; older devices provide
+		// them with VK_KHR_timeline_semaphore, under the KHR names
+		VkPhysicalDeviceProperties props;
+		vkGetPhysicalDeviceProperties( aContext.physicalDevice, &props );
+
+		if( VK_API_VERSION_MAJOR(props.apiVersion) > 1 || VK_API_VERSION_MINOR(props.apiVersion) >= 2 )
+		{
+			mGetCounterValue = vkGetSemaphoreCounterValue;
+			mWaitSemaphores = vkWaitSemaphores;
+		}
+		else
+		{
+			mGetCounterValue = vkGetSemaphoreCounterValueKHR;
+			mWaitSemaphores = vkWaitSemaphoresKHR;
+		}
+
+		if( !mGetCounterValue || !mWaitSemaphores )
+			throw Error( "Timeline semaphores are not available" );
+
+		VkSemaphoreTypeCreateInfo typeInfo{};
+		typeInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO;
+		typeInfo.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+		typeInfo.initialValue = 0;
+
+		VkSemaphoreCreateInfo semaphoreInfo{};
+		semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+		semaphoreInfo.pNext = &typeInfo;
+
+		if( auto const res = vkCreateSemaphore( mDevice, &semaphoreInfo, nullptr, &mSemaphore ); VK_SUCCESS != res )
+		{
+			throw Error( "Unable to create timeline semaphore\n"
+				"vkCreateSemaphore() returned %s", to_string(res).c_str() );
+		}
+	}
+
+	Timeline::~Timeline()
+	{
+		if( VK_NULL_HANDLE != mSemaphore )
+			vkDestroySemaphore( mDevice, mSemaphore, nullptr );
+	}
+
+
+	VkSemaphore Timeline::handle() const noexcept
+	{
+		return mSemaphore;
+	}
+
+	std::uint64_t Timeline::upcoming() const noexcept
+	{
+		return mLast.load( std::memory_order_relaxed ) + 1;
+	}
+
+	std::uint64_t Timeline::next() noexcept
+	{
+		return mLast.fetch_add( 1, std::memory_order_relaxed ) + 1;
+	}
+
+	std::uint64_t Timeline::last() const noexcept
+	{
+		return mLast.load( std::memory_order_relaxed );
+	}
+
+	bool Timeline::poll( std::uint64_t aValue ) const
+	{
+		if( aValue <= mCompleted.load( std::memory_order_acquire ) )
+			return true;
+
+		std::uint64_t value = 0;
+		if( auto const res = mGetCounterValue( mDevice, mSemaphore, &value ); VK_SUCCESS != res )
+		{
+			throw Error( "Unable to query timeline semaphore\n"
+				"vkGetSemaphoreCounterValue() returned %s", to_string(res).c_str() );
+		}
+
+		raise_to_( mCompleted, value );
+		return aValue <= value;
+	}
+
+	void Timeline::wait( std::uint64_t aValue ) const
+	{
+		assert( aValue <= last() );
+
+		if( poll( aValue ) )
+			return;
+
+		VkSemaphoreWaitInfo waitInfo{};
+		waitInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO;
+		waitInfo.semaphoreCount = 1;
+		waitInfo.pSemaphores = &mSemaphore;
+		waitInfo.pValues = &aValue;
+
+		if( auto const res = mWaitSemaphores( mDevice, &waitInfo, std::numeric_limits<std::uint64_t>::max() ); VK_SUCCESS != res )
+		{
+			throw Error( "Unable to wait for timeline value %llu\n"
+				"vkWaitSemaphores() returned %s", (unsigned long long)aValue, to_string(res).c_str() );
+		}
+
+		raise_to_( mCompleted, aValue );
+	}
+
+
+	Timelines::Timelines( VulkanContext const& aContext )
+		: graphics( aContext )
+		, transfer( aContext )
+		, upload( aContext )
+	{}
+}
+
+//EOF vim:syntax=cpp:foldmethod=marker:ts=4:noexpandtab:
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <volk/volk.h>
+
+#include <atomic>
+
+#include <cstdint>
+
+namespace labutils
+{
+	class VulkanContext;
+
+	/* A timeline semaphore, and the values that are signalled on it.
+	 *
+	 * Each submission that signals the timeline uses the value upcoming(),
+	 * and reserves it with next() once vkQueueSubmit() has succeeded. A failed
+	 * submission thus reserves nothing, and no one waits for a value that is
+	 * never signalled. Values increase monotonically, so a value identifies the
+	 * submission and everything signalled before it. The host checks for
+	 * completed work with poll() or blocks with wait(), e.g., before it
+	 * recycles the resources of a submission; the GPU waits for a value with
+	 * a timeline wait (VkTimelineSemaphoreSubmitInfo).
+	 *
+	 * Signal operations must be submitted in the order in which their values
+	 * were reserved. Hold the mutex of the queue that the signal is submitted
+	 * to from upcoming() until next(), and signal a timeline from one queue
+	 * only. poll() and wait() may be called from any thread.
+	 *
+	 * Requires timeline semaphores (Vulkan 1.2 or VK_KHR_timeline_semaphore),
+	 * which the device selection ensures.
+	 */
+	class Timeline
+	{
+		public:
+			explicit Timeline( VulkanContext const& );
+			~Timeline();
+
+			Timeline( Timeline const& ) = delete;
+			Timeline& operator= (Timeline const&) = delete;
+
+		public:
+			VkSemaphore handle() const noexcept;
+
+			// The value of the next signal operation, last() + 1
+			std::uint64_t upcoming() const noexcept;
+
+			// Reserves upcoming(), after its signal operation was submitted
+			std::uint64_t next() noexcept;
+
+			// The last reserved value; 0 if nothing was reserved yet
+			std::uint64_t last() const noexcept;
+
+			// True if the timeline has reached aValue. Doesn't block.
+			bool poll( std::uint64_t aValue ) const;
+
+			// Blocks until the timeline has reached aValue
+			void wait( std::uint64_t aValue ) const;
+
+		private:
+			VkDevice mDevice = VK_NULL_HANDLE;
+			VkSemaphore mSemaphore = VK_NULL_HANDLE;
+
+			// Core (Vulkan 1.2) or extension entry points
+			PFN_vkGetSemaphoreCounterValue mGetCounterValue = nullptr;
+			PFN_vkWaitSemaphores mWaitSemaphores = nullptr;
+
+			std::atomic<std::uint64_t> mLast{ 0 };
+			mutable std::atomic<std::uint64_t> mCompleted{ 0 }; // last value seen by the host
+	};
+
+	// The timelines of the work submitted to a VulkanContext's queues
+	struct Timelines
+	{
+		explicit Timelines( VulkanContext const& );
+
+		Timeline graphics; // frames, on the graphics queue
+		Timeline transfer; // copies on a dedicated transfer queue
+		Timeline upload;   // completed uploads (UploadBatch), on the graphics queue
+	};
+}
+
+//EOF vim:syntax=cpp:foldmethod=marker:ts=4:noexpandtab:
@@ -0,0 +1,573 @@
+#include "upload_batch.hpp"
+
+#include <mutex>
+#include <utility>
+#include <algorithm>
+
+#include <cassert>
+
+#include "error.hpp"
+#include "vkutil.hpp"
+#include "to_string.hpp"
+
+namespace
+{
+	inline
+	VkDeviceSize align_up_( VkDeviceSize aValue, VkDeviceSize aAlignment ) noexcept
+	{
+		return (aValue + aAlignment - 1) / aAlignment * aAlignment;
+	}
+
+	labutils::Buffer create_mapped_staging_( labutils::Allocator const& aAllocator, VkDeviceSize aSize, void*& aMapped )
+	{
+		VkBufferCreateInfo bufferInfo{};
+		bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+		bufferInfo.size = aSize;
+		bufferInfo.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+
+		VmaAllocationCreateInfo allocInfo{};
+		allocInfo.usage = VMA_MEMORY_USAGE_CPU_TO_GPU;
+		allocInfo.flags = VMA_ALLOCATION_CREATE_MAPPED_BIT;
+
+		VkBuffer buffer = VK_NULL_HANDLE;
+		VmaAllocation allocation = VK_NULL_HANDLE;
+		VmaAllocationInfo info{};
+
+		if( auto const res = vmaCreateBuffer( aAllocator.allocator, &bufferInfo, &allocInfo, &buffer, &allocation, &info ); VK_SUCCESS != res )
+		{
+			throw labutils::Error( "Unable to allocate staging buffer.\nvmaCreateBuffer() returned %s", labutils::to_string(res).c_str() );
+		}
+
+		aMapped = info.pMappedData;
+		return labutils::Buffer( aAllocator.allocator, buffer, allocation );
+	}
+
+	VkImageMemoryBarrier image_barrier_( VkImage aImage, VkAccessFlags aSrcAccess, VkAccessFlags aDstAccess, VkImageLayout aSrcLayout, VkImageLayout aDstLayout, std::uint32_t aBaseLevel, std::uint32_t aLevelCount, std::uint32_t aSrcFamily = VK_QUEUE_FAMILY_IGNORED, std::uint32_t aDstFamily = VK_QUEUE_FAMILY_IGNORED ) noexcept
+	{
+		VkImageMemoryBarrier ibarrier{};
+		ibarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+		ibarrier.image = aImage;
+		ibarrier.srcAccessMask = aSrcAccess;
+		ibarrier.dstAccessMask = aDstAccess;
+		ibarrier.srcQueueFamilyIndex = aSrcFamily;
+		ibarrier.dstQueueFamilyIndex = aDstFamily;
+		ibarrier.oldLayout = aSrcLayout;
+		ibarrier.newLayout = aDstLayout;
+		ibarrier.subresourceRange = VkImageSubresourceRange{ VK_IMAGE_ASPECT_COLOR_BIT, aBaseLevel, aLevelCount, 0, 1 };
+		return ibarrier;
+	}
+}
+
+namespace labutils
+{
+	UploadBatch::UploadBatch( VulkanContext const& aContext, Allocator const& aAllocator, VkDeviceSize aStagingCapacity )
+		: mContext( aContext )
+		, mAllocator( aAllocator )
+		, mPool( create_command_pool( aContext, VK_COMMAND_POOL_CREATE_TRANSIENT_BIT | VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT, aContext.transferFamilyIndex ) )
+		, mRingCapacity( aStagingCapacity )
+	{
+		assert( aStagingCapacity > 0 );
+
+		if( aContext.has_transfer_queue() )
+			mAcquirePool = create_command_pool( aContext, VK_COMMAND_POOL_CREATE_TRANSIENT_BIT | VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT );
+
+		void* mapped = nullptr;
+		mRing = create_mapped_staging_( aAllocator, aStagingCapacity, mapped );
+		mRingData = static_cast<std::byte*>(mapped);
+	}
+
+	UploadBatch::~UploadBatch()
+	{
+		// The staging memory and command buffers must outlive the uploads
+		if( !mInFlight.empty() )
+		{
+			try
+			{
+				mContext.timelines->upload.wait( mInFlight.back().ticket );
+			}
+			catch( ... )
+			{
+				// Device lost; nothing left to wait for
+			}
+		}
+	}
+
+
+	StagingRegion UploadBatch::stage( VkDeviceSize aSize, VkDeviceSize aAlignment )
+	{
+		assert( aAlignment > 0 );
+
+		if( aSize > mRingCapacity )
+		{
+			void* mapped = nullptr;
+			auto& buffer = mDedicatedStaging.emplace_back( create_mapped_staging_( mAllocator, aSize, mapped ) );
+			return { mapped, buffer.buffer, 0, aSize };
+		}
+
+		for( ;; )
+		{
+			reclaim_();
+
+			// Allocate after the head, or wrap around to the start of the
+			// ring if the request doesn't fit before the end
+			auto const lapStart = mRingHead - mRingHead % mRingCapacity;
+			auto const offset = align_up_( mRingHead - lapStart, aAlignment );
+
+			auto const position = offset + aSize <= mRingCapacity ? lapStart + offset : lapStart + mRingCapacity;
+			if( position + aSize - mRingTail <= mRingCapacity )
+			{
+				mRingHead = position + aSize;
+
+				auto const ringOffset = VkDeviceSize(position % mRingCapacity);
+				return { mRingData + ringOffset, mRing.buffer, ringOffset, aSize };
+			}
+
+			// The ring is full. Submit the recorded uploads, such that their
+			// staging memory can be reclaimed, and wait for the oldest ones.
+			submit();
+
+			if( mInFlight.empty() )
+			{
+				throw Error( "Upload batch: staging memory exhausted (%llu bytes requested) by regions without recorded uploads",
+					(unsigned long long)aSize );
+			}
+
+			retire_oldest_();
+		}
+	}
+
+	void UploadBatch::copy_to_buffer( StagingRegion const& aSource, VkBuffer aBuffer, VkDeviceSize aOffset, VkAccessFlags aDstAccess, VkPipelineStageFlags aDstStage )
+	{
+		if( 0 == aSource.size )
+			return;
+
+		mBufferCopies.emplace_back( BufferCopy_{ aSource.buffer, aBuffer, VkBufferCopy{ aSource.offset, aOffset, aSource.size }, aDstAccess, aDstStage } );
+	}
+
+	void UploadBatch::upload_image( StagingRegion const& aSource, VkImage aImage, VkExtent2D aExtent, std::uint32_t aMipLevels, std::vector<VkDeviceSize> aLevelOffsets )
+	{
+		assert( !aLevelOffsets.empty() && aLevelOffsets.size() <= aMipLevels );
+
+		ImageUpload_ upload{ aSource.buffer, aImage, aExtent, aMipLevels, {} };
+
+		for( std::uint32_t level = 0; level < aLevelOffsets.size(); ++level )
+		{
+			VkBufferImageCopy copy{};
+			copy.bufferOffset = aSource.offset + aLevelOffsets[level];
+			copy.bufferRowLength = 0;
+			copy.bufferImageHeight = 0;
+			copy.imageSubresource = VkImageSubresourceLayers{ VK_IMAGE_ASPECT_COLOR_BIT, level, 0, 1 };
+			copy.imageOffset = VkOffset3D{ 0, 0, 0 };
+			copy.imageExtent = VkExtent3D{ std::max( aExtent.width >> level, 1u ), std::max( aExtent.height >> level, 1u ), 1 };
+			upload.copies.emplace_back( copy );
+		}
+
+		mImageUploads.emplace_back( std::move(upload) );
+	}
+
+
+	std::uint64_t UploadBatch::submit()
+	{
+		if( mBufferCopies.empty() && mImageUploads.empty() )
+			return mLastTicket;
+
+		bool const transferOwnership = mContext.has_transfer_queue();
+
+		// Reuse the command buffers of a retired submission if possible
+		VkCommandBuffer cbuff = begin_recording_( mPool.handle, mFreeCommandBuffers );
+		VkCommandBuffer acquireCbuff = transferOwnership ? begin_recording_( mAcquirePool.handle, mFreeAcquireCommandBuffers ) : VK_NULL_HANDLE;
+
+		record_( cbuff, acquireCbuff );
+
+		end_recording_( cbuff );
+		if( transferOwnership )
+			end_recording_( acquireCbuff );
+
+		// The staging memory may not be host-coherent
+		vmaFlushAllocation( mAllocator.allocator, mRing.allocation, 0, VK_WHOLE_SIZE );
+		for( auto const& buffer : mDedicatedStaging )
+			vmaFlushAllocation( mAllocator.allocator, buffer.allocation, 0, VK_WHOLE_SIZE );
+
+		// The submission on the graphics queue signals the ticket on the
+		// upload timeline. Values are reserved under the queue lock, such
+		// that they are signalled in order, and only once the submission
+		// succeeded (see Timeline).
+		Timeline& uploadTimeline = mContext.timelines->upload;
+		VkSemaphore const uploadSemaphore = uploadTimeline.handle();
+		std::uint64_t ticket = 0;
+
+		VkTimelineSemaphoreSubmitInfo uploadValues{};
+		uploadValues.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+		uploadValues.signalSemaphoreValueCount = 1;
+		uploadValues.pSignalSemaphoreValues = &ticket;
+
+		if( !transferOwnership )
+		{
+			VkSubmitInfo submitInfo{};
+			submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+			submitInfo.pNext = &uploadValues;
+			submitInfo.commandBufferCount = 1;
+			submitInfo.pCommandBuffers = &cbuff;
+			submitInfo.signalSemaphoreCount = 1;
+			submitInfo.pSignalSemaphores = &uploadSemaphore;
+
+			std::scoped_lock queueLock( mContext.queueMutex );
+			ticket = uploadTimeline.upcoming();
+			if( auto const res = vkQueueSubmit( mContext.graphicsQueue, 1, &submitInfo, VK_NULL_HANDLE ); VK_SUCCESS != res )
+			{
+				throw Error( "Submitting commands\nvkQueueSubmit() returned %s", to_string(res).c_str() );
+			}
+			uploadTimeline.next();
+		}
+		else
+		{
+			// The copies run on the transfer queue, and signal the transfer
+			// timeline. The graphics queue waits for them, then acquires the
+			// results and generates any mip levels.
+			Timeline& transferTimeline = mContext.timelines->transfer;
+			VkSemaphore const transferSemaphore = transferTimeline.handle();
+			std::uint64_t transferValue = 0;
+
+			VkTimelineSemaphoreSubmitInfo transferValues{};
+			transferValues.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+			transferValues.signalSemaphoreValueCount = 1;
+			transferValues.pSignalSemaphoreValues = &transferValue;
+
+			VkSubmitInfo transferInfo{};
+			transferInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+			transferInfo.pNext = &transferValues;
+			transferInfo.commandBufferCount = 1;
+			transferInfo.pCommandBuffers = &cbuff;
+			transferInfo.signalSemaphoreCount = 1;
+			transferInfo.pSignalSemaphores = &transferSemaphore;
+
+			{
+				std::scoped_lock queueLock( mContext.transfer_queue_mutex() );
+				transferValue = transferTimeline.upcoming();
+				if( auto const res = vkQueueSubmit( mContext.transferQueue, 1, &transferInfo, VK_NULL_HANDLE ); VK_SUCCESS != res )
+				{
+					throw Error( "Submitting commands to the transfer queue\nvkQueueSubmit() returned %s", to_string(res).c_str() );
+				}
+				transferTimeline.next();
+			}
+
+			VkPipelineStageFlags const waitStage = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+
+			uploadValues.waitSemaphoreValueCount = 1;
+			uploadValues.pWaitSemaphoreValues = &transferValue;
+
+			VkSubmitInfo acquireInfo{};
+			acquireInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+			acquireInfo.pNext = &uploadValues;
+			acquireInfo.waitSemaphoreCount = 1;
+			acquireInfo.pWaitSemaphores = &transferSemaphore;
+			acquireInfo.pWaitDstStageMask = &waitStage;
+			acquireInfo.commandBufferCount = 1;
+			acquireInfo.pCommandBuffers = &acquireCbuff;
+			acquireInfo.signalSemaphoreCount = 1;
+			acquireInfo.pSignalSemaphores = &uploadSemaphore;
+
+			{
+				std::scoped_lock queueLock( mContext.queueMutex );
+				ticket = uploadTimeline.upcoming();
+				if( auto const res = vkQueueSubmit( mContext.graphicsQueue, 1, &acquireInfo, VK_NULL_HANDLE ); VK_SUCCESS != res )
+				{
+					throw Error( "Submitting commands\nvkQueueSubmit() returned %s", to_string(res).c_str() );
+				}
+				uploadTimeline.next();
+			}
+		}
+
+		mLastTicket = ticket;
+		mInFlight.emplace_back( Submission_{ ticket, cbuff, acquireCbuff, mRingHead, std::move(mDedicatedStaging) } );
+		mRingSubmitted = mRingHead;
+
+		mBufferCopies.clear();
+		mImageUploads.clear();
+		mDedicatedStaging.clear();
+
+		return mLastTicket;
+	}
+
+	bool UploadBatch::is_complete( std::uint64_t aTicket )
+	{
+		reclaim_();
+		return mContext.timelines->upload.poll( aTicket );
+	}
+
+	void UploadBatch::wait( std::uint64_t aTicket )
+	{
+		mContext.timelines->upload.wait( aTicket );
+		reclaim_();
+	}
+
+	void UploadBatch::flush()
+	{
+		wait( submit() );
+	}
+
+
+	VkCommandBuffer UploadBatch::begin_recording_( VkCommandPool aPool, std::vector<VkCommandBuffer>& aFree )
+	{
+		VkCommandBuffer cbuff = VK_NULL_HANDLE;
+		if( !aFree.empty() )
+		{
+			cbuff = aFree.back();
+			aFree.pop_back();
+		}
+		else
+		{
+			cbuff = alloc_command_buffer( mContext, aPool );
+		}
+
+		VkCommandBufferBeginInfo beginInfo{};
+		beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+		beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+		if( auto const res = vkBeginCommandBuffer( cbuff, &beginInfo ); VK_SUCCESS != res )
+		{
+			throw Error( "Beginning command buffer recording\nvkBeginCommandBuffer() returned %s", to_string(res).c_str() );
+		}
+
+		return cbuff;
+	}
+
+	void UploadBatch::end_recording_( VkCommandBuffer aCmdBuff )
+	{
+		if( auto const res = vkEndCommandBuffer( aCmdBuff ); VK_SUCCESS != res )
+		{
+			throw Error( "Ending command buffer recording\nvkEndCommandBuffer() returned %s", to_string(res).c_str() );
+		}
+	}
+
+	void UploadBatch::record_( VkCommandBuffer aCmdBuff, VkCommandBuffer aAcquireCmdBuff )
+	{
+		// With a dedicated transfer queue, aCmdBuff runs on that queue and
+		// aAcquireCmdBuff on the graphics queue. Otherwise aAcquireCmdBuff is
+		// null, and everything goes into aCmdBuff.
+		bool const transferOwnership = VK_NULL_HANDLE != aAcquireCmdBuff;
+		VkCommandBuffer const graphicsCmdBuff = transferOwnership ? aAcquireCmdBuff : aCmdBuff;
+
+		auto const needs_mips = [] (ImageUpload_ const& aUpload) {
+			return aUpload.copies.size() < aUpload.mipLevels;
+		};
+
+		std::vector<VkImageMemoryBarrier> barriers;
+
+		// Prepare all images for the copies
+		for( auto const& upload : mImageUploads )
+		{
+			barriers.emplace_back( image_barrier_( upload.image, 0, VK_ACCESS_TRANSFER_WRITE_BIT,
+				VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 0, upload.mipLevels ) );
+		}
+
+		if( !barriers.empty() )
+		{
+			vkCmdPipelineBarrier( aCmdBuff, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0,
+				0, nullptr, 0, nullptr, std::uint32_t(barriers.size()), barriers.data() );
+		}
+
+		// Copies. Consecutive copies between the same pair of buffers (e.g.
+		// several ranges of one staging region) share a command.
+		std::vector<VkBufferCopy> regions;
+		for( std::size_t i = 0; i < mBufferCopies.size(); )
+		{
+			auto const& first = mBufferCopies[i];
+
+			regions.clear();
+			for( ; i < mBufferCopies.size() && mBufferCopies[i].source == first.source && mBufferCopies[i].buffer == first.buffer; ++i )
+				regions.emplace_back( mBufferCopies[i].region );
+
+			vkCmdCopyBuffer( aCmdBuff, first.source, first.buffer, std::uint32_t(regions.size()), regions.data() );
+		}
+
+		std::uint32_t maxLevels = 0;
+		for( auto const& upload : mImageUploads )
+		{
+			vkCmdCopyBufferToImage( aCmdBuff, upload.source, upload.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+				std::uint32_t(upload.copies.size()), upload.copies.data() );
+
+			maxLevels = std::max( maxLevels, upload.mipLevels );
+		}
+
+		// Hand the results over to the graphics queue family. Images whose
+		// levels were all copied move to their final layout on the way; the
+		// others stay in TRANSFER_DST_OPTIMAL for the mip generation below.
+		if( transferOwnership )
+		{
+			std::vector<VkBufferMemoryBarrier> releaseBuffers, acquireBuffers;
+			std::vector<VkImageMemoryBarrier> releaseImages, acquireImages;
+			VkPipelineStageFlags acquireStages = 0;
+
+			for( auto const& copy : mBufferCopies )
+			{
+				VkBufferMemoryBarrier bbarrier{};
+				bbarrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+				bbarrier.srcQueueFamilyIndex = mContext.transferFamilyIndex;
+				bbarrier.dstQueueFamilyIndex = mContext.graphicsFamilyIndex;
+				bbarrier.buffer = copy.buffer;
+				bbarrier.offset = copy.region.dstOffset;
+				bbarrier.size = copy.region.size;
+
+				bbarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+				bbarrier.dstAccessMask = 0;
+				releaseBuffers.emplace_back( bbarrier );
+
+				bbarrier.srcAccessMask = 0;
+				bbarrier.dstAccessMask = copy.dstAccess;
+				acquireBuffers.emplace_back( bbarrier );
+
+				acquireStages |= copy.dstStage;
+			}
+
+			for( auto const& upload : mImageUploads )
+			{
+				bool const complete = !needs_mips( upload );
+				auto const layout = complete ? VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL : VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+				auto const dstAccess = complete ? VK_ACCESS_SHADER_READ_BIT : VK_ACCESS_TRANSFER_READ_BIT | VK_ACCESS_TRANSFER_WRITE_BIT;
+
+				releaseImages.emplace_back( image_barrier_( upload.image, VK_ACCESS_TRANSFER_WRITE_BIT, 0,
+					VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, layout, 0, upload.mipLevels, mContext.transferFamilyIndex, mContext.graphicsFamilyIndex ) );
+				acquireImages.emplace_back( image_barrier_( upload.image, 0, dstAccess,
+					VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, layout, 0, upload.mipLevels, mContext.transferFamilyIndex, mContext.graphicsFamilyIndex ) );
+
+				acquireStages |= complete ? VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT : VK_PIPELINE_STAGE_TRANSFER_BIT;
+			}
+
+			vkCmdPipelineBarrier( aCmdBuff, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0,
+				0, nullptr,
+				std::uint32_t(releaseBuffers.size()), releaseBuffers.data(),
+				std::uint32_t(releaseImages.size()), releaseImages.data()
+			);
+			vkCmdPipelineBarrier( aAcquireCmdBuff, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, acquireStages, 0,
+				0, nullptr,
+				std::uint32_t(acquireBuffers.size()), acquireBuffers.data(),
+				std::uint32_t(acquireImages.size()), acquireImages.data()
+			);
+		}
+
+		// Generate the missing mip levels by blitting from the previous
+		// level. Each level is processed for all images at once. Blits
+		// require a graphics queue.
+		for( std::uint32_t level = 1; level < maxLevels; ++level )
+		{
+			auto const needs_level = [level] (ImageUpload_ const& aUpload) {
+				return level >= aUpload.copies.size() && level < aUpload.mipLevels;
+			};
+
+			barriers.clear();
+			for( auto const& upload : mImageUploads )
+			{
+				if( needs_level( upload ) )
+				{
+					barriers.emplace_back( image_barrier_( upload.image, VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_TRANSFER_READ_BIT,
+						VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, level-1, 1 ) );
+				}
+			}
+
+			if( barriers.empty() )
+				continue;
+
+			vkCmdPipelineBarrier( graphicsCmdBuff, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0,
+				0, nullptr, 0, nullptr, std::uint32_t(barriers.size()), barriers.data() );
+
+			for( auto const& upload : mImageUploads )
+			{
+				if( !needs_level( upload ) )
+					continue;
+
+				auto const srcWidth = std::int32_t(std::max( upload.extent.width >> (level-1), 1u ));
+				auto const srcHeight = std::int32_t(std::max( upload.extent.height >> (level-1), 1u ));
+
+				VkImageBlit blit{};
+				blit.srcOffsets[0] = { 0, 0, 0 };
+				blit.srcOffsets[1] = { srcWidth, srcHeight, 1 };
+				blit.srcSubresource = VkImageSubresourceLayers{ VK_IMAGE_ASPECT_COLOR_BIT, level-1, 0, 1 };
+				blit.dstOffsets[0] = { 0, 0, 0 };
+				blit.dstOffsets[1] = { std::max( srcWidth >> 1, 1 ), std::max( srcHeight >> 1, 1 ), 1 };
+				blit.dstSubresource = VkImageSubresourceLayers{ VK_IMAGE_ASPECT_COLOR_BIT, level, 0, 1 };
+
+				vkCmdBlitImage( graphicsCmdBuff, upload.image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, upload.image,
+					VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &blit, VK_FILTER_LINEAR );
+			}
+		}
+
+		// Make the results visible to their consumers. The levels that were
+		// blit sources are in TRANSFER_SRC_OPTIMAL; all others are still in
+		// TRANSFER_DST_OPTIMAL. After an ownership transfer, only the images
+		// with generated levels remain.
+		barriers.clear();
+		for( auto const& upload : mImageUploads )
+		{
+			auto const given = std::uint32_t(upload.copies.size());
+			if( needs_mips( upload ) )
+			{
+				if( given > 1 )
+				{
+					barriers.emplace_back( image_barrier_( upload.image, VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT,
+						VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, 0, given-1 ) );
+				}
+
+				barriers.emplace_back( image_barrier_( upload.image, VK_ACCESS_TRANSFER_READ_BIT, VK_ACCESS_SHADER_READ_BIT,
+					VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, given-1, upload.mipLevels-given ) );
+				barriers.emplace_back( image_barrier_( upload.image, VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT,
+					VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, upload.mipLevels-1, 1 ) );
+			}
+			else if( !transferOwnership )
+			{
+				barriers.emplace_back( image_barrier_( upload.image, VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT,
+					VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, 0, upload.mipLevels ) );
+			}
+		}
+
+		VkMemoryBarrier mbarrier{};
+		mbarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+		mbarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+
+		VkPipelineStageFlags dstStages = 0;
+		if( !transferOwnership )
+		{
+			for( auto const& copy : mBufferCopies )
+			{
+				mbarrier.dstAccessMask |= copy.dstAccess;
+				dstStages |= copy.dstStage;
+			}
+		}
+
+		std::uint32_t const memoryBarrierCount = 0 != dstStages ? 1 : 0;
+		if( !barriers.empty() )
+			dstStages |= VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+
+		if( 0 != dstStages )
+		{
+			vkCmdPipelineBarrier( graphicsCmdBuff, VK_PIPELINE_STAGE_TRANSFER_BIT, dstStages, 0,
+				memoryBarrierCount, &mbarrier, 0, nullptr, std::uint32_t(barriers.size()), barriers.data() );
+		}
+	}
+
+	void UploadBatch::retire_oldest_()
+	{
+		assert( !mInFlight.empty() );
+		auto& oldest = mInFlight.front();
+
+		mContext.timelines->upload.wait( oldest.ticket );
+
+		mFreeCommandBuffers.emplace_back( oldest.commandBuffer );
+		if( VK_NULL_HANDLE != oldest.acquireCommandBuffer )
+			mFreeAcquireCommandBuffers.emplace_back( oldest.acquireCommandBuffer );
+
+		mRingTail = oldest.ringEnd;
+
+		mInFlight.pop_front();
+	}
+
+	void UploadBatch::reclaim_()
+	{
+		while( !mInFlight.empty() && mContext.timelines->upload.poll( mInFlight.front().ticket ) )
+			retire_oldest_();
+
+		// Start over at the beginning of the ring once it is empty
+		if( mInFlight.empty() && mRingHead == mRingSubmitted )
+			mRingHead = mRingTail = mRingSubmitted = 0;
+	}
+}
@@ -0,0 +1,168 @@
+#pragma once
+
+#include <volk/volk.h>
+
+#include <deque>
+#include <vector>
+
+#include <cstddef>
+#include <cstdint>
+
+#include "vkobject.hpp"
+#include "vkbuffer.hpp"
+#include "allocator.hpp"
+#include "vulkan_context.hpp"
+
+namespace labutils
+{
+	// Staging memory reserved with UploadBatch::stage(). data points to the
+	// (persistently mapped) memory at offset in buffer.
+	struct StagingRegion
+	{
+		void* data = nullptr;
+		VkBuffer buffer = VK_NULL_HANDLE;
+		VkDeviceSize offset = 0;
+		VkDeviceSize size = 0;
+	};
+
+	/* Collects uploads to buffers and images, and submits them together.
+	 *
+	 * The source data is written to staging memory reserved with stage().
+	 * The staging memory is a ring buffer that is mapped for the lifetime of
+	 * the batch; space is reclaimed as submissions complete. If the ring runs
+	 * full, stage() submits the recorded uploads and waits for the oldest
+	 * submission. Requests larger than the ring get a dedicated staging
+	 * buffer.
+	 *
+	 * The copies are only recorded by submit(): one barrier set that prepares
+	 * all images, all copies, the generated mip levels (one barrier set per
+	 * level, shared by all images), and one barrier set that makes the
+	 * results visible to their consumers. The submission is identified by a
+	 * ticket, its value on the context's upload timeline (see Timeline), which
+	 * can be polled or waited for. Tickets increase monotonically, also
+	 * across batches.
+	 *
+	 * The copies run on VulkanContext::transferQueue. If that is a dedicated
+	 * transfer queue, the results are released to the graphics queue family
+	 * and acquired by a second command buffer on the graphics queue, which
+	 * waits for the copies on the transfer timeline. Mip levels are always
+	 * generated on the graphics queue, since blits require it. With a shared
+	 * queue family, everything is recorded into one command buffer.
+	 *
+	 * An UploadBatch must only be used from one thread. Its submissions hold
+	 * the queue mutexes of the VulkanContext.
+	 */
+	class UploadBatch
+	{
+		public:
+			static constexpr VkDeviceSize kDefaultStagingCapacity = VkDeviceSize(64) << 20;
+
+			UploadBatch( VulkanContext const&, Allocator const&, VkDeviceSize aStagingCapacity = kDefaultStagingCapacity );
+
+			// Waits for all submitted uploads. Recorded but unsubmitted
+			// uploads are discarded.
+			~UploadBatch();
+
+			UploadBatch( UploadBatch const& ) = delete;
+			UploadBatch& operator= (UploadBatch const&) = delete;
+
+		public:
+			// Reserves aSize bytes of staging memory, aligned to aAlignment.
+			// The memory must be written before the next submit(). Since
+			// stage() may submit, the uploads from a region should be recorded
+			// before the next region is reserved; the region is otherwise
+			// released with the submission it was reserved before.
+			StagingRegion stage( VkDeviceSize aSize, VkDeviceSize aAlignment = 16 );
+
+			// Copies aSource to aBuffer at aOffset. aDstAccess and aDstStage
+			// describe how the buffer is used after the upload.
+			void copy_to_buffer( StagingRegion const& aSource, VkBuffer aBuffer, VkDeviceSize aOffset,
+				VkAccessFlags aDstAccess, VkPipelineStageFlags aDstStage );
+
+			// Uploads a 2D color image with aMipLevels levels and a base size
+			// of aExtent. Level i is copied from aSource at aLevelOffsets[i]
+			// (relative to aSource). Any further levels are generated from the
+			// last given one with linear blits; the image then needs
+			// VK_IMAGE_USAGE_TRANSFER_SRC_BIT. The image ends up in the
+			// SHADER_READ_ONLY_OPTIMAL layout, visible to fragment shaders.
+			void upload_image( StagingRegion const& aSource, VkImage aImage, VkExtent2D aExtent, std::uint32_t aMipLevels,
+				std::vector<VkDeviceSize> aLevelOffsets );
+
+			// Records and submits all uploads since the last submit(). Returns
+			// the ticket of the submission (or of the previous submission if
+			// there was nothing to submit; 0 if there was none).
+			std::uint64_t submit();
+
+			// Accept the tickets of any batch
+			bool is_complete( std::uint64_t aTicket );
+			void wait( std::uint64_t aTicket );
+
+			// Submits and waits for everything.
+			void flush();
+
+		private:
+			struct BufferCopy_
+			{
+				VkBuffer source;
+				VkBuffer buffer;
+				VkBufferCopy region;
+				VkAccessFlags dstAccess;
+				VkPipelineStageFlags dstStage;
+			};
+
+			struct ImageUpload_
+			{
+				VkBuffer source;
+				VkImage image;
+				VkExtent2D extent;
+				std::uint32_t mipLevels;
+				std::vector<VkBufferImageCopy> copies; // one per given level
+			};
+
+			struct Submission_
+			{
+				std::uint64_t ticket;
+				VkCommandBuffer commandBuffer;
+				VkCommandBuffer acquireCommandBuffer; // null without a transfer queue
+				std::uint64_t ringEnd; // ring position after this submission
+				std::vector<Buffer> dedicatedStaging;
+			};
+
+			VkCommandBuffer begin_recording_( VkCommandPool, std::vector<VkCommandBuffer>& aFree );
+			void end_recording_( VkCommandBuffer );
+
+			void record_( VkCommandBuffer, VkCommandBuffer aAcquireCmdBuff );
+			void retire_oldest_();
+			void reclaim_();
+
+		private:
+			VulkanContext const& mContext;
+			Allocator const& mAllocator;
+
+			// Command buffers for the transfer queue, and, with a dedicated
+			// transfer queue, for the acquiring graphics queue
+			CommandPool mPool;
+			CommandPool mAcquirePool;
+			std::vector<VkCommandBuffer> mFreeCommandBuffers;
+			std::vector<VkCommandBuffer> mFreeAcquireCommandBuffers;
+
+			// Ring positions count bytes since the ring was last empty; the
+			// offset into the buffer is the position modulo the capacity.
+			Buffer mRing;
+			std::byte* mRingData = nullptr;
+			VkDeviceSize mRingCapacity = 0;
+			std::uint64_t mRingHead = 0;      // next free position
+			std::uint64_t mRingTail = 0;      // oldest position in use
+			std::uint64_t mRingSubmitted = 0; // head at the last submit()
+
+			// Recorded uploads
+			std::vector<BufferCopy_> mBufferCopies;
+			std::vector<ImageUpload_> mImageUploads;
+			std::vector<Buffer> mDedicatedStaging;
+
+			std::deque<Submission_> mInFlight;
+			std::uint64_t mLastTicket = 0;
+	};
+}
+
+//EOF vim:syntax=cpp:foldmethod=marker:ts=4:noexpandtab:
@@ -1,11 +1,13 @@
 #include "vkimage.hpp"
 
+#include <limits>
 #include <vector>
 #include <utility>
 #include <algorithm>
 
 #include <cstdio>
 #include <cassert>
+#include <cstddef>
 #include <cstring> // for std::memcpy()
 
 #include <stb_image.h>
@@ -14,6 +16,10 @@
 #include "vkutil.hpp"
 #include "vkbuffer.hpp"
 #include "to_string.hpp"
+#include "mipmap.hpp"
+#include "mapped_file.hpp"
+#include "upload_batch.hpp"
+#include "texture_cache.hpp"
 
 namespace
 {
@@ -42,6 +48,89 @@ namespace
 
 		return res;
 	}
+
+	// An image file, mapped into memory. stb_image reads the file from the
+	// mapping instead of through stdio and its intermediate buffer.
+	struct ImageFile_
+	{
+		explicit ImageFile_(char const* aPath)
+			: path(aPath)
+			, file(labutils::map_file(aPath))
+		{
+			if (file.size > std::size_t(std::numeric_limits<int>::max()))
+				throw labutils::Error("%s: image file too large", aPath);
+
+			int widthi, heighti, channelsi;
+			if (1 != stbi_info_from_memory(bytes(), int(file.size), &widthi, &heighti, &channelsi))
+			{
+				throw labutils::Error("%s: unable to get image information (%s)", aPath,
+					stbi_failure_reason());
+			}
+
+			assert(widthi > 0 && heighti > 0);
+			width = std::uint32_t(widthi);
+			height = std::uint32_t(heighti);
+		}
+
+		stbi_uc const* bytes() const noexcept
+		{
+			return static_cast<stbi_uc const*>(file.data);
+		}
+
+		// Decodes the image as RGBA8 to aDst, which must have room for
+		// width x height pixels. stb_image always decodes into memory that
+		// it allocates itself, so this is one copy.
+		void decode_rgba8(void* aDst) const
+		{
+			int widthi, heighti, channelsi;
+			stbi_uc* data = stbi_load_from_memory(bytes(), int(file.size), &widthi, &heighti, &channelsi, 4 /*4 channels = RGBA*/);
+
+			if (!data)
+			{
+				throw labutils::Error("%s: unable to load image (%s)", path, stbi_failure_reason());
+			}
+
+			assert(std::uint32_t(widthi) == width && std::uint32_t(heighti) == height);
+			std::memcpy(aDst, data, std::size_t(width) * height * 4);
+
+			// Free image data
+			stbi_image_free(data);
+		}
+
+		// Like decode_rgba8(), and also generates the further mip levels to
+		// aDst + aLevelOffsets[i]. The levels are computed from stb_image's
+		// copy, such that aDst is only written to.
+		void decode_rgba8_with_mips(void* aDst, labutils::MipFilter aFilter, std::vector<std::uint64_t> const& aLevelOffsets) const
+		{
+			int widthi, heighti, channelsi;
+			stbi_uc* data = stbi_load_from_memory(bytes(), int(file.size), &widthi, &heighti, &channelsi, 4 /*4 channels = RGBA*/);
+
+			if (!data)
+			{
+				throw labutils::Error("%s: unable to load image (%s)", path, stbi_failure_reason());
+			}
+
+			assert(std::uint32_t(widthi) == width && std::uint32_t(heighti) == height);
+			std::memcpy(static_cast<std::byte*>(aDst) + aLevelOffsets[0], data, std::size_t(width) * height * 4);
+
+			try
+			{
+				labutils::generate_mip_chain_srgb_rgba8(data, width, height, aFilter, aDst, aLevelOffsets);
+			}
+			catch (...)
+			{
+				stbi_image_free(data);
+				throw;
+			}
+
+			// Free image data
+			stbi_image_free(data);
+		}
+
+		char const* path;
+		labutils::MappedFile file;
+		std::uint32_t width, height;
+	};
 }
 
 namespace labutils
@@ -121,171 +210,30 @@ namespace labutils
 		return 32 - leadingZeros;
 	}
 
-	Image load_image_texture2d_no_minmap(char const* aPattern, VulkanContext const& aContext, VkCommandPool aCmdPool, Allocator const& aAllocator)
+	Image load_image_texture2d_no_minmap(char const* aPattern, UploadBatch& aBatch, Allocator const& aAllocator)
 	{
 		// Get width and height of the image
-		int baseWidthi, baseHeighti, baseChannelsi;
-		if (1 != stbi_info(aPattern, &baseWidthi, &baseHeighti, &baseChannelsi))
-		{
-			throw Error("%s: unable to get image information (%s)", aPattern,
-				stbi_failure_reason());
-		}
-
-		assert(baseWidthi > 0 && baseHeighti > 0);
-
-		auto const baseWidth = std::uint32_t(baseWidthi);
-		auto const baseHeight = std::uint32_t(baseHeighti);
+		ImageFile_ const file(aPattern);
+		auto const baseWidth = file.width, baseHeight = file.height;
 
 		// Create image
 		Image ret = create_image_texture2d(aAllocator, baseWidth, baseHeight, VK_FORMAT_R8G8B8A8_SRGB,
 			VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT);
 
-		// Create command buffer
-		VkCommandBuffer cbuff = alloc_command_buffer(aContext, aCmdPool);
+		// Load image data into staging memory
+		auto const staging = aBatch.stage(VkDeviceSize(baseWidth) * baseHeight * 4);
+		file.decode_rgba8(staging.data);
 
-		// Begin command buffer
-		VkCommandBufferBeginInfo beginInfo{};
-		beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-		beginInfo.flags = 0;
-		beginInfo.pInheritanceInfo = nullptr;
-
-		if (auto const res = vkBeginCommandBuffer(cbuff, &beginInfo); VK_SUCCESS != res)
-		{
-			throw Error("Beginning command buffer recording\nvkBeginCommandBuffer() returned %s",
-				to_string(res).c_str());
-		}
-
-		// Image Barrier
-		image_barrier(
-			cbuff, ret.image, 0,
-			VK_ACCESS_TRANSFER_WRITE_BIT,
-			VK_IMAGE_LAYOUT_UNDEFINED,
-			VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-			VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
-			VK_PIPELINE_STAGE_TRANSFER_BIT,
-			VkImageSubresourceRange{
-				VK_IMAGE_ASPECT_COLOR_BIT,
-				0, 1,
-				0, 1
-			}
-		);
-
-		// update data into mip level
-		std::uint32_t width = baseWidth, height = baseHeight;
-		std::vector<Buffer> stagingBuffers(1);
-
-		// Load image data
-		int widthi, heighti, channelsi;
-		stbi_uc* data = stbi_load(aPattern, &widthi, &heighti, &channelsi, 4 /*4 channels = RGBA*/);
-
-		if (!data)
-		{
-			throw Error("%s: unable to load image (%s)", aPattern, stbi_failure_reason());
-		}
-
-		assert(widthi > 0 && std::uint32_t(widthi) == width);
-		assert(heighti > 0 && std::uint32_t(heighti) == height);
-
-		auto const sizeInBytes = width * height * 4;
-
-		// Create staging buffer for every level!!
-		auto& staging = stagingBuffers.emplace_back(create_buffer(aAllocator, sizeInBytes,
-			VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VMA_MEMORY_USAGE_CPU_TO_GPU));
-
-		// Memory mapping (get pointer in CPU that can point to VkDeviceMemory)
-		void* sptr = nullptr;
-		if (auto const res = vmaMapMemory(aAllocator.allocator, staging.allocation, &sptr); VK_SUCCESS != res)
-		{
-			throw Error("Mapping memory for writing\nvmaMapMemory() returned %s", to_string(res).c_str());
-		}
-
-
-		// Copy data into buffer
-		std::memcpy(sptr, data, sizeInBytes);
-
-		// Unmapping memory
-		vmaUnmapMemory(aAllocator.allocator, staging.allocation);
-
-		// Free image data
-		stbi_image_free(data);
-
-		// Upload data from staging buffer into image
-		VkBufferImageCopy copy;
-		copy.bufferOffset = 0;
-		copy.bufferRowLength = 0;
-		copy.bufferImageHeight = 0;
-		copy.imageSubresource = VkImageSubresourceLayers{
-			VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1 };
-		copy.imageOffset = VkOffset3D{ 0, 0, 0 };
-		copy.imageExtent = VkExtent3D{ width, height, 1 };
-
-		vkCmdCopyBufferToImage(cbuff, staging.buffer, ret.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &copy);
-
-
-		// Image Barrier
-		image_barrier(
-			cbuff, ret.image,
-			VK_ACCESS_TRANSFER_WRITE_BIT,
-			VK_ACCESS_SHADER_READ_BIT,
-			VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-			VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
-			VK_PIPELINE_STAGE_TRANSFER_BIT,
-			VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
-			VkImageSubresourceRange{
-				VK_IMAGE_ASPECT_COLOR_BIT,
-				0, 1,
-				0, 1
-			}
-		);
-
-		// End command
-		if (auto const res = vkEndCommandBuffer(cbuff); VK_SUCCESS != res)
-		{
-			throw Error("Ending command buffer recording\nvkEndCommandBuffer() returned %s", to_string(res).c_str());
-		}
-
-		// Create fence to protect 
-		Fence uploadComplete = create_fence(aContext);
-
-		// Submit queue
-		VkSubmitInfo submitInfo{};
-		submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-		submitInfo.commandBufferCount = 1;
-		submitInfo.pCommandBuffers = &cbuff;
-
-		if (auto const res = vkQueueSubmit(aContext.graphicsQueue, 1, &submitInfo,
-			uploadComplete.handle); VK_SUCCESS != res)
-		{
-			throw Error("Submitting commands\nvkQueueSubmit() returned %s", to_string(res).c_str());
-		}
-
-		// Wait for commands to finish
-		if (auto const res = vkWaitForFences(aContext.device, 1, &uploadComplete.handle, VK_TRUE,
-			std::numeric_limits<std::uint64_t>::max()); VK_SUCCESS != res)
-		{
-			throw Error("Waiting for upload to complete\nvkWaitForFences() returned %s", to_string(res).c_str());
-		}
-
-		// Free commands
-		vkFreeCommandBuffers(aContext.device, aCmdPool, 1, &cbuff);
+		aBatch.upload_image(staging, ret.image, VkExtent2D{ baseWidth, baseHeight }, 1, { 0 });
 
 		return ret;
 	}
 
-	Image load_image_texture2d_with_bliting(char const* aPattern, VulkanContext const& aContext, VkCommandPool aCmdPool, Allocator const& aAllocator)
+	Image load_image_texture2d_with_bliting(char const* aPattern, UploadBatch& aBatch, Allocator const& aAllocator)
 	{
 		// Get width and height of the image
-		int baseWidthi, baseHeighti, baseChannelsi;
-		if (1 != stbi_info(aPattern, &baseWidthi, &baseHeighti, &baseChannelsi))
-		{
-			throw Error("%s: unable to get image information (%s)", aPattern,
-				stbi_failure_reason());
-		}
-
-		assert(baseWidthi > 0 && baseHeighti > 0);
-
-		auto const baseWidth = std::uint32_t(baseWidthi);
-		auto const baseHeight = std::uint32_t(baseHeighti);
+		ImageFile_ const file(aPattern);
+		auto const baseWidth = file.width, baseHeight = file.height;
 
 		// Calculate miplevel
 		auto const mipLevels = compute_mip_level_count(baseWidth, baseHeight);
@@ -294,204 +242,47 @@ namespace labutils
 		Image ret = create_image_texture2d(aAllocator, baseWidth, baseHeight, VK_FORMAT_R8G8B8A8_SRGB,
 			VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT, mipLevels);
 
-		// Create command buffer
-		VkCommandBuffer cbuff = alloc_command_buffer(aContext, aCmdPool);
-
-		// Begin command buffer
-		VkCommandBufferBeginInfo beginInfo{};
-		beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-		beginInfo.flags = 0;
-		beginInfo.pInheritanceInfo = nullptr;
-
-		if (auto const res = vkBeginCommandBuffer(cbuff, &beginInfo); VK_SUCCESS != res)
-		{
-			throw Error("Beginning command buffer recording\nvkBeginCommandBuffer() returned %s",
-				to_string(res).c_str());
-		}
+		// Load image data into staging memory. The remaining levels are
+		// generated by the batch.
+		auto const staging = aBatch.stage(VkDeviceSize(baseWidth) * baseHeight * 4);
+		file.decode_rgba8(staging.data);
 
-		// Image Barrier
-		image_barrier(
-			cbuff, ret.image, 0,
-			VK_ACCESS_TRANSFER_WRITE_BIT,
-			VK_IMAGE_LAYOUT_UNDEFINED,
-			VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-			VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
-			VK_PIPELINE_STAGE_TRANSFER_BIT,
-			VkImageSubresourceRange{
-				VK_IMAGE_ASPECT_COLOR_BIT,
-				0, mipLevels,
-				0, 1
-			}
-		);
-
-		// update data into mip level
-		std::uint32_t width = baseWidth, height = baseHeight;
-		std::vector<Buffer> stagingBuffers(mipLevels);
-
-		// Load image data
-		int widthi, heighti, channelsi;
-		stbi_uc* data = stbi_load(aPattern, &widthi, &heighti, &channelsi, 4 /*4 channels = RGBA*/);
-
-		if (!data)
-		{
-			throw Error("%s: unable to load image (%s)", aPattern, stbi_failure_reason());
-		}
+		aBatch.upload_image(staging, ret.image, VkExtent2D{ baseWidth, baseHeight }, mipLevels, { 0 });
 
-		assert(widthi > 0 && std::uint32_t(widthi) == width);
-		assert(heighti > 0 && std::uint32_t(heighti) == height);
-
-		auto const sizeInBytes = width * height * 4;
-
-		// Create staging buffer for every level!!
-		auto& staging = stagingBuffers.emplace_back(create_buffer(aAllocator, sizeInBytes,
-			VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VMA_MEMORY_USAGE_CPU_TO_GPU));
-
-		// Memory mapping (get pointer in CPU that can point to VkDeviceMemory)
-		void* sptr = nullptr;
-		if (auto const res = vmaMapMemory(aAllocator.allocator, staging.allocation, &sptr); VK_SUCCESS != res)
-		{
-			throw Error("Mapping memory for writing\nvmaMapMemory() returned %s", to_string(res).c_str());
-		}
-
-
-		// Copy data into buffer
-		std::memcpy(sptr, data, sizeInBytes);
-
-		// Unmapping memory
-		vmaUnmapMemory(aAllocator.allocator, staging.allocation);
-
-		// Free image data
-		stbi_image_free(data);
-
-		// Upload data from staging buffer into image
-		VkBufferImageCopy copy;
-		copy.bufferOffset = 0;
-		copy.bufferRowLength = 0;
-		copy.bufferImageHeight = 0;
-		copy.imageSubresource = VkImageSubresourceLayers{
-			VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1 };
-		copy.imageOffset = VkOffset3D{ 0, 0, 0 };
-		copy.imageExtent = VkExtent3D{ width, height, 1 };
-
-		vkCmdCopyBufferToImage(cbuff, staging.buffer, ret.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &copy);
-
-		// create variables for mipmap size
-		std::int32_t mipWidth = widthi;
-		std::int32_t mipHeight = heighti;
-
-		// generate mipmap texture
-		for (uint32_t i = 1; i < mipLevels; i++) {
-			image_barrier(
-				cbuff, ret.image,
-				VK_ACCESS_TRANSFER_WRITE_BIT,
-				VK_ACCESS_TRANSFER_READ_BIT,
-				VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-				VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
-				VK_PIPELINE_STAGE_TRANSFER_BIT,
-				VK_PIPELINE_STAGE_TRANSFER_BIT,
-				VkImageSubresourceRange{
-					VK_IMAGE_ASPECT_COLOR_BIT,
-					i - 1, 1,
-					0, 1
-				}
-			);
-
-			VkImageBlit blit{};
-			blit.srcOffsets[0] = { 0, 0, 0 };
-			blit.srcOffsets[1] = { mipWidth, mipHeight, 1 };
-			blit.srcSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-			blit.srcSubresource.mipLevel = i - 1;
-			blit.srcSubresource.baseArrayLayer = 0;
-			blit.srcSubresource.layerCount = 1;
-			blit.dstOffsets[0] = { 0, 0, 0 };
-			blit.dstOffsets[1] = { mipWidth > 1 ? mipWidth >> 1 : 1, mipHeight > 1 ? mipHeight >> 1 : 1, 1 };
-			blit.dstSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-			blit.dstSubresource.mipLevel = i;
-			blit.dstSubresource.baseArrayLayer = 0;
-			blit.dstSubresource.layerCount = 1;
-
-			vkCmdBlitImage(cbuff, ret.image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, ret.image,
-				VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &blit, VK_FILTER_LINEAR);
-
-			image_barrier(
-				cbuff, ret.image,
-				VK_ACCESS_TRANSFER_READ_BIT,
-				VK_ACCESS_SHADER_READ_BIT,
-				VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
-				VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
-				VK_PIPELINE_STAGE_TRANSFER_BIT,
-				VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
-				VkImageSubresourceRange{
-					VK_IMAGE_ASPECT_COLOR_BIT,
-					i - 1, 1,
-					0, 1
-				}
-			);
-
-			// to prevent the bad situation when the size of texture is not a square
-			if (mipWidth > 1) mipWidth >>= 1;
-			if (mipHeight > 1) mipHeight >>= 1;
-		}
-
-
-
-		// Image Barrier
-		image_barrier(
-			cbuff, ret.image,
-			VK_ACCESS_TRANSFER_WRITE_BIT,
-			VK_ACCESS_SHADER_READ_BIT,
-			VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-			VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
-			VK_PIPELINE_STAGE_TRANSFER_BIT,
-			VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
-			VkImageSubresourceRange{
-				VK_IMAGE_ASPECT_COLOR_BIT,
-				mipLevels - 1, 1,
-				0, 1
-			}
-		);
-
-
-		// End command
-		if (auto const res = vkEndCommandBuffer(cbuff); VK_SUCCESS != res)
-		{
-			throw Error("Ending command buffer recording\nvkEndCommandBuffer() returned %s", to_string(res).c_str());
-		}
+		return ret;
+	}
 
-		// Create fence to protect 
-		Fence uploadComplete = create_fence(aContext);
+	Image load_image_texture2d_with_cpu_mips(char const* aPath, MipFilter aFilter, UploadBatch& aBatch, Allocator const& aAllocator)
+	{
+		// Get width and height of the image
+		ImageFile_ const file(aPath);
+		auto const baseWidth = file.width, baseHeight = file.height;
 
-		// Submit queue
-		VkSubmitInfo submitInfo{};
-		submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-		submitInfo.commandBufferCount = 1;
-		submitInfo.pCommandBuffers = &cbuff;
+		// Calculate miplevel
+		auto const mipLevels = compute_mip_level_count(baseWidth, baseHeight);
 
-		if (auto const res = vkQueueSubmit(aContext.graphicsQueue, 1, &submitInfo,
-			uploadComplete.handle); VK_SUCCESS != res)
-		{
-			throw Error("Submitting commands\nvkQueueSubmit() returned %s", to_string(res).c_str());
-		}
+		// Create image
+		Image ret = create_image_texture2d(aAllocator, baseWidth, baseHeight, VK_FORMAT_R8G8B8A8_SRGB,
+			VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT, mipLevels);
 
-		// Wait for commands to finish
-		if (auto const res = vkWaitForFences(aContext.device, 1, &uploadComplete.handle, VK_TRUE,
-			std::numeric_limits<std::uint64_t>::max()); VK_SUCCESS != res)
+		// All levels are written to one staging region
+		std::vector<VkDeviceSize> levelOffsets(mipLevels);
+		VkDeviceSize sizeInBytes = 0;
+		for (std::uint32_t level = 0; level < mipLevels; ++level)
 		{
-			throw Error("Waiting for upload to complete\nvkWaitForFences() returned %s", to_string(res).c_str());
+			levelOffsets[level] = sizeInBytes;
+			sizeInBytes += VkDeviceSize(std::max(baseWidth >> level, 1u)) * std::max(baseHeight >> level, 1u) * 4;
 		}
 
-		// Free commands
-		vkFreeCommandBuffers(aContext.device, aCmdPool, 1, &cbuff);
-
-
-
+		auto const staging = aBatch.stage(sizeInBytes);
+		file.decode_rgba8_with_mips(staging.data, aFilter, levelOffsets);
 
+		aBatch.upload_image(staging, ret.image, VkExtent2D{ baseWidth, baseHeight }, mipLevels, std::move(levelOffsets));
 
 		return ret;
-
 	}
 
-	Image load_image_texture2d(char const* aPattern, VulkanContext const& aContext, VkCommandPool aCmdPool, Allocator const& aAllocator)
+	Image load_image_texture2d(char const* aPattern, UploadBatch& aBatch, Allocator const& aAllocator)
 	{
 		//DONE- (Section 4) implement me!
 
@@ -503,18 +294,13 @@ namespace labutils
 		}
 
 		// Get width and height of the image
-		int baseWidthi, baseHeighti, baseChannelsi;
-		if (1 != stbi_info(baseName, &baseWidthi, &baseHeighti, &baseChannelsi))
+		std::uint32_t baseWidth, baseHeight;
 		{
-			throw Error("%s: unable to get image information (%s)", baseName,
-				stbi_failure_reason());
+			ImageFile_ const file(baseName);
+			baseWidth = file.width;
+			baseHeight = file.height;
 		}
 
-		assert(baseWidthi > 0 && baseHeighti > 0);
-
-		auto const baseWidth = std::uint32_t(baseWidthi);
-		auto const baseHeight = std::uint32_t(baseHeighti);
-
 		// Calculate miplevel
 		auto const mipLevels = compute_mip_level_count(baseWidth, baseHeight);
 
@@ -522,39 +308,16 @@ namespace labutils
 		Image ret = create_image_texture2d(aAllocator, baseWidth, baseHeight, VK_FORMAT_R8G8B8A8_SRGB,
 			VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT, mipLevels);
 
-		// Create command buffer
-		VkCommandBuffer cbuff = alloc_command_buffer(aContext, aCmdPool);
-
-		// Begin command buffer
-		VkCommandBufferBeginInfo beginInfo{};
-		beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-		beginInfo.flags = 0;
-		beginInfo.pInheritanceInfo = nullptr;
-
-		if (auto const res = vkBeginCommandBuffer(cbuff, &beginInfo); VK_SUCCESS != res)
+		// All levels share one staging region
+		std::vector<VkDeviceSize> levelOffsets(mipLevels);
+		VkDeviceSize sizeInBytes = 0;
+		for (std::uint32_t level = 0; level < mipLevels; ++level)
 		{
-			throw Error("Beginning command buffer recording\nvkBeginCommandBuffer() returned %s",
-				to_string(res).c_str());
+			levelOffsets[level] = sizeInBytes;
+			sizeInBytes += VkDeviceSize(std::max(baseWidth >> level, 1u)) * std::max(baseHeight >> level, 1u) * 4;
 		}
 
-		// Image Barrier
-		image_barrier(
-			cbuff, ret.image, 0,
-			VK_ACCESS_TRANSFER_WRITE_BIT,
-			VK_IMAGE_LAYOUT_UNDEFINED,
-			VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-			VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
-			VK_PIPELINE_STAGE_TRANSFER_BIT,
-			VkImageSubresourceRange{
-				VK_IMAGE_ASPECT_COLOR_BIT,
-				0, mipLevels,
-				0, 1
-			}
-		);
-
-		// update data into mip level
-		std::uint32_t width = baseWidth, height = baseHeight;
-		std::vector<Buffer> stagingBuffers(mipLevels);
+		auto const staging = aBatch.stage(sizeInBytes);
 
 		for (std::uint32_t level = 0; level < mipLevels; ++level)
 		{
@@ -567,233 +330,156 @@ namespace labutils
 					aPattern, level, iret);
 			}
 
-			// Load image data
-			int widthi, heighti, channelsi;
-			stbi_uc* data = stbi_load(levelName, &widthi, &heighti, &channelsi, 4 /*4 channels = RGBA*/);
-
-			if (!data)
+			ImageFile_ const file(levelName);
+			if (file.width != std::max(baseWidth >> level, 1u) || file.height != std::max(baseHeight >> level, 1u))
 			{
-				throw Error("%s: unable to load image for level %u (%s)", levelName, level, stbi_failure_reason());
+				throw Error("%s: unexpected size %ux%u for level %u", levelName, file.width, file.height, level);
 			}
 
-			assert(widthi > 0 && std::uint32_t(widthi) == width);
-			assert(heighti > 0 && std::uint32_t(heighti) == height);
-
-			auto const sizeInBytes = width * height * 4;
-
-			// Create staging buffer for every level!!
-			auto& staging = stagingBuffers.emplace_back(create_buffer(aAllocator, sizeInBytes,
-				VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VMA_MEMORY_USAGE_CPU_TO_GPU));
+			file.decode_rgba8(static_cast<std::byte*>(staging.data) + levelOffsets[level]);
+		}
 
-			// Memory mapping (get pointer in CPU that can point to VkDeviceMemory)
-			void* sptr = nullptr;
-			if (auto const res = vmaMapMemory(aAllocator.allocator, staging.allocation, &sptr); VK_SUCCESS != res)
-			{
-				throw Error("Mapping memory for writing\nvmaMapMemory() returned %s", to_string(res).c_str());
-			}
+		aBatch.upload_image(staging, ret.image, VkExtent2D{ baseWidth, baseHeight }, mipLevels, std::move(levelOffsets));
 
+		return ret;
+	}
 
-			// Copy data into buffer
-			std::memcpy(sptr, data, sizeInBytes);
+	Image load_compressed_texture2d(char const* aPath, BlockFormat aFormat, UploadBatch& aBatch, Allocator const& aAllocator)
+	{
+		// The levels are copied from the mapped cooked file either way, so
+		// there's nothing to gain from decoding into staging memory directly
+		return upload_texture2d(decode_compressed_texture2d(aPath, aFormat), aBatch, aAllocator);
+	}
 
-			// Unmapping memory
-			vmaUnmapMemory(aAllocator.allocator, staging.allocation);
+	DecodedTexture decode_image_texture2d_with_cpu_mips(char const* aPath, MipFilter aFilter)
+	{
+		ImageFile_ const file(aPath);
 
-			// Free image data
-			stbi_image_free(data);
+		DecodedTexture ret;
+		ret.format = VK_FORMAT_R8G8B8A8_SRGB;
+		ret.width = file.width;
+		ret.height = file.height;
+		ret.mipLevels = compute_mip_level_count(file.width, file.height);
 
-			// Upload data from staging buffer into image
-			VkBufferImageCopy copy;
-			copy.bufferOffset = 0;
-			copy.bufferRowLength = 0;
-			copy.bufferImageHeight = 0;
-			copy.imageSubresource = VkImageSubresourceLayers{
-				VK_IMAGE_ASPECT_COLOR_BIT, level, 0, 1 };
-			copy.imageOffset = VkOffset3D{ 0, 0, 0 };
-			copy.imageExtent = VkExtent3D{ width, height, 1 };
-
-			vkCmdCopyBufferToImage(cbuff, staging.buffer, ret.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &copy);
-
-			width >>= 1;
-			if (0 == width)
-				width = 1;
-
-			height >>= 1;
-			if (0 == height)
-				height = 1;
+		std::vector<VkDeviceSize> levelOffsets(ret.mipLevels);
+		VkDeviceSize sizeInBytes = 0;
+		for (std::uint32_t level = 0; level < ret.mipLevels; ++level)
+		{
+			levelOffsets[level] = sizeInBytes;
+			sizeInBytes += VkDeviceSize(std::max(file.width >> level, 1u)) * std::max(file.height >> level, 1u) * 4;
 		}
 
-		// Image Barrier
-		image_barrier(
-			cbuff, ret.image,
-			VK_ACCESS_TRANSFER_WRITE_BIT,
-			VK_ACCESS_SHADER_READ_BIT,
-			VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-			VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
-			VK_PIPELINE_STAGE_TRANSFER_BIT,
-			VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
-			VkImageSubresourceRange{
-				VK_IMAGE_ASPECT_COLOR_BIT,
-				0, mipLevels,
-				0, 1
-			}
-		);
+		ret.pixels.resize(std::size_t(sizeInBytes));
+		file.decode_rgba8_with_mips(ret.pixels.data(), aFilter, levelOffsets);
 
-		// End command
-		if (auto const res = vkEndCommandBuffer(cbuff); VK_SUCCESS != res)
+		for (std::uint32_t level = 0; level < ret.mipLevels; ++level)
 		{
-			throw Error("Ending command buffer recording\nvkEndCommandBuffer() returned %s", to_string(res).c_str());
+			auto const end = level+1 < ret.mipLevels ? levelOffsets[level+1] : sizeInBytes;
+			ret.levels.emplace_back(DecodedTexture::Level{ ret.pixels.data() + levelOffsets[level], std::size_t(end - levelOffsets[level]) });
 		}
 
-		// Create fence to protect 
-		Fence uploadComplete = create_fence(aContext);
+		return ret;
+	}
 
-		// Submit queue
-		VkSubmitInfo submitInfo{};
-		submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-		submitInfo.commandBufferCount = 1;
-		submitInfo.pCommandBuffers = &cbuff;
+	DecodedTexture decode_image_texture2d(char const* aPath, bool aGenerateMips)
+	{
+		ImageFile_ const file(aPath);
 
-		if (auto const res = vkQueueSubmit(aContext.graphicsQueue, 1, &submitInfo,
-			uploadComplete.handle); VK_SUCCESS != res)
-		{
-			throw Error("Submitting commands\nvkQueueSubmit() returned %s", to_string(res).c_str());
-		}
+		DecodedTexture ret;
+		ret.format = VK_FORMAT_R8G8B8A8_SRGB;
+		ret.width = file.width;
+		ret.height = file.height;
+		ret.mipLevels = aGenerateMips ? compute_mip_level_count(file.width, file.height) : 1;
 
-		// Wait for commands to finish
-		if (auto const res = vkWaitForFences(aContext.device, 1, &uploadComplete.handle, VK_TRUE,
-			std::numeric_limits<std::uint64_t>::max()); VK_SUCCESS != res)
-		{
-			throw Error("Waiting for upload to complete\nvkWaitForFences() returned %s", to_string(res).c_str());
-		}
+		ret.pixels.resize(std::size_t(file.width) * file.height * 4);
+		file.decode_rgba8(ret.pixels.data());
 
-		// Free commands
-		vkFreeCommandBuffers(aContext.device, aCmdPool, 1, &cbuff);
+		ret.levels.emplace_back(DecodedTexture::Level{ ret.pixels.data(), ret.pixels.size() });
 
 		return ret;
 	}
 
-	Image create_image_texture2d_with_solid_color(char const* aPattern, VulkanContext const& aContext, VkCommandPool aCmdPool, Allocator const& aAllocator, glm::vec4 inColor)
+	DecodedTexture decode_compressed_texture2d(char const* aPath, BlockFormat aFormat)
 	{
+		auto const cookedPath = cooked_texture_path(aPath, aFormat);
 
-		// Create image
-		Image ret = create_image_texture2d(aAllocator, 1, 1, VK_FORMAT_R8G8B8A8_SRGB,
-			VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT);
+		auto cooked = load_cooked_texture(cookedPath.c_str(), aPath, aFormat);
+		if (!cooked)
+		{
+			cook_texture(aPath, cookedPath.c_str(), aFormat);
 
-		// Create command buffer
-		VkCommandBuffer cbuff = alloc_command_buffer(aContext, aCmdPool);
+			cooked = load_cooked_texture(cookedPath.c_str(), aPath, aFormat);
+			if (!cooked)
+				throw Error("%s: unable to load freshly cooked texture '%s'", aPath, cookedPath.c_str());
+		}
 
-		// Begin command buffer
-		VkCommandBufferBeginInfo beginInfo{};
-		beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-		beginInfo.flags = 0;
-		beginInfo.pInheritanceInfo = nullptr;
+		DecodedTexture ret;
+		ret.format = cooked->format;
+		ret.width = cooked->width;
+		ret.height = cooked->height;
+		ret.mipLevels = std::uint32_t(cooked->levels.size());
 
-		if (auto const res = vkBeginCommandBuffer(cbuff, &beginInfo); VK_SUCCESS != res)
-		{
-			throw Error("Beginning command buffer recording\nvkBeginCommandBuffer() returned %s",
-				to_string(res).c_str());
-		}
+		for (auto const& level : cooked->levels)
+			ret.levels.emplace_back(DecodedTexture::Level{ level.data, level.size });
 
-		// Image Barrier
-		image_barrier(
-			cbuff, ret.image, 0,
-			VK_ACCESS_TRANSFER_WRITE_BIT,
-			VK_IMAGE_LAYOUT_UNDEFINED,
-			VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-			VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
-			VK_PIPELINE_STAGE_TRANSFER_BIT,
-			VkImageSubresourceRange{
-				VK_IMAGE_ASPECT_COLOR_BIT,
-				0, 1,
-				0, 1
-			}
-		);
+		// The levels point into the mapping, which doesn't move with the file
+		ret.file = std::move(cooked->file);
 
-		// update data into mip level
-		std::vector<Buffer> stagingBuffers(1);
+		return ret;
+	}
 
-		auto const sizeInBytes = 4;
+	Image upload_texture2d(DecodedTexture const& aTexture, UploadBatch& aBatch, Allocator const& aAllocator)
+	{
+		assert(!aTexture.levels.empty() && aTexture.levels.size() <= aTexture.mipLevels);
 
-		// Create staging buffer for every level!!
-		auto& staging = stagingBuffers.emplace_back(create_buffer(aAllocator, sizeInBytes,
-			VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VMA_MEMORY_USAGE_CPU_TO_GPU));
+		// Levels that aren't given are generated with blits from the last
+		// one that is
+		VkImageUsageFlags usage = VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+		if (aTexture.levels.size() < aTexture.mipLevels)
+			usage |= VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
 
-		// Memory mapping (get pointer in CPU that can point to VkDeviceMemory)
-		void* sptr = nullptr;
-		if (auto const res = vmaMapMemory(aAllocator.allocator, staging.allocation, &sptr); VK_SUCCESS != res)
+		// Create image
+		Image ret = create_image_texture2d(aAllocator, aTexture.width, aTexture.height, aTexture.format, usage, aTexture.mipLevels);
+
+		// All levels share one staging region. The offsets are multiples of
+		// 16 bytes, and thus of the block size for compressed formats, as
+		// required for copies to compressed images.
+		std::vector<VkDeviceSize> levelOffsets(aTexture.levels.size());
+		VkDeviceSize sizeInBytes = 0;
+		for (std::size_t level = 0; level < aTexture.levels.size(); ++level)
 		{
-			throw Error("Mapping memory for writing\nvmaMapMemory() returned %s", to_string(res).c_str());
+			levelOffsets[level] = sizeInBytes;
+			sizeInBytes += (aTexture.levels[level].size + 15) & ~VkDeviceSize(15);
 		}
 
-
-		// Copy data into buffer
-		const char color[4] = { inColor[0] * 255.f, inColor[1] * 255.f, inColor[2] * 255.f, inColor[3] * 255.f };
-
-		std::memcpy(sptr, color, sizeInBytes);
-
-		// Unmapping memory
-		vmaUnmapMemory(aAllocator.allocator, staging.allocation);
-
-		// Upload data from staging buffer into image
-		VkBufferImageCopy copy;
-		copy.bufferOffset = 0;
-		copy.bufferRowLength = 0;
-		copy.bufferImageHeight = 0;
-		copy.imageSubresource = VkImageSubresourceLayers{
-			VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1 };
-		copy.imageOffset = VkOffset3D{ 0, 0, 0 };
-		copy.imageExtent = VkExtent3D{ 1, 1, 1 };
-
-		vkCmdCopyBufferToImage(cbuff, staging.buffer, ret.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &copy);
-
-
-		// Image Barrier
-		image_barrier(
-			cbuff, ret.image,
-			VK_ACCESS_TRANSFER_WRITE_BIT,
-			VK_ACCESS_SHADER_READ_BIT,
-			VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-			VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
-			VK_PIPELINE_STAGE_TRANSFER_BIT,
-			VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
-			VkImageSubresourceRange{
-				VK_IMAGE_ASPECT_COLOR_BIT,
-				0, 1,
-				0, 1
-			}
-		);
-
-		// End command
-		if (auto const res = vkEndCommandBuffer(cbuff); VK_SUCCESS != res)
+		auto const staging = aBatch.stage(sizeInBytes);
+		for (std::size_t level = 0; level < aTexture.levels.size(); ++level)
 		{
-			throw Error("Ending command buffer recording\nvkEndCommandBuffer() returned %s", to_string(res).c_str());
+			std::memcpy(static_cast<std::byte*>(staging.data) + levelOffsets[level],
+				aTexture.levels[level].data, aTexture.levels[level].size);
 		}
 
-		// Create fence to protect 
-		Fence uploadComplete = create_fence(aContext);
+		aBatch.upload_image(staging, ret.image, VkExtent2D{ aTexture.width, aTexture.height }, aTexture.mipLevels, std::move(levelOffsets));
+
+		return ret;
+	}
 
-		// Submit queue
-		VkSubmitInfo submitInfo{};
-		submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-		submitInfo.commandBufferCount = 1;
-		submitInfo.pCommandBuffers = &cbuff;
+	Image create_image_texture2d_with_solid_color(char const* aPattern, UploadBatch& aBatch, Allocator const& aAllocator, glm::vec4 inColor)
+	{
+		(void)aPattern;
 
-		if (auto const res = vkQueueSubmit(aContext.graphicsQueue, 1, &submitInfo,
-			uploadComplete.handle); VK_SUCCESS != res)
-		{
-			throw Error("Submitting commands\nvkQueueSubmit() returned %s", to_string(res).c_str());
-		}
+		// Create image
+		Image ret = create_image_texture2d(aAllocator, 1, 1, VK_FORMAT_R8G8B8A8_SRGB,
+			VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT);
 
-		// Wait for commands to finish
-		if (auto const res = vkWaitForFences(aContext.device, 1, &uploadComplete.handle, VK_TRUE,
-			std::numeric_limits<std::uint64_t>::max()); VK_SUCCESS != res)
-		{
-			throw Error("Waiting for upload to complete\nvkWaitForFences() returned %s", to_string(res).c_str());
-		}
+		// Copy data into staging memory
+		auto const staging = aBatch.stage(4);
+
+		glm::vec4 const scaled = glm::clamp(inColor, 0.f, 1.f) * 255.f;
+		std::uint8_t const color[4] = { std::uint8_t(scaled[0]), std::uint8_t(scaled[1]), std::uint8_t(scaled[2]), std::uint8_t(scaled[3]) };
+		std::memcpy(staging.data, color, sizeof(color));
 
-		// Free commands
-		vkFreeCommandBuffers(aContext.device, aCmdPool, 1, &cbuff);
+		aBatch.upload_image(staging, ret.image, VkExtent2D{ 1, 1 }, 1, { 0 });
 
 		return ret;
 	}
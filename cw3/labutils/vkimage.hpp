@@ -3,11 +3,16 @@
 #include <volk/volk.h>
 #include <vk_mem_alloc.h>
 #include <glm/glm.hpp>
+#include <vector>
 #include <utility>
 
 #include <cassert>
+#include <cstddef>
 
 #include "allocator.hpp"
+#include "mapped_file.hpp"
+#include "mipmap.hpp"
+#include "block_compress.hpp"
 
 namespace labutils
 {
@@ -32,11 +37,63 @@ namespace labutils
 			VmaAllocator mAllocator = VK_NULL_HANDLE;
 	};
 
-	Image load_image_texture2d(char const* aPattern, VulkanContext const&, VkCommandPool, Allocator const&);
-	Image load_image_texture2d_with_bliting(char const* aPattern, VulkanContext const&, VkCommandPool, Allocator const&);
-	Image load_image_texture2d_no_minmap(char const* aPattern, VulkanContext const& aContext, VkCommandPool aCmdPool, Allocator const& aAllocator);
+	class UploadBatch;
+
+	// The functions taking an UploadBatch create the image immediately and
+	// record its upload into the batch. The image may be used once the
+	// batch's submission has completed.
+	Image load_image_texture2d(char const* aPattern, UploadBatch&, Allocator const&);
+	Image load_image_texture2d_with_bliting(char const* aPattern, UploadBatch&, Allocator const&);
+	// Like load_image_texture2d_with_bliting(), but the mip levels are
+	// generated on the CPU (see generate_mip_chain_srgb_rgba8()), directly
+	// into staging memory, instead of with a chain of blits on the GPU.
+	Image load_image_texture2d_with_cpu_mips(char const* aPath, MipFilter, UploadBatch&, Allocator const&);
+	Image load_image_texture2d_no_minmap(char const* aPattern, UploadBatch& aBatch, Allocator const& aAllocator);
+	// Loads the image at aPath as a block-compressed texture with a full mip
+	// chain, in the format block_format_srgb(aFormat). The image is cooked on
+	// first use and whenever it changes (see texture_cache.hpp); the levels
+	// are copied from the mapped cooked file to staging memory as they are.
+	// The device must be able to sample the format.
+	Image load_compressed_texture2d(char const* aPath, BlockFormat aFormat, UploadBatch&, Allocator const&);
+
+	// The CPU half of loading a texture: the data of its levels, ready to be
+	// copied to staging memory. The decode_*() functions don't use the device
+	// and can run on any thread, e.g. on the workers of a ThreadPool, while
+	// upload_texture2d() records the upload on the thread that owns the
+	// batch. This costs one more copy of the pixels than the load_*()
+	// functions, which decode straight into staging memory.
+	struct DecodedTexture
+	{
+		struct Level
+		{
+			void const* data;
+			std::size_t size;
+		};
+
+		VkFormat format = VK_FORMAT_UNDEFINED;
+		std::uint32_t width = 0, height = 0;
+
+		// Levels of the image. Levels beyond those in levels are generated
+		// with blits during the upload.
+		std::uint32_t mipLevels = 1;
+		std::vector<Level> levels; // point into pixels or file
+
+		std::vector<std::byte> pixels;
+		MappedFile file;
+	};
+
+	// As load_image_texture2d_with_cpu_mips()
+	DecodedTexture decode_image_texture2d_with_cpu_mips(char const* aPath, MipFilter);
+	// The base level only. With aGenerateMips, the further levels are
+	// generated as in load_image_texture2d_with_bliting().
+	DecodedTexture decode_image_texture2d(char const* aPath, bool aGenerateMips);
+	// As load_compressed_texture2d(); cooks the texture if needed.
+	DecodedTexture decode_compressed_texture2d(char const* aPath, BlockFormat);
+
+	Image upload_texture2d(DecodedTexture const&, UploadBatch&, Allocator const&);
+
 	Image create_image_texture2d(Allocator const&, std::uint32_t aWidth, std::uint32_t aHeight, VkFormat, VkImageUsageFlags = VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT, std::uint32_t mipLevels = 1);
-	Image create_image_texture2d_with_solid_color(char const* aPattern, VulkanContext const& aContext, VkCommandPool aCmdPool, Allocator const& aAllocator, glm::vec4 inColor);
+	Image create_image_texture2d_with_solid_color(char const* aPattern, UploadBatch& aBatch, Allocator const& aAllocator, glm::vec4 inColor);
 	std::uint32_t compute_mip_level_count(std::uint32_t aWidth, std::uint32_t aHeight);
 }
 
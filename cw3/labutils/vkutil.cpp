@@ -101,11 +101,16 @@ namespace labutils
 
 
 	CommandPool create_command_pool( VulkanContext const& aContext, VkCommandPoolCreateFlags aFlags )
+	{
+		return create_command_pool( aContext, aFlags, aContext.graphicsFamilyIndex );
+	}
+
+	CommandPool create_command_pool( VulkanContext const& aContext, VkCommandPoolCreateFlags aFlags, std::uint32_t aQueueFamilyIndex )
 	{
 		//DONE: implement me!
 		VkCommandPoolCreateInfo poolInfo{};
 		poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
-		poolInfo.queueFamilyIndex = aContext.graphicsFamilyIndex;
+		poolInfo.queueFamilyIndex = aQueueFamilyIndex;
 		poolInfo.flags = aFlags;
 
 		VkCommandPool cpool = VK_NULL_HANDLE;
@@ -219,7 +224,8 @@ namespace labutils
 		VkDescriptorPoolSize const pools[] = {
 			{VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, aMaxDescriptors}, // each containing a descriptor type and number of 
 																  // descriptors of that type to be allocated in the pool
-			{VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, aMaxDescriptors}
+			{VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, aMaxDescriptors},
+			{VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT, aMaxDescriptors}
 		};
 
 		VkDescriptorPoolCreateInfo poolInfo{};
@@ -304,7 +310,7 @@ namespace labutils
 		return ImageView(aContext.device, view);
 	}
 
-	Sampler create_default_sampler(VulkanContext const& aContext, VkBool32 useAnisotropy)
+	VkSamplerCreateInfo default_sampler_info(VulkanContext const& aContext, VkBool32 useAnisotropy)
 	{
 
 		// properties of physical deivce (for a)
@@ -326,10 +332,14 @@ namespace labutils
 		samplerInfo.anisotropyEnable = useAnisotropy;
 		samplerInfo.maxAnisotropy = props.limits.maxSamplerAnisotropy;
 
-		// create sampler
+		return samplerInfo;
+	}
+
+	Sampler create_sampler(VulkanContext const& aContext, VkSamplerCreateInfo const& aInfo)
+	{
 		VkSampler sampler = VK_NULL_HANDLE;
 
-		if (auto const res = vkCreateSampler(aContext.device, &samplerInfo, nullptr, &sampler); VK_SUCCESS != res)
+		if (auto const res = vkCreateSampler(aContext.device, &aInfo, nullptr, &sampler); VK_SUCCESS != res)
 		{
 			throw Error("Unable to create sampler\nvkCreateSampler() returned %s", to_string(res).c_str());
 		}
@@ -337,4 +347,9 @@ namespace labutils
 		return Sampler(aContext.device, sampler);
 	}
 
+	Sampler create_default_sampler(VulkanContext const& aContext, VkBool32 useAnisotropy)
+	{
+		return create_sampler(aContext, default_sampler_info(aContext, useAnisotropy));
+	}
+
 }
@@ -2,6 +2,8 @@
 
 #include <volk/volk.h>
 
+#include <cstdint>
+
 #include "vkobject.hpp"
 #include "vulkan_context.hpp"
 
@@ -9,7 +11,9 @@ namespace labutils
 {
 	ShaderModule load_shader_module( VulkanContext const&, char const* aSpirvPath );
 
+	// Creates a pool for the graphics queue family, or for aQueueFamilyIndex
 	CommandPool create_command_pool( VulkanContext const&, VkCommandPoolCreateFlags = 0 );
+	CommandPool create_command_pool( VulkanContext const&, VkCommandPoolCreateFlags, std::uint32_t aQueueFamilyIndex );
 	VkCommandBuffer alloc_command_buffer( VulkanContext const&, VkCommandPool );
 
 	Fence create_fence( VulkanContext const&, VkFenceCreateFlags = 0 );
@@ -43,6 +47,12 @@ namespace labutils
 
 	ImageView create_image_view_texture2d(VulkanContext const&, VkImage, VkFormat);
 
+	// Trilinear filtering with repeat addressing, optionally with the
+	// device's maximum anisotropy. Samplers that are shared should come
+	// from a SamplerCache instead.
+	VkSamplerCreateInfo default_sampler_info(VulkanContext const&, VkBool32 useAnisotropy);
+
+	Sampler create_sampler(VulkanContext const&, VkSamplerCreateInfo const&);
 	Sampler create_default_sampler(VulkanContext const&, VkBool32 useAnisotropy);
 
 }
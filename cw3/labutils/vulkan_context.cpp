@@ -21,7 +21,9 @@ namespace
 
 	VkDevice create_device( 
 		VkPhysicalDevice,
-		std::uint32_t aQueueFamily
+		std::uint32_t aQueueFamily,
+		std::vector<char const*> const& aEnabledExtensions,
+		void const* aFeatureChain
 	);
 }
 
@@ -33,6 +35,8 @@ namespace labutils
 	VulkanContext::~VulkanContext()
 	{
 		// Device-related objects
+		timelines.reset();
+
 		if( VK_NULL_HANDLE != device )
 			vkDestroyDevice( device, nullptr );
 
@@ -51,6 +55,11 @@ namespace labutils
 		, device( std::exchange( aOther.device, VK_NULL_HANDLE ) )
 		, graphicsFamilyIndex( aOther.graphicsFamilyIndex )
 		, graphicsQueue( std::exchange( aOther.graphicsQueue, VK_NULL_HANDLE ) )
+		, transferFamilyIndex( aOther.transferFamilyIndex )
+		, transferQueue( std::exchange( aOther.transferQueue, VK_NULL_HANDLE ) )
+		, descriptorIndexing( aOther.descriptorIndexing )
+		, maxDrawIndirectCount( aOther.maxDrawIndirectCount )
+		, timelines( std::move(aOther.timelines) )
 		, debugMessenger( std::exchange( aOther.debugMessenger, VK_NULL_HANDLE ) )
 	{}
 
@@ -72,11 +81,27 @@ namespace labutils
 		std::swap( device, aOther.device );
 		std::swap( graphicsFamilyIndex, aOther.graphicsFamilyIndex );
 		std::swap( graphicsQueue, aOther.graphicsQueue );
+		std::swap( transferFamilyIndex, aOther.transferFamilyIndex );
+		std::swap( transferQueue, aOther.transferQueue );
+		std::swap( descriptorIndexing, aOther.descriptorIndexing );
+		std::swap( maxDrawIndirectCount, aOther.maxDrawIndirectCount );
+		std::swap( timelines, aOther.timelines );
 		std::swap( debugMessenger, aOther.debugMessenger );
 		return *this;
 	}
 
 
+	bool VulkanContext::has_transfer_queue() const noexcept
+	{
+		return transferFamilyIndex != graphicsFamilyIndex;
+	}
+
+	std::mutex& VulkanContext::transfer_queue_mutex() const noexcept
+	{
+		return has_transfer_queue() ? transferQueueMutex : queueMutex;
+	}
+
+
 	// make_vulkan_context()
 	VulkanContext make_vulkan_context()
 	{
@@ -149,13 +174,31 @@ namespace labutils
 			throw lut::Error( "No queue family with GRAPHICS" );
 		}
 
-		ret.device = create_device( ret.physicalDevice, ret.graphicsFamilyIndex );
+		// Timeline semaphores; select_device() ensures that they are supported
+		std::vector<char const*> enabledDevExtensions;
+
+		bool timelineExtension = false;
+		detail::supports_timeline_semaphores( ret.physicalDevice, timelineExtension );
+		if( timelineExtension )
+			enabledDevExtensions.emplace_back( VK_KHR_TIMELINE_SEMAPHORE_EXTENSION_NAME );
+
+		VkPhysicalDeviceTimelineSemaphoreFeatures enabledTimeline{};
+		enabledTimeline.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_TIMELINE_SEMAPHORE_FEATURES;
+		enabledTimeline.timelineSemaphore = VK_TRUE;
+
+		ret.device = create_device( ret.physicalDevice, ret.graphicsFamilyIndex, enabledDevExtensions, &enabledTimeline );
 
 		// Retrieve VkQueue
 		vkGetDeviceQueue( ret.device, ret.graphicsFamilyIndex, 0, &ret.graphicsQueue );
 
 		assert( VK_NULL_HANDLE != ret.graphicsQueue );
 
+		// Uploads share the graphics queue
+		ret.transferFamilyIndex = ret.graphicsFamilyIndex;
+		ret.transferQueue = ret.graphicsQueue;
+
+		ret.timelines = std::make_unique<Timelines>( ret );
+
 		// Done
 		return ret;
 	}
@@ -182,7 +225,7 @@ namespace
 		return {};
 	}
 
-	VkDevice create_device( VkPhysicalDevice aPhysicalDev, std::uint32_t aQueueFamily )
+	VkDevice create_device( VkPhysicalDevice aPhysicalDev, std::uint32_t aQueueFamily, std::vector<char const*> const& aEnabledExtensions, void const* aFeatureChain )
 	{
 		float queuePriorities[1] = { 1.f };
 
@@ -197,10 +240,14 @@ namespace
 		
 		VkDeviceCreateInfo deviceInfo{};
 		deviceInfo.sType  = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+		deviceInfo.pNext  = aFeatureChain;
 
 		deviceInfo.queueCreateInfoCount  = 1;
 		deviceInfo.pQueueCreateInfos     = &queueInfo;
 
+		deviceInfo.enabledExtensionCount    = std::uint32_t(aEnabledExtensions.size());
+		deviceInfo.ppEnabledExtensionNames  = aEnabledExtensions.data();
+
 		deviceInfo.pEnabledFeatures      = &deviceFeatures;
 
 		VkDevice device = VK_NULL_HANDLE;
@@ -229,6 +276,10 @@ namespace
 		if( major < 1 || (major == 1 && minor < 1) )
 			return -1.f;
 
+		bool timelineExtension = false;
+		if( !lut::detail::supports_timeline_semaphores( aPhysicalDev, timelineExtension ) )
+			return -1.f;
+
 		// Discrete GPU > Integrated GPU > others
 		float score = 0.f;
 
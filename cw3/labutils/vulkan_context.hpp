@@ -2,8 +2,12 @@
 
 #include <volk/volk.h>
 
+#include <mutex>
+#include <memory>
 #include <cstdint>
 
+#include "timeline.hpp"
+
 namespace labutils
 {
 	class VulkanContext
@@ -28,9 +32,47 @@ namespace labutils
 			std::uint32_t graphicsFamilyIndex = 0;
 			VkQueue graphicsQueue = VK_NULL_HANDLE;
 
+			// Queue for uploads. This is a queue from a dedicated TRANSFER
+			// family if the device has one; otherwise it is the graphics queue.
+			// Resources written on a dedicated transfer queue must have their
+			// ownership transferred to the graphics family before use.
+			std::uint32_t transferFamilyIndex = 0;
+			VkQueue transferQueue = VK_NULL_HANDLE;
+
+			// Vulkan requires queues to be externally synchronized. Hold this
+			// around vkQueueSubmit(), vkQueuePresentKHR() and vkDeviceWaitIdle()
+			// when the queues (including the present queue of a VulkanWindow)
+			// may be used from several threads. Not moved with the context.
+			mutable std::mutex queueMutex;
+
+			// Guards the transfer queue if it is distinct from the graphics
+			// queue; use transfer_queue_mutex() to get the right one.
+			// vkDeviceWaitIdle() must hold both mutexes.
+			mutable std::mutex transferQueueMutex;
+
+			// True if the device supports (and has enabled) the descriptor
+			// indexing features for bindless texture arrays: sampled images
+			// that are updated after bind, partially bound and updated while
+			// unused by pending work, and arrays of them that are indexed
+			// dynamically.
+			bool descriptorIndexing = false;
+
+			// Largest drawCount of a single indirect draw: the device's limit if
+			// it supports (and has enabled) multiDrawIndirect, and 1 otherwise.
+			std::uint32_t maxDrawIndirectCount = 1;
+
+			// Timeline semaphores for the work submitted to the queues (see
+			// Timeline). Created with the device, and destroyed before it.
+			std::unique_ptr<Timelines> timelines;
 			
 			//bool haveDebugUtils = false;
 			VkDebugUtilsMessengerEXT debugMessenger = VK_NULL_HANDLE;
+
+		public:
+			// True if transferQueue is from a dedicated family, i.e., if
+			// ownership transfers are required.
+			bool has_transfer_queue() const noexcept;
+			std::mutex& transfer_queue_mutex() const noexcept;
 	};
 
 	VulkanContext make_vulkan_context();
@@ -24,11 +24,13 @@ namespace
 	float score_device( VkPhysicalDevice, VkSurfaceKHR );
 
 	std::optional<std::uint32_t> find_queue_family( VkPhysicalDevice, VkQueueFlags, VkSurfaceKHR = VK_NULL_HANDLE );
+	std::optional<std::uint32_t> find_dedicated_transfer_family( VkPhysicalDevice );
 
 	VkDevice create_device( 
 		VkPhysicalDevice,
 		std::vector<std::uint32_t> const& aQueueFamilies,
-		std::vector<char const*> const& aEnabledDeviceExtensions = {}
+		std::vector<char const*> const& aEnabledDeviceExtensions = {},
+		void const* aFeatureChain = nullptr
 	);
 
 	std::vector<VkSurfaceFormatKHR> get_surface_formats( VkPhysicalDevice, VkSurfaceKHR );
@@ -108,7 +110,7 @@ namespace labutils
 	}
 
 	// make_vulkan_window()
-	VulkanWindow make_vulkan_window()
+	VulkanWindow make_vulkan_window( bool aUseTransferQueue )
 	{
 		VulkanWindow ret;
 
@@ -238,11 +240,9 @@ namespace labutils
 		if (VK_NULL_HANDLE == ret.physicalDevice)
 			throw lut::Error("No suitable physical device found!");
 
-		{
-			VkPhysicalDeviceProperties props;
-			vkGetPhysicalDeviceProperties(ret.physicalDevice, &props);
-			std::fprintf(stderr, "Selected device: %s (%d.%d.%d)\n", props.deviceName, VK_API_VERSION_MAJOR(props.apiVersion), VK_API_VERSION_MINOR(props.apiVersion), VK_API_VERSION_PATCH(props.apiVersion));
-		}
+		VkPhysicalDeviceProperties props;
+		vkGetPhysicalDeviceProperties(ret.physicalDevice, &props);
+		std::fprintf(stderr, "Selected device: %s (%d.%d.%d)\n", props.deviceName, VK_API_VERSION_MAJOR(props.apiVersion), VK_API_VERSION_MINOR(props.apiVersion), VK_API_VERSION_PATCH(props.apiVersion));
 
 		// Create a logical device
 		// Enable required extensions. The device selection method ensures that
@@ -253,6 +253,56 @@ namespace labutils
 		//DONE: list necessary extensions here
 		enabledDevExensions.emplace_back(VK_KHR_SWAPCHAIN_EXTENSION_NAME);
 
+		// Descriptor indexing is core in Vulkan 1.2, and otherwise provided by
+		// VK_EXT_descriptor_indexing. Bindless texture arrays need descriptors
+		// that can be written while the set is bound, and arrays that are only
+		// partially written.
+		bool const indexingCore = VK_API_VERSION_MAJOR(props.apiVersion) > 1 || VK_API_VERSION_MINOR(props.apiVersion) >= 2;
+		bool const indexingExtension = !indexingCore && lut::detail::get_device_extensions(ret.physicalDevice).count(VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME);
+
+		VkPhysicalDeviceDescriptorIndexingFeatures supportedIndexing{};
+		supportedIndexing.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES;
+
+		VkPhysicalDeviceFeatures2 supportedFeatures{};
+		supportedFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+		if (indexingCore || indexingExtension)
+			supportedFeatures.pNext = &supportedIndexing;
+
+		vkGetPhysicalDeviceFeatures2(ret.physicalDevice, &supportedFeatures);
+
+		VkPhysicalDeviceDescriptorIndexingFeatures enabledIndexing{};
+		enabledIndexing.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES;
+
+		ret.descriptorIndexing = supportedFeatures.features.shaderSampledImageArrayDynamicIndexing
+			&& supportedIndexing.descriptorBindingSampledImageUpdateAfterBind
+			&& supportedIndexing.descriptorBindingPartiallyBound
+			&& supportedIndexing.descriptorBindingUpdateUnusedWhilePending;
+
+		if (ret.descriptorIndexing)
+		{
+			enabledIndexing.descriptorBindingSampledImageUpdateAfterBind = VK_TRUE;
+			enabledIndexing.descriptorBindingPartiallyBound = VK_TRUE;
+			enabledIndexing.descriptorBindingUpdateUnusedWhilePending = VK_TRUE;
+
+			if (indexingExtension)
+				enabledDevExensions.emplace_back(VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME);
+		}
+
+		// Several indirect draws per command; create_device() enables
+		// multiDrawIndirect where it is supported
+		ret.maxDrawIndirectCount = supportedFeatures.features.multiDrawIndirect ? props.limits.maxDrawIndirectCount : 1;
+
+		// Timeline semaphores; score_device() ensures that they are supported
+		bool timelineExtension = false;
+		lut::detail::supports_timeline_semaphores(ret.physicalDevice, timelineExtension);
+		if (timelineExtension)
+			enabledDevExensions.emplace_back(VK_KHR_TIMELINE_SEMAPHORE_EXTENSION_NAME);
+
+		VkPhysicalDeviceTimelineSemaphoreFeatures enabledTimeline{};
+		enabledTimeline.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_TIMELINE_SEMAPHORE_FEATURES;
+		enabledTimeline.pNext = ret.descriptorIndexing ? &enabledIndexing : nullptr;
+		enabledTimeline.timelineSemaphore = VK_TRUE;
+
 		for (auto const& ext : enabledDevExensions)
 			std::fprintf(stderr, "Enabling device extension: %s\n", ext);
 
@@ -287,7 +337,23 @@ namespace labutils
 			queueFamilyIndices.emplace_back(*present);
 		}
 
-		ret.device = create_device(ret.physicalDevice, queueFamilyIndices, enabledDevExensions);
+		// Optionally, a queue from a dedicated TRANSFER family for uploads. This
+		// is not part of queueFamilyIndices, which are shared by the swapchain
+		// images.
+		std::vector<std::uint32_t> deviceQueueFamilies = queueFamilyIndices;
+
+		ret.transferFamilyIndex = ret.graphicsFamilyIndex;
+		if (aUseTransferQueue)
+		{
+			auto const index = find_dedicated_transfer_family(ret.physicalDevice);
+			if (index && queueFamilyIndices.end() == std::find(queueFamilyIndices.begin(), queueFamilyIndices.end(), *index))
+			{
+				ret.transferFamilyIndex = *index;
+				deviceQueueFamilies.emplace_back(*index);
+			}
+		}
+
+		ret.device = create_device(ret.physicalDevice, deviceQueueFamilies, enabledDevExensions, &enabledTimeline);
 
 		// Retrieve VkQueues
 		vkGetDeviceQueue(ret.device, ret.graphicsFamilyIndex, 0, &ret.graphicsQueue);
@@ -304,6 +370,18 @@ namespace labutils
 			ret.presentQueue = ret.graphicsQueue;
 		}
 
+		if (ret.has_transfer_queue())
+		{
+			vkGetDeviceQueue(ret.device, ret.transferFamilyIndex, 0, &ret.transferQueue);
+			std::fprintf(stderr, "Using queue family %u for uploads\n", ret.transferFamilyIndex);
+		}
+		else
+		{
+			ret.transferQueue = ret.graphicsQueue;
+		}
+
+		ret.timelines = std::make_unique<lut::Timelines>(ret);
+
 		// Create swap chain
 		std::tie(ret.swapchain, ret.swapchainFormat, ret.swapchainExtent) = create_swapchain(ret.physicalDevice, ret.surface, ret.device, ret.window, queueFamilyIndices);
 
@@ -654,7 +732,28 @@ namespace
 		return {};
 	}
 
-	VkDevice create_device( VkPhysicalDevice aPhysicalDev, std::vector<std::uint32_t> const& aQueues, std::vector<char const*> const& aEnabledExtensions )
+	// Finds a queue family that supports TRANSFER, but neither GRAPHICS nor
+	// COMPUTE. Such families typically map to the DMA engines of the GPU, and
+	// can copy data concurrently to rendering.
+	std::optional<std::uint32_t> find_dedicated_transfer_family( VkPhysicalDevice aPhysicalDev )
+	{
+		std::uint32_t numQueues = 0;
+		vkGetPhysicalDeviceQueueFamilyProperties(aPhysicalDev, &numQueues, nullptr);
+
+		std::vector<VkQueueFamilyProperties> families(numQueues);
+		vkGetPhysicalDeviceQueueFamilyProperties(aPhysicalDev, &numQueues, families.data());
+
+		for (std::uint32_t i = 0; i < numQueues; ++i)
+		{
+			auto const flags = families[i].queueFlags;
+			if ((flags & VK_QUEUE_TRANSFER_BIT) && !(flags & (VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT)))
+				return i;
+		}
+
+		return {};
+	}
+
+	VkDevice create_device( VkPhysicalDevice aPhysicalDev, std::vector<std::uint32_t> const& aQueues, std::vector<char const*> const& aEnabledExtensions, void const* aFeatureChain )
 	{
 		if (aQueues.empty())
 			throw lut::Error("create_device(): no queues requested");
@@ -671,11 +770,25 @@ namespace
 			queueInfo.pQueuePriorities = queuePriorities;
 		}
 
+		VkPhysicalDeviceFeatures supportedFeatures;
+		vkGetPhysicalDeviceFeatures(aPhysicalDev, &supportedFeatures);
+
 		VkPhysicalDeviceFeatures deviceFeatures{};
 		deviceFeatures.samplerAnisotropy = VK_TRUE;
 
+		// Block-compressed textures are used where the device supports them
+		// (see load_compressed_texture2d())
+		deviceFeatures.textureCompressionBC = supportedFeatures.textureCompressionBC;
+
+		// Bindless texture arrays are indexed with a per-draw value
+		deviceFeatures.shaderSampledImageArrayDynamicIndexing = supportedFeatures.shaderSampledImageArrayDynamicIndexing;
+
+		// The G-buffer draws of a mesh are a single indirect draw, if possible
+		deviceFeatures.multiDrawIndirect = supportedFeatures.multiDrawIndirect;
+
 		VkDeviceCreateInfo deviceInfo{};
 		deviceInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+		deviceInfo.pNext = aFeatureChain;
 
 		deviceInfo.queueCreateInfoCount = std::uint32_t(queueInfos.size());
 		deviceInfo.pQueueCreateInfos = queueInfos.data();
@@ -738,6 +851,13 @@ namespace
 
 		}
 
+		// Synchronization is built on timeline semaphores (see Timeline)
+		if (bool timelineExtension = false; !lut::detail::supports_timeline_semaphores(aPhysicalDev, timelineExtension))
+		{
+			std::fprintf(stderr, "Info: Discarding device '%s': no timeline semaphores\n", props.deviceName);
+			return -1.f;
+		}
+
 		//DONE:  - check that there is a queue family that supports graphics
 		//DONE:    commands
 		if (!find_queue_family(aPhysicalDev, VK_QUEUE_GRAPHICS_BIT))
@@ -41,7 +41,10 @@ namespace labutils
 			VkExtent2D swapchainExtent;
 	};
 
-	VulkanWindow make_vulkan_window();
+	// With aUseTransferQueue, uploads go to a dedicated TRANSFER queue family
+	// if the device has one. Otherwise (or if there is no such family), they
+	// share the graphics queue.
+	VulkanWindow make_vulkan_window( bool aUseTransferQueue = true );
 
 
 	struct SwapChanges